@@ -0,0 +1,257 @@
+/**
+ * @file analysis_stage.cpp
+ * @brief Implementation of the analysis worker pool and its fan-in queues
+ * 
+ * This file contains the routing of packet records from capture threads to
+ * analysis workers and the worker loop that accounts them in the workers'
+ * dashboard shards.
+ */
+
+#include "analysis_stage.h"
+#include "dashboard.h"
+#include "stats_shard.h"
+#include <chrono>
+
+/**
+ * @brief Parses a queue policy name
+ * @param name "drop" or "block"
+ * @param policy Receives the policy
+ * @return false for an unknown name
+ */
+bool AnalysisConfig::parsePolicy(const std::string& name, QueuePolicy& policy) {
+    if (name == "drop") {
+        policy = QueuePolicy::Drop;
+    } else if (name == "block") {
+        policy = QueuePolicy::Block;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Constructor - allocates one ring per worker
+ * @param config Worker count, ring size and full-queue policy
+ */
+AnalysisQueue::AnalysisQueue(const AnalysisConfig& config)
+    : policy(config.policy), staged(config.workers), staged_count(config.workers, 0), checked(CHECKED_SLOTS, 0) {
+    for (unsigned int w = 0; w < config.workers; w++) {
+        rings.push_back(std::make_unique<SpscRing<PacketInfo>>(config.ring_capacity));
+    }
+}
+
+/**
+ * @brief Routes a batch of records to the workers (owning capture thread only)
+ * @param infos Packet records
+ * @param frames Captured frames of the records, for payload signatures (null = none)
+ * @param count Number of records
+ * @param health Capture thread counters receiving drops and waits
+ */
+void AnalysisQueue::submit(const PacketInfo* infos, const uint8_t* const* frames, size_t count,
+                           PipelineHealth& health) {
+    size_t workers = rings.size();
+    for (size_t i = 0; i < count; i++) {
+        const PacketInfo& info = infos[i];
+        bool payload = frames != nullptr && info.payload_captured != 0;
+        uint64_t source = 0;
+        uint64_t destination = 0;
+        if (workers > 1 || payload) {
+            source = endpointHash(info.source_addr, info.source_port);
+            destination = endpointHash(info.dest_addr, info.dest_port);
+        }
+        size_t worker = workers > 1 ? analysisWorkerOf(source, destination, info.protocol, workers) : 0;
+        PacketInfo& record = staged[worker][staged_count[worker]++];
+        record = info;
+        if (payload) {
+            checkPayload(record, frames[i], source, destination);
+        }
+        if (staged_count[worker] == STAGING) {
+            flush(worker, health);
+        }
+    }
+    for (size_t worker = 0; worker < workers; worker++) {
+        if (staged_count[worker] > 0) {
+            flush(worker, health);
+        }
+    }
+}
+
+/**
+ * @brief Fills a record's payload signature if its direction was not checked yet
+ * 
+ * Unlike the worker routing, the direction key tells the endpoints apart,
+ * so each direction of a connection gets its own slot.
+ * 
+ * @param record Staged record
+ * @param frame Captured frame of the record
+ * @param source Hash of the record's source endpoint
+ * @param destination Hash of the record's destination endpoint
+ */
+void AnalysisQueue::checkPayload(PacketInfo& record, const uint8_t* frame, uint64_t source, uint64_t destination) {
+    uint64_t direction = (source * 0xC2B2AE3D27D4EB4FULL + destination) ^ static_cast<uint64_t>(record.protocol);
+    direction *= 0xFF51AFD7ED558CCDULL;
+    uint32_t tag = static_cast<uint32_t>(direction >> 32) | 1;
+    uint32_t& slot = checked[direction & (CHECKED_SLOTS - 1)];
+    if (slot == tag) {
+        return;
+    }
+    slot = tag;
+    record.payload_app = payloadSignature(record.protocol == Protocol::TCP, frame + record.payload_offset,
+                                          record.payload_captured);
+}
+
+/**
+ * @brief Pushes the staged records of one worker
+ * 
+ * With the drop policy whatever does not fit is counted and discarded. With
+ * the block policy the capture thread yields until the worker catches up,
+ * which leaves the backlog in the kernel ring, where it is counted as
+ * kernel drops if it overflows.
+ * 
+ * @param worker Worker index
+ * @param health Capture thread counters receiving drops and waits
+ */
+void AnalysisQueue::flush(size_t worker, PipelineHealth& health) {
+    const PacketInfo* records = staged[worker].data();
+    size_t remaining = staged_count[worker];
+    staged_count[worker] = 0;
+    
+    size_t pushed = rings[worker]->push(records, remaining);
+    if (pushed == remaining) {
+        return;
+    }
+    if (policy == QueuePolicy::Drop) {
+        health.queue_dropped += remaining - pushed;
+        return;
+    }
+    health.queue_waits++;
+    while (pushed < remaining) {
+        std::this_thread::yield();
+        pushed += rings[worker]->push(records + pushed, remaining - pushed);
+    }
+}
+
+/**
+ * @brief Constructor - creates the worker shards
+ * @param dash Dashboard the workers account into
+ * @param analysis Worker count, ring size and full-queue policy
+ */
+AnalysisStage::AnalysisStage(std::shared_ptr<Dashboard> dash, const AnalysisConfig& analysis)
+    : dashboard(dash), config(analysis), stopping(false) {
+    for (unsigned int w = 0; w < config.workers; w++) {
+        StatsShard* shard = dashboard->createShard();
+        // Worker health is reported as the analysis stage, not under an interface
+        shard->health().interface_index = ANALYSIS_HEALTH_INDEX;
+        shards.push_back(shard);
+    }
+}
+
+/**
+ * @brief Destructor - stops the workers
+ */
+AnalysisStage::~AnalysisStage() {
+    stop();
+}
+
+/**
+ * @brief Starts the worker threads
+ */
+void AnalysisStage::start() {
+    for (size_t w = 0; w < shards.size(); w++) {
+        threads.emplace_back(&AnalysisStage::run, this, w);
+    }
+}
+
+/**
+ * @brief Accounts everything queued so far and stops the workers
+ */
+void AnalysisStage::stop() {
+    stopping.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    threads.clear();
+}
+
+/**
+ * @brief Creates the queues of one capture thread
+ * @return Pointer to the new queues
+ */
+AnalysisQueue* AnalysisStage::createQueue() {
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    queues.push_back(std::make_unique<AnalysisQueue>(config));
+    return queues.back().get();
+}
+
+/**
+ * @brief Creates the health-only shard of one capture thread
+ * @return Shard owned by the dashboard
+ */
+StatsShard* AnalysisStage::createHealthShard() {
+    return dashboard->createHealthShard();
+}
+
+/**
+ * @brief Worker thread: drains its rings until stop() and the rings are empty
+ * 
+ * An idle worker yields for a while before it starts sleeping a millisecond
+ * at a time, so a short lull does not leave records waiting for a whole
+ * sleep while a quiet link costs almost nothing.
+ * 
+ * @param worker Worker index
+ */
+void AnalysisStage::run(size_t worker) {
+    constexpr unsigned int IDLE_SPINS = 256;
+    StatsShard* shard = shards[worker];
+    PipelineHealth& health = shard->health();
+    std::vector<PacketInfo> batch(DRAIN_BATCH);
+    std::vector<AnalysisQueue*> drain_list;   // Worker's copy of queues
+    unsigned int idle_rounds = 0;
+    
+    while (true) {
+        // Read the flag first: records submitted before stop() are then always accounted
+        bool stop_requested = stopping.load(std::memory_order_acquire);
+        {
+            std::lock_guard<std::mutex> lock(queues_mutex);
+            if (drain_list.size() != queues.size()) {
+                drain_list.clear();
+                for (const auto& queue : queues) {
+                    drain_list.push_back(queue.get());
+                }
+            }
+        }
+        
+        size_t total = 0;
+        for (AnalysisQueue* queue : drain_list) {
+            // Bounded per queue so one busy capture thread cannot starve the others
+            size_t count = queue->ring(worker).pop(batch.data(), batch.size());
+            if (count == 0) {
+                continue;
+            }
+            // The frames were released with their capture batch; the records carry their signatures
+            uint64_t start_ns = monotonicNs();
+            shard->updateBatch(batch.data(), count, start_ns);
+            health.update.record(monotonicNs() - start_ns);
+            health.processed += count;
+            health.batches++;
+            total += count;
+        }
+        
+        if (total > 0) {
+            idle_rounds = 0;
+            continue;
+        }
+        if (stop_requested) {
+            break;
+        }
+        shard->poll();   // Idle: still answer pending snapshot requests
+        if (++idle_rounds < IDLE_SPINS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    shard->publish();
+}
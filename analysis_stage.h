@@ -0,0 +1,242 @@
+/**
+ * @file analysis_stage.h
+ * @brief Fan-in queues between capture threads and a pool of analysis workers
+ * 
+ * This header defines the AnalysisStage class, which moves statistics work
+ * off the capture threads: capture threads only decode packets and push
+ * their records into queues, and a configurable number of analysis workers
+ * do the flow tracking, host aggregation and sketches. Records are routed by
+ * a hash of the connection that does not depend on the direction, so every
+ * packet of a connection reaches the same worker and flow state needs no
+ * locks.
+ */
+
+#ifndef ANALYSIS_STAGE_H
+#define ANALYSIS_STAGE_H
+
+#include <atomic>
+#include <array>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include "network_monitor.h"
+#include "spsc_ring.h"
+#include "flow_table.h"
+
+class Dashboard;
+class StatsShard;
+
+/**
+ * @enum QueuePolicy
+ * @brief What a capture thread does when an analysis queue is full
+ */
+enum class QueuePolicy : uint8_t {
+    Drop,     ///< Discard the records that do not fit and count them
+    Block     ///< Wait for the worker to make room (backpressure into the capture ring)
+};
+
+/**
+ * @struct AnalysisConfig
+ * @brief Size of the analysis worker pool and its queues
+ */
+struct AnalysisConfig {
+    unsigned int workers = 0;           ///< Analysis threads (0 = capture threads account their own packets)
+    size_t ring_capacity = 16384;       ///< Records buffered per capture thread and worker
+    QueuePolicy policy = QueuePolicy::Drop;
+    
+    /**
+     * @brief Parses a queue policy name
+     * @param name "drop" or "block"
+     * @param policy Receives the policy
+     * @return false for an unknown name
+     */
+    static bool parsePolicy(const std::string& name, QueuePolicy& policy);
+};
+
+/**
+ * @brief Hashes one endpoint of a packet
+ * @param addr Address bytes
+ * @param port Port number
+ * @return Hash of the address and port
+ */
+inline uint64_t endpointHash(const uint8_t (&addr)[16], uint16_t port) {
+    return hashKeyBytes(addr, sizeof(addr)) ^ (port * 0x9E3779B97F4A7C15ULL);
+}
+
+/**
+ * @brief Chooses the analysis worker of a packet from its endpoint hashes
+ * 
+ * The two endpoints are combined with XOR, so both directions of a
+ * connection pick the same worker.
+ * 
+ * @param source Hash of the source endpoint (endpointHash())
+ * @param destination Hash of the destination endpoint
+ * @param protocol Transport protocol
+ * @param workers Number of workers
+ * @return Worker index below workers
+ */
+inline size_t analysisWorkerOf(uint64_t source, uint64_t destination, Protocol protocol, size_t workers) {
+    uint64_t hash = (source ^ destination ^ static_cast<uint64_t>(protocol)) * 0xFF51AFD7ED558CCDULL;
+    return static_cast<size_t>((hash >> 32) % workers);
+}
+
+/**
+ * @brief Chooses the analysis worker of a packet
+ * @param info Packet record
+ * @param workers Number of workers
+ * @return Worker index below workers
+ */
+inline size_t analysisWorkerOf(const PacketInfo& info, size_t workers) {
+    return analysisWorkerOf(endpointHash(info.source_addr, info.source_port),
+                            endpointHash(info.dest_addr, info.dest_port), info.protocol, workers);
+}
+
+/**
+ * @class AnalysisQueue
+ * @brief The queues of one capture thread, one single-producer ring per worker
+ * 
+ * Records are staged per worker and pushed in runs, so routing a batch
+ * costs one hash per packet plus a few ring operations per worker.
+ * 
+ * The workers never see the frames, so the queue also checks the first
+ * payload of each connection direction against the application signatures
+ * and stores the result in the record. A small direct-mapped table of
+ * directions already checked keeps later payloads from being classified;
+ * a direction that lost its slot may be checked again, which the workers'
+ * shards ignore.
+ */
+class AnalysisQueue {
+public:
+    /**
+     * @brief Constructor - allocates one ring per worker
+     * @param config Worker count, ring size and full-queue policy
+     */
+    explicit AnalysisQueue(const AnalysisConfig& config);
+    
+    AnalysisQueue(const AnalysisQueue&) = delete;
+    AnalysisQueue& operator=(const AnalysisQueue&) = delete;
+    
+    /**
+     * @brief Routes a batch of records to the workers (owning capture thread only)
+     * @param infos Packet records
+     * @param frames Captured frames of the records, for payload signatures (null = none)
+     * @param count Number of records
+     * @param health Capture thread counters receiving drops and waits
+     */
+    void submit(const PacketInfo* infos, const uint8_t* const* frames, size_t count, PipelineHealth& health);
+    
+    /**
+     * @brief Gets the ring feeding one worker
+     * @param worker Worker index
+     * @return The worker's ring from this capture thread
+     */
+    SpscRing<PacketInfo>& ring(size_t worker) { return *rings[worker]; }
+
+private:
+    /// Records staged per worker before a push
+    static constexpr size_t STAGING = 64;
+    /// Slots of the table of connection directions whose first payload was checked
+    static constexpr size_t CHECKED_SLOTS = 4096;
+    
+    QueuePolicy policy;
+    std::vector<std::unique_ptr<SpscRing<PacketInfo>>> rings;
+    std::vector<std::array<PacketInfo, STAGING>> staged;
+    std::vector<size_t> staged_count;
+    std::vector<uint32_t> checked;    ///< Tag of the direction last checked per slot (0 = none)
+    
+    /**
+     * @brief Fills a record's payload signature if its direction was not checked yet
+     * @param record Staged record
+     * @param frame Captured frame of the record
+     * @param source Hash of the record's source endpoint
+     * @param destination Hash of the record's destination endpoint
+     */
+    void checkPayload(PacketInfo& record, const uint8_t* frame, uint64_t source, uint64_t destination);
+    
+    /**
+     * @brief Pushes the staged records of one worker
+     * @param worker Worker index
+     * @param health Capture thread counters receiving drops and waits
+     */
+    void flush(size_t worker, PipelineHealth& health);
+};
+
+/**
+ * @class AnalysisStage
+ * @brief Pool of analysis workers fed by the capture threads' queues
+ * 
+ * Each worker owns one dashboard shard and drains its ring of every capture
+ * thread in turn. Capture threads keep a shard of their own for their
+ * health counters only.
+ */
+class AnalysisStage {
+public:
+    /**
+     * @brief Constructor - creates the worker shards
+     * @param dashboard Dashboard the workers account into
+     * @param config Worker count, ring size and full-queue policy
+     */
+    AnalysisStage(std::shared_ptr<Dashboard> dashboard, const AnalysisConfig& config);
+    
+    /**
+     * @brief Destructor - stops the workers
+     */
+    ~AnalysisStage();
+    
+    AnalysisStage(const AnalysisStage&) = delete;
+    AnalysisStage& operator=(const AnalysisStage&) = delete;
+    
+    /**
+     * @brief Starts the worker threads
+     */
+    void start();
+    
+    /**
+     * @brief Accounts everything queued so far and stops the workers
+     * 
+     * Call after the capture threads have stopped submitting. Every worker
+     * publishes its final snapshot before this returns.
+     */
+    void stop();
+    
+    /**
+     * @brief Creates the queues of one capture thread
+     * 
+     * Safe to call while the workers are running. The queues are owned by
+     * the stage.
+     * 
+     * @return Pointer to the new queues
+     */
+    AnalysisQueue* createQueue();
+    
+    /**
+     * @brief Creates the health-only shard of one capture thread
+     * @return Shard owned by the dashboard
+     */
+    StatsShard* createHealthShard();
+    
+    /** @brief Number of analysis workers */
+    size_t workerCount() const { return shards.size(); }
+
+private:
+    /// Records moved out of a ring per drain step
+    static constexpr size_t DRAIN_BATCH = 256;
+    
+    std::shared_ptr<Dashboard> dashboard;
+    AnalysisConfig config;
+    std::vector<StatsShard*> shards;           ///< One per worker, owned by the dashboard
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::mutex queues_mutex;                   ///< Guards queues while they are created
+    std::vector<std::unique_ptr<AnalysisQueue>> queues;
+    
+    /**
+     * @brief Worker thread: drains its rings until stop() and the rings are empty
+     * @param worker Worker index
+     */
+    void run(size_t worker);
+};
+
+#endif // ANALYSIS_STAGE_H
@@ -0,0 +1,223 @@
+/**
+ * @file app_classifier.h
+ * @brief Application-layer protocol classification
+ * 
+ * This header defines the AppProtocol identifiers and the classifier
+ * StatsShard applies when a connection starts: a constexpr table of
+ * well-known ports, looked up on a connection's first packet, and a few
+ * signature checks on the first payload bytes of each direction (TLS
+ * handshakes, HTTP, SSH, QUIC long headers and DNS). Later packets are not
+ * classified.
+ */
+
+#ifndef APP_CLASSIFIER_H
+#define APP_CLASSIFIER_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @enum AppProtocol
+ * @brief Application protocol identifier
+ * 
+ * Stored as a single byte in flow entries and records; use
+ * appProtocolName() to obtain the display string.
+ */
+enum class AppProtocol : uint8_t {
+    Unknown = 0,
+    DNS,
+    HTTP,
+    TLS,
+    QUIC,
+    SSH,
+    DHCP,
+    NTP,
+    SNMP,
+    SMTP,
+    IMAP,
+    POP3,
+    FTP,
+    SMB,
+    RDP,
+    Count          ///< Number of application identifiers (not a protocol)
+};
+
+/// Number of distinct AppProtocol values, usable as an array bound
+constexpr size_t APP_PROTOCOL_COUNT = static_cast<size_t>(AppProtocol::Count);
+
+/**
+ * @brief Gets the display name of an application protocol
+ * @param protocol Application identifier
+ * @return Name such as "DNS" or "TLS"
+ */
+inline const char* appProtocolName(AppProtocol protocol) {
+    static const char* const NAMES[APP_PROTOCOL_COUNT] = {
+        "Unknown", "DNS", "HTTP", "TLS", "QUIC", "SSH", "DHCP", "NTP", "SNMP", "SMTP", "IMAP", "POP3", "FTP",
+        "SMB", "RDP"
+    };
+    size_t index = static_cast<size_t>(protocol);
+    return index < APP_PROTOCOL_COUNT ? NAMES[index] : "?";
+}
+
+/**
+ * @brief Maps TCP and UDP ports to the application served on them without branching
+ * 
+ * One byte per port and transport (128 KiB in total), built at compile time.
+ */
+struct AppPortTable {
+    std::array<AppProtocol, 65536> tcp{};
+    std::array<AppProtocol, 65536> udp{};
+    
+    constexpr AppPortTable() {
+        tcp[53] = AppProtocol::DNS;
+        udp[53] = AppProtocol::DNS;
+        udp[5353] = AppProtocol::DNS;      // Multicast DNS
+        tcp[853] = AppProtocol::TLS;       // DNS over TLS
+        tcp[80] = AppProtocol::HTTP;
+        tcp[8080] = AppProtocol::HTTP;
+        tcp[8000] = AppProtocol::HTTP;
+        tcp[443] = AppProtocol::TLS;
+        tcp[8443] = AppProtocol::TLS;
+        tcp[465] = AppProtocol::TLS;       // SMTP over TLS
+        tcp[993] = AppProtocol::TLS;       // IMAP over TLS
+        tcp[995] = AppProtocol::TLS;       // POP3 over TLS
+        udp[443] = AppProtocol::QUIC;
+        tcp[22] = AppProtocol::SSH;
+        udp[67] = AppProtocol::DHCP;
+        udp[68] = AppProtocol::DHCP;
+        udp[546] = AppProtocol::DHCP;      // DHCPv6
+        udp[547] = AppProtocol::DHCP;
+        udp[123] = AppProtocol::NTP;
+        udp[161] = AppProtocol::SNMP;
+        udp[162] = AppProtocol::SNMP;
+        tcp[25] = AppProtocol::SMTP;
+        tcp[587] = AppProtocol::SMTP;
+        tcp[143] = AppProtocol::IMAP;
+        tcp[110] = AppProtocol::POP3;
+        tcp[20] = AppProtocol::FTP;
+        tcp[21] = AppProtocol::FTP;
+        tcp[445] = AppProtocol::SMB;
+        tcp[139] = AppProtocol::SMB;
+        tcp[3389] = AppProtocol::RDP;
+        udp[3389] = AppProtocol::RDP;
+    }
+};
+
+/// Port table shared by every shard
+inline constexpr AppPortTable APP_PORTS;
+
+/**
+ * @brief Packs four characters into a big-endian word for signature compares
+ * @param text Four characters (plus the terminator)
+ * @return The characters as they appear in a payload, read big-endian
+ */
+constexpr uint32_t signatureWord(const char (&text)[5]) {
+    return (static_cast<uint32_t>(static_cast<uint8_t>(text[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(text[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(text[2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(text[3]));
+}
+
+/**
+ * @brief Recognizes an application from the start of a TCP payload
+ * 
+ * Looks for a TLS handshake record carrying a ClientHello or ServerHello,
+ * an HTTP request method or status line, and an SSH version banner. These
+ * open every connection of their protocol, so the first data segment of
+ * each direction decides.
+ * 
+ * @param payload First captured payload bytes
+ * @param length Number of captured payload bytes
+ * @return Matched application, or AppProtocol::Unknown
+ */
+inline AppProtocol tcpSignature(const uint8_t* payload, size_t length) {
+    if (length < 4) {
+        return AppProtocol::Unknown;
+    }
+    // TLS record: handshake (22), version 3.x, then the handshake type after the 5-byte record header
+    if (payload[0] == 0x16 && payload[1] == 0x03 && payload[2] <= 0x04) {
+        return length >= 6 && (payload[5] == 0x01 || payload[5] == 0x02) ? AppProtocol::TLS : AppProtocol::Unknown;
+    }
+    uint32_t word = (static_cast<uint32_t>(payload[0]) << 24) | (static_cast<uint32_t>(payload[1]) << 16) |
+                    (static_cast<uint32_t>(payload[2]) << 8) | payload[3];
+    switch (word) {
+        case signatureWord("GET "):
+        case signatureWord("POST"):
+        case signatureWord("HEAD"):
+        case signatureWord("PUT "):
+        case signatureWord("DELE"):
+        case signatureWord("OPTI"):
+        case signatureWord("PATC"):
+        case signatureWord("CONN"):
+        case signatureWord("HTTP"):
+            return AppProtocol::HTTP;
+        case signatureWord("SSH-"):
+            return AppProtocol::SSH;
+        default:
+            return AppProtocol::Unknown;
+    }
+}
+
+/**
+ * @brief Recognizes an application from the start of a UDP payload
+ * 
+ * QUIC long headers (sent until the handshake completes) carry a version
+ * word; v1, v2 and the IETF drafts are accepted. A DNS message is accepted
+ * when its header holds one question, a standard opcode and a zero
+ * reserved bit, and the question name starts with a valid label length.
+ * 
+ * @param payload First captured payload bytes
+ * @param length Number of captured payload bytes
+ * @return Matched application, or AppProtocol::Unknown
+ */
+inline AppProtocol udpSignature(const uint8_t* payload, size_t length) {
+    if (length >= 5 && (payload[0] & 0xC0) == 0xC0) {
+        uint32_t version = (static_cast<uint32_t>(payload[1]) << 24) | (static_cast<uint32_t>(payload[2]) << 16) |
+                           (static_cast<uint32_t>(payload[3]) << 8) | payload[4];
+        if (version == 0x00000001 || version == 0x6B3343CF || (version & 0xFFFFFF00) == 0xFF000000) {
+            return AppProtocol::QUIC;
+        }
+    }
+    if (length >= 17) {
+        unsigned int opcode = (payload[2] >> 3) & 0x0F;
+        unsigned int questions = (static_cast<unsigned int>(payload[4]) << 8) | payload[5];
+        if (opcode == 0 && (payload[3] & 0x40) == 0 && questions == 1 && payload[12] <= 63) {
+            return AppProtocol::DNS;
+        }
+    }
+    return AppProtocol::Unknown;
+}
+
+/**
+ * @brief Recognizes an application from the start of a TCP or UDP payload
+ * @param tcp true for TCP, false for UDP
+ * @param payload First captured payload bytes (may be null if length is 0)
+ * @param length Number of captured payload bytes
+ * @return Matched application, or AppProtocol::Unknown
+ */
+inline AppProtocol payloadSignature(bool tcp, const uint8_t* payload, size_t length) {
+    if (length == 0) {
+        return AppProtocol::Unknown;
+    }
+    return tcp ? tcpSignature(payload, length) : udpSignature(payload, length);
+}
+
+/**
+ * @brief Guesses an application from a connection's ports
+ * 
+ * The destination port is looked up first, then the source port, so
+ * responses from a well-known port map the same way as the requests.
+ * 
+ * @param tcp true for TCP, false for UDP
+ * @param source_port Source port
+ * @param dest_port Destination port
+ * @return Application served on either port, or AppProtocol::Unknown
+ */
+inline AppProtocol portApplication(bool tcp, uint16_t source_port, uint16_t dest_port) {
+    const std::array<AppProtocol, 65536>& ports = tcp ? APP_PORTS.tcp : APP_PORTS.udp;
+    AppProtocol guess = ports[dest_port];
+    return guess != AppProtocol::Unknown ? guess : ports[source_port];
+}
+
+#endif // APP_CLASSIFIER_H
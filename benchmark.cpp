@@ -0,0 +1,530 @@
+/**
+ * @file benchmark.cpp
+ * @brief Throughput benchmark for the packet parse and statistics path
+ * 
+ * Feeds synthetic packet streams (and optionally a recorded capture file)
+ * through NetworkMonitor, StatsShard and the flow table without a network
+ * interface, and reports packets/s, ns/packet, heap allocations per packet
+ * and, where perf events are available, cache misses per packet.
+ * 
+ * Every scenario uses a fixed random seed, so runs are reproducible and
+ * results can be compared between builds.
+ */
+
+#include "network_monitor.h"
+#include "dashboard.h"
+#include "stats_shard.h"
+#include "flow_table.h"
+#include "file_backend.h"
+#include "analysis_stage.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+// Heap allocation counter, incremented by the replaced global operator new
+static std::atomic<uint64_t> allocation_count(0);
+
+void* operator new(std::size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+/**
+ * @class CacheMissCounter
+ * @brief User-space hardware cache miss counter (Linux perf events)
+ */
+class CacheMissCounter {
+public:
+    CacheMissCounter() : fd(-1) {
+#ifdef __linux__
+        struct perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+    }
+    
+    ~CacheMissCounter() {
+#ifdef __linux__
+        if (fd >= 0) {
+            close(fd);
+        }
+#endif
+    }
+    
+    bool available() const { return fd >= 0; }
+    
+    void start() {
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+    
+    uint64_t stop() {
+        uint64_t value = 0;
+#ifdef __linux__
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(fd, &value, sizeof(value)) != static_cast<ssize_t>(sizeof(value))) {
+                value = 0;
+            }
+        }
+#endif
+        return value;
+    }
+
+private:
+    int fd;
+};
+
+/**
+ * @brief Traffic mix of a synthetic stream
+ */
+enum class Mix {
+    Tcp,     ///< TCP only
+    Udp,     ///< UDP only
+    Mixed    ///< 60% TCP, 30% UDP, 10% ICMP
+};
+
+const char* mixName(Mix mix) {
+    switch (mix) {
+        case Mix::Tcp: return "tcp";
+        case Mix::Udp: return "udp";
+        default:       return "mixed";
+    }
+}
+
+/// Bytes per generated frame (Ethernet + IPv4 + TCP headers)
+constexpr size_t FRAME_SIZE = 64;
+
+/**
+ * @struct Stream
+ * @brief Pre-generated frames and the order in which they are replayed
+ */
+struct Stream {
+    std::vector<u_char> frames;          ///< One frame per flow, FRAME_SIZE bytes each
+    std::vector<uint32_t> order;         ///< Flow index of every packet in the cycle
+    std::vector<uint32_t> lengths;       ///< Wire length of every packet in the cycle
+};
+
+/**
+ * @brief Builds a synthetic stream with the given flow count and mix
+ * @param flows Number of distinct 5-tuples
+ * @param mix Protocol mix
+ * @param cycle Packets in one cycle of the replay order
+ * @return Generated stream
+ */
+Stream makeStream(uint32_t flows, Mix mix, size_t cycle) {
+    std::mt19937 rng(12345);
+    Stream stream;
+    stream.frames.assign(static_cast<size_t>(flows) * FRAME_SIZE, 0);
+    for (uint32_t f = 0; f < flows; f++) {
+        u_char* frame = stream.frames.data() + static_cast<size_t>(f) * FRAME_SIZE;
+        frame[12] = 0x08;                      // EtherType IPv4
+        u_char* ip = frame + 14;
+        ip[0] = 0x45;
+        uint8_t protocol = IPPROTO_TCP;
+        if (mix == Mix::Udp) {
+            protocol = IPPROTO_UDP;
+        } else if (mix == Mix::Mixed) {
+            uint32_t pick = rng() % 10;
+            protocol = pick < 6 ? IPPROTO_TCP : (pick < 9 ? IPPROTO_UDP : IPPROTO_ICMP);
+        }
+        ip[9] = protocol;
+        ip[12] = 10;                           // Source 10.x.y.z from the flow index
+        ip[13] = static_cast<u_char>(f >> 16);
+        ip[14] = static_cast<u_char>(f >> 8);
+        ip[15] = static_cast<u_char>(f);
+        ip[16] = 192;                          // Destination 192.168.0.1
+        ip[17] = 168;
+        ip[19] = 1;
+        u_char* l4 = ip + 20;
+        uint16_t source_port = static_cast<uint16_t>(1024 + (f % 60000));
+        l4[0] = static_cast<u_char>(source_port >> 8);
+        l4[1] = static_cast<u_char>(source_port);
+        l4[2] = 0x01;                          // Destination port 443
+        l4[3] = 0xBB;
+    }
+    
+    std::uniform_int_distribution<uint32_t> flow_pick(0, flows - 1);
+    std::uniform_int_distribution<uint32_t> length_pick(64, 1514);
+    stream.order.resize(cycle);
+    stream.lengths.resize(cycle);
+    for (size_t i = 0; i < cycle; i++) {
+        stream.order[i] = flow_pick(rng);
+        stream.lengths[i] = length_pick(rng);
+    }
+    return stream;
+}
+
+/**
+ * @class SyntheticBackend
+ * @brief Capture backend replaying a pre-generated stream from memory
+ * 
+ * Batches point into the stream's frames, like the zero-copy ring backend,
+ * so the measured cost is the processing path alone.
+ */
+class SyntheticBackend : public CaptureBackend {
+public:
+    SyntheticBackend(const Stream& s, uint64_t packets)
+        : stream(s), remaining(packets), cursor(0), timestamp_us(0) {
+    }
+    
+    bool open(const std::string&, const CaptureConfig&, std::string&) override { return true; }
+    
+    int dispatch(int max_packets, BatchHandler handler, void* user) override {
+        if (remaining == 0) {
+            return -1;
+        }
+        size_t count = PacketBatch::CAPACITY;
+        if (remaining < count) {
+            count = static_cast<size_t>(remaining);
+        }
+        if (max_packets >= 0 && static_cast<size_t>(max_packets) < count) {
+            count = static_cast<size_t>(max_packets);
+        }
+        for (size_t i = 0; i < count; i++) {
+            struct pcap_pkthdr& pkthdr = batch.headers[i];
+            timestamp_us++;
+            pkthdr.ts.tv_sec = static_cast<decltype(pkthdr.ts.tv_sec)>(timestamp_us / 1000000);
+            pkthdr.ts.tv_usec = static_cast<decltype(pkthdr.ts.tv_usec)>(timestamp_us % 1000000);
+            pkthdr.caplen = FRAME_SIZE;
+            pkthdr.len = stream.lengths[cursor];
+            batch.packets[i] = stream.frames.data() + static_cast<size_t>(stream.order[cursor]) * FRAME_SIZE;
+            if (++cursor == stream.order.size()) {
+                cursor = 0;
+            }
+        }
+        batch.count = count;
+        handler(user, batch);
+        remaining -= count;
+        return static_cast<int>(count);
+    }
+    
+    void breakLoop() override { remaining = 0; }
+    bool stats(CaptureStats&) override { return false; }
+    int datalink() const override { return DLT_EN10MB; }
+    const char* name() const override { return "synthetic"; }
+
+private:
+    const Stream& stream;
+    uint64_t remaining;
+    size_t cursor;
+    uint64_t timestamp_us;
+    PacketBatch batch;
+};
+
+/**
+ * @struct Measurement
+ * @brief Cost of one benchmark run
+ */
+struct Measurement {
+    uint64_t packets = 0;
+    uint64_t elapsed_ns = 0;
+    uint64_t allocations = 0;
+    uint64_t cache_misses = 0;
+};
+
+CacheMissCounter cache_counter;
+
+/**
+ * @brief Times a callable that processes a number of packets
+ * @param body Work to measure, returning the packets it processed
+ * @return Measured costs
+ */
+template <typename Body>
+Measurement measure(Body body) {
+    Measurement m;
+    uint64_t allocations = allocation_count.load(std::memory_order_relaxed);
+    cache_counter.start();
+    auto start = std::chrono::steady_clock::now();
+    m.packets = body();
+    auto stop = std::chrono::steady_clock::now();
+    m.cache_misses = cache_counter.stop();
+    m.allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+    m.elapsed_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count());
+    return m;
+}
+
+void printHeader() {
+    std::cout << std::left << std::setw(34) << "Scenario" << std::right
+              << std::setw(12) << "Packets" << std::setw(10) << "Mpps" << std::setw(10) << "ns/pkt"
+              << std::setw(13) << "allocs/pkt" << std::setw(14) << "misses/pkt" << std::endl;
+    std::cout << std::string(93, '-') << std::endl;
+}
+
+void printRow(const std::string& scenario, const Measurement& m) {
+    double packets = m.packets > 0 ? static_cast<double>(m.packets) : 1.0;
+    double seconds = static_cast<double>(m.elapsed_ns) / 1e9;
+    std::cout << std::left << std::setw(34) << scenario << std::right
+              << std::setw(12) << m.packets
+              << std::setw(10) << std::fixed << std::setprecision(2) << (seconds > 0 ? packets / seconds / 1e6 : 0.0)
+              << std::setw(10) << std::setprecision(1) << static_cast<double>(m.elapsed_ns) / packets
+              << std::setw(13) << std::setprecision(4) << static_cast<double>(m.allocations) / packets;
+    if (cache_counter.available()) {
+        std::cout << std::setw(14) << std::setprecision(2) << static_cast<double>(m.cache_misses) / packets;
+    } else {
+        std::cout << std::setw(14) << "n/a";
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * @brief Runs packets through NetworkMonitor into a dashboard shard
+ * @param name Scenario label
+ * @param backend Packet source
+ * @param flow_config Flow table settings
+ * @param packets Packets to process (-1 until the backend ends)
+ */
+void runPipeline(const std::string& name, std::unique_ptr<CaptureBackend> backend,
+                 const FlowTableConfig& flow_config, int packets) {
+    auto dashboard = std::make_shared<Dashboard>(flow_config);
+    NetworkMonitor monitor(name, std::move(backend), true);
+    monitor.setDashboard(dashboard);
+    Measurement m = measure([&]() {
+        monitor.startCapture(packets);
+        return monitor.packetsProcessed();
+    });
+    printRow(name, m);
+}
+
+/**
+ * @brief Runs packets through NetworkMonitor into analysis workers
+ * 
+ * The capture thread only decodes and queues; the run ends once the workers
+ * have accounted every packet. Queues block when full, so nothing is lost
+ * and the rate is that of the slower side.
+ * 
+ * @param name Scenario label
+ * @param backend Packet source
+ * @param flow_config Flow table settings
+ * @param workers Analysis workers
+ * @param packets Packets to process
+ */
+void runFanIn(const std::string& name, std::unique_ptr<CaptureBackend> backend,
+              const FlowTableConfig& flow_config, unsigned int workers, int packets) {
+    auto dashboard = std::make_shared<Dashboard>(flow_config);
+    AnalysisConfig config;
+    config.workers = workers;
+    config.policy = QueuePolicy::Block;
+    auto stage = std::make_shared<AnalysisStage>(dashboard, config);
+    NetworkMonitor monitor(name, std::move(backend), true);
+    monitor.setAnalysisStage(stage);
+    Measurement m = measure([&]() {
+        stage->start();
+        monitor.startCapture(packets);
+        stage->stop();
+        return monitor.packetsProcessed();
+    });
+    printRow(name, m);
+}
+
+/**
+ * @brief Runs pre-parsed packet records through StatsShard::updateBatch()
+ * @param name Scenario label
+ * @param stream Synthetic stream to derive records from
+ * @param flow_config Flow table settings
+ * @param packets Packets to account
+ */
+void runStats(const std::string& name, const Stream& stream, const FlowTableConfig& flow_config, uint64_t packets) {
+    std::vector<PacketInfo> infos(stream.order.size());
+    for (size_t i = 0; i < infos.size(); i++) {
+        PacketInfo& info = infos[i];
+        std::memset(&info, 0, sizeof(info));
+        const u_char* frame = stream.frames.data() + static_cast<size_t>(stream.order[i]) * FRAME_SIZE;
+        std::memcpy(info.source_addr, frame + 26, 4);
+        std::memcpy(info.dest_addr, frame + 30, 4);
+        info.source_port = static_cast<uint16_t>((frame[34] << 8) | frame[35]);
+        info.dest_port = static_cast<uint16_t>((frame[36] << 8) | frame[37]);
+        info.protocol = frame[23] == IPPROTO_TCP ? Protocol::TCP
+                      : frame[23] == IPPROTO_UDP ? Protocol::UDP : Protocol::ICMP;
+        info.ip_version = 4;
+        info.length = stream.lengths[i];
+        info.timestamp_ns = (i + 1) * 1000ULL;
+    }
+    StatsShard shard(flow_config);
+    Measurement m = measure([&]() {
+        uint64_t done = 0;
+        size_t cursor = 0;
+        while (done < packets) {
+            size_t count = std::min<size_t>(PacketBatch::CAPACITY, infos.size() - cursor);
+            count = std::min<uint64_t>(count, packets - done);
+            shard.updateBatch(infos.data() + cursor, count, monotonicNs());
+            cursor = (cursor + count) % infos.size();
+            done += count;
+        }
+        return done;
+    });
+    printRow(name, m);
+}
+
+/**
+ * @brief Runs connection keys through FlowTable::findOrInsert() alone
+ * @param name Scenario label
+ * @param stream Synthetic stream to derive keys from
+ * @param flow_config Flow table settings
+ * @param packets Lookups to perform
+ */
+void runFlowTable(const std::string& name, const Stream& stream, const FlowTableConfig& flow_config,
+                  uint64_t packets) {
+    std::vector<ConnectionInfo> keys(stream.order.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        ConnectionInfo& key = keys[i];
+        std::memset(&key, 0, sizeof(key));
+        const u_char* frame = stream.frames.data() + static_cast<size_t>(stream.order[i]) * FRAME_SIZE;
+        std::memcpy(key.source_addr, frame + 26, 4);
+        std::memcpy(key.dest_addr, frame + 30, 4);
+        key.source_port = static_cast<uint16_t>((frame[34] << 8) | frame[35]);
+        key.protocol = Protocol::TCP;
+        key.ip_version = 4;
+    }
+    ConnectionTable table(flow_config);
+    Measurement m = measure([&]() {
+        for (uint64_t i = 0; i < packets; i++) {
+            table.findOrInsert(keys[i % keys.size()], (i + 1) * 1000ULL).counters.packets++;
+        }
+        return packets;
+    });
+    printRow(name, m);
+}
+
+void showHelp() {
+    std::cout << "Network Analyzer benchmark - parse and statistics throughput without a NIC" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  ./benchmark [OPTIONS]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --packets <n>          Packets per scenario (default: 5000000)" << std::endl;
+    std::cout << "  --max-flows <n>        Flow table capacity (default: 65536)" << std::endl;
+    std::cout << "  --analysis-workers <n> Analysis workers of the fan-in scenarios (default: 2)" << std::endl;
+    std::cout << "  --read <file>          Also run a recorded pcap/pcapng file through the pipeline" << std::endl;
+    std::cout << "  -h, --help             Show this help message" << std::endl;
+}
+
+}  // namespace
+
+/**
+ * @brief Benchmark entry point
+ * 
+ * Runs every synthetic scenario (pipeline, fan-in, stats shard and flow
+ * table, for each flow count and mix) and then the recorded file if one was given.
+ * 
+ * @param argc Argument count
+ * @param argv Argument vector
+ * @return Exit status code (0 for success)
+ */
+int main(int argc, char* argv[]) {
+    uint64_t packets = 5000000;
+    FlowTableConfig flow_config;
+    std::string read_file;
+    unsigned int analysis_workers = 2;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg(argv[i]);
+        if (arg == "--packets" && i + 1 < argc) {
+            packets = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--max-flows" && i + 1 < argc) {
+            flow_config.max_flows = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+        } else if (arg == "--analysis-workers" && i + 1 < argc) {
+            analysis_workers = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--read" && i + 1 < argc) {
+            read_file = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            showHelp();
+            return 0;
+        } else {
+            std::cerr << "Unknown option '" << arg << "' (use --help)" << std::endl;
+            return 1;
+        }
+    }
+    if (packets == 0 || packets > static_cast<uint64_t>(INT32_MAX) || flow_config.max_flows == 0 ||
+        analysis_workers == 0 || analysis_workers > 256) {
+        std::cerr << "Invalid --packets, --max-flows or --analysis-workers value" << std::endl;
+        return 1;
+    }
+    
+    if (!cache_counter.available()) {
+        std::cout << "Note: perf events unavailable, cache misses are not reported" << std::endl;
+    }
+    std::cout << "Flow table capacity: " << flow_config.max_flows << " flows" << std::endl << std::endl;
+    printHeader();
+    
+    const uint32_t flow_counts[] = {1, 1000, 50000, 1000000};
+    const Mix mixes[] = {Mix::Tcp, Mix::Udp, Mix::Mixed};
+    const size_t cycle = 1 << 20;
+    for (uint32_t flows : flow_counts) {
+        for (Mix mix : mixes) {
+            Stream stream = makeStream(flows, mix, cycle);
+            std::string label = std::to_string(flows) + " flows " + mixName(mix);
+            runPipeline("pipeline " + label, std::make_unique<SyntheticBackend>(stream, packets),
+                        flow_config, static_cast<int>(packets));
+            if (mix == Mix::Mixed) {
+                runFanIn("fan-in " + label, std::make_unique<SyntheticBackend>(stream, packets),
+                         flow_config, analysis_workers, static_cast<int>(packets));
+                runStats("stats " + label, stream, flow_config, packets);
+                runFlowTable("flowtable " + label, stream, flow_config, packets);
+            }
+        }
+    }
+    
+    if (!read_file.empty()) {
+        CaptureConfig config;
+        config.backend = BackendType::File;
+        auto backend = std::make_unique<FileBackend>();
+        std::string error;
+        if (!backend->open(read_file, config, error)) {
+            std::cerr << "Couldn't open file " << read_file << ": " << error << std::endl;
+            return 1;
+        }
+        runPipeline("pipeline recorded file", std::move(backend), flow_config, -1);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file byte_order.h
+ * @brief Little-endian integer encoding for the binary output formats
+ * 
+ * This header defines the helpers the binary packet log, the binary metrics
+ * stream and the history file use to write and read fixed-width integers in
+ * little-endian byte order, independent of the host.
+ */
+
+#ifndef BYTE_ORDER_H
+#define BYTE_ORDER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Appends an integer in little-endian byte order
+ * @param out Destination
+ * @param value Value
+ * @param bytes Width in bytes
+ */
+inline void appendLittleEndian(std::string& out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Stores an integer in little-endian byte order
+ * @param at Destination
+ * @param value Value
+ * @param bytes Width in bytes
+ */
+inline void storeLittleEndian(uint8_t* at, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        at[i] = static_cast<uint8_t>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Loads an unsigned integer stored in little-endian byte order
+ * @param at Source
+ * @param bytes Width in bytes
+ * @return Value
+ */
+inline uint64_t loadLittleEndian(const uint8_t* at, size_t bytes) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(at[i]) << (8 * i);
+    }
+    return value;
+}
+
+#endif // BYTE_ORDER_H
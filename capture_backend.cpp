@@ -0,0 +1,280 @@
+/**
+ * @file capture_backend.cpp
+ * @brief Implementation of the capture backend factory and libpcap backend
+ * 
+ * This file contains the portable libpcap backend, which configures the
+ * kernel buffer, snapshot length, timeout and immediate mode explicitly
+ * instead of relying on pcap_open_live() defaults.
+ */
+
+#include "capture_backend.h"
+#include "tpacket_backend.h"
+#include "file_backend.h"
+#include <iostream>
+#include <cstring>
+#include <mutex>
+
+/**
+ * @brief Compiles a BPF filter expression
+ * @param handle pcap handle giving link type and snaplen
+ * @param expression Filter expression (empty accepts every packet)
+ * @param program Receives the compiled program; release with pcap_freecode()
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool compileFilter(pcap_t* handle, const std::string& expression, struct bpf_program& program, std::string& error) {
+    static std::mutex compile_mutex;
+    std::lock_guard<std::mutex> lock(compile_mutex);
+    if (pcap_compile(handle, &program, expression.c_str(), 1, PCAP_NETMASK_UNKNOWN) < 0) {
+        error = std::string("invalid filter '") + expression + "': " + pcap_geterr(handle);
+        return false;
+    }
+    return true;
+}
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+
+/**
+ * @brief Joins an AF_PACKET socket to a hash fanout group
+ * @param fd AF_PACKET socket descriptor
+ * @param group Fanout group id (0-65535)
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool joinFanoutGroup(int fd, int group, std::string& error) {
+    int arg = (group & 0xFFFF) | ((PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG) << 16);
+    if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT, &arg, sizeof(arg)) < 0) {
+        error = std::string("PACKET_FANOUT: ") + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+#endif
+
+/**
+ * @brief Creates a backend of the requested type
+ * @param type Requested backend
+ * @return New backend instance
+ */
+std::unique_ptr<CaptureBackend> CaptureBackend::create(BackendType type) {
+    if (type == BackendType::File) {
+        return std::make_unique<FileBackend>();
+    }
+#ifdef __linux__
+    if (type == BackendType::Mmap) {
+        return std::make_unique<TPacketBackend>();
+    }
+#endif
+    return std::make_unique<PcapBackend>();
+}
+
+/**
+ * @brief Constructor - creates an unopened backend
+ */
+PcapBackend::PcapBackend()
+    : handle(nullptr), stopped(false), drained(false), slot_size(0), timestamp_source("host"), handler(nullptr),
+      handler_user(nullptr) {
+}
+
+/**
+ * @brief Destructor - closes the pcap session
+ */
+PcapBackend::~PcapBackend() {
+    if (handle) {
+        pcap_close(handle);
+    }
+}
+
+/**
+ * @brief Opens a device with explicit buffer, timeout and snapshot settings
+ * @param device Network interface name
+ * @param config Capture settings
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool PcapBackend::open(const std::string& device, const CaptureConfig& config, std::string& error) {
+    char errbuf[PCAP_ERRBUF_SIZE];
+    handle = pcap_create(device.c_str(), errbuf);
+    if (handle == nullptr) {
+        error = errbuf;
+        return false;
+    }
+    
+    pcap_set_snaplen(handle, config.snaplen);
+    pcap_set_promisc(handle, config.promiscuous ? 1 : 0);
+    pcap_set_timeout(handle, config.timeout_ms);
+    if (config.buffer_size > 0) {
+        pcap_set_buffer_size(handle, config.buffer_size);
+    }
+    pcap_set_immediate_mode(handle, config.immediate ? 1 : 0);
+    
+    // Nanosecond timestamps where the platform has them; libpcap falls back to microseconds
+    pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO);
+    timestamp_source = "host";
+    if (!config.timestamp_type.empty()) {
+        int type = pcap_tstamp_type_name_to_val(config.timestamp_type.c_str());
+        if (type < 0) {
+            error = "unknown timestamp type '" + config.timestamp_type + "'";
+            pcap_close(handle);
+            handle = nullptr;
+            return false;
+        }
+        if (pcap_set_tstamp_type(handle, type) == 0) {
+            timestamp_source = config.timestamp_type;
+        } else {
+            std::cerr << "Warning on " << device << ": timestamp type " << config.timestamp_type
+                      << " is not supported, using host timestamps" << std::endl;
+        }
+    }
+    
+    int status = pcap_activate(handle);
+    if (status < 0) {
+        error = pcap_geterr(handle);
+        if (error.empty()) {
+            error = pcap_statustostr(status);
+        }
+        pcap_close(handle);
+        handle = nullptr;
+        return false;
+    }
+    if (status > 0) {
+        std::cerr << "Warning on " << device << ": " << pcap_statustostr(status) << std::endl;
+    }
+    
+    if (!config.filter.empty()) {
+        struct bpf_program program;
+        if (!compileFilter(handle, config.filter, program, error)) {
+            pcap_close(handle);
+            handle = nullptr;
+            return false;
+        }
+        int result = pcap_setfilter(handle, &program);
+        pcap_freecode(&program);
+        if (result < 0) {
+            error = std::string("pcap_setfilter: ") + pcap_geterr(handle);
+            pcap_close(handle);
+            handle = nullptr;
+            return false;
+        }
+    }
+    
+    if (config.fanout_group >= 0) {
+#ifdef __linux__
+        // libpcap captures through an AF_PACKET socket on Linux
+        if (!joinFanoutGroup(pcap_get_selectable_fd(handle), config.fanout_group, error)) {
+            pcap_close(handle);
+            handle = nullptr;
+            return false;
+        }
+#else
+        error = "packet fanout is only supported on Linux";
+        pcap_close(handle);
+        handle = nullptr;
+        return false;
+#endif
+    }
+    
+    batch.nanosecond = pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO;
+    slot_size = static_cast<size_t>(pcap_snapshot(handle));
+    storage.resize(slot_size * PacketBatch::CAPACITY);
+    return true;
+}
+
+/**
+ * @brief Delivers the packets that are ready via pcap_dispatch()
+ * @param max_packets Upper bound on packets to deliver (-1 for no limit)
+ * @param batch_handler Function invoked for every filled batch
+ * @param user Opaque pointer passed to the handler
+ * @return Number of packets delivered, or -1 on error or after breakLoop()
+ */
+int PcapBackend::dispatch(int max_packets, BatchHandler batch_handler, void* user) {
+    handler = batch_handler;
+    handler_user = user;
+    if (stopped.load(std::memory_order_relaxed)) {
+        if (!drained) {
+            // Deliver what is already buffered without waiting for more
+            drained = true;
+            char errbuf[PCAP_ERRBUF_SIZE];
+            pcap_setnonblock(handle, 1, errbuf);
+            if (pcap_dispatch(handle, -1, collect, reinterpret_cast<u_char*>(this)) == PCAP_ERROR_BREAK) {
+                pcap_dispatch(handle, -1, collect, reinterpret_cast<u_char*>(this));
+            }
+            flush();
+        }
+        return -1;
+    }
+    int count = pcap_dispatch(handle, max_packets, collect, reinterpret_cast<u_char*>(this));
+    flush();
+    if (count == PCAP_ERROR) {
+        std::cerr << "Capture error: " << pcap_geterr(handle) << std::endl;
+        return -1;
+    }
+    return count < 0 ? -1 : count;  // PCAP_ERROR_BREAK
+}
+
+/**
+ * @brief pcap_dispatch() callback that appends one packet to the batch
+ * 
+ * The data is copied (at most one snapshot length) because libpcap may reuse
+ * its buffer once the callback returns.
+ */
+void PcapBackend::collect(u_char* user, const struct pcap_pkthdr* pkthdr, const u_char* packet) {
+    PcapBackend* self = reinterpret_cast<PcapBackend*>(user);
+    PacketBatch& batch = self->batch;
+    size_t caplen = pkthdr->caplen < self->slot_size ? pkthdr->caplen : self->slot_size;
+    u_char* slot = self->storage.data() + batch.count * self->slot_size;
+    std::memcpy(slot, packet, caplen);
+    batch.headers[batch.count] = *pkthdr;
+    batch.headers[batch.count].caplen = static_cast<bpf_u_int32>(caplen);
+    batch.packets[batch.count] = slot;
+    if (++batch.count == PacketBatch::CAPACITY) {
+        self->flush();
+    }
+}
+
+/**
+ * @brief Hands the current batch to the handler and empties it
+ */
+void PcapBackend::flush() {
+    if (batch.count > 0) {
+        handler(handler_user, batch);
+        batch.count = 0;
+    }
+}
+
+/**
+ * @brief Interrupts the capture loop (async-signal-safe)
+ */
+void PcapBackend::breakLoop() {
+    stopped.store(true, std::memory_order_relaxed);
+    if (handle) {
+        pcap_breakloop(handle);
+    }
+}
+
+/**
+ * @brief Reads the kernel packet counters via pcap_stats()
+ * @param stats Receives the counters
+ * @return true if libpcap could read them
+ */
+bool PcapBackend::stats(CaptureStats& stats) {
+    struct pcap_stat ps;
+    if (handle == nullptr || pcap_stats(handle, &ps) < 0) {
+        return false;
+    }
+    stats.received = ps.ps_recv;
+    stats.dropped = ps.ps_drop;
+    stats.interface_dropped = ps.ps_ifdrop;
+    return true;
+}
+
+/**
+ * @brief Gets the link-layer type of captured packets
+ * @return DLT_* value
+ */
+int PcapBackend::datalink() const {
+    return pcap_datalink(handle);
+}
@@ -0,0 +1,246 @@
+/**
+ * @file capture_backend.h
+ * @brief Packet capture backend abstraction
+ * 
+ * This header defines the CaptureBackend interface used by NetworkMonitor
+ * to receive packets, the CaptureConfig settings shared by all backends, and
+ * the portable libpcap backend.
+ */
+
+#ifndef CAPTURE_BACKEND_H
+#define CAPTURE_BACKEND_H
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <pcap.h>
+
+/**
+ * @enum BackendType
+ * @brief Available capture backends
+ */
+enum class BackendType {
+    Pcap,   ///< libpcap (all platforms)
+    Mmap,   ///< Linux AF_PACKET TPACKET_V3 memory-mapped ring
+    File    ///< Memory-mapped pcap/pcapng file (the device name is the file path)
+};
+
+/**
+ * @struct CaptureConfig
+ * @brief Capture settings applied when a device is opened
+ */
+struct CaptureConfig {
+#ifdef __linux__
+    BackendType backend = BackendType::Mmap;
+#else
+    BackendType backend = BackendType::Pcap;
+#endif
+    int snaplen = 128;                    ///< Bytes captured per packet (headers only by default)
+    std::string filter;                   ///< BPF filter expression applied in the kernel (empty = all)
+    bool promiscuous = true;              ///< Enable promiscuous mode
+    int timeout_ms = 1000;                ///< Read timeout before a partial batch is delivered
+    int buffer_size = 32 * 1024 * 1024;   ///< Kernel buffer size for libpcap in bytes (0 = default)
+    bool immediate = false;               ///< Deliver packets as soon as they arrive (libpcap)
+    /// libpcap time stamp type name ("host", "adapter", "adapter_unsynced", ...; empty = default).
+    /// The ring backend maps the adapter types to raw NIC hardware timestamps
+    std::string timestamp_type;
+    
+    // TPACKET_V3 ring geometry
+    uint32_t ring_block_size = 4 * 1024 * 1024; ///< Bytes per ring block (power of two multiple of the page size)
+    uint32_t ring_frame_count = 16384;          ///< Nominal 2 KiB frames in the ring
+    uint32_t ring_block_timeout_ms = 64;        ///< Kernel retires a partially filled block after this long
+    
+    /// PACKET_FANOUT_HASH group to join (Linux only, -1 = none); sockets in
+    /// the same group on one interface share its traffic by flow hash
+    int fanout_group = -1;
+    
+    // Capture file reading
+    bool replay = false;                  ///< Pace file records by their timestamps instead of reading at full speed
+    unsigned int file_part = 0;           ///< Part of the file read by this backend
+    unsigned int file_parts = 1;          ///< Number of parts the file is split into for parallel readers
+    /// Monotonic time the replay of the file started, shared by the readers of its parts
+    /// (0 until the first reader anchors it; null = each reader keeps its own clock)
+    std::shared_ptr<std::atomic<uint64_t>> replay_clock;
+};
+
+/**
+ * @brief Compiles a BPF filter expression
+ * 
+ * Serialized internally because older libpcap versions keep compiler state
+ * in globals.
+ * 
+ * @param handle pcap handle (live, or from pcap_open_dead()) giving link type and snaplen
+ * @param expression Filter expression (empty accepts every packet)
+ * @param program Receives the compiled program; release with pcap_freecode()
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool compileFilter(pcap_t* handle, const std::string& expression, struct bpf_program& program, std::string& error);
+
+#ifdef __linux__
+/**
+ * @brief Joins an AF_PACKET socket to a hash fanout group
+ * 
+ * The kernel then spreads packets over all sockets of the group by flow hash,
+ * so every packet of a flow reaches the same socket. IP fragments are
+ * reassembled for hashing so they follow their flow.
+ * 
+ * @param fd AF_PACKET socket descriptor
+ * @param group Fanout group id (0-65535)
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool joinFanoutGroup(int fd, int group, std::string& error);
+#endif
+
+/**
+ * @struct PacketBatch
+ * @brief A group of captured packets handed to the processing pipeline at once
+ * 
+ * Packet pointers refer either to the backend's ring (zero-copy backends) or
+ * to the backend's batch storage, and are only valid until the batch handler
+ * returns.
+ */
+struct PacketBatch {
+    static constexpr size_t CAPACITY = 256;    ///< Maximum packets per batch
+    
+    size_t count = 0;                          ///< Packets in the batch
+    bool nanosecond = false;                   ///< headers[].ts.tv_usec holds nanoseconds (as in libpcap's nano precision)
+    struct pcap_pkthdr headers[CAPACITY];      ///< Capture metadata per packet
+    const u_char* packets[CAPACITY];           ///< Packet data per packet
+};
+
+/**
+ * @struct CaptureStats
+ * @brief Kernel packet counters for one capture socket
+ */
+struct CaptureStats {
+    uint64_t received = 0;         ///< Packets that passed the filter
+    uint64_t dropped = 0;          ///< Packets dropped because the buffer or ring was full
+    uint64_t interface_dropped = 0; ///< Packets dropped by the interface or driver
+};
+
+/**
+ * @brief Handler invoked by a backend for every filled batch
+ */
+using BatchHandler = void (*)(void* user, const PacketBatch& batch);
+
+/**
+ * @class CaptureBackend
+ * @brief Source of captured packets for a single device
+ * 
+ * Backends collect packets into a PacketBatch and invoke the handler once per
+ * batch rather than once per packet, which keeps the processing loop hot in
+ * the instruction cache and amortizes per-call overhead.
+ */
+class CaptureBackend {
+public:
+    virtual ~CaptureBackend() = default;
+    
+    /**
+     * @brief Opens a device for capture
+     * @param device Network interface name
+     * @param config Capture settings
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    virtual bool open(const std::string& device, const CaptureConfig& config, std::string& error) = 0;
+    
+    /**
+     * @brief Delivers the packets that are ready, waiting up to the read timeout
+     * @param max_packets Upper bound on packets to deliver (-1 for no limit)
+     * @param handler Function invoked for every filled batch
+     * @param user Opaque pointer passed to the handler
+     * @return Number of packets delivered, or -1 on error or after breakLoop()
+     */
+    virtual int dispatch(int max_packets, BatchHandler handler, void* user) = 0;
+    
+    /**
+     * @brief Makes the current or next dispatch() return -1
+     * 
+     * Safe to call from another thread or from a signal handler. Packets that
+     * have already reached user space are still delivered by the next
+     * dispatch() call before it returns -1.
+     */
+    virtual void breakLoop() = 0;
+    
+    /**
+     * @brief Reads the kernel packet counters accumulated since open()
+     * @param stats Receives the counters
+     * @return true if the backend could read them
+     */
+    virtual bool stats(CaptureStats& stats) = 0;
+    
+    /**
+     * @brief Gets the link-layer type of captured packets
+     * @return DLT_* value
+     */
+    virtual int datalink() const = 0;
+    
+    /**
+     * @brief Gets a short backend name for diagnostics
+     * @return Backend name
+     */
+    virtual const char* name() const = 0;
+    
+    /**
+     * @brief Gets where packet timestamps come from, for diagnostics
+     * @return libpcap time stamp type name, such as "host" or "adapter"
+     */
+    virtual const char* timestampSource() const { return "host"; }
+    
+    /**
+     * @brief Creates a backend of the requested type
+     * 
+     * Falls back to libpcap when the requested type is not supported on the
+     * current platform.
+     * 
+     * @param type Requested backend
+     * @return New backend instance
+     */
+    static std::unique_ptr<CaptureBackend> create(BackendType type);
+};
+
+/**
+ * @class PcapBackend
+ * @brief Portable backend built on pcap_create()/pcap_dispatch()
+ */
+class PcapBackend : public CaptureBackend {
+public:
+    PcapBackend();
+    ~PcapBackend() override;
+    
+    bool open(const std::string& device, const CaptureConfig& config, std::string& error) override;
+    int dispatch(int max_packets, BatchHandler handler, void* user) override;
+    void breakLoop() override;
+    bool stats(CaptureStats& stats) override;
+    int datalink() const override;
+    const char* name() const override { return "pcap"; }
+    const char* timestampSource() const override { return timestamp_source.c_str(); }
+
+private:
+    pcap_t* handle;                ///< pcap session handle
+    std::atomic<bool> stopped;     ///< Set by breakLoop()
+    bool drained;                  ///< Buffered packets were delivered after breakLoop()
+    PacketBatch batch;             ///< Batch being filled by pcap_dispatch()
+    std::vector<u_char> storage;   ///< Copies of packet data (libpcap reuses its buffer)
+    size_t slot_size;              ///< Bytes of storage per batch slot (the snapshot length)
+    std::string timestamp_source;  ///< Time stamp type in effect
+    BatchHandler handler;          ///< Handler for the current dispatch() call
+    void* handler_user;            ///< User pointer for the current dispatch() call
+    
+    /**
+     * @brief pcap_dispatch() callback that appends one packet to the batch
+     */
+    static void collect(u_char* user, const struct pcap_pkthdr* pkthdr, const u_char* packet);
+    
+    /**
+     * @brief Hands the current batch to the handler and empties it
+     */
+    void flush();
+};
+
+#endif // CAPTURE_BACKEND_H
@@ -0,0 +1,203 @@
+/**
+ * @file cpu_affinity.cpp
+ * @brief Implementation of the CPU pinning and NUMA topology helpers
+ * 
+ * Topology comes from sysfs (/sys/class/net and /sys/devices/system/node)
+ * and pinning uses sched_setaffinity(), which applies to the calling thread
+ * on Linux.
+ */
+
+#include "cpu_affinity.h"
+#include <algorithm>
+#include <fstream>
+#include <cstdlib>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11"
+ * @param text List to parse
+ * @param cpus Receives the CPUs in ascending order without duplicates
+ * @return true if the list is well formed and not empty
+ */
+bool parseCpuList(const std::string& text, std::vector<int>& cpus) {
+    constexpr long MAX_CPU = 4095;
+    cpus.clear();
+    size_t position = 0;
+    while (position < text.size()) {
+        size_t comma = text.find(',', position);
+        std::string range = text.substr(position, comma == std::string::npos ? std::string::npos : comma - position);
+        position = comma == std::string::npos ? text.size() : comma + 1;
+        if (range.empty()) {
+            return false;
+        }
+        
+        char* end = nullptr;
+        long first = std::strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str()) {
+            return false;
+        }
+        if (*end == '-') {
+            const char* second = end + 1;
+            last = std::strtol(second, &end, 10);
+            if (end == second) {
+                return false;
+            }
+        }
+        if (*end != '\0' || first < 0 || last < first || last > MAX_CPU) {
+            return false;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return !cpus.empty();
+}
+
+/**
+ * @brief Formats a CPU set in the cpulist format
+ * @param cpus CPUs in ascending order
+ * @return List such as "0-3,8"
+ */
+std::string formatCpuList(const std::vector<int>& cpus) {
+    std::string text;
+    for (size_t i = 0; i < cpus.size(); i++) {
+        size_t last = i;
+        while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+            last++;
+        }
+        if (!text.empty()) {
+            text += ',';
+        }
+        text += std::to_string(cpus[i]);
+        if (last != i) {
+            text += '-';
+            text += std::to_string(cpus[last]);
+        }
+        i = last;
+    }
+    return text;
+}
+
+#ifdef __linux__
+
+/**
+ * @brief Gets the CPUs the calling thread may run on
+ * @return Allowed CPUs in ascending order (empty if unknown)
+ */
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return cpus;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+/**
+ * @brief Gets the NUMA node a network interface's device is attached to
+ * @param device Interface name
+ * @return Node number, or -1 if unknown
+ */
+int deviceNumaNode(const std::string& device) {
+    if (device.empty() || device.find('/') != std::string::npos) {
+        return -1;  // Capture files and paths are not devices
+    }
+    std::ifstream file("/sys/class/net/" + device + "/device/numa_node");
+    int node = -1;
+    if (!(file >> node)) {
+        return -1;
+    }
+    return node;  // The kernel reports -1 itself when the device has no affinity
+}
+
+/**
+ * @brief Gets the CPUs of a NUMA node
+ * @param node Node number
+ * @return CPUs of the node in ascending order (empty if unknown)
+ */
+std::vector<int> numaNodeCpus(int node) {
+    std::vector<int> cpus;
+    if (node < 0) {
+        return cpus;
+    }
+    std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string text;
+    if (!std::getline(file, text) || !parseCpuList(text, cpus)) {
+        cpus.clear();
+    }
+    return cpus;
+}
+
+/**
+ * @brief Restricts the calling thread to a set of CPUs
+ * @param cpus CPUs the thread may run on
+ * @return true if the thread's affinity was changed
+ */
+bool pinCurrentThread(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return false;
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+#else
+
+std::vector<int> allowedCpus() {
+    return std::vector<int>();
+}
+
+int deviceNumaNode(const std::string&) {
+    return -1;
+}
+
+std::vector<int> numaNodeCpus(int) {
+    return std::vector<int>();
+}
+
+bool pinCurrentThread(const std::vector<int>&) {
+    return false;
+}
+
+#endif
+
+/**
+ * @brief Constructor - saves the current affinity and applies the new one
+ * @param cpus CPUs to run on (empty = leave the affinity alone)
+ */
+ScopedAffinity::ScopedAffinity(const std::vector<int>& cpus) {
+    if (cpus.empty()) {
+        return;
+    }
+    std::vector<int> current = allowedCpus();
+    if (!current.empty() && pinCurrentThread(cpus)) {
+        saved = current;
+    }
+}
+
+/**
+ * @brief Destructor - restores the saved affinity
+ */
+ScopedAffinity::~ScopedAffinity() {
+    if (!saved.empty()) {
+        pinCurrentThread(saved);
+    }
+}
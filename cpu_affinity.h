@@ -0,0 +1,107 @@
+/**
+ * @file cpu_affinity.h
+ * @brief CPU pinning and NUMA placement of capture and housekeeping threads
+ * 
+ * This header declares the affinity settings and the helpers that read the
+ * CPU and NUMA topology from sysfs and pin the calling thread. Pinning is
+ * only implemented on Linux; elsewhere the helpers report failure and
+ * threads run wherever the scheduler puts them.
+ */
+
+#ifndef CPU_AFFINITY_H
+#define CPU_AFFINITY_H
+
+#include <string>
+#include <vector>
+
+/**
+ * @struct AffinityConfig
+ * @brief Which CPUs capture threads and housekeeping threads run on
+ */
+struct AffinityConfig {
+    std::vector<int> capture_cpus;   ///< CPUs handed to capture threads in turn (empty = not pinned)
+    bool numa_local = false;         ///< Pick capture CPUs on each NIC's NUMA node
+    int housekeeping_cpu = -1;       ///< CPU for the render, export and log threads (-1 = not pinned)
+    
+    /** @brief Whether any pinning was requested */
+    bool enabled() const { return !capture_cpus.empty() || numa_local || housekeeping_cpu >= 0; }
+};
+
+/**
+ * @brief Parses a CPU list such as "0-3,8,10-11" (the sysfs cpulist format)
+ * @param text List to parse
+ * @param cpus Receives the CPUs in ascending order without duplicates
+ * @return true if the list is well formed and not empty
+ */
+bool parseCpuList(const std::string& text, std::vector<int>& cpus);
+
+/**
+ * @brief Gets the CPUs the calling thread may run on
+ * 
+ * Called before any thread is pinned, this is the set the process was
+ * started with (e.g. by taskset or a cgroup).
+ * 
+ * @return Allowed CPUs in ascending order (empty if unknown)
+ */
+std::vector<int> allowedCpus();
+
+/**
+ * @brief Gets the NUMA node a network interface's device is attached to
+ * @param device Interface name
+ * @return Node number, or -1 for virtual devices, single-node systems and
+ *         platforms without sysfs
+ */
+int deviceNumaNode(const std::string& device);
+
+/**
+ * @brief Gets the CPUs of a NUMA node
+ * @param node Node number
+ * @return CPUs of the node in ascending order (empty if unknown)
+ */
+std::vector<int> numaNodeCpus(int node);
+
+/**
+ * @brief Restricts the calling thread to a set of CPUs
+ * @param cpus CPUs the thread may run on
+ * @return true if the thread's affinity was changed
+ */
+bool pinCurrentThread(const std::vector<int>& cpus);
+
+/**
+ * @brief Formats a CPU set in the cpulist format
+ * @param cpus CPUs in ascending order
+ * @return List such as "0-3,8"
+ */
+std::string formatCpuList(const std::vector<int>& cpus);
+
+/**
+ * @class ScopedAffinity
+ * @brief Moves the calling thread onto some CPUs until the scope ends
+ * 
+ * Memory is placed on the NUMA node of the CPU that first touches it, and
+ * the kernel allocates socket rings on the node of the thread that sets
+ * them up. Opening a capture and building its statistics shard inside this
+ * scope therefore puts both next to the CPU that will use them, without
+ * making the opening thread's own affinity permanent.
+ */
+class ScopedAffinity {
+public:
+    /**
+     * @brief Constructor - saves the current affinity and applies the new one
+     * @param cpus CPUs to run on (empty = leave the affinity alone)
+     */
+    explicit ScopedAffinity(const std::vector<int>& cpus);
+    
+    /**
+     * @brief Destructor - restores the saved affinity
+     */
+    ~ScopedAffinity();
+    
+    ScopedAffinity(const ScopedAffinity&) = delete;
+    ScopedAffinity& operator=(const ScopedAffinity&) = delete;
+
+private:
+    std::vector<int> saved;   ///< Affinity to restore (empty = nothing changed)
+};
+
+#endif // CPU_AFFINITY_H
@@ -12,75 +12,329 @@
 
 /**
  * @brief Constructor - Initializes the dashboard
+ * @param config Flow table settings applied to every shard
+ * @param talkers Host aggregation settings applied to every shard
  */
-Dashboard::Dashboard() : total_packets(0), total_bytes(0) {
+Dashboard::Dashboard(const FlowTableConfig& config, const TalkerConfig& talkers)
+    : flow_config(config), talker_config(talkers), merged_sketches(talkers.sketches), current(std::make_shared<const DashboardSnapshot>()),
+      snapshot_pool(SNAPSHOT_POOL), refreshes(0) {
     start_time = std::chrono::steady_clock::now();
-    last_update = start_time;
 }
 
 /**
- * @brief Updates dashboard with new packet information
- * @param info PacketInfo structure containing packet details
+ * @brief Empties the snapshot for reuse, keeping the capacity of its lists
  */
-void Dashboard::updatePacket(const PacketInfo& info) {
-    total_packets++;
-    total_bytes += info.length;
+void DashboardSnapshot::reset() {
+    counters = StatsCounters();
+    top_by_packets.clear();
+    top_by_bytes.clear();
+    top_hosts.clear();
+    top_subnets.clear();
+    active_flows = 0;
+    evicted_flows = 0;
+    health.interfaces.clear();
+    health.analysis = PipelineHealth();
+    health.analysis_workers = 0;
+    health.render = LatencyHistogram();
+    health.flow_slots = PoolUsage();
+    health.host_slots = PoolUsage();
+    health.snapshot_slots = PoolUsage();
+    rates = TrafficRates();
+    peak_rates.fill(Rate());
+    elapsed_seconds = 0.0;
+    sequence = 0;
+    sketches.enabled = false;
+    sketches.distinct_sources = 0.0;
+    sketches.distinct_destinations = 0.0;
+    sketches.distinct_flows = 0.0;
+    sketches.memory_bytes = 0;
+    sketches.hosts.clear();
+    tcp = TcpStats();
+    interval = 0;
+    interval_entered = false;
+    interval_start = StatsCounters();
+}
+
+/**
+ * @brief Creates a statistics shard for one capture thread
+ * @return Pointer to the new shard
+ */
+StatsShard* Dashboard::createShard() {
+    std::lock_guard<std::mutex> lock(shard_mutex);
+    shards.push_back(std::make_unique<StatsShard>(flow_config, talker_config));
+    return shards.back().get();
+}
+
+/**
+ * @brief Creates a shard that only publishes a capture thread's health
+ * @return Pointer to the new shard
+ */
+StatsShard* Dashboard::createHealthShard() {
+    FlowTableConfig minimal_flows;
+    minimal_flows.max_flows = 1;
+    TalkerConfig no_hosts;
+    no_hosts.max_hosts = 0;
+    std::lock_guard<std::mutex> lock(shard_mutex);
+    health_shards.push_back(std::make_unique<StatsShard>(minimal_flows, no_hosts));
+    return health_shards.back().get();
+}
+
+/**
+ * @brief Combines per-shard top lists into one list sorted by a metric
+ * 
+ * The same flow may appear in several shards' lists; duplicates are summed
+ * and keep the furthest TCP state either shard reached, and a confirmed
+ * application over a port guess.
+ * Inputs are at most TOP_CONNECTIONS entries per shard, so this is cheap.
+ * 
+ * @param records Concatenated shard lists, replaced by the merged list
+ * @param metric Counter used for ordering
+ */
+static void mergeTopList(std::vector<FlowRecord>& records, uint64_t FlowCounters::*metric) {
+    std::sort(records.begin(), records.end(),
+              [](const FlowRecord& a, const FlowRecord& b) { return a.connection < b.connection; });
+    size_t out = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (out > 0 && std::memcmp(&records[out - 1].connection, &records[i].connection,
+                                   sizeof(ConnectionInfo)) == 0) {
+            records[out - 1].counters.packets += records[i].counters.packets;
+            records[out - 1].counters.bytes += records[i].counters.bytes;
+            records[out - 1].interval.merge(records[i].interval);
+            for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+                records[out - 1].rates[w].merge(records[i].rates[w]);
+            }
+            // Without RSS both directions share a shard; otherwise keep whichever side saw the handshake
+            FlowRecord& merged = records[out - 1];
+            merged.retransmissions += records[i].retransmissions;
+            if (records[i].tcp_state > merged.tcp_state) {
+                merged.tcp_state = records[i].tcp_state;
+            }
+            // A signature match seen by any shard beats a port guess
+            if ((records[i].app_confirmed && !merged.app_confirmed) || merged.app == AppProtocol::Unknown) {
+                merged.app = records[i].app;
+                merged.app_confirmed = records[i].app_confirmed;
+            }
+            if (merged.handshake_rtt_ns == 0 && records[i].handshake_rtt_ns != 0) {
+                merged.handshake_rtt_ns = records[i].handshake_rtt_ns;
+                merged.reversed = records[i].reversed;
+            }
+        } else {
+            records[out++] = records[i];
+        }
+    }
+    records.resize(out);
+    std::sort(records.begin(), records.end(),
+              [metric](const FlowRecord& a, const FlowRecord& b) { return a.counters.*metric > b.counters.*metric; });
+}
+
+/**
+ * @brief Combines per-shard talker lists into one list sorted by bytes
+ * 
+ * A host or subnet seen by several shards is summed; each shard contributes
+ * at most TOP_TALKERS entries.
+ * 
+ * @param records Concatenated shard lists, replaced by the merged list
+ */
+static void mergeTalkers(std::vector<TalkerRecord>& records) {
+    auto same = [](const TalkerRecord& a, const TalkerRecord& b) {
+        return a.ip_version == b.ip_version && a.prefix_length == b.prefix_length &&
+               std::memcmp(a.address, b.address, sizeof(a.address)) == 0;
+    };
+    std::sort(records.begin(), records.end(), [](const TalkerRecord& a, const TalkerRecord& b) {
+        if (a.ip_version != b.ip_version) {
+            return a.ip_version < b.ip_version;
+        }
+        if (a.prefix_length != b.prefix_length) {
+            return a.prefix_length < b.prefix_length;
+        }
+        return std::memcmp(a.address, b.address, sizeof(a.address)) < 0;
+    });
+    size_t out = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        if (out > 0 && same(records[out - 1], records[i])) {
+            records[out - 1].counters.packets += records[i].counters.packets;
+            records[out - 1].counters.bytes += records[i].counters.bytes;
+            records[out - 1].interval.merge(records[i].interval);
+        } else {
+            records[out++] = records[i];
+        }
+    }
+    records.resize(out);
+    std::sort(records.begin(), records.end(),
+              [](const TalkerRecord& a, const TalkerRecord& b) { return a.counters.bytes > b.counters.bytes; });
+}
+
+/**
+ * @brief Merges the latest snapshot of every shard, publishes the result
+ *        and requests new shard snapshots
+ * 
+ * Snapshots requested here are published by the capture threads on their
+ * next packet and picked up on the following refresh. The merged view is
+ * built off to the side and made visible with a single pointer swap.
+ */
+void Dashboard::collect() {
+    // Reuse a snapshot no reader holds any more, so refreshes stop allocating once warmed up
+    std::shared_ptr<DashboardSnapshot> next = snapshot_pool.acquire();
+    next->reset();
+    std::array<PipelineHealth, MAX_INTERFACES> interface_health;
+    std::array<bool, MAX_INTERFACES> interface_seen{};
+    size_t shard_count = 0;
     
-    // Update protocol statistics
-    protocol_counts[info.protocol]++;
-    protocol_bytes[info.protocol] += info.length;
+    if (talker_config.sketches) {
+        merged_sketches.clear();
+    }
+    next->interval = StatsShard::currentInterval();
+    next->interval_entered = true;
+    {
+        std::lock_guard<std::mutex> lock(shard_mutex);
+        for (auto& shard : health_shards) {
+            const ShardSnapshot& latest = shard->latest();
+            uint16_t index = latest.health.interface_index;
+            if (index < MAX_INTERFACES) {
+                interface_health[index].interface_index = index;
+                interface_health[index].merge(latest.health);
+                interface_seen[index] = true;
+            }
+            shard->requestSnapshot();
+        }
+        for (auto& shard : shards) {
+            const ShardSnapshot& latest = shard->latest();
+            uint16_t index = latest.health.interface_index;
+            if (index == ANALYSIS_HEALTH_INDEX) {
+                next->health.analysis.merge(latest.health);
+                next->health.analysis_workers++;
+            } else if (index < MAX_INTERFACES) {
+                interface_health[index].interface_index = index;
+                interface_health[index].merge(latest.health);
+                interface_seen[index] = true;
+            }
+            next->counters.merge(latest.counters);
+            next->top_by_packets.insert(next->top_by_packets.end(), latest.top_by_packets.begin(), latest.top_by_packets.end());
+            next->top_by_bytes.insert(next->top_by_bytes.end(), latest.top_by_bytes.begin(), latest.top_by_bytes.end());
+            next->top_hosts.insert(next->top_hosts.end(), latest.top_hosts.begin(), latest.top_hosts.end());
+            next->top_subnets.insert(next->top_subnets.end(), latest.top_subnets.begin(), latest.top_subnets.end());
+            next->active_flows += latest.active_flows;
+            next->evicted_flows += latest.evicted_flows;
+            next->health.flow_slots.merge(latest.flow_slots);
+            next->health.host_slots.merge(latest.host_slots);
+            next->rates.merge(latest.rates);
+            next->tcp.merge(latest.tcp);
+            // A shard that has not entered the interval yet has only accounted traffic from before it
+            if (latest.interval == next->interval) {
+                next->interval_start.merge(latest.interval_start);
+            } else {
+                next->interval_start.merge(latest.counters);
+                next->interval_entered = false;
+            }
+            if (talker_config.sketches) {
+                merged_sketches.merge(latest.sketches);
+            }
+            shard->requestSnapshot();
+        }
+        shard_count = shards.size();
+    }
+    
+    // A single shard's lists are already sorted
+    if (shard_count > 1) {
+        mergeTopList(next->top_by_packets, &FlowCounters::packets);
+        mergeTopList(next->top_by_bytes, &FlowCounters::bytes);
+        mergeTalkers(next->top_hosts);
+        mergeTalkers(next->top_subnets);
+    }
     
-    // Update interface statistics
-    if (!info.interface_name.empty()) {
-        interface_counts[info.interface_name]++;
-        interface_bytes[info.interface_name] += info.length;
+    if (talker_config.sketches) {
+        SketchSummary& summary = next->sketches;
+        summary.enabled = true;
+        summary.distinct_sources = merged_sketches.sources.estimate();
+        summary.distinct_destinations = merged_sketches.destinations.estimate();
+        summary.distinct_flows = merged_sketches.flows.estimate();
+        summary.memory_bytes = merged_sketches.memoryBytes();
+        for (const TalkerRecord& host : next->top_hosts) {
+            SketchEstimate estimate;
+            std::memcpy(estimate.address, host.address, sizeof(estimate.address));
+            estimate.ip_version = host.ip_version;
+            uint64_t key = TrafficSketches::addressHash(host.address, host.ip_version);
+            estimate.sources = merged_sketches.sources_per_destination.estimate(key);
+            estimate.ports = merged_sketches.ports_per_source.estimate(key);
+            estimate.bytes_sent = merged_sketches.bytes_per_source.estimate(key);
+            summary.hosts.push_back(estimate);
+        }
     }
     
-    // Update connection tracking
-    ConnectionInfo conn;
-    conn.source_ip = info.source_ip;
-    conn.dest_ip = info.dest_ip;
-    conn.source_port = info.source_port;
-    conn.dest_port = info.dest_port;
-    conn.protocol = info.protocol;
+    for (size_t i = 0; i < MAX_INTERFACES; i++) {
+        if (interface_seen[i]) {
+            next->health.interfaces.push_back(interface_health[i]);
+        }
+    }
+    next->health.render = render_latency;
+    next->health.snapshot_slots = snapshot_pool.usage();
     
-    connections[conn]++;
+    // Peaks are kept across refreshes; the history only covers the last minute
+    for (size_t c = 0; c < TrafficRates::CHANNELS; c++) {
+        Rate recent = next->rates.peak(c);
+        peak_rates[c].packets_per_sec = std::max(peak_rates[c].packets_per_sec, recent.packets_per_sec);
+        peak_rates[c].bytes_per_sec = std::max(peak_rates[c].bytes_per_sec, recent.bytes_per_sec);
+    }
+    next->peak_rates = peak_rates;
+    next->elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    next->sequence = ++refreshes;
     
-    last_update = std::chrono::steady_clock::now();
+    std::atomic_store(&current, std::shared_ptr<const DashboardSnapshot>(std::move(next)));
 }
 
 /**
- * @brief Gets the color code for a given protocol
- * @param protocol Protocol name (TCP, UDP, ICMP, etc.)
- * @return ANSI color code string
+ * @brief Merges the shards and publishes a new snapshot
  */
-std::string Dashboard::getProtocolColor(const std::string& protocol) {
-    if (protocol == "TCP") return Colors::TCP;
-    if (protocol == "UDP") return Colors::UDP;
-    if (protocol == "ICMP") return Colors::ICMP;
-    return Colors::OTHER;
+void Dashboard::refresh() {
+    std::lock_guard<std::mutex> lock(refresh_mutex);
+    collect();
 }
 
 /**
- * @brief Gets the OSI layer description for a protocol
- * @param protocol Protocol name
- * @return OSI layer description
+ * @brief Gets the snapshot published by the latest refresh
+ * @return Latest snapshot (empty before the first refresh)
  */
-std::string Dashboard::getOSILayer(const std::string& protocol) {
-    if (protocol == "TCP" || protocol == "UDP") {
-        return "Layer 4 (Transport)";
-    }
-    if (protocol == "ICMP") {
-        return "Layer 3 (Network)";
+std::shared_ptr<const DashboardSnapshot> Dashboard::snapshot() const {
+    return std::atomic_load(&current);
+}
+
+/**
+ * @brief Gets the pipeline health as of the last refresh
+ * @return Per-interface capture counters and stage latencies
+ */
+HealthReport Dashboard::healthReport() const {
+    return snapshot()->health;
+}
+
+/**
+ * @brief Gets the color code for a given protocol
+ * @param protocol Protocol identifier (TCP, UDP, ICMP, etc.)
+ * @return ANSI color code string
+ */
+const std::string& Dashboard::getProtocolColor(Protocol protocol) {
+    switch (protocol) {
+        case Protocol::TCP:  return Colors::TCP;
+        case Protocol::UDP:  return Colors::UDP;
+        case Protocol::ICMP: return Colors::ICMP;
+        default:             return Colors::OTHER;
     }
-    return "Layer 3/4 (Network/Transport)";
 }
 
 /**
- * @brief Clears the terminal screen
+ * @brief Gets the OSI layer description for a protocol
+ * @param protocol Protocol identifier
+ * @return OSI layer description
  */
-void Dashboard::clearScreen() {
-    std::cout << "\033[2J\033[1;1H";
+const char* Dashboard::getOSILayer(Protocol protocol) {
+    switch (protocol) {
+        case Protocol::TCP:
+        case Protocol::UDP:
+            return "Layer 4 (Transport)";
+        case Protocol::ICMP:
+            return "Layer 3 (Network)";
+        default:
+            return "Layer 3/4 (Network/Transport)";
+    }
 }
 
 /**
@@ -103,194 +357,557 @@ std::string Dashboard::formatBytes(size_t bytes) {
     return oss.str();
 }
 
+/**
+ * @brief Formats a byte rate for human-readable display
+ * @param bytes_per_sec Bytes per second
+ * @return Formatted string (e.g., "1.50 MB/s")
+ */
+std::string Dashboard::formatRate(double bytes_per_sec) {
+    return formatBytes(static_cast<size_t>(bytes_per_sec)) + "/s";
+}
+
+/**
+ * @brief Formats a duration for human-readable display
+ * @param ns Duration in nanoseconds
+ * @return Formatted string (e.g., "850 ns", "1.2 us")
+ */
+std::string Dashboard::formatDuration(uint64_t ns) {
+    const char* units[] = {"ns", "us", "ms", "s"};
+    int unit_index = 0;
+    double value = static_cast<double>(ns);
+    
+    while (value >= 1000.0 && unit_index < 3) {
+        value /= 1000.0;
+        unit_index++;
+    }
+    
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(unit_index == 0 ? 0 : 1) << value << " " << units[unit_index];
+    return oss.str();
+}
+
 /**
  * @brief Draws a horizontal bar chart
+ * @param out Frame being rendered
  * @param label Label for the bar
  * @param value Current value
  * @param max_value Maximum value for scaling
  * @param color Color for the bar
  * @param width Width of the bar in characters
  */
-void Dashboard::drawBar(const std::string& label, size_t value, size_t max_value,
+void Dashboard::drawBar(std::ostream& out, const std::string& label, size_t value, size_t max_value,
                        const std::string& color, int width) {
     int bar_length = 0;
     if (max_value > 0) {
         bar_length = static_cast<int>((static_cast<double>(value) / max_value) * width);
     }
     
-    std::cout << Colors::LABEL << std::setw(10) << std::left << label << Colors::RESET << " │ ";
-    std::cout << color;
-    for (int i = 0; i < bar_length; i++) {
-        std::cout << "█";
-    }
-    std::cout << Colors::RESET;
-    for (int i = bar_length; i < width; i++) {
-        std::cout << " ";
-    }
-    std::cout << " │ " << Colors::LABEL << std::setw(10) << std::right << value << Colors::RESET << std::endl;
+    out << Colors::LABEL << std::setw(10) << std::left << label << Colors::RESET << " │ ";
+    // Whole runs of the bar and its padding are copied from prebuilt strings
+    static const char BLOCK[] = "█";
+    static const std::string blocks = [] {
+        std::string bar;
+        for (int i = 0; i < MAX_BAR_WIDTH; i++) {
+            bar += BLOCK;
+        }
+        return bar;
+    }();
+    static const std::string spaces(MAX_BAR_WIDTH, ' ');
+    width = std::min(std::max(width, 0), MAX_BAR_WIDTH);
+    bar_length = std::min(std::max(bar_length, 0), width);
+    
+    out << color;
+    out.write(blocks.data(), static_cast<std::streamsize>(bar_length) * (sizeof(BLOCK) - 1));
+    out << Colors::RESET;
+    out.write(spaces.data(), width - bar_length);
+    out << " │ " << Colors::LABEL << std::setw(10) << std::right << value << Colors::RESET << '\n';
 }
 
 /**
  * @brief Displays protocol distribution chart
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
  */
-void Dashboard::displayProtocolDistribution() {
-    std::cout << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║  PROTOCOL DISTRIBUTION (by OSI Layer)                         ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
+void Dashboard::displayProtocolDistribution(std::ostream& out, const DashboardSnapshot& view) {
+    const StatsCounters& counters = view.counters;
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  PROTOCOL DISTRIBUTION (by OSI Layer)                         ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
     
     // Find max count for scaling
-    size_t max_count = 0;
-    for (const auto& pair : protocol_counts) {
-        if (pair.second > max_count) {
-            max_count = pair.second;
-        }
-    }
+    size_t max_count = *std::max_element(counters.protocol_counts.begin(), counters.protocol_counts.end());
     
     // Display each protocol with its OSI layer info
-    for (const auto& pair : protocol_counts) {
-        std::string color = getProtocolColor(pair.first);
-        std::string layer = getOSILayer(pair.first);
+    for (size_t i = 0; i < PROTOCOL_COUNT; i++) {
+        if (counters.protocol_counts[i] == 0) {
+            continue;
+        }
+        Protocol protocol = static_cast<Protocol>(i);
+        const std::string& color = getProtocolColor(protocol);
+        const char* layer = getOSILayer(protocol);
         
-        std::cout << color << "  " << pair.first << Colors::RESET 
-                  << " (" << Colors::LABEL << layer << Colors::RESET << ")" << std::endl;
-        drawBar("Packets", pair.second, max_count, color, 40);
+        out << color << "  " << protocolName(protocol) << Colors::RESET 
+            << " (" << Colors::LABEL << layer << Colors::RESET << ")\n";
+        drawBar(out, "Packets", counters.protocol_counts[i], max_count, color, 40);
         
-        size_t bytes = protocol_bytes[pair.first];
-        std::cout << Colors::LABEL << "           └─ Traffic: " << formatBytes(bytes) 
-                  << Colors::RESET << std::endl;
-        std::cout << std::endl;
+        out << Colors::LABEL << "           └─ Traffic: " << formatBytes(counters.protocol_bytes[i])
+            << "  Rate: " << formatRate(view.rates.rate(protocolRateChannel(i), 10).bytes_per_sec)
+            << " (peak " << formatRate(view.peak_rates[protocolRateChannel(i)].bytes_per_sec) << ")"
+            << Colors::RESET << '\n';
+        out << '\n';
+    }
+}
+
+/**
+ * @brief Displays the traffic of each application protocol
+ * 
+ * Counters are kept per connection's settled application, so this costs
+ * one pass over APP_PROTOCOL_COUNT entries per frame. Traffic of
+ * unrecognized connections is only summarized.
+ * 
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
+ */
+void Dashboard::displayApplications(std::ostream& out, const DashboardSnapshot& view) {
+    const StatsCounters& counters = view.counters;
+    size_t unknown = static_cast<size_t>(AppProtocol::Unknown);
+    size_t max_count = 0;
+    for (size_t i = 0; i < APP_PROTOCOL_COUNT; i++) {
+        if (i != unknown) {
+            max_count = std::max(max_count, counters.app_counts[i]);
+        }
+    }
+    if (max_count == 0) {
+        return;  // No TCP or UDP traffic recognized yet
     }
+    
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  APPLICATION PROTOCOLS (Layer 7)                               ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    
+    for (size_t i = 0; i < APP_PROTOCOL_COUNT; i++) {
+        if (i == unknown || counters.app_counts[i] == 0) {
+            continue;
+        }
+        drawBar(out, appProtocolName(static_cast<AppProtocol>(i)), counters.app_counts[i], max_count, Colors::APP, 40);
+        out << Colors::LABEL << "           └─ Traffic: " << formatBytes(counters.app_bytes[i]) << Colors::RESET << '\n';
+    }
+    out << Colors::LABEL << "  Unrecognized: " << counters.app_counts[unknown] << " packets, "
+        << formatBytes(counters.app_bytes[unknown]) << Colors::RESET << '\n';
+    out << '\n';
 }
 
 /**
  * @brief Displays traffic statistics
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
  */
-void Dashboard::displayTrafficStats() {
-    auto now = std::chrono::steady_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
+void Dashboard::displayTrafficStats(std::ostream& out, const DashboardSnapshot& view) {
+    const StatsCounters& counters = view.counters;
+    auto duration = static_cast<long long>(view.elapsed_seconds);
     
     if (duration == 0) duration = 1; // Avoid division by zero
     
-    double packets_per_sec = static_cast<double>(total_packets) / duration;
-    double bytes_per_sec = static_cast<double>(total_bytes) / duration;
-    
-    std::cout << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║  TRAFFIC STATISTICS                                            ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
-    
-    std::cout << Colors::LABEL << "  Total Packets:    " << Colors::RESET << total_packets << std::endl;
-    std::cout << Colors::LABEL << "  Total Traffic:    " << Colors::RESET << formatBytes(total_bytes) << std::endl;
-    std::cout << Colors::LABEL << "  Monitoring Time:  " << Colors::RESET << duration << " seconds" << std::endl;
-    std::cout << Colors::LABEL << "  Packet Rate:      " << Colors::RESET 
-              << std::fixed << std::setprecision(2) << packets_per_sec << " packets/sec" << std::endl;
-    std::cout << Colors::LABEL << "  Traffic Rate:     " << Colors::RESET 
-              << formatBytes(static_cast<size_t>(bytes_per_sec)) << "/sec" << std::endl;
-    std::cout << std::endl;
+    double packets_per_sec = static_cast<double>(counters.total_packets) / duration;
+    double bytes_per_sec = static_cast<double>(counters.total_bytes) / duration;
+    
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  TRAFFIC STATISTICS                                            ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    
+    out << Colors::LABEL << "  Total Packets:    " << Colors::RESET << counters.total_packets << '\n';
+    out << Colors::LABEL << "  Total Traffic:    " << Colors::RESET << formatBytes(counters.total_bytes) << '\n';
+    out << Colors::LABEL << "  Monitoring Time:  " << Colors::RESET << duration << " seconds\n";
+    out << Colors::LABEL << "  Packet Rate:      " << Colors::RESET 
+        << std::fixed << std::setprecision(2) << packets_per_sec << " packets/sec\n";
+    out << Colors::LABEL << "  Traffic Rate:     " << Colors::RESET 
+        << formatBytes(static_cast<size_t>(bytes_per_sec)) << "/sec\n";
+    out << Colors::LABEL << "  Active Flows:     " << Colors::RESET << view.active_flows
+        << Colors::LABEL << " (limit " << flow_config.max_flows << " per shard, "
+        << view.evicted_flows << " expired/evicted)" << Colors::RESET << '\n';
+    out << '\n';
+    
+    // Sliding-window rates show bursts that the averages since start hide
+    std::array<Rate, RATE_WINDOW_COUNT> recent = view.rates.rates(RATE_CHANNEL_TOTAL);
+    const Rate& peak = view.peak_rates[RATE_CHANNEL_TOTAL];
+    out << Colors::LABEL << "  " << std::left << std::setw(16) << "Rate over" << std::right;
+    for (uint32_t window : RATE_WINDOWS) {
+        out << std::setw(13) << (std::to_string(window) + " s");
+    }
+    out << std::setw(13) << "Peak" << Colors::RESET << '\n';
+    out << "  " << std::left << std::setw(16) << "Packets/sec" << std::right << std::fixed << std::setprecision(1);
+    for (const Rate& rate : recent) {
+        out << std::setw(13) << rate.packets_per_sec;
+    }
+    out << Colors::BAR << std::setw(13) << peak.packets_per_sec << Colors::RESET << '\n';
+    out << "  " << std::left << std::setw(16) << "Traffic/sec" << std::right;
+    for (const Rate& rate : recent) {
+        out << std::setw(13) << formatRate(rate.bytes_per_sec);
+    }
+    out << Colors::BAR << std::setw(13) << formatRate(peak.bytes_per_sec) << Colors::RESET << '\n';
+    out << '\n';
 }
 
 /**
- * @brief Displays top connections
+ * @brief Displays per-interface capture counters and stage latencies
+ * 
+ * Kernel counters come from pcap_stats()/PACKET_STATISTICS and are refreshed
+ * by the capture threads about once per second. Parse and stats latencies
+ * are per batch; the per-packet column divides total time by packets.
+ * 
+ * @param out Frame being rendered
+ * @param report Merged pipeline health
  */
-void Dashboard::displayTopConnections() {
-    std::cout << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║  TOP 10 CONNECTIONS                                            ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
+void Dashboard::displayHealth(std::ostream& out, const HealthReport& report) {
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  PIPELINE HEALTH                                               ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
     
-    // Convert map to vector for sorting
-    std::vector<std::pair<ConnectionInfo, size_t>> conn_vec(connections.begin(), connections.end());
+    out << Colors::LABEL << "  " << std::left << std::setw(12) << "Interface" << std::right
+        << std::setw(12) << "Received" << std::setw(10) << "Dropped" << std::setw(9) << "Drop %"
+        << std::setw(12) << "Processed" << std::setw(8) << "Batch" << Colors::RESET << '\n';
     
-    // Sort by packet count (descending)
-    std::sort(conn_vec.begin(), conn_vec.end(),
-              [](const auto& a, const auto& b) { return a.second > b.second; });
+    PipelineHealth stages;
+    for (const auto& entry : report.interfaces) {
+        uint64_t dropped = entry.capture.dropped + entry.capture.interface_dropped;
+        double drop_rate = entry.capture.received > 0
+            ? 100.0 * static_cast<double>(dropped) / static_cast<double>(entry.capture.received) : 0.0;
+        double batch_size = entry.batches > 0
+            ? static_cast<double>(entry.processed) / static_cast<double>(entry.batches) : 0.0;
+        const std::string& color = dropped > 0 ? Colors::OTHER : Colors::TCP;
+        
+        out << "  " << std::left << std::setw(12) << NetworkMonitor::interfaceName(entry.interface_index)
+            << std::right << std::setw(12) << entry.capture.received
+            << color << std::setw(10) << dropped << std::setw(8) << std::fixed << std::setprecision(2)
+            << drop_rate << "%" << Colors::RESET
+            << std::setw(12) << entry.processed << std::setw(8) << std::setprecision(1) << batch_size
+            << '\n';
+        stages.merge(entry);
+    }
+    if (report.analysis_workers > 0) {
+        // Fanned in: capture threads only queue, the workers account
+        uint64_t dropped = stages.queue_dropped;
+        double drop_rate = stages.processed > 0
+            ? 100.0 * static_cast<double>(dropped) / static_cast<double>(stages.processed) : 0.0;
+        out << "  Analysis: " << report.analysis_workers << " workers, " << report.analysis.processed << " accounted, "
+            << (dropped > 0 ? Colors::OTHER : Colors::TCP) << dropped << " dropped at the queues ("
+            << std::fixed << std::setprecision(2) << drop_rate << "%)" << Colors::RESET
+            << ", " << stages.queue_waits << " waits for room" << '\n';
+    }
+    out << '\n';
+    
+    out << Colors::LABEL << "  " << std::left << std::setw(12) << "Stage" << std::right
+        << std::setw(12) << "p50" << std::setw(12) << "p99" << std::setw(12) << "max"
+        << std::setw(14) << "per packet" << Colors::RESET << '\n';
+    struct StageRow {
+        const char* name;
+        const LatencyHistogram* histogram;
+        uint64_t units;
+    };
+    const bool fanned_in = report.analysis_workers > 0;
+    const StageRow rows[] = {
+        {"Parse", &stages.parse, stages.processed},
+        {fanned_in ? "Queue" : "Stats", &stages.update, stages.processed},
+        {"Analysis", &report.analysis.update, report.analysis.processed},
+        {"Render", &report.render, 0},
+    };
+    for (const auto& row : rows) {
+        if (row.histogram == &report.analysis.update && !fanned_in) {
+            continue;
+        }
+        out << "  " << std::left << std::setw(12) << row.name << std::right
+            << std::setw(12) << formatDuration(row.histogram->percentile(0.50))
+            << std::setw(12) << formatDuration(row.histogram->percentile(0.99))
+            << std::setw(12) << formatDuration(row.histogram->maxNs());
+        if (row.units > 0) {
+            out << std::setw(14) << formatDuration(row.histogram->totalNs() / row.units);
+        }
+        out << '\n';
+    }
+    out << '\n';
+    
+    // Fixed-capacity stores: memory stays flat, these show how close to full they run
+    out << Colors::LABEL << "  " << std::left << std::setw(12) << "Pool" << std::right
+        << std::setw(10) << "Used" << std::setw(10) << "Capacity" << std::setw(10) << "Peak"
+        << std::setw(10) << "Recycled" << std::setw(12) << "Memory" << Colors::RESET << '\n';
+    struct PoolRow {
+        const char* name;
+        const PoolUsage* usage;
+    };
+    const PoolRow pools[] = {
+        {"Flows", &report.flow_slots},
+        {"Hosts", &report.host_slots},
+        {"Snapshots", &report.snapshot_slots},
+    };
+    for (const auto& row : pools) {
+        const PoolUsage& usage = *row.usage;
+        const std::string& color = usage.used >= usage.capacity && usage.capacity > 0 ? Colors::OTHER : Colors::RESET;
+        out << "  " << std::left << std::setw(12) << row.name << std::right
+            << color << std::setw(10) << usage.used << Colors::RESET
+            << std::setw(10) << usage.capacity << std::setw(10) << usage.peak
+            << std::setw(10) << usage.recycled << std::setw(12) << formatBytes(usage.bytes) << '\n';
+    }
+    
+    if (report.losingPackets()) {
+        out << Colors::OTHER << "  ⚠ Packets are being dropped before analysis: "
+            << (report.totalDropped() > 0 ? "capture is not keeping up" : "analysis workers are not keeping up")
+            << Colors::RESET << '\n';
+    }
+    out << '\n';
+}
+
+/**
+ * @brief Displays top connections
+ * 
+ * Renders at most 10 rows from an already merged and sorted top list, so the
+ * cost is independent of the number of tracked flows. Connections are shown
+ * from their initiator, with their application when it is known; TCP rows
+ * add the state, handshake RTT and retransmission count.
+ * 
+ * @param out Frame being rendered
+ * @param title Panel title
+ * @param records Merged top list, sorted descending
+ */
+void Dashboard::displayTopConnections(std::ostream& out, const std::string& title, const std::vector<FlowRecord>& records) {
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  " << std::setw(62) << std::left << title << "║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
     
     // Display top 10
-    int count = 0;
-    for (const auto& pair : conn_vec) {
-        if (count >= 10) break;
-        
-        const ConnectionInfo& conn = pair.first;
-        std::string color = getProtocolColor(conn.protocol);
+    size_t shown = std::min<size_t>(records.size(), 10);
+    for (size_t i = 0; i < shown; i++) {
+        const FlowRecord& record = records[i];
+        const ConnectionInfo conn = record.oriented();
+        const std::string& color = getProtocolColor(conn.protocol);
         
-        std::cout << "  " << color << conn.protocol << Colors::RESET << " │ ";
-        std::cout << conn.source_ip << ":" << conn.source_port << " → ";
-        std::cout << conn.dest_ip << ":" << conn.dest_port;
-        std::cout << Colors::LABEL << " (" << pair.second << " packets)" << Colors::RESET << std::endl;
-        
-        count++;
+        out << "  " << color << protocolName(conn.protocol) << Colors::RESET;
+        if (record.app != AppProtocol::Unknown) {
+            out << "/" << Colors::APP << appProtocolName(record.app) << Colors::RESET;
+        }
+        out << " │ ";
+        out << formatAddress(conn.source_addr, conn.ip_version) << ":" << conn.source_port << " → ";
+        out << formatAddress(conn.dest_addr, conn.ip_version) << ":" << conn.dest_port;
+        out << Colors::LABEL << " (" << record.counters.packets << " packets, "
+            << formatBytes(record.counters.bytes) << ", " << formatRate(record.rates[0].bytes_per_sec);
+        if (conn.protocol == Protocol::TCP) {
+            out << ", " << tcpStateName(record.tcp_state);
+            if (record.handshake_rtt_ns != 0) {
+                out << ", rtt " << formatDuration(record.handshake_rtt_ns);
+            }
+            if (record.retransmissions != 0) {
+                out << ", " << record.retransmissions << " retx";
+            }
+        }
+        out << ")" << Colors::RESET << '\n';
     }
     
-    if (connections.empty()) {
-        std::cout << Colors::LABEL << "  No connections yet..." << Colors::RESET << std::endl;
+    if (records.empty()) {
+        out << Colors::LABEL << "  No connections yet..." << Colors::RESET << '\n';
     }
     
-    std::cout << std::endl;
+    out << '\n';
 }
 
 /**
- * @brief Displays interface statistics
+ * @brief Displays the heaviest hosts and subnets
+ * 
+ * Host traffic includes both directions, so a conversation between two
+ * tracked hosts counts towards each of them.
+ * 
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
  */
-void Dashboard::displayInterfaceStats() {
-    if (interface_counts.empty()) {
-        return;  // Don't display if no interface data
+void Dashboard::displayTopTalkers(std::ostream& out, const DashboardSnapshot& view) {
+    if (view.top_hosts.empty()) {
+        return;  // Host aggregation disabled or no IP traffic yet
     }
     
-    std::cout << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║  INTERFACE STATISTICS                                          ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  TOP TALKERS                                                   ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
     
-    // Find max count for scaling
-    size_t max_count = 0;
-    for (const auto& pair : interface_counts) {
-        if (pair.second > max_count) {
-            max_count = pair.second;
+    auto showList = [&](const char* label, const std::vector<TalkerRecord>& records) {
+        out << Colors::LABEL << "  " << label << Colors::RESET << '\n';
+        size_t shown = std::min<size_t>(records.size(), 5);
+        for (size_t i = 0; i < shown; i++) {
+            const TalkerRecord& record = records[i];
+            std::string prefix = formatAddress(record.address, record.ip_version) + "/" +
+                                 std::to_string(record.prefix_length);
+            out << "    " << std::setw(43) << std::left << prefix << std::right
+                << Colors::LABEL << " (" << record.counters.packets << " packets, "
+                << formatBytes(record.counters.bytes) << ")" << Colors::RESET << '\n';
         }
+    };
+    showList("Hosts:", view.top_hosts);
+    showList("Subnets:", view.top_subnets);
+    
+    const PoolUsage& hosts = view.health.host_slots;
+    out << Colors::LABEL << "  Tracked hosts: " << hosts.used;
+    if (hosts.refused != 0) {
+        out << "  (table full, " << hosts.refused << " packets not attributed to a host)";
+    }
+    out << Colors::RESET << '\n';
+    out << '\n';
+}
+
+/**
+ * @brief Displays the sketch estimates
+ * 
+ * Fan-in flags hosts many sources converge on (floods), fan-out flags hosts
+ * that touch many ports (scans). Estimates are approximate by design.
+ * 
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
+ */
+void Dashboard::displaySketches(std::ostream& out, const DashboardSnapshot& view) {
+    const SketchSummary& summary = view.sketches;
+    if (!summary.enabled) {
+        return;
+    }
+    
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  TRAFFIC SKETCHES (ESTIMATES)                                  ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    
+    out << std::fixed << std::setprecision(0);
+    out << Colors::LABEL << "  Distinct sources: " << Colors::RESET << "~" << summary.distinct_sources
+        << Colors::LABEL << "  destinations: " << Colors::RESET << "~" << summary.distinct_destinations
+        << Colors::LABEL << "  flows: " << Colors::RESET << "~" << summary.distinct_flows << '\n';
+    
+    out << Colors::LABEL << "  " << std::left << std::setw(30) << "Host" << std::right
+        << std::setw(10) << "Sources" << std::setw(10) << "Ports" << std::setw(12) << "Sent" << Colors::RESET << '\n';
+    size_t shown = std::min<size_t>(summary.hosts.size(), 5);
+    for (size_t i = 0; i < shown; i++) {
+        const SketchEstimate& host = summary.hosts[i];
+        out << "  " << std::left << std::setw(30) << formatAddress(host.address, host.ip_version) << std::right
+            << std::setw(10) << host.sources << std::setw(10) << host.ports
+            << std::setw(12) << formatBytes(host.bytes_sent) << '\n';
+    }
+    out << Colors::LABEL << "  Sketch memory per thread: " << formatBytes(summary.memory_bytes) << Colors::RESET << '\n';
+    out << '\n';
+}
+
+/**
+ * @brief Displays TCP connection states, handshake RTT and retransmissions
+ * 
+ * Counts are transitions into each state since startup, so a connection that
+ * completed its handshake and closed is counted under both.
+ * 
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
+ */
+void Dashboard::displayTcp(std::ostream& out, const DashboardSnapshot& view) {
+    const TcpStats& tcp = view.tcp;
+    auto entered = [&tcp](TcpState state) { return tcp.transitions[static_cast<size_t>(state)]; };
+    if (entered(TcpState::SynSent) == 0 && entered(TcpState::Established) == 0) {
+        return;  // No TCP traffic yet
     }
     
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  TCP CONNECTIONS                                               ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    
+    uint64_t handshakes = tcp.handshake_rtt.count();
+    out << Colors::LABEL << "  Opened: " << Colors::RESET << entered(TcpState::SynSent)
+        << Colors::LABEL << "  Handshakes: " << Colors::RESET << handshakes
+        << Colors::LABEL << "  Mid-stream: " << Colors::RESET << entered(TcpState::Established) - handshakes
+        << Colors::LABEL << "  Closed: " << Colors::RESET << entered(TcpState::Closed)
+        << Colors::LABEL << "  Reset: " << Colors::RESET << entered(TcpState::Reset) << '\n';
+    if (handshakes != 0) {
+        out << Colors::LABEL << "  Handshake RTT  p50: " << Colors::RESET << formatDuration(tcp.handshake_rtt.percentile(0.50))
+            << Colors::LABEL << "  p99: " << Colors::RESET << formatDuration(tcp.handshake_rtt.percentile(0.99))
+            << Colors::LABEL << "  max: " << Colors::RESET << formatDuration(tcp.handshake_rtt.maxNs()) << '\n';
+    }
+    double share = tcp.data_segments ? 100.0 * static_cast<double>(tcp.retransmissions) / static_cast<double>(tcp.data_segments) : 0.0;
+    out << Colors::LABEL << "  Retransmissions: " << Colors::RESET << tcp.retransmissions
+        << Colors::LABEL << " of " << tcp.data_segments << " data segments ("
+        << std::fixed << std::setprecision(2) << share << "%)" << Colors::RESET << '\n';
+    out << '\n';
+}
+
+/**
+ * @brief Displays interface statistics
+ * @param out Frame being rendered
+ * @param view Snapshot being rendered
+ */
+void Dashboard::displayInterfaceStats(std::ostream& out, const DashboardSnapshot& view) {
+    const StatsCounters& counters = view.counters;
+    // Find max count for scaling
+    size_t max_count = *std::max_element(counters.interface_counts.begin(), counters.interface_counts.end());
+    if (max_count == 0) {
+        return;  // Don't display if no interface data
+    }
+    
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  INTERFACE STATISTICS                                          ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    
     // Display each interface
-    for (const auto& pair : interface_counts) {
-        std::string iface = pair.first;
-        size_t count = pair.second;
-        size_t bytes = interface_bytes[iface];
+    for (size_t i = 0; i < MAX_INTERFACES; i++) {
+        size_t count = counters.interface_counts[i];
+        if (count == 0) {
+            continue;
+        }
+        size_t bytes = counters.interface_bytes[i];
         
-        std::cout << Colors::LABEL << "  Interface: " << Colors::RESET << iface << std::endl;
-        drawBar("Packets", count, max_count, Colors::BAR, 40);
-        std::cout << Colors::LABEL << "           └─ Traffic: " << formatBytes(bytes) 
-                  << Colors::RESET << std::endl;
-        std::cout << std::endl;
+        out << Colors::LABEL << "  Interface: " << Colors::RESET
+            << NetworkMonitor::interfaceName(static_cast<uint16_t>(i)) << '\n';
+        drawBar(out, "Packets", count, max_count, Colors::BAR, 40);
+        out << Colors::LABEL << "           └─ Traffic: " << formatBytes(bytes)
+            << "  Rate: " << formatRate(view.rates.rate(interfaceRateChannel(i), 10).bytes_per_sec)
+            << " (peak " << formatRate(view.peak_rates[interfaceRateChannel(i)].bytes_per_sec) << ")"
+            << Colors::RESET << '\n';
+        out << '\n';
     }
 }
 
 /**
  * @brief Displays the complete dashboard to console
+ * 
+ * The frame is built in memory and handed to the TerminalFrame, which
+ * writes only the cells that changed since the previous refresh.
  */
 void Dashboard::display() {
-    clearScreen();
+    std::lock_guard<std::mutex> lock(refresh_mutex);
+    uint64_t start_ns = monotonicNs();
+    collect();
+    std::shared_ptr<const DashboardSnapshot> view = snapshot();
+    std::ostream& out = frame.stream();
     
     // Dashboard title
-    std::cout << Colors::HEADER;
-    std::cout << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║                                                                ║" << std::endl;
-    std::cout << "║          NETWORK TRAFFIC ANALYZER DASHBOARD                    ║" << std::endl;
-    std::cout << "║          Real-time Monitoring with OSI Layer View              ║" << std::endl;
-    std::cout << "║                                                                ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
-    std::cout << std::endl;
+    out << Colors::HEADER;
+    out << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║                                                                ║\n";
+    out << "║          NETWORK TRAFFIC ANALYZER DASHBOARD                    ║\n";
+    out << "║          Real-time Monitoring with OSI Layer View              ║\n";
+    out << "║                                                                ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    out << '\n';
     
     // Display sections
-    displayTrafficStats();
-    displayInterfaceStats();  // Show interface stats if available
-    displayProtocolDistribution();
-    displayTopConnections();
+    displayTrafficStats(out, *view);
+    displayHealth(out, view->health);
+    displayInterfaceStats(out, *view);  // Show interface stats if available
+    displayProtocolDistribution(out, *view);
+    displayApplications(out, *view);
+    displayTopConnections(out, "TOP 10 CONNECTIONS", view->top_by_packets);
+    displayTopConnections(out, "TOP 10 CONNECTIONS BY TRAFFIC", view->top_by_bytes);
+    displayTcp(out, *view);
+    displayTopTalkers(out, *view);
+    displaySketches(out, *view);
     
     // Legend
-    std::cout << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗" << std::endl;
-    std::cout << "║  COLOR LEGEND (OSI Model)                                      ║" << std::endl;
-    std::cout << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << std::endl;
-    std::cout << "  " << Colors::TCP << "■ TCP" << Colors::RESET << " - Layer 4 (Transport Layer)" << std::endl;
-    std::cout << "  " << Colors::UDP << "■ UDP" << Colors::RESET << " - Layer 4 (Transport Layer)" << std::endl;
-    std::cout << "  " << Colors::ICMP << "■ ICMP" << Colors::RESET << " - Layer 3 (Network Layer)" << std::endl;
-    std::cout << "  " << Colors::OTHER << "■ Other" << Colors::RESET << " - Various Layers" << std::endl;
-    std::cout << std::endl;
-    
-    std::cout << Colors::LABEL << "Press Ctrl+C to stop monitoring..." << Colors::RESET << std::endl;
+    out << Colors::HEADER << "╔════════════════════════════════════════════════════════════════╗\n";
+    out << "║  COLOR LEGEND (OSI Model)                                      ║\n";
+    out << "╚════════════════════════════════════════════════════════════════╝" << Colors::RESET << '\n';
+    out << "  " << Colors::TCP << "■ TCP" << Colors::RESET << " - Layer 4 (Transport Layer)\n";
+    out << "  " << Colors::UDP << "■ UDP" << Colors::RESET << " - Layer 4 (Transport Layer)\n";
+    out << "  " << Colors::ICMP << "■ ICMP" << Colors::RESET << " - Layer 3 (Network Layer)\n";
+    out << "  " << Colors::OTHER << "■ Other" << Colors::RESET << " - Various Layers\n";
+    out << '\n';
+    
+    out << Colors::LABEL << "Press Ctrl+C to stop monitoring..." << Colors::RESET << '\n';
+    frame.present();
+    
+    render_latency.record(monotonicNs() - start_ns);
 }
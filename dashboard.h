@@ -16,7 +16,13 @@
 #include <chrono>
 #include <iomanip>
 #include <algorithm>
+#include <array>
+#include <memory>
+#include <mutex>
 #include "network_monitor.h"
+#include "stats_shard.h"
+#include "terminal_frame.h"
+#include "object_pool.h"
 
 /**
  * @namespace Colors
@@ -37,6 +43,9 @@ namespace Colors {
     // Other protocols - Magenta
     const std::string OTHER = "\033[38;5;201m";    // Magenta for others
     
+    // OSI Layer 7 (Application Layer) - Violet
+    const std::string APP = "\033[38;5;141m";      // Violet for application protocols
+    
     // UI Elements
     const std::string HEADER = "\033[38;5;51m";    // Cyan for headers
     const std::string LABEL = "\033[38;5;250m";    // Gray for labels
@@ -44,25 +53,60 @@ namespace Colors {
 }
 
 /**
- * @struct ConnectionInfo
- * @brief Stores information about a network connection
+ * @struct SketchEstimate
+ * @brief Sketch estimates for one of the heaviest hosts
  */
-struct ConnectionInfo {
-    std::string source_ip;
-    std::string dest_ip;
-    int source_port;
-    int dest_port;
-    std::string protocol;
-    size_t packet_count;
-    size_t total_bytes;
-    
-    bool operator<(const ConnectionInfo& other) const {
-        if (source_ip != other.source_ip) return source_ip < other.source_ip;
-        if (dest_ip != other.dest_ip) return dest_ip < other.dest_ip;
-        if (source_port != other.source_port) return source_port < other.source_port;
-        if (dest_port != other.dest_port) return dest_port < other.dest_port;
-        return protocol < other.protocol;
-    }
+struct SketchEstimate {
+    uint8_t address[16];
+    uint8_t ip_version;
+    double sources = 0.0;      ///< Distinct sources that sent to the host
+    double ports = 0.0;        ///< Distinct destination ports the host sent to
+    uint64_t bytes_sent = 0;   ///< Bytes the host sent (never underestimated)
+};
+
+/**
+ * @struct SketchSummary
+ * @brief Estimates read from the merged sketches at one refresh
+ */
+struct SketchSummary {
+    bool enabled = false;
+    double distinct_sources = 0.0;
+    double distinct_destinations = 0.0;
+    double distinct_flows = 0.0;
+    size_t memory_bytes = 0;              ///< Sketch storage of one shard
+    std::vector<SketchEstimate> hosts;    ///< Estimates for the heaviest hosts, in top_hosts order
+};
+
+/**
+ * @struct DashboardSnapshot
+ * @brief Immutable view of the statistics merged at one refresh
+ * 
+ * Published by Dashboard::refresh() and shared by every consumer (rendering,
+ * export, alerting); a snapshot is never modified once published.
+ */
+struct DashboardSnapshot {
+    StatsCounters counters;                  ///< Totals across all shards
+    std::vector<FlowRecord> top_by_packets;  ///< Merged heaviest flows by packets, descending
+    std::vector<FlowRecord> top_by_bytes;    ///< Merged heaviest flows by bytes, descending
+    std::vector<TalkerRecord> top_hosts;     ///< Merged heaviest hosts by bytes, descending
+    std::vector<TalkerRecord> top_subnets;   ///< Merged heaviest subnets by bytes, descending
+    size_t active_flows = 0;                 ///< Live flows across all shards
+    size_t evicted_flows = 0;                ///< Flows expired or evicted so far
+    HealthReport health;                     ///< Pipeline health per interface and render latency
+    TrafficRates rates;                      ///< Per-second counters merged across shards
+    std::array<Rate, TrafficRates::CHANNELS> peak_rates{};  ///< Highest one-second rates seen per channel
+    double elapsed_seconds = 0.0;            ///< Time since the dashboard started
+    uint64_t sequence = 0;                   ///< Refresh number (0 before the first refresh)
+    SketchSummary sketches;                  ///< Distinct counts and fan-in/fan-out (with --sketches)
+    TcpStats tcp;                            ///< TCP state transitions, handshake RTT and retransmissions
+    uint32_t interval = 0;                   ///< History interval in progress (StatsShard::currentInterval())
+    bool interval_entered = false;           ///< Every shard has published a snapshot from interval
+    StatsCounters interval_start;            ///< Totals when interval began, exact once interval_entered
+    
+    /**
+     * @brief Empties the snapshot for reuse, keeping the capacity of its lists
+     */
+    void reset();
 };
 
 /**
@@ -70,83 +114,201 @@ struct ConnectionInfo {
  * @brief Real-time dashboard for network traffic visualization
  * 
  * Collects packet statistics and displays color-coded visualizations
- * organized by OSI model layers and protocol types.
+ * organized by OSI model layers and protocol types. Statistics are gathered
+ * in per-thread StatsShard instances and merged here on every refresh, so
+ * capture threads never share mutable state or block on the renderer.
+ * 
+ * Each refresh publishes a new DashboardSnapshot by swapping a shared
+ * pointer; readers keep whichever snapshot they loaded for as long as they
+ * need it, so rendering and export never hold a lock while they work.
  */
 class Dashboard {
 public:
     /**
      * @brief Constructor - initializes the dashboard
+     * @param flow_config Flow table settings applied to every shard
+     * @param talker_config Host aggregation settings applied to every shard
+     */
+    explicit Dashboard(const FlowTableConfig& flow_config = FlowTableConfig(),
+                       const TalkerConfig& talker_config = TalkerConfig());
+    
+    /**
+     * @brief Creates a statistics shard for one capture thread
+     * 
+     * The returned shard is owned by the dashboard and must only be updated
+     * by the thread it was handed to.
+     * 
+     * @return Pointer to the new shard
+     */
+    StatsShard* createShard();
+    
+    /**
+     * @brief Creates a shard that only publishes a capture thread's health
+     * 
+     * Used by capture threads whose packets are accounted by analysis
+     * workers. The shard's tables are sized to the minimum and only its
+     * health counters are merged.
+     * 
+     * @return Pointer to the new shard
      */
-    Dashboard();
+    StatsShard* createHealthShard();
     
     /**
-     * @brief Updates dashboard with new packet information
-     * @param info PacketInfo structure containing packet details
+     * @brief Merges the shards and publishes a new snapshot
+     * 
+     * Safe to call from any thread; concurrent refreshes are serialized.
      */
-    void updatePacket(const PacketInfo& info);
+    void refresh();
     
     /**
-     * @brief Displays the dashboard to console
+     * @brief Refreshes and displays the dashboard to console
+     * 
+     * Only cells that changed since the previous call are redrawn, in a
+     * single write to stdout.
      */
     void display();
     
+    /**
+     * @brief Gets the snapshot published by the latest refresh
+     * 
+     * Safe to call from any thread. The returned snapshot stays valid and
+     * unchanged while it is held, even if newer ones are published.
+     * 
+     * @return Latest snapshot (empty before the first refresh)
+     */
+    std::shared_ptr<const DashboardSnapshot> snapshot() const;
+    
+    /**
+     * @brief Gets the pipeline health as of the last refresh
+     * 
+     * Safe to call from any thread, e.g. to alert when packets are dropped
+     * or a processing stage becomes the bottleneck.
+     * 
+     * @return Per-interface capture counters and stage latencies
+     */
+    HealthReport healthReport() const;
+    
     /**
      * @brief Gets the color code for a given protocol
-     * @param protocol Protocol name (TCP, UDP, ICMP, etc.)
+     * @param protocol Protocol identifier (TCP, UDP, ICMP, etc.)
      * @return ANSI color code string
      */
-    static std::string getProtocolColor(const std::string& protocol);
+    static const std::string& getProtocolColor(Protocol protocol);
     
     /**
      * @brief Gets the OSI layer description for a protocol
-     * @param protocol Protocol name
+     * @param protocol Protocol identifier
      * @return OSI layer description
      */
-    static std::string getOSILayer(const std::string& protocol);
+    static const char* getOSILayer(Protocol protocol);
 
 private:
-    // Statistics
-    std::map<std::string, size_t> protocol_counts;
-    std::map<std::string, size_t> protocol_bytes;
-    std::map<std::string, size_t> interface_counts;  ///< Packet count per interface
-    std::map<std::string, size_t> interface_bytes;   ///< Byte count per interface
-    std::map<ConnectionInfo, size_t> connections;
-    size_t total_packets;
-    size_t total_bytes;
+    // Per-thread shards (the mutex only guards the vector itself)
+    std::vector<std::unique_ptr<StatsShard>> shards;
+    std::vector<std::unique_ptr<StatsShard>> health_shards;  ///< Health-only shards of fanned-in capture threads
+    std::mutex shard_mutex;
+    FlowTableConfig flow_config;
+    TalkerConfig talker_config;
+    TrafficSketches merged_sketches;         ///< Scratch for merging shard sketches (refresh only)
+    
+    // Published statistics (accessed with std::atomic_load/std::atomic_store)
+    std::shared_ptr<const DashboardSnapshot> current;
+    SharedObjectPool<DashboardSnapshot> snapshot_pool;  ///< Snapshots recycled once no reader holds them
+    std::mutex refresh_mutex;                ///< Serializes refreshes and rendering
+    uint64_t refreshes;                      ///< Snapshots published so far
+    LatencyHistogram render_latency;         ///< Time to refresh and draw one frame
+    std::array<Rate, TrafficRates::CHANNELS> peak_rates{};  ///< Running peaks (refresh only)
     
     // Timing
     std::chrono::steady_clock::time_point start_time;
-    std::chrono::steady_clock::time_point last_update;
+    
+    // Rendering
+    TerminalFrame frame;                     ///< Previous frame on screen and buffers for the next
+    static constexpr int MAX_BAR_WIDTH = 64; ///< Widest bar drawBar() renders
+    static constexpr size_t SNAPSHOT_POOL = 4;  ///< Snapshots kept for reuse
+    
+    /**
+     * @brief Merges the latest snapshot of every shard, publishes the result
+     *        and requests new shard snapshots
+     * 
+     * Callers hold refresh_mutex.
+     */
+    void collect();
     
     /**
      * @brief Displays protocol distribution chart
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
      */
-    void displayProtocolDistribution();
+    void displayProtocolDistribution(std::ostream& out, const DashboardSnapshot& view);
+    
+    /**
+     * @brief Displays the traffic of each application protocol
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
+     */
+    void displayApplications(std::ostream& out, const DashboardSnapshot& view);
     
     /**
      * @brief Displays traffic statistics
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
+     */
+    void displayTrafficStats(std::ostream& out, const DashboardSnapshot& view);
+    
+    /**
+     * @brief Displays per-interface capture counters and stage latencies
+     * @param out Frame being rendered
+     * @param report Merged pipeline health
      */
-    void displayTrafficStats();
+    void displayHealth(std::ostream& out, const HealthReport& report);
     
     /**
      * @brief Displays top connections
+     * @param out Frame being rendered
+     * @param title Panel title
+     * @param records Merged top list, sorted descending
      */
-    void displayTopConnections();
+    void displayTopConnections(std::ostream& out, const std::string& title, const std::vector<FlowRecord>& records);
+    
+    /**
+     * @brief Displays the heaviest hosts and subnets
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
+     */
+    void displayTopTalkers(std::ostream& out, const DashboardSnapshot& view);
+    
+    /**
+     * @brief Displays the sketch estimates
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
+     */
+    void displaySketches(std::ostream& out, const DashboardSnapshot& view);
+    
+    /**
+     * @brief Displays TCP connection states, handshake RTT and retransmissions
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
+     */
+    void displayTcp(std::ostream& out, const DashboardSnapshot& view);
     
     /**
      * @brief Displays interface statistics
+     * @param out Frame being rendered
+     * @param view Snapshot being rendered
      */
-    void displayInterfaceStats();
+    void displayInterfaceStats(std::ostream& out, const DashboardSnapshot& view);
     
     /**
      * @brief Draws a horizontal bar chart
+     * @param out Frame being rendered
      * @param label Label for the bar
      * @param value Current value
      * @param max_value Maximum value for scaling
      * @param color Color for the bar
-     * @param width Width of the bar in characters
+     * @param width Width of the bar in characters (at most MAX_BAR_WIDTH)
      */
-    void drawBar(const std::string& label, size_t value, size_t max_value, 
+    void drawBar(std::ostream& out, const std::string& label, size_t value, size_t max_value, 
                  const std::string& color, int width = 40);
     
     /**
@@ -157,9 +319,18 @@ private:
     std::string formatBytes(size_t bytes);
     
     /**
-     * @brief Clears the terminal screen
+     * @brief Formats a byte rate for human-readable display
+     * @param bytes_per_sec Bytes per second
+     * @return Formatted string (e.g., "1.50 MB/s")
+     */
+    std::string formatRate(double bytes_per_sec);
+    
+    /**
+     * @brief Formats a duration for human-readable display
+     * @param ns Duration in nanoseconds
+     * @return Formatted string (e.g., "850 ns", "1.2 us")
      */
-    void clearScreen();
+    static std::string formatDuration(uint64_t ns);
 };
 
 #endif // DASHBOARD_H
@@ -0,0 +1,568 @@
+/**
+ * @file file_backend.cpp
+ * @brief Implementation of the pcap/pcapng file reader
+ * 
+ * This file contains the file mapping, the in-place record parsers for both
+ * container formats, record boundary detection for parallel readers and
+ * timestamp-paced replay.
+ */
+
+#include "file_backend.h"
+#include "health_metrics.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <thread>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+constexpr uint32_t PCAP_MAGIC_US = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_NS = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_SHB = 0x0A0D0D0A;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr uint32_t PCAPNG_IDB = 1;
+constexpr uint32_t PCAPNG_SPB = 3;
+constexpr uint32_t PCAPNG_EPB = 6;
+constexpr size_t PCAP_FILE_HEADER_SIZE = 24;
+constexpr size_t PCAP_RECORD_HEADER_SIZE = 16;
+/// Largest record accepted while looking for a record boundary
+constexpr uint32_t MAX_RECORD_SIZE = 262144;
+/// Consecutive records that must parse for an offset to count as a boundary
+constexpr int BOUNDARY_CHAIN = 8;
+
+inline uint32_t swap32(uint32_t v) {
+    return ((v & 0xFF) << 24) | ((v & 0xFF00) << 8) | ((v >> 8) & 0xFF00) | (v >> 24);
+}
+
+inline uint32_t rawRead32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+}
+
+/**
+ * @brief Constructor - creates an unopened backend
+ */
+FileBackend::FileBackend()
+    : data(nullptr), size(0), format(Format::Pcap), swapped(false), nanosecond(false),
+      link_type(DLT_EN10MB), file_snaplen(0), position(0), end(0), stopped(false),
+      records_read(0), has_filter(false), program(), replay(false), replay_started(false),
+      replay_origin_ts_ns(0), replay_origin_wall_ns(0), timeout_ms(1000) {
+    batch.nanosecond = true;  // Both formats carry at least microseconds; keep whatever they have
+}
+
+/**
+ * @brief Destructor - releases the filter and the mapping
+ */
+FileBackend::~FileBackend() {
+    if (has_filter) {
+        pcap_freecode(&program);
+    }
+    unmapFile();
+}
+
+uint16_t FileBackend::read16(const uint8_t* p) const {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return swapped ? static_cast<uint16_t>((v << 8) | (v >> 8)) : v;
+}
+
+uint32_t FileBackend::read32(const uint8_t* p) const {
+    uint32_t v = rawRead32(p);
+    return swapped ? swap32(v) : v;
+}
+
+/**
+ * @brief Maps the file into memory
+ * 
+ * Falls back to reading the whole file where mmap() is not available.
+ * 
+ * @param path File to map
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool FileBackend::mapFile(const std::string& path, std::string& error) {
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+        error = "empty or unreadable file";
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED) {
+        error = std::string("mmap: ") + std::strerror(errno);
+        size = 0;
+        return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t*>(mapped);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    if (contents.empty()) {
+        error = "empty or unreadable file";
+        return false;
+    }
+    size = contents.size();
+    data = contents.data();
+#endif
+    return true;
+}
+
+/**
+ * @brief Releases the mapping
+ */
+void FileBackend::unmapFile() {
+#ifndef _WIN32
+    if (data) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+    contents.clear();
+    data = nullptr;
+    size = 0;
+}
+
+/**
+ * @brief Records a pcapng Interface Description Block
+ * @param body Block body
+ * @param length Body length in bytes
+ */
+void FileBackend::addInterface(const uint8_t* body, size_t length) {
+    Interface iface{1000000, DLT_EN10MB};
+    if (length >= 8) {
+        iface.link_type = read16(body);
+        
+        // Options: code, length, value padded to 32 bits
+        size_t offset = 8;
+        while (offset + 4 <= length) {
+            uint16_t code = read16(body + offset);
+            uint16_t option_length = read16(body + offset + 2);
+            if (code == 0 || offset + 4 + option_length > length) {
+                break;
+            }
+            if (code == 9 && option_length >= 1) {  // if_tsresol
+                uint8_t resolution = body[offset + 4];
+                uint8_t exponent = resolution & 0x7F;
+                if (resolution & 0x80) {
+                    iface.units_per_second = exponent < 64 ? (1ULL << exponent) : 1000000;
+                } else {
+                    uint64_t units = 1;
+                    for (uint8_t i = 0; i < exponent && i < 19; i++) {
+                        units *= 10;
+                    }
+                    iface.units_per_second = units;
+                }
+            }
+            offset += 4 + ((option_length + 3u) & ~3u);
+        }
+    }
+    if (interfaces.empty()) {
+        link_type = iface.link_type;
+    }
+    interfaces.push_back(iface);
+}
+
+/**
+ * @brief Parses the file header (and leading pcapng metadata blocks)
+ * 
+ * Also reads the timestamp of the file's first packet, which every part
+ * replays relative to.
+ * 
+ * @param first_record Receives the offset of the first record
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool FileBackend::parseHeader(size_t& first_record, std::string& error) {
+    if (size < 12) {
+        error = "file too short for a capture header";
+        return false;
+    }
+    uint32_t magic = rawRead32(data);
+    if (magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+        magic == swap32(PCAP_MAGIC_US) || magic == swap32(PCAP_MAGIC_NS)) {
+        if (size < PCAP_FILE_HEADER_SIZE) {
+            error = "truncated pcap file header";
+            return false;
+        }
+        format = Format::Pcap;
+        swapped = magic == swap32(PCAP_MAGIC_US) || magic == swap32(PCAP_MAGIC_NS);
+        nanosecond = magic == PCAP_MAGIC_NS || magic == swap32(PCAP_MAGIC_NS);
+        file_snaplen = read32(data + 16);
+        link_type = static_cast<int>(read32(data + 20) & 0xFFFF);
+        first_record = PCAP_FILE_HEADER_SIZE;
+        struct pcap_pkthdr pkthdr;
+        const u_char* packet;
+        size_t next;
+        if (!readRecord(first_record, pkthdr, replay_origin_ts_ns, packet, next)) {
+            replay_origin_ts_ns = 0;   // No complete packet; dispatch() reports the truncation
+        }
+        return true;
+    }
+    if (magic == PCAPNG_SHB) {
+        format = Format::Pcapng;
+        // Read the section header and interface descriptions that precede the packets
+        size_t offset = 0;
+        while (offset < size) {
+            struct pcap_pkthdr pkthdr;
+            uint64_t ts_ns;
+            const u_char* packet;
+            size_t next;
+            if (!readRecord(offset, pkthdr, ts_ns, packet, next)) {
+                error = "malformed pcapng block";
+                return false;
+            }
+            if (packet != nullptr) {
+                replay_origin_ts_ns = ts_ns;
+                break;
+            }
+            offset = next;
+        }
+        first_record = 0;  // Part 0 re-reads the metadata blocks in order
+        return true;
+    }
+    error = "not a pcap or pcapng file";
+    return false;
+}
+
+/**
+ * @brief Reads one record header in place
+ * @param offset Offset of the record
+ * @param pkthdr Receives capture metadata for packet records (ts.tv_usec in nanoseconds)
+ * @param ts_ns Receives the timestamp in nanoseconds for packet records
+ * @param packet Receives the packet data, or nullptr for non-packet blocks
+ * @param next Receives the offset of the following record
+ * @return false if the record is truncated or malformed
+ */
+bool FileBackend::readRecord(size_t offset, struct pcap_pkthdr& pkthdr, uint64_t& ts_ns,
+                             const u_char*& packet, size_t& next) {
+    const uint8_t* p = data + offset;
+    packet = nullptr;
+    
+    if (format == Format::Pcap) {
+        if (size - offset < PCAP_RECORD_HEADER_SIZE) {
+            return false;
+        }
+        uint32_t seconds = read32(p);
+        uint32_t fraction = read32(p + 4);
+        uint32_t caplen = read32(p + 8);
+        if (caplen > size - offset - PCAP_RECORD_HEADER_SIZE) {
+            return false;
+        }
+        pkthdr.ts.tv_sec = seconds;
+        pkthdr.ts.tv_usec = nanosecond ? fraction : fraction * 1000;
+        pkthdr.caplen = caplen;
+        pkthdr.len = read32(p + 12);
+        ts_ns = static_cast<uint64_t>(seconds) * 1000000000ULL +
+                (nanosecond ? fraction : static_cast<uint64_t>(fraction) * 1000ULL);
+        packet = p + PCAP_RECORD_HEADER_SIZE;
+        next = offset + PCAP_RECORD_HEADER_SIZE + caplen;
+        return true;
+    }
+    
+    if (size - offset < 12) {
+        return false;
+    }
+    uint32_t type = rawRead32(p);  // Palindromic for the section header
+    if (type == PCAPNG_SHB) {
+        uint32_t byte_order = rawRead32(p + 8);
+        if (byte_order != PCAPNG_BYTE_ORDER_MAGIC && byte_order != swap32(PCAPNG_BYTE_ORDER_MAGIC)) {
+            return false;
+        }
+        swapped = byte_order != PCAPNG_BYTE_ORDER_MAGIC;
+    }
+    type = read32(p);
+    uint32_t total = read32(p + 4);
+    if (total < 12 || (total & 3) != 0 || total > size - offset || read32(p + total - 4) != total) {
+        return false;
+    }
+    const uint8_t* body = p + 8;
+    size_t body_length = total - 12;
+    next = offset + total;
+    
+    if (type == PCAPNG_SHB) {
+        interfaces.clear();
+    } else if (type == PCAPNG_IDB) {
+        addInterface(body, body_length);
+    } else if (type == PCAPNG_EPB) {
+        if (body_length < 20) {
+            return false;
+        }
+        uint32_t interface_id = read32(body);
+        uint64_t timestamp = (static_cast<uint64_t>(read32(body + 4)) << 32) | read32(body + 8);
+        uint32_t caplen = read32(body + 12);
+        if (caplen > body_length - 20) {
+            return false;
+        }
+        uint64_t units = interface_id < interfaces.size() ? interfaces[interface_id].units_per_second : 1000000;
+        uint64_t seconds = timestamp / units;
+        uint64_t fraction = timestamp % units;
+        uint64_t fraction_ns = static_cast<uint64_t>(static_cast<long double>(fraction) * 1e9L / units);
+        pkthdr.ts.tv_sec = static_cast<decltype(pkthdr.ts.tv_sec)>(seconds);
+        pkthdr.ts.tv_usec = static_cast<decltype(pkthdr.ts.tv_usec)>(fraction_ns);
+        pkthdr.caplen = caplen;
+        pkthdr.len = read32(body + 16);
+        ts_ns = seconds * 1000000000ULL + fraction_ns;
+        packet = body + 20;
+    } else if (type == PCAPNG_SPB) {
+        if (body_length < 4) {
+            return false;
+        }
+        uint32_t length = read32(body);
+        uint32_t caplen = length < body_length - 4 ? length : static_cast<uint32_t>(body_length - 4);
+        pkthdr.ts.tv_sec = 0;
+        pkthdr.ts.tv_usec = 0;
+        pkthdr.caplen = caplen;
+        pkthdr.len = length;
+        ts_ns = 0;  // Simple packet blocks carry no timestamp
+        packet = body + 4;
+    }
+    return true;
+}
+
+/**
+ * @brief Checks whether a chain of plausible records starts at an offset
+ * 
+ * Classic pcap records have no marker, so a candidate must be followed by
+ * BOUNDARY_CHAIN records with sane lengths and close timestamps. pcapng
+ * blocks repeat their length at the end, which is checked instead.
+ * 
+ * @param offset Candidate record offset
+ * @return true if the following records all parse and look consistent
+ */
+bool FileBackend::validRecordChain(size_t offset) {
+    uint32_t previous_seconds = 0;
+    for (int i = 0; i < BOUNDARY_CHAIN; i++) {
+        if (offset == size) {
+            return i > 0;
+        }
+        const uint8_t* p = data + offset;
+        if (format == Format::Pcap) {
+            if (size - offset < PCAP_RECORD_HEADER_SIZE) {
+                return false;
+            }
+            uint32_t seconds = read32(p);
+            uint32_t fraction = read32(p + 4);
+            uint32_t caplen = read32(p + 8);
+            uint32_t length = read32(p + 12);
+            uint32_t limit = file_snaplen > 0 && file_snaplen < MAX_RECORD_SIZE ? file_snaplen : MAX_RECORD_SIZE;
+            if (caplen > limit || caplen > length || length > MAX_RECORD_SIZE ||
+                fraction >= (nanosecond ? 1000000000u : 1000000u) ||
+                caplen > size - offset - PCAP_RECORD_HEADER_SIZE) {
+                return false;
+            }
+            if (i > 0 && (seconds + 3600 < previous_seconds || seconds > previous_seconds + 3600)) {
+                return false;
+            }
+            previous_seconds = seconds;
+            offset += PCAP_RECORD_HEADER_SIZE + caplen;
+        } else {
+            if (size - offset < 12) {
+                return false;
+            }
+            uint32_t type = read32(p);
+            uint32_t total = read32(p + 4);
+            bool known = (type >= 1 && type <= 10) || type == PCAPNG_SHB;
+            if (!known || total < 12 || (total & 3) != 0 || total > size - offset ||
+                read32(p + total - 4) != total) {
+                return false;
+            }
+            offset += total;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the first record boundary at or after an offset
+ * @param offset Arbitrary file offset
+ * @param first_record Offset of the first record in the file
+ * @return Record offset, or the file size if none is found
+ */
+size_t FileBackend::findRecordBoundary(size_t offset, size_t first_record) {
+    if (offset <= first_record) {
+        return first_record;
+    }
+    size_t step = 1;
+    if (format == Format::Pcapng) {
+        step = 4;  // Blocks are 32-bit aligned
+        offset = (offset + 3) & ~static_cast<size_t>(3);
+    }
+    for (; offset < size; offset += step) {
+        if (validRecordChain(offset)) {
+            return offset;
+        }
+    }
+    return size;
+}
+
+/**
+ * @brief Maps a capture file and selects this reader's part of it
+ * @param path Path of the pcap or pcapng file
+ * @param config Capture settings (filter, replay mode, part number)
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool FileBackend::open(const std::string& path, const CaptureConfig& config, std::string& error) {
+    if (!mapFile(path, error)) {
+        return false;
+    }
+    size_t first_record = 0;
+    if (!parseHeader(first_record, error)) {
+        unmapFile();
+        return false;
+    }
+    
+    // Applying the filter is the only per-packet cost beyond parsing the record header
+    if (!config.filter.empty()) {
+        pcap_t* dead = pcap_open_dead(link_type, static_cast<int>(MAX_RECORD_SIZE));
+        if (dead == nullptr) {
+            error = "pcap_open_dead failed";
+            unmapFile();
+            return false;
+        }
+        has_filter = compileFilter(dead, config.filter, program, error);
+        pcap_close(dead);
+        if (!has_filter) {
+            unmapFile();
+            return false;
+        }
+    }
+    
+    unsigned int parts = config.file_parts > 0 ? config.file_parts : 1;
+    unsigned int part = config.file_part < parts ? config.file_part : parts - 1;
+    position = findRecordBoundary(size / parts * part, first_record);
+    end = part + 1 == parts ? size : findRecordBoundary(size / parts * (part + 1), first_record);
+    
+    replay = config.replay;
+    replay_clock = config.replay_clock;
+    timeout_ms = config.timeout_ms;
+    return true;
+}
+
+/**
+ * @brief Delivers the next batch of records straight from the mapping
+ * 
+ * In replay mode a record is held back until as much time has passed since
+ * the replay started as separates its timestamp from the file's first
+ * packet. The parts of a file share the start, so each part begins when its
+ * first packet is due rather than at once. A partial batch is delivered
+ * before waiting, and a single call waits at most the read timeout.
+ * 
+ * @param max_packets Upper bound on packets to deliver (-1 for no limit)
+ * @param handler Function invoked for every filled batch
+ * @param user Opaque pointer passed to the handler
+ * @return Number of packets delivered, or -1 at the end of the part or after breakLoop()
+ */
+int FileBackend::dispatch(int max_packets, BatchHandler handler, void* user) {
+    if (stopped.load(std::memory_order_relaxed) || position >= end) {
+        return -1;
+    }
+    
+    int delivered = 0;
+    batch.count = 0;
+    while (position < end && batch.count < PacketBatch::CAPACITY &&
+           (max_packets < 0 || delivered < max_packets)) {
+        struct pcap_pkthdr& pkthdr = batch.headers[batch.count];
+        uint64_t ts_ns = 0;
+        const u_char* packet;
+        size_t next;
+        if (!readRecord(position, pkthdr, ts_ns, packet, next)) {
+            std::cerr << "Truncated or malformed record at offset " << position << ", stopping" << std::endl;
+            end = position;
+            break;
+        }
+        if (packet == nullptr) {
+            position = next;
+            continue;
+        }
+        
+        if (replay) {
+            if (!replay_started) {
+                // The first part to reach a packet starts the clock for all of them
+                replay_started = true;
+                replay_origin_wall_ns = monotonicNs();
+                if (replay_clock) {
+                    uint64_t expected = 0;
+                    if (!replay_clock->compare_exchange_strong(expected, replay_origin_wall_ns)) {
+                        replay_origin_wall_ns = expected;
+                    }
+                }
+            }
+            uint64_t due = replay_origin_wall_ns + (ts_ns > replay_origin_ts_ns ? ts_ns - replay_origin_ts_ns : 0);
+            uint64_t now = monotonicNs();
+            if (now < due) {
+                if (batch.count > 0) {
+                    break;  // Deliver what is due before waiting
+                }
+                uint64_t wait = due - now;
+                uint64_t limit = static_cast<uint64_t>(timeout_ms) * 1000000ULL;
+                std::this_thread::sleep_for(std::chrono::nanoseconds(wait < limit ? wait : limit));
+                if (monotonicNs() < due || stopped.load(std::memory_order_relaxed)) {
+                    return 0;
+                }
+            }
+        }
+        
+        position = next;
+        records_read++;
+        if (has_filter && pcap_offline_filter(&program, &pkthdr, packet) == 0) {
+            continue;
+        }
+        batch.packets[batch.count++] = packet;
+        delivered++;
+    }
+    
+    if (batch.count > 0) {
+        handler(user, batch);
+        batch.count = 0;
+    }
+    return delivered;
+}
+
+/**
+ * @brief Stops delivery after the current batch (async-signal-safe)
+ */
+void FileBackend::breakLoop() {
+    stopped.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Reports the records read by this part
+ * @param stats Receives the record count as received packets (nothing is dropped)
+ * @return Always true
+ */
+bool FileBackend::stats(CaptureStats& stats) {
+    stats.received = records_read;
+    stats.dropped = 0;
+    stats.interface_dropped = 0;
+    return true;
+}
+
+/**
+ * @brief Gets the link-layer type of the file
+ * @return Link type from the file header (first interface for pcapng)
+ */
+int FileBackend::datalink() const {
+    return link_type;
+}
@@ -0,0 +1,145 @@
+/**
+ * @file file_backend.h
+ * @brief Memory-mapped pcap/pcapng file reader
+ * 
+ * This header defines the FileBackend class, which replays capture files
+ * through the same batch pipeline as live capture.
+ */
+
+#ifndef FILE_BACKEND_H
+#define FILE_BACKEND_H
+
+#include "capture_backend.h"
+
+/**
+ * @class FileBackend
+ * @brief Capture backend reading a pcap or pcapng file in place
+ * 
+ * The file is memory-mapped and records are parsed where they lie: batches
+ * point straight into the mapping, so no packet data is copied. Records are
+ * delivered as fast as possible, or paced by their timestamps in replay mode.
+ * 
+ * A file can be split into several parts read by independent backends. Each
+ * part starts at the first record boundary after its share of the file; the
+ * boundary is found by validating a chain of consecutive record headers, so
+ * neighbouring parts agree on it without reading the file up to that point.
+ * pcapng parts beyond the first use the interface descriptions found at the
+ * start of the file.
+ */
+class FileBackend : public CaptureBackend {
+public:
+    FileBackend();
+    ~FileBackend() override;
+    
+    bool open(const std::string& path, const CaptureConfig& config, std::string& error) override;
+    int dispatch(int max_packets, BatchHandler handler, void* user) override;
+    void breakLoop() override;
+    bool stats(CaptureStats& stats) override;
+    int datalink() const override;
+    const char* name() const override { return "file"; }
+
+private:
+    /**
+     * @brief Container formats understood by the reader
+     */
+    enum class Format {
+        Pcap,     ///< Classic libpcap format
+        Pcapng    ///< pcap next generation block format
+    };
+    
+    /**
+     * @brief Timestamp and link settings of one pcapng interface
+     */
+    struct Interface {
+        uint64_t units_per_second;   ///< Timestamp resolution (if_tsresol)
+        int link_type;               ///< LINKTYPE_* value
+    };
+    
+    const uint8_t* data;             ///< Start of the mapped file
+    size_t size;                     ///< File size in bytes
+    std::vector<uint8_t> contents;   ///< File contents where mmap() is unavailable
+    Format format;                   ///< Container format
+    bool swapped;                    ///< File byte order differs from the host
+    bool nanosecond;                 ///< Classic pcap timestamps are in nanoseconds
+    int link_type;                   ///< Link type of the file (first interface for pcapng)
+    uint32_t file_snaplen;           ///< Snapshot length recorded in the file header
+    std::vector<Interface> interfaces; ///< pcapng interfaces of the current section
+    size_t position;                 ///< Offset of the next record
+    size_t end;                      ///< Offset where this part ends
+    std::atomic<bool> stopped;       ///< Set by breakLoop()
+    uint64_t records_read;           ///< Packet records that passed through this part
+    bool has_filter;                 ///< A filter program is applied in user space
+    struct bpf_program program;      ///< Compiled filter
+    bool replay;                     ///< Deliver packets at their recorded pace
+    bool replay_started;             ///< The replay clock has been anchored
+    uint64_t replay_origin_ts_ns;    ///< Capture timestamp of the file's first packet
+    uint64_t replay_origin_wall_ns;  ///< Monotonic time the file's first packet was (or would be) due
+    std::shared_ptr<std::atomic<uint64_t>> replay_clock; ///< Replay start shared with the other parts, or null
+    int timeout_ms;                  ///< Longest wait for a due packet per dispatch() call
+    PacketBatch batch;               ///< Pointers into the mapping
+    
+    /**
+     * @brief Maps the file into memory
+     * @param path File to map
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool mapFile(const std::string& path, std::string& error);
+    
+    /**
+     * @brief Releases the mapping
+     */
+    void unmapFile();
+    
+    /**
+     * @brief Parses the file header (and leading pcapng metadata blocks)
+     * 
+     * Also reads the timestamp of the file's first packet, which every part
+     * replays relative to.
+     * 
+     * @param first_record Receives the offset of the first record
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool parseHeader(size_t& first_record, std::string& error);
+    
+    /**
+     * @brief Reads one record header in place
+     * 
+     * @param offset Offset of the record
+     * @param pkthdr Receives capture metadata for packet records
+     * @param ts_ns Receives the timestamp in nanoseconds for packet records
+     * @param packet Receives the packet data, or nullptr for non-packet blocks
+     * @param next Receives the offset of the following record
+     * @return false if the record is truncated or malformed
+     */
+    bool readRecord(size_t offset, struct pcap_pkthdr& pkthdr, uint64_t& ts_ns,
+                    const u_char*& packet, size_t& next);
+    
+    /**
+     * @brief Checks whether a chain of plausible records starts at an offset
+     * @param offset Candidate record offset
+     * @return true if the following records all parse and look consistent
+     */
+    bool validRecordChain(size_t offset);
+    
+    /**
+     * @brief Finds the first record boundary at or after an offset
+     * @param offset Arbitrary file offset
+     * @param first_record Offset of the first record in the file
+     * @return Record offset, or the file size if none is found
+     */
+    size_t findRecordBoundary(size_t offset, size_t first_record);
+    
+    /**
+     * @brief Records a pcapng Interface Description Block
+     * @param body Block body
+     * @param length Body length in bytes
+     */
+    void addInterface(const uint8_t* body, size_t length);
+    
+    uint16_t read16(const uint8_t* p) const;
+    uint32_t read32(const uint8_t* p) const;
+};
+
+#endif // FILE_BACKEND_H
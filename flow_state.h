@@ -0,0 +1,199 @@
+/**
+ * @file flow_state.h
+ * @brief Per-connection state kept in the flow table
+ * 
+ * This header defines the value stored for every bidirectional connection:
+ * its counters, the TCP state machine position, handshake timing and the
+ * sequence tracking used to spot retransmissions, plus the per-shard TCP
+ * totals derived from them.
+ */
+
+#ifndef FLOW_STATE_H
+#define FLOW_STATE_H
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include "health_metrics.h"
+#include "app_classifier.h"
+
+/// TCP flag bits as carried in PacketInfo::tcp_flags
+constexpr uint8_t TCP_FIN = 0x01;
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_RST = 0x04;
+constexpr uint8_t TCP_ACK = 0x10;
+
+/**
+ * @enum TcpState
+ * @brief Position of a connection in a simplified TCP state machine
+ * 
+ * Connections picked up mid-stream start as Established without a
+ * handshake. Non-TCP flows stay at None.
+ */
+enum class TcpState : uint8_t {
+    None = 0,      ///< Not TCP, or nothing decided yet
+    SynSent,       ///< Initiator's SYN seen
+    SynReceived,   ///< Responder's SYN-ACK seen
+    Established,   ///< Handshake completed (or joined mid-stream)
+    Closing,       ///< FIN seen from one side
+    Closed,        ///< FIN seen from both sides
+    Reset,         ///< RST seen
+    Count          ///< Number of states (not a state)
+};
+
+/// Number of TcpState values, usable as an array bound
+constexpr size_t TCP_STATE_COUNT = static_cast<size_t>(TcpState::Count);
+
+/**
+ * @brief Gets the short display name of a TCP state
+ * @param state Connection state
+ * @return Name such as "EST" or "SYN"
+ */
+inline const char* tcpStateName(TcpState state) {
+    static const char* const NAMES[TCP_STATE_COUNT] = {"-", "SYN", "SYN-ACK", "EST", "FIN", "CLOSED", "RST"};
+    size_t index = static_cast<size_t>(state);
+    return index < TCP_STATE_COUNT ? NAMES[index] : "?";
+}
+
+/**
+ * @struct FlowCounters
+ * @brief Per-connection packet and byte counters
+ */
+struct FlowCounters {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+ * @struct IntervalCounters
+ * @brief Traffic of an entry during the latest two history intervals
+ * 
+ * Intervals are numbered by StatsShard::startInterval(). The counters move
+ * on lazily with the first packet of a new interval, so starting one costs
+ * nothing per entry, and the interval before stays readable until a
+ * history writer has seen every shard move past it.
+ */
+struct IntervalCounters {
+    FlowCounters current;    ///< Traffic during interval
+    FlowCounters previous;   ///< Traffic during the interval before
+    uint32_t interval = 0;   ///< Interval current belongs to
+    
+    /**
+     * @brief Accounts a packet to the interval in progress
+     * @param now Interval in progress
+     * @param length Packet length in bytes
+     */
+    void add(uint32_t now, uint64_t length) {
+        if (interval != now) {
+            *this = at(now);
+        }
+        current.packets++;
+        current.bytes += length;
+    }
+    
+    /**
+     * @brief Gets the counters as seen from a later interval
+     * @param now Interval in progress, not older than interval
+     * @return Copy whose current belongs to now
+     */
+    IntervalCounters at(uint32_t now) const {
+        IntervalCounters result;
+        result.interval = now;
+        if (interval == now) {
+            result = *this;
+        } else if (interval + 1 == now) {
+            result.previous = current;
+        }
+        return result;
+    }
+    
+    /**
+     * @brief Gets the traffic of one interval
+     * @param which Interval asked for
+     * @return Its counters, zero if it is neither of the two kept
+     */
+    FlowCounters during(uint32_t which) const {
+        if (which == interval) {
+            return current;
+        }
+        return which + 1 == interval ? previous : FlowCounters();
+    }
+    
+    /**
+     * @brief Adds another shard's counters for the same entry
+     * 
+     * A shard that has not seen the newest interval yet reports an older
+     * one; both are first brought to the newer interval.
+     * 
+     * @param other Counters to add
+     */
+    void merge(const IntervalCounters& other) {
+        uint32_t now = static_cast<int32_t>(other.interval - interval) > 0 ? other.interval : interval;
+        IntervalCounters a = at(now);
+        IntervalCounters b = other.at(now);
+        a.current.packets += b.current.packets;
+        a.current.bytes += b.current.bytes;
+        a.previous.packets += b.previous.packets;
+        a.previous.bytes += b.previous.bytes;
+        *this = a;
+    }
+};
+
+/**
+ * @struct FlowState
+ * @brief Everything tracked for one bidirectional connection
+ * 
+ * Connections are keyed with their endpoints in a canonical order, so both
+ * directions share one entry; direction 0 is traffic from the key's source
+ * endpoint. The initiator is the side that sent the SYN, or the side seen
+ * first for connections without an observed handshake. The application is
+ * a port guess unless the first payload of either direction matches a
+ * signature, which then holds for the rest of the connection.
+ */
+struct FlowState {
+    /// Flag bits
+    static constexpr uint8_t INITIATOR_REVERSED = 0x01;  ///< The key's destination endpoint initiated
+    static constexpr uint8_t SEQUENCE_KNOWN = 0x02;      ///< Shifted left by the direction
+    static constexpr uint8_t FIN_SEEN = 0x08;            ///< Shifted left by the direction
+    static constexpr uint8_t APP_CONFIRMED = 0x20;       ///< app came from a payload signature and is final
+    static constexpr uint8_t APP_CHECKED = 0x40;         ///< First payload checked; shifted left by the direction
+    
+    FlowCounters counters;          ///< Both directions
+    IntervalCounters interval;      ///< Both directions, during the latest history intervals
+    uint64_t syn_ns = 0;            ///< Timestamp of the initiator's SYN
+    uint64_t handshake_rtt_ns = 0;  ///< SYN to the initiator's final handshake ACK (0 = not observed)
+    uint32_t next_seq[2] = {};      ///< Highest sequence number sent so far, per direction
+    uint32_t retransmissions = 0;   ///< Segments that only resent data already seen
+    TcpState state = TcpState::None;
+    uint8_t flags = 0;
+    AppProtocol app = AppProtocol::Unknown;  ///< Application, from the ports or a payload signature
+    
+    /** @brief Whether the key's destination endpoint initiated the connection */
+    bool reversed() const { return (flags & INITIATOR_REVERSED) != 0; }
+};
+
+/**
+ * @struct TcpStats
+ * @brief TCP connection totals of one shard, merged across shards for display
+ */
+struct TcpStats {
+    std::array<uint64_t, TCP_STATE_COUNT> transitions{};  ///< Connections that entered each state
+    LatencyHistogram handshake_rtt;    ///< SYN to final ACK per completed handshake
+    uint64_t data_segments = 0;        ///< Segments carrying payload, SYN or FIN
+    uint64_t retransmissions = 0;      ///< Of those, segments that resent data already seen
+    
+    /**
+     * @brief Adds another shard's totals to this one
+     * @param other Totals to add
+     */
+    void merge(const TcpStats& other) {
+        for (size_t i = 0; i < TCP_STATE_COUNT; i++) {
+            transitions[i] += other.transitions[i];
+        }
+        handshake_rtt.merge(other.handshake_rtt);
+        data_segments += other.data_segments;
+        retransmissions += other.retransmissions;
+    }
+};
+
+#endif // FLOW_STATE_H
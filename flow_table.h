@@ -0,0 +1,310 @@
+/**
+ * @file flow_table.h
+ * @brief Fixed-capacity open-addressing flow table
+ * 
+ * This header defines the FlowTable template, a flat hash table keyed on a
+ * binary flow key. All storage is allocated once at construction, so the
+ * table never allocates on the packet path and its memory is bounded by the
+ * configured maximum number of flows.
+ */
+
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @struct FlowTableConfig
+ * @brief Sizing and eviction settings for a FlowTable
+ */
+struct FlowTableConfig {
+    size_t max_flows = 65536;                          ///< Maximum number of live flows
+    uint64_t idle_timeout_ns = 300ULL * 1000000000ULL; ///< Flows idle longer than this are expired (0 = never)
+};
+
+/**
+ * @brief Hashes a trivially copyable key by mixing its bytes 8 at a time
+ * @param data Pointer to key bytes
+ * @param size Key size in bytes
+ * @return 64-bit hash value
+ */
+inline uint64_t hashKeyBytes(const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, 8);
+        h = (h ^ word) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    if (i < size) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + i, size - i);
+        h = (h ^ word) * 0xC4CEB9FE1A85EC53ULL;
+    }
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+/**
+ * @class FlowTable
+ * @brief Linear-probing hash table with bounded size and idle/LRU eviction
+ * 
+ * Slots are stored in a single cache-line-aligned array; a parallel array of
+ * one-byte tags lets probes skip non-matching slots without touching the
+ * keys. When the table is full, the least recently seen of a small sample of
+ * slots is evicted (approximate LRU), and every insertion also expires a few
+ * idle slots so that memory stays bounded on long runs.
+ * 
+ * @tparam Key Trivially copyable key type compared bytewise
+ * @tparam Value Default-constructible value type
+ */
+template <typename Key, typename Value>
+class FlowTable {
+public:
+    /**
+     * @struct Slot
+     * @brief A single table slot (aligned to a cache line)
+     */
+    struct alignas(64) Slot {
+        Key key;
+        uint64_t last_seen_ns;
+        Value value;
+    };
+    
+    /**
+     * @brief Constructor - allocates all storage up front
+     * @param config Maximum flow count and idle timeout
+     */
+    explicit FlowTable(const FlowTableConfig& config = FlowTableConfig())
+        : max_flows(config.max_flows ? config.max_flows : 1),
+          idle_timeout_ns(config.idle_timeout_ns),
+          count(0), peak_count(0), sweep_cursor(0), evictions(0) {
+        // Keep the load factor at or below 3/4
+        size_t capacity = 16;
+        while (capacity * 3 < max_flows * 4) {
+            capacity *= 2;
+        }
+        mask = capacity - 1;
+        slots.resize(capacity);
+        tags.assign(capacity, 0);
+    }
+    
+    /**
+     * @brief Finds a flow, inserting it if absent
+     * @param key Flow key
+     * @param now_ns Current packet timestamp in nanoseconds
+     * @return Reference to the flow's value (new flows are value-initialized)
+     */
+    Value& findOrInsert(const Key& key, uint64_t now_ns) {
+        uint64_t hash = hashKeyBytes(&key, sizeof(Key));
+        uint8_t tag = tagOf(hash);
+        size_t pos = hash & mask;
+        
+        while (tags[pos] != 0) {
+            if (tags[pos] == tag && std::memcmp(&slots[pos].key, &key, sizeof(Key)) == 0) {
+                slots[pos].last_seen_ns = now_ns;
+                return slots[pos].value;
+            }
+            pos = (pos + 1) & mask;
+        }
+        
+        // New flow: make room first, which may reshuffle the probe sequence
+        expireSome(now_ns);
+        if (count >= max_flows) {
+            evictOldest();
+        }
+        pos = hash & mask;
+        while (tags[pos] != 0) {
+            pos = (pos + 1) & mask;
+        }
+        
+        tags[pos] = tag;
+        slots[pos].key = key;
+        slots[pos].last_seen_ns = now_ns;
+        slots[pos].value = Value();
+        count++;
+        if (count > peak_count) {
+            peak_count = count;
+        }
+        return slots[pos].value;
+    }
+    
+    /**
+     * @brief Looks up a flow without inserting it
+     * @param key Flow key
+     * @return Pointer to the flow's value, or nullptr if absent
+     */
+    Value* find(const Key& key) {
+        uint64_t hash = hashKeyBytes(&key, sizeof(Key));
+        uint8_t tag = tagOf(hash);
+        for (size_t pos = hash & mask; tags[pos] != 0; pos = (pos + 1) & mask) {
+            if (tags[pos] == tag && std::memcmp(&slots[pos].key, &key, sizeof(Key)) == 0) {
+                return &slots[pos].value;
+            }
+        }
+        return nullptr;
+    }
+    
+    /**
+     * @brief Removes a flow if present
+     * @param key Flow key
+     * @return true if the flow was removed
+     */
+    bool erase(const Key& key) {
+        uint64_t hash = hashKeyBytes(&key, sizeof(Key));
+        uint8_t tag = tagOf(hash);
+        for (size_t pos = hash & mask; tags[pos] != 0; pos = (pos + 1) & mask) {
+            if (tags[pos] == tag && std::memcmp(&slots[pos].key, &key, sizeof(Key)) == 0) {
+                eraseAt(pos);
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    /**
+     * @brief Expires every flow idle for longer than the configured timeout
+     * @param now_ns Current packet timestamp in nanoseconds
+     */
+    void expire(uint64_t now_ns) {
+        if (idle_timeout_ns == 0) {
+            return;
+        }
+        for (size_t pos = 0; pos <= mask; ) {
+            if (tags[pos] != 0 && isIdle(pos, now_ns)) {
+                eraseAt(pos);  // Re-examine pos; a later slot may have shifted into it
+            } else {
+                pos++;
+            }
+        }
+    }
+    
+    /**
+     * @brief Calls fn(key, value) for every live flow
+     * @param fn Visitor callable
+     */
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (size_t pos = 0; pos <= mask; pos++) {
+            if (tags[pos] != 0) {
+                fn(slots[pos].key, slots[pos].value);
+            }
+        }
+    }
+    
+    /** @brief Number of live flows */
+    size_t size() const { return count; }
+    
+    /** @brief Maximum number of live flows */
+    size_t maxFlows() const { return max_flows; }
+    
+    /** @brief Number of flows removed by idle expiry or LRU eviction */
+    size_t evicted() const { return evictions; }
+    
+    /** @brief Largest number of live flows seen at once */
+    size_t peak() const { return peak_count; }
+    
+    /** @brief Bytes of slot and tag storage allocated at construction */
+    size_t memoryBytes() const { return slots.capacity() * sizeof(Slot) + tags.capacity(); }
+
+private:
+    static constexpr size_t SWEEP_STEP = 2;     ///< Slots examined for idleness per insertion
+    static constexpr size_t LRU_SAMPLE = 8;     ///< Occupied slots sampled when the table is full
+    
+    std::vector<Slot> slots;
+    std::vector<uint8_t> tags;   ///< 0 = empty, otherwise 0x80 | 7 bits of the hash
+    size_t mask;
+    size_t max_flows;
+    uint64_t idle_timeout_ns;
+    size_t count;
+    size_t peak_count;
+    size_t sweep_cursor;
+    size_t evictions;
+    
+    static uint8_t tagOf(uint64_t hash) {
+        return static_cast<uint8_t>(0x80 | (hash >> 57));
+    }
+    
+    size_t homeOf(size_t pos) const {
+        return hashKeyBytes(&slots[pos].key, sizeof(Key)) & mask;
+    }
+    
+    bool isIdle(size_t pos, uint64_t now_ns) const {
+        return now_ns > slots[pos].last_seen_ns &&
+               now_ns - slots[pos].last_seen_ns > idle_timeout_ns;
+    }
+    
+    /**
+     * @brief Removes the slot at pos using backward-shift deletion
+     * 
+     * Later members of the same probe run are moved back so that lookups
+     * never need tombstones.
+     */
+    void eraseAt(size_t pos) {
+        size_t hole = pos;
+        size_t next = (hole + 1) & mask;
+        while (tags[next] != 0) {
+            size_t home = homeOf(next);
+            // Move next into the hole unless its home lies cyclically in (hole, next]
+            bool stays = (hole <= next) ? (home > hole && home <= next)
+                                        : (home > hole || home <= next);
+            if (!stays) {
+                slots[hole] = slots[next];
+                tags[hole] = tags[next];
+                hole = next;
+            }
+            next = (next + 1) & mask;
+        }
+        tags[hole] = 0;
+        count--;
+        evictions++;
+    }
+    
+    /**
+     * @brief Incrementally expires idle flows around the sweep cursor
+     */
+    void expireSome(uint64_t now_ns) {
+        if (idle_timeout_ns == 0) {
+            return;
+        }
+        for (size_t i = 0; i < SWEEP_STEP; i++) {
+            size_t pos = sweep_cursor;
+            if (tags[pos] != 0 && isIdle(pos, now_ns)) {
+                eraseAt(pos);
+            } else {
+                sweep_cursor = (sweep_cursor + 1) & mask;
+            }
+        }
+    }
+    
+    /**
+     * @brief Evicts the least recently seen flow among a sample of slots
+     */
+    void evictOldest() {
+        size_t victim = mask + 1;
+        size_t sampled = 0;
+        for (size_t i = 0; i <= mask && sampled < LRU_SAMPLE; i++) {
+            size_t pos = (sweep_cursor + i) & mask;
+            if (tags[pos] == 0) {
+                continue;
+            }
+            if (victim > mask || slots[pos].last_seen_ns < slots[victim].last_seen_ns) {
+                victim = pos;
+            }
+            sampled++;
+        }
+        if (victim <= mask) {
+            sweep_cursor = (victim + 1) & mask;
+            eraseAt(victim);
+        }
+    }
+};
+
+#endif // FLOW_TABLE_H
@@ -0,0 +1,101 @@
+/**
+ * @file health_metrics.cpp
+ * @brief Implementation of the pipeline health instrumentation
+ * 
+ * This file contains histogram merging and percentile estimation and the
+ * aggregation of per-thread health counters.
+ */
+
+#include "health_metrics.h"
+
+/**
+ * @brief Adds another histogram to this one
+ * @param other Histogram to add
+ */
+void LatencyHistogram::merge(const LatencyHistogram& other) {
+    for (size_t i = 0; i < BUCKETS; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    samples += other.samples;
+    total_ns += other.total_ns;
+    if (other.max_ns > max_ns) {
+        max_ns = other.max_ns;
+    }
+}
+
+/**
+ * @brief Estimates a percentile
+ * @param fraction Percentile as a fraction (e.g. 0.99)
+ * @return Upper bound of the bucket holding the percentile, in ns (0 if empty)
+ */
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    if (samples == 0) {
+        return 0;
+    }
+    uint64_t rank = static_cast<uint64_t>(fraction * static_cast<double>(samples));
+    if (rank >= samples) {
+        rank = samples - 1;
+    }
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > rank) {
+            uint64_t upper = 1ULL << (i + 1);
+            return upper < max_ns ? upper : max_ns;
+        }
+    }
+    return max_ns;
+}
+
+/**
+ * @brief Adds another thread's counters to this one
+ * @param other Counters to add
+ */
+void PipelineHealth::merge(const PipelineHealth& other) {
+    capture.received += other.capture.received;
+    capture.dropped += other.capture.dropped;
+    capture.interface_dropped += other.capture.interface_dropped;
+    processed += other.processed;
+    batches += other.batches;
+    queue_dropped += other.queue_dropped;
+    queue_waits += other.queue_waits;
+    parse.merge(other.parse);
+    update.merge(other.update);
+}
+
+/**
+ * @brief Adds another store's counters to this one
+ * @param other Counters to add
+ */
+void PoolUsage::merge(const PoolUsage& other) {
+    used += other.used;
+    capacity += other.capacity;
+    peak += other.peak;
+    recycled += other.recycled;
+    refused += other.refused;
+    bytes += other.bytes;
+}
+
+/**
+ * @brief Gets the packets the kernel dropped across all interfaces
+ * @return Buffer/ring and interface drops combined
+ */
+uint64_t HealthReport::totalDropped() const {
+    uint64_t dropped = 0;
+    for (const auto& entry : interfaces) {
+        dropped += entry.capture.dropped + entry.capture.interface_dropped;
+    }
+    return dropped;
+}
+
+/**
+ * @brief Gets the records discarded between capture and analysis threads
+ * @return Analysis queue drops across all interfaces
+ */
+uint64_t HealthReport::queueDropped() const {
+    uint64_t dropped = 0;
+    for (const auto& entry : interfaces) {
+        dropped += entry.queue_dropped;
+    }
+    return dropped;
+}
@@ -0,0 +1,197 @@
+/**
+ * @file health_metrics.h
+ * @brief Capture-loss and pipeline health instrumentation
+ * 
+ * This header defines the counters and latency histograms that show whether
+ * the analyzer keeps up with the traffic: kernel received/dropped counters
+ * per capture socket, packets processed, and per-stage processing times.
+ */
+
+#ifndef HEALTH_METRICS_H
+#define HEALTH_METRICS_H
+
+#include <array>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "capture_backend.h"
+
+/**
+ * @brief Reads the monotonic clock in nanoseconds
+ * @return Nanoseconds since an arbitrary fixed point
+ */
+inline uint64_t monotonicNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @brief Reads the wall clock in nanoseconds since the epoch
+ * @return Current time
+ */
+inline uint64_t wallClockNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+/**
+ * @class LatencyHistogram
+ * @brief Log2-bucketed histogram of durations in nanoseconds
+ * 
+ * Bucket i counts durations in [2^i, 2^(i+1)) ns, so recording is a count
+ * of leading zeros and an increment, and histograms merge by addition.
+ * Percentiles are reported as the upper bound of their bucket.
+ */
+class LatencyHistogram {
+public:
+    static constexpr size_t BUCKETS = 40;  ///< Covers up to 2^40 ns (about 18 minutes)
+    
+    /**
+     * @brief Records one duration
+     * @param ns Duration in nanoseconds
+     */
+    void record(uint64_t ns) {
+        size_t bucket = bucketOf(ns);
+        buckets[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+        samples++;
+        total_ns += ns;
+        if (ns > max_ns) {
+            max_ns = ns;
+        }
+    }
+    
+    /**
+     * @brief Adds another histogram to this one
+     * @param other Histogram to add
+     */
+    void merge(const LatencyHistogram& other);
+    
+    /**
+     * @brief Estimates a percentile
+     * @param fraction Percentile as a fraction (e.g. 0.99)
+     * @return Upper bound of the bucket holding the percentile, in ns (0 if empty)
+     */
+    uint64_t percentile(double fraction) const;
+    
+    /**
+     * @brief Gets the number of recorded durations
+     * @return Sample count
+     */
+    uint64_t count() const { return samples; }
+    
+    /**
+     * @brief Gets the sum of all recorded durations
+     * @return Total in nanoseconds
+     */
+    uint64_t totalNs() const { return total_ns; }
+    
+    /**
+     * @brief Gets the longest recorded duration
+     * @return Maximum in nanoseconds
+     */
+    uint64_t maxNs() const { return max_ns; }
+
+private:
+    std::array<uint64_t, BUCKETS> buckets{};
+    uint64_t samples = 0;
+    uint64_t total_ns = 0;
+    uint64_t max_ns = 0;
+    
+    static size_t bucketOf(uint64_t ns) {
+#if defined(__GNUC__) || defined(__clang__)
+        return ns == 0 ? 0 : static_cast<size_t>(63 - __builtin_clzll(ns));
+#else
+        size_t bucket = 0;
+        while (ns >>= 1) {
+            bucket++;
+        }
+        return bucket;
+#endif
+    }
+};
+
+/// PipelineHealth::interface_index of analysis workers, which serve every interface
+constexpr uint16_t ANALYSIS_HEALTH_INDEX = UINT16_MAX;
+
+/**
+ * @struct PipelineHealth
+ * @brief Health counters of one capture thread
+ * 
+ * Written only by the capture thread and published with its statistics
+ * snapshot. Stage histograms record the time spent per batch.
+ */
+struct PipelineHealth {
+    uint16_t interface_index = 0;  ///< Interface the thread captures on
+    CaptureStats capture;          ///< Kernel counters of the thread's socket
+    uint64_t processed = 0;        ///< Packets parsed and accounted
+    uint64_t batches = 0;          ///< Batches received from the backend
+    uint64_t queue_dropped = 0;    ///< Records discarded because an analysis queue was full
+    uint64_t queue_waits = 0;      ///< Times the thread waited for room in an analysis queue
+    LatencyHistogram parse;        ///< Time to decode a batch into packet records
+    LatencyHistogram update;       ///< Time to account (or print, or queue) a batch
+    
+    /**
+     * @brief Adds another thread's counters to this one
+     * @param other Counters to add
+     */
+    void merge(const PipelineHealth& other);
+};
+
+/**
+ * @struct PoolUsage
+ * @brief Occupancy of a fixed-capacity store (flow slots, host slots, snapshots)
+ * 
+ * Every store is allocated up front and reuses its slots, so memory stays
+ * flat however much the traffic churns; these counters show how full the
+ * stores run and how often slots are recycled.
+ */
+struct PoolUsage {
+    uint64_t used = 0;         ///< Slots holding live entries
+    uint64_t capacity = 0;     ///< Slots available
+    uint64_t peak = 0;         ///< Most slots used at once (summed over threads)
+    uint64_t recycled = 0;     ///< Slots released and reused for a new entry
+    uint64_t refused = 0;      ///< Requests that found no free slot
+    uint64_t bytes = 0;        ///< Memory reserved
+    
+    /**
+     * @brief Adds another store's counters to this one
+     * @param other Counters to add
+     */
+    void merge(const PoolUsage& other);
+};
+
+/**
+ * @struct HealthReport
+ * @brief Pipeline health merged across capture threads
+ * 
+ * Interfaces served by several fanout workers are reported as one entry.
+ */
+struct HealthReport {
+    std::vector<PipelineHealth> interfaces;  ///< One entry per interface, in registry order
+    PipelineHealth analysis;                 ///< Analysis workers combined (see ANALYSIS_HEALTH_INDEX)
+    size_t analysis_workers = 0;             ///< Analysis workers reporting (0 = capture threads account inline)
+    LatencyHistogram render;                 ///< Time to collect and draw one dashboard frame
+    PoolUsage flow_slots;                    ///< Connection tables of all shards
+    PoolUsage host_slots;                    ///< Per-host tables of all shards
+    PoolUsage snapshot_slots;                ///< Recycled dashboard snapshots
+    
+    /**
+     * @brief Gets the packets the kernel dropped across all interfaces
+     * @return Buffer/ring and interface drops combined
+     */
+    uint64_t totalDropped() const;
+    
+    /**
+     * @brief Gets the records discarded between capture and analysis threads
+     * @return Analysis queue drops across all interfaces
+     */
+    uint64_t queueDropped() const;
+    
+    /**
+     * @brief Checks whether any packets were lost before processing
+     * @return true if the kernel, an interface or an analysis queue dropped packets
+     */
+    bool losingPackets() const { return totalDropped() > 0 || queueDropped() > 0; }
+};
+
+#endif // HEALTH_METRICS_H
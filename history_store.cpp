@@ -0,0 +1,604 @@
+/**
+ * @file history_store.cpp
+ * @brief Implementation of the interval history writer and reader
+ * 
+ * This file contains the block layout shared by both sides, the interval
+ * rollover and encoding, and the memory-mapped reader behind the query
+ * mode.
+ */
+
+#include "history_store.h"
+#include "byte_order.h"
+#include "health_metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+constexpr char MAGIC[4] = {'N', 'A', 'H', '1'};
+constexpr size_t HEADER_BYTES = 48;
+constexpr uint64_t NS_PER_SEC = 1000000000ULL;
+constexpr size_t SUMMARY_ROWS = 10;   ///< Subnets and flows listed by a query
+
+/**
+ * @struct Layout
+ * @brief Byte offsets of every column of a block
+ */
+struct Layout {
+    size_t protocol_packets, protocol_bytes;
+    size_t interface_names, interface_packets, interface_bytes, interface_dropped;
+    size_t subnet_addresses, subnet_versions, subnet_prefixes, subnet_packets, subnet_bytes;
+    size_t flow_sources, flow_destinations, flow_source_ports, flow_dest_ports;
+    size_t flow_protocols, flow_versions, flow_packets, flow_bytes;
+    size_t total;   ///< Block length
+};
+
+/**
+ * @brief Computes the column offsets of a block
+ * @param protocols Protocol count
+ * @param interfaces Interface count
+ * @param subnets Subnet count
+ * @param flows Flow count
+ * @return Offsets from the start of the block, each 8-byte aligned
+ */
+Layout layoutOf(size_t protocols, size_t interfaces, size_t subnets, size_t flows) {
+    Layout layout;
+    size_t at = HEADER_BYTES;
+    auto column = [&at](size_t bytes) {
+        size_t start = at;
+        at += (bytes + 7) & ~static_cast<size_t>(7);
+        return start;
+    };
+    layout.protocol_packets = column(protocols * 8);
+    layout.protocol_bytes = column(protocols * 8);
+    layout.interface_names = column(interfaces * HISTORY_NAME_BYTES);
+    layout.interface_packets = column(interfaces * 8);
+    layout.interface_bytes = column(interfaces * 8);
+    layout.interface_dropped = column(interfaces * 8);
+    layout.subnet_addresses = column(subnets * 16);
+    layout.subnet_versions = column(subnets);
+    layout.subnet_prefixes = column(subnets);
+    layout.subnet_packets = column(subnets * 8);
+    layout.subnet_bytes = column(subnets * 8);
+    layout.flow_sources = column(flows * 16);
+    layout.flow_destinations = column(flows * 16);
+    layout.flow_source_ports = column(flows * 2);
+    layout.flow_dest_ports = column(flows * 2);
+    layout.flow_protocols = column(flows);
+    layout.flow_versions = column(flows);
+    layout.flow_packets = column(flows * 8);
+    layout.flow_bytes = column(flows * 8);
+    layout.total = at;
+    return layout;
+}
+
+/**
+ * @brief Formats a wall-clock time as UTC
+ * @param ns Nanoseconds since the epoch
+ * @return Time such as "2024-05-01 12:34:00"
+ */
+std::string formatTime(uint64_t ns) {
+    std::time_t seconds = static_cast<std::time_t>(ns / NS_PER_SEC);
+    const std::tm* utc = std::gmtime(&seconds);
+    char text[32] = "?";
+    if (utc != nullptr) {
+        std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", utc);
+    }
+    return text;
+}
+}  // namespace
+
+/**
+ * @brief Constructor
+ * @param file_path History file, created or appended to
+ * @param interval_seconds Length of one interval
+ */
+HistoryWriter::HistoryWriter(const std::string& file_path, unsigned int interval_seconds)
+    : path(file_path), interval_ns((interval_seconds ? interval_seconds : 1) * NS_PER_SEC), file(nullptr),
+      interval_start_ns(0), next_rollover_ns(0), intervals(0), interval(0), pending(false), pending_end_ns(0) {
+}
+
+/**
+ * @brief Destructor - closes the file
+ */
+HistoryWriter::~HistoryWriter() {
+    if (file != nullptr) {
+        std::fclose(file);
+    }
+}
+
+/**
+ * @brief Opens the file for appending
+ * 
+ * The first interval starts now, against an all-zero baseline, and ends on
+ * the next multiple of the interval length. Its subnet and flow traffic is
+ * that of the shard interval in progress, which runs from the start of the
+ * capture.
+ * 
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool HistoryWriter::open(std::string& error) {
+    file = std::fopen(path.c_str(), "ab");
+    if (file == nullptr) {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    interval = StatsShard::currentInterval();
+    interval_start_ns = wallClockNs();
+    next_rollover_ns = (interval_start_ns / interval_ns + 1) * interval_ns;
+    return true;
+}
+
+/**
+ * @brief Takes a new snapshot into account, writing a block if an interval ended
+ * 
+ * An interval that ended is written once every shard has published a
+ * snapshot from the next one, so its totals and its subnet and flow
+ * counters are complete. A shard whose thread has stopped never moves on,
+ * so the block is written at the next rollover at the latest.
+ * 
+ * @param view Latest cumulative snapshot
+ * @param wall_ns Wall-clock time of the snapshot
+ */
+void HistoryWriter::record(const DashboardSnapshot& view, uint64_t wall_ns) {
+    if (file != nullptr && pending && view.interval == interval + 1 && view.interval_entered) {
+        rollover(view, view.interval_start);
+    }
+    if (file != nullptr && wall_ns >= next_rollover_ns) {
+        if (pending) {
+            rollover(view, pendingTotals(view));
+        }
+        endInterval(wall_ns);
+    }
+}
+
+/**
+ * @brief Writes the interval in progress, if it has traffic, and closes the file
+ * @param view Final cumulative snapshot
+ * @param wall_ns Wall-clock time of the snapshot
+ */
+void HistoryWriter::finish(const DashboardSnapshot& view, uint64_t wall_ns) {
+    if (file == nullptr) {
+        return;
+    }
+    // The capture threads have stopped, so every shard's counters are final
+    if (pending) {
+        rollover(view, pendingTotals(view));
+    }
+    if (file != nullptr && view.counters.total_packets != baseline.total_packets) {
+        pending_end_ns = wall_ns;
+        rollover(view, view.counters);
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+/**
+ * @brief Ends the interval in progress and starts the next one in every shard
+ * @param wall_ns Wall-clock end of the interval
+ */
+void HistoryWriter::endInterval(uint64_t wall_ns) {
+    pending = true;
+    pending_end_ns = wall_ns;
+    next_rollover_ns = (wall_ns / interval_ns + 1) * interval_ns;
+    StatsShard::startInterval();
+}
+
+/**
+ * @brief Gets the cumulative totals at the end of the pending interval
+ * 
+ * Shards that have not entered the next interval contribute their latest
+ * counters, which is exact for threads that have stopped.
+ * 
+ * @param view Cumulative snapshot taken after the interval ended
+ * @return Totals to close the interval with
+ */
+const StatsCounters& HistoryWriter::pendingTotals(const DashboardSnapshot& view) const {
+    return view.interval == interval + 1 ? view.interval_start : view.counters;
+}
+
+/**
+ * @brief Writes the block of the interval that ended and moves on to the next
+ * 
+ * Blocks are flushed as soon as they are written, so a reader (or a crash)
+ * sees every completed interval.
+ * 
+ * @param view Cumulative snapshot taken after the interval ended
+ * @param totals Cumulative totals at the end of the interval
+ */
+void HistoryWriter::rollover(const DashboardSnapshot& view, const StatsCounters& totals) {
+    encode(view, pending_end_ns, totals);
+    if (std::fwrite(block.data(), 1, block.size(), file) != block.size() || std::fflush(file) != 0) {
+        std::cerr << "History: writing " << path << " failed: " << std::strerror(errno)
+                  << "; no further intervals are recorded" << std::endl;
+        std::fclose(file);
+        file = nullptr;
+        return;
+    }
+    intervals++;
+    saveBaseline(view, totals);
+    interval++;
+    interval_start_ns = pending_end_ns;
+    pending = false;
+}
+
+/**
+ * @brief Encodes one interval into the block buffer
+ * 
+ * Subnets and flows come from the snapshot's top lists and carry the
+ * per-interval counters the shards keep for them, so entries that entered
+ * the lists during the interval need no baseline. Entries without traffic
+ * in the interval are left out.
+ * 
+ * @param view Cumulative snapshot taken after the interval ended
+ * @param end_ns Wall-clock end of the interval
+ * @param totals Cumulative totals at the end of the interval
+ */
+void HistoryWriter::encode(const DashboardSnapshot& view, uint64_t end_ns, const StatsCounters& totals) {
+    interval_subnets.clear();
+    for (const TalkerRecord& subnet : view.top_subnets) {
+        TalkerRecord delta = subnet;
+        delta.counters = subnet.interval.during(interval);
+        if (delta.counters.packets > 0) {
+            interval_subnets.push_back(delta);
+        }
+    }
+    
+    interval_flows.clear();
+    for (const FlowRecord& flow : view.top_by_bytes) {
+        FlowRecord delta = flow;
+        delta.counters = flow.interval.during(interval);
+        if (delta.counters.packets > 0) {
+            interval_flows.push_back(delta);
+        }
+    }
+    std::sort(interval_flows.begin(), interval_flows.end(), [](const FlowRecord& a, const FlowRecord& b) {
+        return a.counters.bytes > b.counters.bytes;
+    });
+    if (interval_flows.size() > HISTORY_TOP_FLOWS) {
+        interval_flows.resize(HISTORY_TOP_FLOWS);
+    }
+    
+    const size_t interfaces = std::min<size_t>(view.health.interfaces.size(), UINT16_MAX);
+    const size_t subnets = std::min<size_t>(interval_subnets.size(), UINT16_MAX);
+    const size_t flows = interval_flows.size();
+    const Layout layout = layoutOf(PROTOCOL_COUNT, interfaces, subnets, flows);
+    block.assign(layout.total, '\0');
+    uint8_t* out = reinterpret_cast<uint8_t*>(&block[0]);
+    
+    std::memcpy(out, MAGIC, sizeof(MAGIC));
+    storeLittleEndian(out + 4, layout.total, 4);
+    storeLittleEndian(out + 8, interval_start_ns, 8);
+    storeLittleEndian(out + 16, end_ns, 8);
+    storeLittleEndian(out + 24, totals.total_packets - baseline.total_packets, 8);
+    storeLittleEndian(out + 32, totals.total_bytes - baseline.total_bytes, 8);
+    storeLittleEndian(out + 40, PROTOCOL_COUNT, 2);
+    storeLittleEndian(out + 42, interfaces, 2);
+    storeLittleEndian(out + 44, subnets, 2);
+    storeLittleEndian(out + 46, flows, 2);
+    
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        storeLittleEndian(out + layout.protocol_packets + 8 * p, totals.protocol_counts[p] - baseline.protocol_counts[p], 8);
+        storeLittleEndian(out + layout.protocol_bytes + 8 * p, totals.protocol_bytes[p] - baseline.protocol_bytes[p], 8);
+    }
+    
+    for (size_t i = 0; i < interfaces; i++) {
+        const PipelineHealth& entry = view.health.interfaces[i];
+        uint16_t index = entry.interface_index;
+        const std::string& name = NetworkMonitor::interfaceName(index);
+        std::memcpy(out + layout.interface_names + HISTORY_NAME_BYTES * i, name.data(),
+                    std::min(name.size(), HISTORY_NAME_BYTES));
+        uint64_t dropped = entry.capture.dropped + entry.capture.interface_dropped + entry.queue_dropped;
+        storeLittleEndian(out + layout.interface_packets + 8 * i,
+                          totals.interface_counts[index] - baseline.interface_counts[index], 8);
+        storeLittleEndian(out + layout.interface_bytes + 8 * i,
+                          totals.interface_bytes[index] - baseline.interface_bytes[index], 8);
+        storeLittleEndian(out + layout.interface_dropped + 8 * i,
+                          dropped >= baseline_dropped[index] ? dropped - baseline_dropped[index] : dropped, 8);
+    }
+    
+    for (size_t s = 0; s < subnets; s++) {
+        const TalkerRecord& subnet = interval_subnets[s];
+        std::memcpy(out + layout.subnet_addresses + 16 * s, subnet.address, 16);
+        out[layout.subnet_versions + s] = subnet.ip_version;
+        out[layout.subnet_prefixes + s] = subnet.prefix_length;
+        storeLittleEndian(out + layout.subnet_packets + 8 * s, subnet.counters.packets, 8);
+        storeLittleEndian(out + layout.subnet_bytes + 8 * s, subnet.counters.bytes, 8);
+    }
+    
+    for (size_t f = 0; f < flows; f++) {
+        const FlowRecord& flow = interval_flows[f];
+        const ConnectionInfo connection = flow.oriented();
+        std::memcpy(out + layout.flow_sources + 16 * f, connection.source_addr, 16);
+        std::memcpy(out + layout.flow_destinations + 16 * f, connection.dest_addr, 16);
+        storeLittleEndian(out + layout.flow_source_ports + 2 * f, connection.source_port, 2);
+        storeLittleEndian(out + layout.flow_dest_ports + 2 * f, connection.dest_port, 2);
+        out[layout.flow_protocols + f] = static_cast<uint8_t>(connection.protocol);
+        out[layout.flow_versions + f] = connection.ip_version;
+        storeLittleEndian(out + layout.flow_packets + 8 * f, flow.counters.packets, 8);
+        storeLittleEndian(out + layout.flow_bytes + 8 * f, flow.counters.bytes, 8);
+    }
+}
+
+/**
+ * @brief Makes the end of an interval the baseline of the next one
+ * @param view Cumulative snapshot taken after the interval ended (for the drop counters)
+ * @param totals Cumulative totals at the end of the interval
+ */
+void HistoryWriter::saveBaseline(const DashboardSnapshot& view, const StatsCounters& totals) {
+    baseline = totals;
+    for (const PipelineHealth& entry : view.health.interfaces) {
+        if (entry.interface_index < MAX_INTERFACES) {
+            baseline_dropped[entry.interface_index] =
+                entry.capture.dropped + entry.capture.interface_dropped + entry.queue_dropped;
+        }
+    }
+}
+
+HistoryReader::HistoryReader() : data(nullptr), size(0), damaged(false) {
+}
+
+/**
+ * @brief Destructor - releases the mapping
+ */
+HistoryReader::~HistoryReader() {
+    close();
+}
+
+/**
+ * @brief Releases the mapping
+ */
+void HistoryReader::close() {
+#ifndef _WIN32
+    if (data != nullptr && contents.empty()) {
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+#endif
+    contents.clear();
+    index.clear();
+    data = nullptr;
+    size = 0;
+}
+
+/**
+ * @brief Maps a history file and indexes its blocks
+ * 
+ * Indexing stops at the first block whose header or length does not check
+ * out; a file that is being appended to may end in half a block.
+ * 
+ * @param path History file
+ * @param error Receives a description of the failure
+ * @return true if the file could be read
+ */
+bool HistoryReader::open(const std::string& path, std::string& error) {
+    close();
+    damaged = false;
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        error = std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    if (size > 0) {
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            error = std::string("mmap: ") + std::strerror(errno);
+            ::close(fd);
+            size = 0;
+            return false;
+        }
+        data = static_cast<const uint8_t*>(mapped);
+    }
+    ::close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        error = "cannot open file";
+        return false;
+    }
+    contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    size = contents.size();
+    data = contents.data();
+#endif
+
+    size_t offset = 0;
+    while (offset + HEADER_BYTES <= size) {
+        const uint8_t* at = data + offset;
+        if (std::memcmp(at, MAGIC, sizeof(MAGIC)) != 0) {
+            break;
+        }
+        Block entry;
+        size_t length = static_cast<size_t>(loadLittleEndian(at + 4, 4));
+        entry.data = at;
+        entry.start_ns = loadLittleEndian(at + 8, 8);
+        entry.end_ns = loadLittleEndian(at + 16, 8);
+        entry.packets = loadLittleEndian(at + 24, 8);
+        entry.bytes = loadLittleEndian(at + 32, 8);
+        entry.protocols = static_cast<uint16_t>(loadLittleEndian(at + 40, 2));
+        entry.interfaces = static_cast<uint16_t>(loadLittleEndian(at + 42, 2));
+        entry.subnets = static_cast<uint16_t>(loadLittleEndian(at + 44, 2));
+        entry.flows = static_cast<uint16_t>(loadLittleEndian(at + 46, 2));
+        if (length != layoutOf(entry.protocols, entry.interfaces, entry.subnets, entry.flows).total ||
+            length > size - offset) {
+            break;
+        }
+        index.push_back(entry);
+        offset += length;
+    }
+    damaged = offset != size;
+    return true;
+}
+
+/**
+ * @brief Prints the intervals of a time range and their combined totals
+ * 
+ * One line per interval, then the range's totals per interface and its
+ * heaviest subnets and flows, summed over the intervals they appear in.
+ * 
+ * @param out Destination
+ * @param from_ns Only intervals ending after this wall-clock time (0 = from the start)
+ * @param to_ns Only intervals starting before this wall-clock time (0 = to the end)
+ */
+void HistoryReader::printSummary(std::ostream& out, uint64_t from_ns, uint64_t to_ns) const {
+    struct InterfaceTotals {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint64_t dropped = 0;
+    };
+    std::map<std::string, InterfaceTotals> interfaces;
+    std::map<std::string, TalkerRecord> subnets;   // Keyed on version, prefix and address bytes
+    std::map<std::string, FlowRecord> flows;       // Keyed on the oriented connection bytes
+    std::array<uint64_t, PROTOCOL_COUNT> protocol_packets{};
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    size_t selected = 0;
+    
+    out << std::left << std::setw(21) << "Interval start (UTC)" << std::right << std::setw(8) << "Seconds"
+        << std::setw(14) << "Packets" << std::setw(16) << "Bytes";
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        out << std::setw(12) << protocolName(static_cast<Protocol>(p));
+    }
+    out << '\n';
+    
+    for (const Block& entry : index) {
+        if ((from_ns != 0 && entry.end_ns <= from_ns) || (to_ns != 0 && entry.start_ns >= to_ns)) {
+            continue;
+        }
+        selected++;
+        packets += entry.packets;
+        bytes += entry.bytes;
+        const Layout layout = layoutOf(entry.protocols, entry.interfaces, entry.subnets, entry.flows);
+        const uint8_t* at = entry.data;
+        
+        uint64_t seconds = entry.end_ns > entry.start_ns ? (entry.end_ns - entry.start_ns + NS_PER_SEC / 2) / NS_PER_SEC : 0;
+        out << std::left << std::setw(21) << formatTime(entry.start_ns) << std::right << std::setw(8) << seconds
+            << std::setw(14) << entry.packets << std::setw(16) << entry.bytes;
+        for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+            uint64_t count = p < entry.protocols ? loadLittleEndian(at + layout.protocol_packets + 8 * p, 8) : 0;
+            protocol_packets[p] += count;
+            out << std::setw(12) << count;
+        }
+        out << '\n';
+        
+        for (size_t i = 0; i < entry.interfaces; i++) {
+            const char* name = reinterpret_cast<const char*>(at + layout.interface_names + HISTORY_NAME_BYTES * i);
+            InterfaceTotals& totals = interfaces[std::string(name, strnlen(name, HISTORY_NAME_BYTES))];
+            totals.packets += loadLittleEndian(at + layout.interface_packets + 8 * i, 8);
+            totals.bytes += loadLittleEndian(at + layout.interface_bytes + 8 * i, 8);
+            totals.dropped += loadLittleEndian(at + layout.interface_dropped + 8 * i, 8);
+        }
+        
+        for (size_t s = 0; s < entry.subnets; s++) {
+            std::string key(reinterpret_cast<const char*>(at + layout.subnet_addresses + 16 * s), 16);
+            key += static_cast<char>(at[layout.subnet_versions + s]);
+            key += static_cast<char>(at[layout.subnet_prefixes + s]);
+            auto inserted = subnets.emplace(key, TalkerRecord());
+            TalkerRecord& subnet = inserted.first->second;
+            if (inserted.second) {
+                std::memcpy(subnet.address, at + layout.subnet_addresses + 16 * s, 16);
+                subnet.ip_version = at[layout.subnet_versions + s];
+                subnet.prefix_length = at[layout.subnet_prefixes + s];
+            }
+            subnet.counters.packets += loadLittleEndian(at + layout.subnet_packets + 8 * s, 8);
+            subnet.counters.bytes += loadLittleEndian(at + layout.subnet_bytes + 8 * s, 8);
+        }
+        
+        for (size_t f = 0; f < entry.flows; f++) {
+            ConnectionInfo connection;
+            std::memset(&connection, 0, sizeof(connection));
+            std::memcpy(connection.source_addr, at + layout.flow_sources + 16 * f, 16);
+            std::memcpy(connection.dest_addr, at + layout.flow_destinations + 16 * f, 16);
+            connection.source_port = static_cast<uint16_t>(loadLittleEndian(at + layout.flow_source_ports + 2 * f, 2));
+            connection.dest_port = static_cast<uint16_t>(loadLittleEndian(at + layout.flow_dest_ports + 2 * f, 2));
+            uint8_t protocol = at[layout.flow_protocols + f];
+            connection.protocol = protocol < PROTOCOL_COUNT ? static_cast<Protocol>(protocol) : Protocol::Other;
+            connection.ip_version = at[layout.flow_versions + f];
+            
+            FlowRecord& flow = flows[std::string(reinterpret_cast<const char*>(&connection), sizeof(connection))];
+            flow.connection = connection;
+            flow.counters.packets += loadLittleEndian(at + layout.flow_packets + 8 * f, 8);
+            flow.counters.bytes += loadLittleEndian(at + layout.flow_bytes + 8 * f, 8);
+        }
+    }
+    
+    out << '\n' << selected << " of " << index.size() << " intervals, " << packets << " packets, " << bytes << " bytes";
+    if (selected > 0) {
+        out << " (";
+        for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+            out << (p == 0 ? "" : ", ") << protocolName(static_cast<Protocol>(p)) << " " << protocol_packets[p];
+        }
+        out << ")";
+    }
+    out << '\n';
+    if (selected == 0) {
+        return;
+    }
+    
+    out << '\n' << std::left << std::setw(34) << "Interface" << std::right
+        << std::setw(14) << "Packets" << std::setw(16) << "Bytes" << std::setw(12) << "Dropped" << '\n';
+    for (const auto& entry : interfaces) {
+        out << std::left << std::setw(34) << entry.first << std::right << std::setw(14) << entry.second.packets
+            << std::setw(16) << entry.second.bytes << std::setw(12) << entry.second.dropped << '\n';
+    }
+    
+    std::vector<TalkerRecord> top_subnets;
+    for (const auto& entry : subnets) {
+        top_subnets.push_back(entry.second);
+    }
+    std::sort(top_subnets.begin(), top_subnets.end(), [](const TalkerRecord& a, const TalkerRecord& b) {
+        return a.counters.bytes > b.counters.bytes;
+    });
+    if (!top_subnets.empty()) {
+        out << '\n' << std::left << std::setw(34) << "Top subnets" << std::right
+            << std::setw(14) << "Packets" << std::setw(16) << "Bytes" << '\n';
+        for (size_t i = 0; i < top_subnets.size() && i < SUMMARY_ROWS; i++) {
+            const TalkerRecord& subnet = top_subnets[i];
+            std::string label = formatAddress(subnet.address, subnet.ip_version) + "/" + std::to_string(subnet.prefix_length);
+            out << std::left << std::setw(34) << label << std::right << std::setw(14) << subnet.counters.packets
+                << std::setw(16) << subnet.counters.bytes << '\n';
+        }
+    }
+    
+    std::vector<FlowRecord> top_flows;
+    for (const auto& entry : flows) {
+        top_flows.push_back(entry.second);
+    }
+    std::sort(top_flows.begin(), top_flows.end(), [](const FlowRecord& a, const FlowRecord& b) {
+        return a.counters.bytes > b.counters.bytes;
+    });
+    if (!top_flows.empty()) {
+        out << '\n' << std::left << std::setw(58) << "Top flows" << std::right
+            << std::setw(14) << "Packets" << std::setw(16) << "Bytes" << '\n';
+        for (size_t i = 0; i < top_flows.size() && i < SUMMARY_ROWS; i++) {
+            const ConnectionInfo& connection = top_flows[i].connection;
+            std::string label = std::string(protocolName(connection.protocol)) + " "
+                + formatAddress(connection.source_addr, connection.ip_version) + ":" + std::to_string(connection.source_port)
+                + " -> " + formatAddress(connection.dest_addr, connection.ip_version) + ":" + std::to_string(connection.dest_port);
+            out << std::left << std::setw(58) << label << std::right << std::setw(14) << top_flows[i].counters.packets
+                << std::setw(16) << top_flows[i].counters.bytes << '\n';
+        }
+    }
+}
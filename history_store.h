@@ -0,0 +1,232 @@
+/**
+ * @file history_store.h
+ * @brief Per-interval traffic history in an append-only columnar file
+ * 
+ * This header defines HistoryWriter, which rolls the cumulative dashboard
+ * statistics over into fixed intervals (one minute by default) and appends
+ * one block per interval to a history file, and HistoryReader, which maps
+ * such a file and summarizes a time range of it.
+ */
+
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <array>
+#include <string>
+#include <vector>
+#include <ostream>
+#include <cstdio>
+#include <cstdint>
+#include "dashboard.h"
+
+/// Flows stored per interval, heaviest by bytes first
+constexpr size_t HISTORY_TOP_FLOWS = 32;
+/// Bytes reserved per interface name in a block (longer names are cut)
+constexpr size_t HISTORY_NAME_BYTES = 32;
+
+/**
+ * @class HistoryWriter
+ * @brief Turns cumulative snapshots into per-interval blocks and appends them to a file
+ * 
+ * The capture threads never pause and their cumulative counters are never
+ * reset, so the totals of an interval are the counters at its end minus
+ * those at its start. Subnets and flows enter and leave the top lists
+ * at any time, so their traffic comes from the per-interval counters the
+ * shards keep instead: every rollover starts a new shard interval
+ * (StatsShard::startInterval()), and the block of the interval that ended
+ * is written once every shard has published a snapshot from the next one.
+ * Each shard also records its counters when it enters an interval, so the
+ * totals split at the same packet as the subnet and flow counters (drop
+ * counters are still snapshot differences). Intervals end on wall-clock
+ * multiples of their length, so files of different runs line up.
+ * 
+ * Each block is self-contained, so the file only ever grows and a block
+ * cut short by a crash is simply ignored by readers. All integers are
+ * little-endian and every column starts on an 8-byte boundary, so a
+ * mapped file can be scanned in place:
+ * 
+ *     char[4]  magic "NAH1"
+ *     uint32   block length in bytes (a multiple of 8)
+ *     uint64   interval start, interval end (wall clock, ns since the epoch)
+ *     uint64   packets, bytes
+ *     uint16   protocol count P, interface count I, subnet count S, flow count F
+ *     columns  P x uint64 packets, P x uint64 bytes
+ *              I x char[32] name, I x uint64 packets, bytes, dropped
+ *              S x uint8[16] address, S x uint8 IP version, S x uint8 prefix length,
+ *              S x uint64 packets, bytes
+ *              F x uint8[16] source, F x uint8[16] destination, F x uint16 source port,
+ *              F x uint16 destination port, F x uint8 protocol, F x uint8 IP version,
+ *              F x uint64 packets, bytes
+ * 
+ * Byte and 16-bit columns are zero-padded to the next 8-byte boundary.
+ * Subnets and flows are those of the snapshot's top lists, with the
+ * traffic they had during the interval.
+ */
+class HistoryWriter {
+public:
+    /**
+     * @brief Constructor
+     * @param path History file, created or appended to
+     * @param interval_seconds Length of one interval
+     */
+    HistoryWriter(const std::string& path, unsigned int interval_seconds);
+    
+    /**
+     * @brief Destructor - closes the file
+     */
+    ~HistoryWriter();
+    
+    HistoryWriter(const HistoryWriter&) = delete;
+    HistoryWriter& operator=(const HistoryWriter&) = delete;
+    
+    /**
+     * @brief Opens the file for appending
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool open(std::string& error);
+    
+    /**
+     * @brief Takes a new snapshot into account, writing a block if an interval ended
+     * @param view Latest cumulative snapshot
+     * @param wall_ns Wall-clock time of the snapshot
+     */
+    void record(const DashboardSnapshot& view, uint64_t wall_ns);
+    
+    /**
+     * @brief Writes the interval in progress, if it has traffic, and closes the file
+     * @param view Final cumulative snapshot
+     * @param wall_ns Wall-clock time of the snapshot
+     */
+    void finish(const DashboardSnapshot& view, uint64_t wall_ns);
+    
+    /** @brief Number of blocks written so far */
+    uint64_t intervalsWritten() const { return intervals; }
+
+private:
+    std::string path;
+    uint64_t interval_ns;
+    FILE* file;
+    uint64_t interval_start_ns;      ///< Wall-clock start of the interval in progress
+    uint64_t next_rollover_ns;       ///< Wall-clock end of the interval in progress
+    uint64_t intervals;
+    uint32_t interval;               ///< Shard interval whose subnet and flow counters are recorded
+    bool pending;                    ///< The interval ended but is not written yet
+    uint64_t pending_end_ns;         ///< Wall-clock end of the pending interval
+    
+    // Cumulative values at the start of the interval in progress
+    StatsCounters baseline;
+    std::array<uint64_t, MAX_INTERFACES> baseline_dropped{};
+    
+    // Scratch reused for every block
+    std::vector<TalkerRecord> interval_subnets;
+    std::vector<FlowRecord> interval_flows;
+    std::string block;
+    
+    /**
+     * @brief Ends the interval in progress and starts the next one in every shard
+     * @param wall_ns Wall-clock end of the interval
+     */
+    void endInterval(uint64_t wall_ns);
+    
+    /**
+     * @brief Gets the cumulative totals at the end of the pending interval
+     * @param view Cumulative snapshot taken after the interval ended
+     * @return Totals to close the interval with
+     */
+    const StatsCounters& pendingTotals(const DashboardSnapshot& view) const;
+    
+    /**
+     * @brief Writes the block of the interval that ended and moves on to the next
+     * @param view Cumulative snapshot taken after the interval ended
+     * @param totals Cumulative totals at the end of the interval
+     */
+    void rollover(const DashboardSnapshot& view, const StatsCounters& totals);
+    
+    /**
+     * @brief Encodes one interval into the block buffer
+     * @param view Cumulative snapshot taken after the interval ended
+     * @param end_ns Wall-clock end of the interval
+     * @param totals Cumulative totals at the end of the interval
+     */
+    void encode(const DashboardSnapshot& view, uint64_t end_ns, const StatsCounters& totals);
+    
+    /**
+     * @brief Makes the end of an interval the baseline of the next one
+     * @param view Cumulative snapshot taken after the interval ended (for the drop counters)
+     * @param totals Cumulative totals at the end of the interval
+     */
+    void saveBaseline(const DashboardSnapshot& view, const StatsCounters& totals);
+};
+
+/**
+ * @class HistoryReader
+ * @brief Memory-mapped view of a history file
+ * 
+ * Opening indexes the blocks in one pass over their headers; the columns
+ * are read in place only when an interval is summarized.
+ */
+class HistoryReader {
+public:
+    /**
+     * @struct Block
+     * @brief Location and column offsets of one interval
+     */
+    struct Block {
+        const uint8_t* data = nullptr;
+        uint64_t start_ns = 0;
+        uint64_t end_ns = 0;
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        uint16_t protocols = 0;
+        uint16_t interfaces = 0;
+        uint16_t subnets = 0;
+        uint16_t flows = 0;
+    };
+    
+    HistoryReader();
+    
+    /**
+     * @brief Destructor - releases the mapping
+     */
+    ~HistoryReader();
+    
+    HistoryReader(const HistoryReader&) = delete;
+    HistoryReader& operator=(const HistoryReader&) = delete;
+    
+    /**
+     * @brief Maps a history file and indexes its blocks
+     * @param path History file
+     * @param error Receives a description of the failure
+     * @return true if the file could be read (it may hold no complete block)
+     */
+    bool open(const std::string& path, std::string& error);
+    
+    /** @brief Complete blocks in the file, oldest first */
+    const std::vector<Block>& blocks() const { return index; }
+    
+    /** @brief Whether the file ends in an incomplete or damaged block, which was ignored */
+    bool truncated() const { return damaged; }
+    
+    /**
+     * @brief Prints the intervals of a time range and their combined totals
+     * @param out Destination
+     * @param from_ns Only intervals ending after this wall-clock time (0 = from the start)
+     * @param to_ns Only intervals starting before this wall-clock time (0 = to the end)
+     */
+    void printSummary(std::ostream& out, uint64_t from_ns, uint64_t to_ns) const;
+
+private:
+    const uint8_t* data;
+    size_t size;
+    std::vector<uint8_t> contents;   ///< File contents where mmap() is not available
+    std::vector<Block> index;
+    bool damaged;
+    
+    /**
+     * @brief Releases the mapping
+     */
+    void close();
+};
+
+#endif // HISTORY_STORE_H
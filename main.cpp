@@ -2,7 +2,7 @@
  * @file main.cpp
  * @brief Entry point for the Network Analyzer application
  * 
- * This file contains the main function and signal handling for graceful shutdown.
+ * This file contains the main function and signal handling for clean shutdown.
  * It initializes the NetworkMonitor and starts packet capture on a specified
  * or default network interface with optional dashboard visualization.
  */
@@ -10,11 +10,20 @@
 #include "network_monitor.h"
 #include "dashboard.h"
 #include "multi_monitor.h"
+#include "metrics_exporter.h"
+#include "packet_log.h"
+#include "packet_dump.h"
+#include "cpu_affinity.h"
+#include "analysis_stage.h"
+#include "history_store.h"
 #include <csignal>
 #include <memory>
 #include <thread>
 #include <atomic>
 #include <sstream>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 
 /// Global pointer to the NetworkMonitor instance for signal handler access
 std::unique_ptr<NetworkMonitor> monitor;
@@ -22,24 +31,195 @@ std::unique_ptr<NetworkMonitor> monitor;
 std::unique_ptr<MultiMonitor> multi_monitor;
 /// Global pointer to the Dashboard instance
 std::shared_ptr<Dashboard> dashboard_ptr;
+/// Global pointer to the metrics exporter, if any output is configured
+std::unique_ptr<MetricsExporter> exporter;
+/// Global pointer to the per-packet log, if packets are logged
+std::shared_ptr<PacketLog> packet_log;
+/// Global pointer to the packet dump, if packets are saved
+std::shared_ptr<PacketDump> packet_dump;
 /// Flag to control dashboard updates
 std::atomic<bool> running(true);
 
 /**
- * @brief Signal handler for graceful shutdown
+ * @brief Signal handler for clean shutdown
  * 
- * Handles SIGINT (Ctrl+C) to cleanly stop packet capture and exit.
- * The NetworkMonitor destructor will automatically close the pcap session.
+ * Handles SIGINT (Ctrl+C) and SIGTERM by breaking the capture loops of every
+ * monitor. The capture calls then drain the packets already in user space and
+ * return, so main() can join the threads, show the final statistics and
+ * report drops. Only async-signal-safe operations are performed here. A
+ * second signal terminates immediately.
  * 
  * @param signum Signal number received
  */
 void signalHandler(int signum) {
-    std::cout << "\nInterrupt signal (" << signum << ") received." << std::endl;
-    std::cout << "Stopping packet capture..." << std::endl;
     running = false;
-    // A more direct way to stop pcap_loop is needed for immediate exit.
-    // For simplicity, we let the destructor handle cleanup.
-    exit(signum);
+    if (multi_monitor) {
+        multi_monitor->stopCapture();
+    }
+    if (monitor) {
+        monitor->stopCapture();
+    }
+    signal(signum, SIG_DFL);
+}
+
+/**
+ * @brief Installs signalHandler() for SIGINT and SIGTERM
+ * 
+ * Called once the monitor objects exist, so the handler never sees a
+ * half-assigned pointer. Earlier signals keep their default action.
+ */
+void installSignalHandlers() {
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+}
+
+/**
+ * @brief Creates the dashboard that aggregates statistics, if anything consumes them
+ * 
+ * The dashboard is needed for dashboard mode and for metrics export; in
+ * export-only mode it aggregates without ever being drawn.
+ * 
+ * @param use_dashboard Whether to use dashboard mode
+ * @param flow_config Flow table settings for the dashboard
+ * @param talker_config Host aggregation settings for the dashboard
+ * @param export_config Metrics export destinations
+ */
+void createDashboard(bool use_dashboard, const FlowTableConfig& flow_config, const TalkerConfig& talker_config,
+                     const ExportConfig& export_config) {
+    if (use_dashboard || export_config.enabled()) {
+        dashboard_ptr = std::make_shared<Dashboard>(flow_config, talker_config);
+    }
+}
+
+/**
+ * @brief Starts the metrics exporter if any export destination is configured
+ * @param export_config Metrics export destinations
+ * @return false if a destination could not be opened
+ */
+bool startExporter(const ExportConfig& export_config) {
+    if (!export_config.enabled()) {
+        return true;
+    }
+    exporter = std::make_unique<MetricsExporter>(dashboard_ptr, export_config);
+    std::string error;
+    if (!exporter->start(error)) {
+        std::cerr << "Metrics export: " << error << std::endl;
+        exporter.reset();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Starts the packet log if packets are to be logged
+ * 
+ * Plain mode always logs (to stdout by default); with the dashboard or
+ * metrics export, packets are only logged to an explicit --log-file.
+ * 
+ * @param log_config Packet log destination and format
+ * @param aggregating Whether the dashboard or metrics export is active
+ * @return false if the log file could not be opened
+ */
+bool startPacketLog(const LogConfig& log_config, bool aggregating) {
+    if (aggregating && log_config.path == "-") {
+        return true;
+    }
+    packet_log = std::make_shared<PacketLog>(log_config);
+    std::string error;
+    if (!packet_log->start(error)) {
+        std::cerr << "Packet log: " << error << std::endl;
+        packet_log.reset();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Starts the packet dump if packets are to be saved
+ * @param dump_config Packet selection, dump files and rotation
+ * @return false if the filter is invalid or the first file could not be opened
+ */
+bool startPacketDump(const DumpConfig& dump_config) {
+    if (!dump_config.enabled()) {
+        return true;
+    }
+    packet_dump = std::make_shared<PacketDump>(dump_config, dashboard_ptr);
+    std::string error;
+    if (!packet_dump->start(error)) {
+        std::cerr << "Packet dump: " << error << std::endl;
+        packet_dump.reset();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Shows the final dashboard and the capture counters after capture stopped
+ * @param use_dashboard Whether to use dashboard mode
+ */
+void finishCapture(bool use_dashboard) {
+    if (use_dashboard && dashboard_ptr) {
+        dashboard_ptr->display();  // Collects the snapshots published on exit
+    }
+    if (exporter) {
+        exporter->stop();  // Exports the final snapshot
+    }
+    if (packet_log) {
+        packet_log->stop();  // Writes the records still queued
+    }
+    if (packet_dump) {
+        packet_dump->stop();  // Writes the buffers the capture threads handed over
+    }
+    std::cout << std::endl << "Packet capture stopped." << std::endl;
+    if (packet_log && packet_log->droppedRecords() > 0) {
+        std::cerr << "Packet log: " << packet_log->droppedRecords() << " records dropped (queue full), "
+                  << packet_log->writtenRecords() << " written" << std::endl;
+    }
+    if (packet_dump) {
+        std::cerr << "Packet dump: " << packet_dump->dumpedPackets() << " packets saved in "
+                  << packet_dump->filesWritten() << " file(s)";
+        if (packet_dump->droppedPackets() > 0) {
+            std::cerr << ", " << packet_dump->droppedPackets() << " dropped (buffers full)";
+        }
+        std::cerr << std::endl;
+    }
+    if (multi_monitor) {
+        multi_monitor->printCaptureStats();
+    } else if (monitor) {
+        monitor->printCaptureStats();
+    }
+}
+
+/**
+ * @brief Starts the thread that redraws the dashboard until capture stops
+ * 
+ * The thread only reads published snapshots, so a slow terminal delays the
+ * next frame but never the capture threads. Frames are scheduled at a fixed
+ * cadence; a frame that overruns its slot pushes the schedule back instead
+ * of causing a burst of catch-up redraws.
+ * 
+ * @param refresh_ms Interval between frames in milliseconds
+ * @return The dashboard thread
+ */
+std::thread startDashboardThread(unsigned int refresh_ms) {
+    return std::thread([refresh_ms]() {
+        const auto interval = std::chrono::milliseconds(refresh_ms);
+        const auto poll = std::min<std::chrono::milliseconds>(interval, std::chrono::milliseconds(100));
+        auto next_frame = std::chrono::steady_clock::now();
+        while (running) {
+            dashboard_ptr->display();
+            next_frame += interval;
+            auto now = std::chrono::steady_clock::now();
+            if (next_frame < now) {
+                next_frame = now;
+            }
+            // Sleep in short steps so shutdown is not delayed by a long interval
+            while (running && now < next_frame) {
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(next_frame - now, poll));
+                now = std::chrono::steady_clock::now();
+            }
+        }
+    });
 }
 
 /**
@@ -57,6 +237,52 @@ void showHelp() {
     std::cout << "  -i, --interactive      Interactive interface selection" << std::endl;
     std::cout << "  -m, --multi            Multi-interface mode (specify interfaces with --interfaces)" << std::endl;
     std::cout << "  --interfaces <list>    Comma-separated list of interfaces for multi-mode" << std::endl;
+    std::cout << "  --workers <n>          Capture threads per interface using packet fanout (Linux)," << std::endl;
+    std::cout << "                         or parallel readers of a --read file" << std::endl;
+    std::cout << "  --analysis-workers <n> Account packets on n analysis threads fed by the capture threads," << std::endl;
+    std::cout << "                         which then only decode and queue (default: 0, account inline)" << std::endl;
+    std::cout << "  --queue-policy <p>     Full analysis queue: drop (count and discard) or block (default: drop)" << std::endl;
+    std::cout << "  --analysis-queue <n>   Packets buffered per capture thread and analysis worker (default: 16384)" << std::endl;
+    std::cout << "  --cpus <list|numa>     Pin capture threads to these CPUs in turn (e.g. 2-7), or to the" << std::endl;
+    std::cout << "                         CPUs of each NIC's NUMA node; rings and shards follow (Linux)" << std::endl;
+    std::cout << "  --housekeeping-cpu <n> Run the dashboard, export and log threads on this CPU (Linux)" << std::endl;
+    std::cout << "  --read <file>          Analyze a pcap/pcapng file as fast as possible instead of live capture" << std::endl;
+    std::cout << "  --replay               With --read, replay packets at the pace of their timestamps" << std::endl;
+    std::cout << "  --refresh-ms <ms>      Dashboard refresh interval (default: 1000)" << std::endl;
+    std::cout << "  --prometheus <[addr:]port> Serve Prometheus metrics on http://addr:port/metrics" << std::endl;
+    std::cout << "  --json <target>        Stream NDJSON snapshots to a file, - (stdout) or host:port" << std::endl;
+    std::cout << "  --binary <target>      Stream binary snapshot records to a file, - or host:port" << std::endl;
+    std::cout << "  --export-interval <ms> Metrics export interval (default: 1000)" << std::endl;
+    std::cout << "  --history <file>       Append per-interval traffic history to a file" << std::endl;
+    std::cout << "  --history-interval <sec> Length of one history interval (default: 60)" << std::endl;
+    std::cout << "  --query <file>         Summarize a history file and exit" << std::endl;
+    std::cout << "  --since <unix time>    With --query, only intervals after this time (seconds)" << std::endl;
+    std::cout << "  --until <unix time>    With --query, only intervals before this time (seconds)" << std::endl;
+    std::cout << "  --log-file <path>      Write the per-packet log to a file (default: stdout in plain mode)" << std::endl;
+    std::cout << "  --log-format <fmt>     Per-packet log format: text, csv or binary (default: text)" << std::endl;
+    std::cout << "  --log-flush-ms <ms>    Longest delay before logged packets are written (default: 200)" << std::endl;
+    std::cout << "  --log-queue <n>        Packets buffered per capture thread before drops (default: 65536)" << std::endl;
+    std::cout << "  --dump <file>          Save packets to rotating pcapng files (all packets unless selected below)" << std::endl;
+    std::cout << "  --dump-filter <expr>   Save the packets matching this BPF filter" << std::endl;
+    std::cout << "  --dump-top <n>         Save the packets of the n heaviest connections (with --dashboard or export)" << std::endl;
+    std::cout << "  --dump-size <MiB>      Start a new dump file after this size (default: 100, 0 = never)" << std::endl;
+    std::cout << "  --dump-seconds <sec>   Start a new dump file after this long (default: 0 = never)" << std::endl;
+    std::cout << "  --dump-files <n>       Keep only the newest n dump files (default: 0 = all)" << std::endl;
+    std::cout << "  --max-flows <n>        Maximum tracked connections per capture thread (default: 65536)" << std::endl;
+    std::cout << "  --flow-timeout <sec>   Expire connections idle for this long (default: 300, 0 = never)" << std::endl;
+    std::cout << "  --max-hosts <n>        Hosts tracked per address family and capture thread (default: 16384, 0 = off)" << std::endl;
+    std::cout << "  --subnet-prefix <v4>[,<v6>] Prefix lengths of the top subnets (default: 24,64)" << std::endl;
+    std::cout << "  --sketches             Estimate distinct sources, destinations, flows and per-host fan-in/fan-out" << std::endl;
+    std::cout << "  --filter <expr>        BPF filter applied in the kernel (e.g. \"tcp port 443\")" << std::endl;
+    std::cout << "  --snaplen <bytes>      Bytes captured per packet (default: 128, headers only)" << std::endl;
+    std::cout << "  --backend <pcap|mmap>  Capture backend (default: mmap on Linux, pcap elsewhere)" << std::endl;
+    std::cout << "  --buffer-size <MiB>    Kernel capture buffer for the pcap backend (default: 32)" << std::endl;
+    std::cout << "  --immediate            Deliver packets immediately (pcap backend)" << std::endl;
+    std::cout << "  --tstamp-type <type>   Packet timestamp source: host, adapter, adapter_unsynced, ..." << std::endl;
+    std::cout << "                         (default: host; adapter types use NIC hardware clocks)" << std::endl;
+    std::cout << "  --ring-block-size <KiB> TPACKET_V3 ring block size (default: 4096)" << std::endl;
+    std::cout << "  --ring-frames <n>      Nominal 2 KiB frames in the TPACKET_V3 ring (default: 16384)" << std::endl;
+    std::cout << "  --ring-timeout <ms>    TPACKET_V3 block retire timeout (default: 64)" << std::endl;
     std::cout << "  -h, --help             Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
@@ -67,9 +293,36 @@ void showHelp() {
     std::cout << "  ./network_monitor --list                         # List available interfaces" << std::endl;
     std::cout << "  ./network_monitor -m --interfaces eth0,lo        # Monitor multiple interfaces" << std::endl;
     std::cout << "  ./network_monitor -m -d --interfaces eth0,docker0  # Multi-interface with dashboard" << std::endl;
+    std::cout << "  ./network_monitor -d --read incident.pcap --workers 4  # Analyze a capture file in parallel" << std::endl;
+    std::cout << "  ./network_monitor eth0 --prometheus 9109         # Export metrics for Prometheus" << std::endl;
+    std::cout << "  ./network_monitor eth0 --history traffic.nah     # Keep per-minute traffic history" << std::endl;
+    std::cout << "  ./network_monitor -d eth0 --dump hot.pcapng --dump-top 3 --dump-files 10  # Save the top flows" << std::endl;
+    std::cout << "  ./network_monitor --query traffic.nah --since 1714560000  # Summarize the history since then" << std::endl;
+    std::cout << "  ./network_monitor eth0 --workers 4 --cpus numa --housekeeping-cpu 0  # NIC-local workers" << std::endl;
     std::cout << std::endl;
 }
 
+/**
+ * @brief Prints the summary of a history file
+ * @param path History file written with --history
+ * @param from_ns Start of the range in ns since the epoch (0 = from the start)
+ * @param to_ns End of the range in ns since the epoch (0 = to the end)
+ * @return Exit status code
+ */
+int queryHistory(const std::string& path, uint64_t from_ns, uint64_t to_ns) {
+    HistoryReader reader;
+    std::string error;
+    if (!reader.open(path, error)) {
+        std::cerr << "Cannot read history " << path << ": " << error << std::endl;
+        return 1;
+    }
+    if (reader.truncated()) {
+        std::cerr << "Warning: " << path << " ends in an incomplete block, which is ignored" << std::endl;
+    }
+    reader.printSummary(std::cout, from_ns, to_ns);
+    return 0;
+}
+
 /**
  * @brief Lists all available network interfaces
  */
@@ -196,6 +449,138 @@ std::vector<std::string> parseInterfaceList(const std::string& list) {
     return interfaces;
 }
 
+/**
+ * @brief Parses a non-negative integer option value
+ * @param value Option value text
+ * @param option Option name used in error messages
+ * @param out Parsed value
+ * @param min_value Smallest accepted value
+ * @param max_value Largest accepted value
+ * @return true on success
+ */
+bool parseNumber(const std::string& value, const std::string& option, unsigned long long& out,
+                 unsigned long long min_value = 0, unsigned long long max_value = ULLONG_MAX) {
+    try {
+        size_t used = 0;
+        out = std::stoull(value, &used);
+        if (used == value.size() && value[0] != '-' &&
+            out >= min_value && out <= max_value) {
+            return true;
+        }
+    } catch (const std::exception&) {
+    }
+    std::cerr << "Invalid value '" << value << "' for " << option << std::endl;
+    return false;
+}
+
+/**
+ * @brief Checks that requested CPUs exist and are available to the process
+ * @param affinity Requested placement
+ * @return true if it can be applied
+ */
+bool checkAffinity(const AffinityConfig& affinity) {
+    std::vector<int> available = allowedCpus();
+    if (available.empty()) {
+        std::cerr << "CPU pinning is not supported on this platform" << std::endl;
+        return false;
+    }
+    std::vector<int> requested = affinity.capture_cpus;
+    if (affinity.housekeeping_cpu >= 0) {
+        requested.push_back(affinity.housekeeping_cpu);
+    }
+    for (int cpu : requested) {
+        if (std::find(available.begin(), available.end(), cpu) == available.end()) {
+            std::cerr << "CPU " << cpu << " is not available (allowed: " << formatCpuList(available) << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Runs capture through MultiMonitor until it stops
+ * 
+ * Used for multi-interface mode, for a single interface served by several
+ * fanout workers and whenever analysis workers are configured.
+ * 
+ * @param interfaces Interfaces to monitor
+ * @param use_dashboard Whether to use dashboard mode
+ * @param flow_config Flow table settings for the dashboard
+ * @param talker_config Host aggregation settings for the dashboard
+ * @param capture_config Capture settings for every interface
+ * @param workers Capture threads per interface
+ * @param affinity CPU placement of the capture and housekeeping threads
+ * @param analysis Analysis workers fed by the capture threads
+ * @param refresh_ms Dashboard refresh interval in milliseconds
+ * @param export_config Metrics export destinations
+ * @param log_config Packet log destination and format
+ * @param dump_config Packet dump selection, files and rotation
+ * @return Exit status code
+ */
+int runMultiMonitor(const std::vector<std::string>& interfaces, bool use_dashboard,
+                    const FlowTableConfig& flow_config, const TalkerConfig& talker_config,
+                    const CaptureConfig& capture_config, unsigned int workers, const AffinityConfig& affinity,
+                    const AnalysisConfig& analysis, unsigned int refresh_ms, const ExportConfig& export_config, const LogConfig& log_config,
+                    const DumpConfig& dump_config) {
+    // Create multi-monitor instance (it records the CPUs available before any pinning)
+    multi_monitor = std::make_unique<MultiMonitor>(interfaces, use_dashboard, capture_config, workers, affinity, analysis);
+    installSignalHandlers();
+    
+    // Threads started from here on (dashboard, exporter, packet log) inherit the housekeeping CPU;
+    // capture threads set their own affinity
+    if (affinity.housekeeping_cpu >= 0) {
+        if (pinCurrentThread({affinity.housekeeping_cpu})) {
+            std::cout << "Housekeeping threads: CPU " << affinity.housekeeping_cpu << std::endl;
+        } else {
+            std::cerr << "Could not pin housekeeping threads to CPU " << affinity.housekeeping_cpu << std::endl;
+        }
+    }
+    
+    createDashboard(use_dashboard, flow_config, talker_config, export_config);
+    if (dashboard_ptr) {
+        multi_monitor->setDashboard(dashboard_ptr);
+    }
+    if (!startExporter(export_config) || !startPacketLog(log_config, dashboard_ptr != nullptr) ||
+        !startPacketDump(dump_config)) {
+        return 1;
+    }
+    if (packet_log) {
+        multi_monitor->setPacketLog(packet_log);
+    }
+    if (packet_dump) {
+        multi_monitor->setPacketDump(packet_dump);
+    }
+    
+    bool opened = false;
+    if (use_dashboard) {
+        std::cout << "Starting multi-interface monitor with dashboard... (Press Ctrl+C to stop)" << std::endl;
+        
+        // Start dashboard update thread right away: it draws whatever the shards have published so far
+        std::thread dashboard_thread = startDashboardThread(refresh_ms);
+        
+        // Start capture (this will block)
+        opened = multi_monitor->startCapture();
+        
+        // Wait for dashboard thread to finish
+        running = false;
+        if (dashboard_thread.joinable()) {
+            dashboard_thread.join();
+        }
+    } else {
+        std::cout << "Starting multi-interface monitor... (Press Ctrl+C to stop)" << std::endl;
+        if (exporter) {
+            std::cout << "Exporting metrics (packet printing is disabled)" << std::endl;
+        } else {
+            std::cout << "Tip: Use --dashboard flag for visual dashboard mode" << std::endl;
+        }
+        // Start capture (this will block)
+        opened = multi_monitor->startCapture();
+    }
+    
+    finishCapture(use_dashboard);
+    return opened ? 0 : 1;
+}
+
 /**
  * @brief Main entry point for the network monitor application
  * 
@@ -212,6 +597,48 @@ std::vector<std::string> parseInterfaceList(const std::string& list) {
  *   -i, --interactive       Interactive interface selection
  *   -m, --multi             Multi-interface mode
  *   --interfaces <list>     Comma-separated interface list for multi-mode
+ *   --workers <n>           Capture threads per interface (Linux fanout) or file readers
+ *   --analysis-workers <n>  Analysis threads fed by the capture threads
+ *   --queue-policy <p>      Full analysis queue policy (drop, block)
+ *   --analysis-queue <n>    Analysis queue size per capture thread and worker
+ *   --cpus <list|numa>      Capture thread CPUs, or NIC-local NUMA placement
+ *   --housekeeping-cpu <n>  CPU of the dashboard, export and log threads
+ *   --read <file>           Analyze a pcap/pcapng capture file
+ *   --replay                Pace --read by packet timestamps
+ *   --refresh-ms <ms>       Dashboard refresh interval
+ *   --prometheus <[a:]port> Serve Prometheus metrics
+ *   --json <target>         Stream NDJSON snapshots
+ *   --binary <target>       Stream binary snapshot records
+ *   --export-interval <ms>  Metrics export interval
+ *   --history <file>        Per-interval traffic history file
+ *   --history-interval <s>  History interval length
+ *   --query <file>          Summarize a history file
+ *   --since <unix time>     Start of the queried range
+ *   --until <unix time>     End of the queried range
+ *   --log-file <path>       Per-packet log file
+ *   --log-format <fmt>      Per-packet log format (text, csv, binary)
+ *   --log-flush-ms <ms>     Per-packet log flush interval
+ *   --log-queue <n>         Per-packet log queue size per capture thread
+ *   --dump <file>           Rotating pcapng dump of selected packets
+ *   --dump-filter <expr>    BPF filter selecting dumped packets
+ *   --dump-top <n>          Dump the n heaviest connections
+ *   --dump-size <MiB>       Dump file size limit
+ *   --dump-seconds <sec>    Dump file age limit
+ *   --dump-files <n>        Number of dump files kept
+ *   --max-flows <n>         Maximum tracked connections per capture thread
+ *   --flow-timeout <sec>    Idle timeout for tracked connections
+ *   --max-hosts <n>         Hosts tracked per address family and capture thread
+ *   --subnet-prefix <v4>[,<v6>] Prefix lengths of the top subnets
+ *   --sketches              Cardinality and fan-in/fan-out sketches
+ *   --filter <expr>         Kernel BPF filter
+ *   --snaplen <bytes>       Bytes captured per packet
+ *   --backend <pcap|mmap>   Capture backend
+ *   --buffer-size <MiB>     Kernel buffer size (pcap backend)
+ *   --immediate             Immediate mode (pcap backend)
+ *   --tstamp-type <type>    Packet timestamp source (host, adapter, ...)
+ *   --ring-block-size <KiB> TPACKET_V3 block size
+ *   --ring-frames <n>       TPACKET_V3 frame count
+ *   --ring-timeout <ms>     TPACKET_V3 block retire timeout
  *   -h, --help              Show help message
  * 
  * Examples:
@@ -226,17 +653,28 @@ std::vector<std::string> parseInterfaceList(const std::string& list) {
  * @return Exit status code (0 for success)
  */
 int main(int argc, char* argv[]) {
-    // Register signal handler for Ctrl+C
-    signal(SIGINT, signalHandler);
-
     char* dev_char = nullptr;
-    char errbuf[PCAP_ERRBUF_SIZE];
     bool use_dashboard = false;
     bool interactive_mode = false;
     bool list_mode = false;
     bool multi_mode = false;
     std::string interface_list;
-
+    std::string read_file;
+    FlowTableConfig flow_config;
+    TalkerConfig talker_config;
+    CaptureConfig capture_config;
+    unsigned int workers = 1;
+    AffinityConfig affinity;
+    AnalysisConfig analysis;
+    unsigned int refresh_ms = 1000;
+    ExportConfig export_config;
+    LogConfig log_config;
+    DumpConfig dump_config;
+    std::string query_file;
+    uint64_t query_from_ns = 0;
+    uint64_t query_to_ns = 0;
+    unsigned long long number = 0;
+    
     // Parse command-line arguments
     for (int i = 1; i < argc; i++) {
         std::string arg(argv[i]);
@@ -250,6 +688,191 @@ int main(int argc, char* argv[]) {
             multi_mode = true;
         } else if (arg == "--interfaces" && i + 1 < argc) {
             interface_list = argv[++i];
+        } else if (arg == "--workers" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, 256)) {
+                return 1;
+            }
+            workers = static_cast<unsigned int>(number);
+        } else if (arg == "--analysis-workers" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 256)) {
+                return 1;
+            }
+            analysis.workers = static_cast<unsigned int>(number);
+        } else if (arg == "--queue-policy" && i + 1 < argc) {
+            std::string name(argv[++i]);
+            if (!AnalysisConfig::parsePolicy(name, analysis.policy)) {
+                std::cerr << "Unknown queue policy '" << name << "' (expected drop or block)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--analysis-queue" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 256, 1ULL << 24)) {
+                return 1;
+            }
+            analysis.ring_capacity = static_cast<size_t>(number);
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            std::string value(argv[++i]);
+            if (value == "numa") {
+                affinity.numa_local = true;
+            } else if (!parseCpuList(value, affinity.capture_cpus)) {
+                std::cerr << "Invalid CPU list '" << value << "' for --cpus" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--housekeeping-cpu" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 4095)) {
+                return 1;
+            }
+            affinity.housekeeping_cpu = static_cast<int>(number);
+        } else if (arg == "--read" && i + 1 < argc) {
+            read_file = argv[++i];
+        } else if (arg == "--replay") {
+            capture_config.replay = true;
+        } else if (arg == "--refresh-ms" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 10, 3600000)) {
+                return 1;
+            }
+            refresh_ms = static_cast<unsigned int>(number);
+        } else if (arg == "--prometheus" && i + 1 < argc) {
+            export_config.prometheus = argv[++i];
+        } else if (arg == "--json" && i + 1 < argc) {
+            export_config.json = argv[++i];
+        } else if (arg == "--binary" && i + 1 < argc) {
+            export_config.binary = argv[++i];
+        } else if (arg == "--export-interval" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 10, 3600000)) {
+                return 1;
+            }
+            export_config.interval_ms = static_cast<unsigned int>(number);
+        } else if (arg == "--history" && i + 1 < argc) {
+            export_config.history = argv[++i];
+        } else if (arg == "--history-interval" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, 86400)) {
+                return 1;
+            }
+            export_config.history_interval_s = static_cast<unsigned int>(number);
+        } else if (arg == "--query" && i + 1 < argc) {
+            query_file = argv[++i];
+        } else if ((arg == "--since" || arg == "--until") && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, UINT32_MAX)) {
+                return 1;
+            }
+            (arg == "--since" ? query_from_ns : query_to_ns) = number * 1000000000ULL;
+        } else if (arg == "--log-file" && i + 1 < argc) {
+            log_config.path = argv[++i];
+        } else if (arg == "--log-format" && i + 1 < argc) {
+            std::string name(argv[++i]);
+            if (!PacketLog::parseFormat(name, log_config.format)) {
+                std::cerr << "Unknown log format '" << name << "' (expected text, csv or binary)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--log-flush-ms" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, 3600000)) {
+                return 1;
+            }
+            log_config.flush_ms = static_cast<unsigned int>(number);
+        } else if (arg == "--log-queue" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1024, 1ULL << 26)) {
+                return 1;
+            }
+            log_config.ring_capacity = static_cast<size_t>(number);
+        } else if (arg == "--dump" && i + 1 < argc) {
+            dump_config.path = argv[++i];
+        } else if (arg == "--dump-filter" && i + 1 < argc) {
+            dump_config.filter = argv[++i];
+        } else if (arg == "--dump-top" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, TOP_CONNECTIONS)) {
+                return 1;
+            }
+            dump_config.top_flows = static_cast<unsigned int>(number);
+        } else if (arg == "--dump-size" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 1ULL << 20)) {
+                return 1;
+            }
+            dump_config.rotate_bytes = number << 20;
+        } else if (arg == "--dump-seconds" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 86400 * 7)) {
+                return 1;
+            }
+            dump_config.rotate_seconds = static_cast<unsigned int>(number);
+        } else if (arg == "--dump-files" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 1000000)) {
+                return 1;
+            }
+            dump_config.max_files = static_cast<unsigned int>(number);
+        } else if (arg == "--max-flows" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1)) {
+                return 1;
+            }
+            flow_config.max_flows = static_cast<size_t>(number);
+        } else if (arg == "--flow-timeout" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, UINT32_MAX)) {
+                return 1;
+            }
+            flow_config.idle_timeout_ns = number * 1000000000ULL;
+        } else if (arg == "--max-hosts" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 1ULL << 24)) {
+                return 1;
+            }
+            talker_config.max_hosts = static_cast<size_t>(number);
+        } else if (arg == "--sketches") {
+            talker_config.sketches = true;
+        } else if (arg == "--subnet-prefix" && i + 1 < argc) {
+            std::string lengths(argv[++i]);
+            size_t comma = lengths.find(',');
+            if (!parseNumber(lengths.substr(0, comma), arg, number, 0, 32)) {
+                return 1;
+            }
+            talker_config.ipv4_prefix = static_cast<uint8_t>(number);
+            if (comma != std::string::npos) {
+                if (!parseNumber(lengths.substr(comma + 1), arg, number, 0, 128)) {
+                    return 1;
+                }
+                talker_config.ipv6_prefix = static_cast<uint8_t>(number);
+            }
+        } else if (arg == "--filter" && i + 1 < argc) {
+            capture_config.filter = argv[++i];
+        } else if (arg == "--snaplen" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 64, 262144)) {
+                return 1;
+            }
+            capture_config.snaplen = static_cast<int>(number);
+        } else if (arg == "--backend" && i + 1 < argc) {
+            std::string name(argv[++i]);
+            if (name == "pcap") {
+                capture_config.backend = BackendType::Pcap;
+            } else if (name == "mmap") {
+                capture_config.backend = BackendType::Mmap;
+            } else {
+                std::cerr << "Unknown backend '" << name << "' (expected pcap or mmap)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--buffer-size" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 0, 2047)) {
+                return 1;
+            }
+            capture_config.buffer_size = static_cast<int>(number * 1024 * 1024);
+        } else if (arg == "--immediate") {
+            capture_config.immediate = true;
+        } else if (arg == "--tstamp-type" && i + 1 < argc) {
+            capture_config.timestamp_type = argv[++i];
+            if (pcap_tstamp_type_name_to_val(capture_config.timestamp_type.c_str()) < 0) {
+                std::cerr << "Invalid value '" << capture_config.timestamp_type << "' for " << arg << std::endl;
+                return 1;
+            }
+        } else if (arg == "--ring-block-size" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 4, 1024 * 1024)) {
+                return 1;
+            }
+            capture_config.ring_block_size = static_cast<uint32_t>(number * 1024);
+        } else if (arg == "--ring-frames" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, UINT32_MAX)) {
+                return 1;
+            }
+            capture_config.ring_frame_count = static_cast<uint32_t>(number);
+        } else if (arg == "--ring-timeout" && i + 1 < argc) {
+            if (!parseNumber(argv[++i], arg, number, 1, UINT32_MAX)) {
+                return 1;
+            }
+            capture_config.ring_block_timeout_ms = static_cast<uint32_t>(number);
         } else if (arg == "--help" || arg == "-h") {
             showHelp();
             return 0;
@@ -264,8 +887,42 @@ int main(int argc, char* argv[]) {
         return 0;
     }
     
+    // Handle history query mode
+    if (!query_file.empty()) {
+        return queryHistory(query_file, query_from_ns, query_to_ns);
+    }
+    
+    // The dashboard owns stdout; exported streams must go elsewhere
+    if (use_dashboard && (export_config.json == "-" || export_config.binary == "-")) {
+        std::cerr << "--json - and --binary - cannot be combined with --dashboard" << std::endl;
+        return 1;
+    }
+    
+    if (!dump_config.enabled() && (dump_config.top_flows > 0 || !dump_config.filter.empty())) {
+        std::cerr << "--dump-top and --dump-filter require --dump <file>" << std::endl;
+        return 1;
+    }
+    // The heaviest connections come from dashboard snapshots, which only the dashboard and export threads refresh
+    if (dump_config.top_flows > 0 && !use_dashboard && !export_config.enabled()) {
+        std::cerr << "--dump-top requires --dashboard or a metrics export" << std::endl;
+        return 1;
+    }
+    
+    if (affinity.enabled() && !checkAffinity(affinity)) {
+        return 1;
+    }
+    
+    // Handle capture file mode
+    if (!read_file.empty()) {
+        capture_config.backend = BackendType::File;
+        dev_char = const_cast<char*>(read_file.c_str());
+    } else if (capture_config.replay) {
+        std::cerr << "--replay requires --read" << std::endl;
+        return 1;
+    }
+    
     // Handle multi-interface mode
-    if (multi_mode) {
+    if (multi_mode && read_file.empty()) {
         std::vector<std::string> interfaces;
         
         if (!interface_list.empty()) {
@@ -285,90 +942,60 @@ int main(int argc, char* argv[]) {
             return 1;
         }
         
-        // Create multi-monitor instance
-        multi_monitor = std::make_unique<MultiMonitor>(interfaces, use_dashboard);
-        
-        if (use_dashboard) {
-            // Create dashboard instance
-            dashboard_ptr = std::make_shared<Dashboard>();
-            multi_monitor->setDashboard(dashboard_ptr);
-            
-            std::cout << "Starting multi-interface monitor with dashboard... (Press Ctrl+C to stop)" << std::endl;
-            std::cout << "Initializing dashboard in 2 seconds..." << std::endl;
-            std::this_thread::sleep_for(std::chrono::seconds(2));
-            
-            // Start dashboard update thread
-            std::thread dashboard_thread([&]() {
-                while (running) {
-                    dashboard_ptr->display();
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                }
-            });
-            
-            // Start capture (this will block)
-            multi_monitor->startCapture();
-            
-            // Wait for dashboard thread to finish
-            running = false;
-            if (dashboard_thread.joinable()) {
-                dashboard_thread.join();
-            }
-        } else {
-            std::cout << "Starting multi-interface monitor... (Press Ctrl+C to stop)" << std::endl;
-            std::cout << "Tip: Use --dashboard flag for visual dashboard mode" << std::endl;
-            // Start capture (this will block)
-            multi_monitor->startCapture();
-        }
-        
-        return 0;
+        return runMultiMonitor(interfaces, use_dashboard, flow_config, talker_config, capture_config, workers, affinity, analysis, refresh_ms, export_config, log_config, dump_config);
     }
     
     // Handle interactive mode (single interface)
-    if (interactive_mode) {
-        std::string selected = selectInterface();
-        if (selected.empty()) {
+    std::string device = dev_char != nullptr ? dev_char : "";
+    if (interactive_mode && read_file.empty()) {
+        device = selectInterface();
+        if (device.empty()) {
             return 1;
         }
-        dev_char = const_cast<char*>(selected.c_str());
     }
-
+    
     // Find device if not specified (single interface mode)
-    if (dev_char == nullptr) {
-        // Use pcap_findalldevs instead of deprecated pcap_lookupdev
-        pcap_if_t* alldevs;
-        if (pcap_findalldevs(&alldevs, errbuf) == -1) {
-            std::cerr << "Couldn't find devices: " << errbuf << std::endl;
-            return 2;
-        }
-        
-        if (alldevs == nullptr) {
+    if (device.empty()) {
+        std::vector<std::string> available = NetworkMonitor::listInterfaces();
+        if (available.empty()) {
             std::cerr << "No network interfaces found" << std::endl;
             return 2;
         }
-        
-        dev_char = alldevs->name;
-        std::cout << "Using default device: " << dev_char << std::endl;
+        device = available.front();
+        std::cout << "Using default device: " << device << std::endl;
     }
-
-    std::string device(dev_char);
-    monitor = std::make_unique<NetworkMonitor>(device, use_dashboard);
-
-    if (use_dashboard) {
-        // Create dashboard instance
-        dashboard_ptr = std::make_shared<Dashboard>();
+    
+    if (workers > 1 || affinity.enabled() || analysis.workers > 0) {
+        return runMultiMonitor({device}, use_dashboard, flow_config, talker_config, capture_config, workers, affinity, analysis, refresh_ms, export_config, log_config, dump_config);
+    }
+    try {
+        monitor = std::make_unique<NetworkMonitor>(device, use_dashboard, capture_config);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    installSignalHandlers();
+    
+    createDashboard(use_dashboard, flow_config, talker_config, export_config);
+    if (dashboard_ptr) {
         monitor->setDashboard(dashboard_ptr);
-        
+    }
+    if (!startExporter(export_config) || !startPacketLog(log_config, dashboard_ptr != nullptr) ||
+        !startPacketDump(dump_config)) {
+        return 1;
+    }
+    if (packet_log) {
+        monitor->setPacketLog(packet_log);
+    }
+    if (packet_dump) {
+        monitor->setPacketDump(packet_dump);
+    }
+    
+    if (use_dashboard) {
         std::cout << "Starting network monitor with dashboard... (Press Ctrl+C to stop)" << std::endl;
-        std::cout << "Initializing dashboard in 2 seconds..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(2));
         
-        // Start dashboard update thread
-        std::thread dashboard_thread([&]() {
-            while (running) {
-                dashboard_ptr->display();
-                std::this_thread::sleep_for(std::chrono::seconds(1));
-            }
-        });
+        // Start dashboard update thread right away: it draws whatever the shards have published so far
+        std::thread dashboard_thread = startDashboardThread(refresh_ms);
         
         // Capture packets (this will block)
         monitor->startCapture(-1);
@@ -380,11 +1007,16 @@ int main(int argc, char* argv[]) {
         }
     } else {
         std::cout << "Starting network monitor... (Press Ctrl+C to stop)" << std::endl;
-        std::cout << "Tip: Use --dashboard flag for visual dashboard mode" << std::endl;
-        std::cout << "     Use --help for more options" << std::endl;
+        if (exporter) {
+            std::cout << "Exporting metrics (packet printing is disabled)" << std::endl;
+        } else {
+            std::cout << "Tip: Use --dashboard flag for visual dashboard mode" << std::endl;
+            std::cout << "     Use --help for more options" << std::endl;
+        }
         // Capture indefinitely until interrupted. Pass -1 for infinite loop.
         monitor->startCapture(-1);
     }
-
+    
+    finishCapture(use_dashboard);
     return 0;
 }
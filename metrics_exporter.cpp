@@ -0,0 +1,1005 @@
+/**
+ * @file metrics_exporter.cpp
+ * @brief Implementation of the MetricsExporter class
+ * 
+ * This file contains the exporter thread, the Prometheus, JSON and binary
+ * encoders, the non-blocking stream writer and the minimal HTTP server that
+ * answers Prometheus scrapes.
+ */
+
+#include "metrics_exporter.h"
+#include "byte_order.h"
+#include "health_metrics.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdarg>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace {
+constexpr uint64_t NS_PER_MS = 1000000ULL;
+constexpr uint64_t RECONNECT_DELAY_NS = 5000 * NS_PER_MS;   ///< Pause between TCP connection attempts
+constexpr int CONNECT_TIMEOUT_MS = 200;                     ///< Longest wait for a TCP connection
+constexpr uint64_t CLIENT_TIMEOUT_NS = 5000 * NS_PER_MS;    ///< Scrapes taking longer are dropped
+constexpr size_t MAX_CLIENTS = 16;                          ///< Concurrent scrape connections
+constexpr size_t MAX_REQUEST_SIZE = 8192;                   ///< Larger HTTP requests are rejected
+constexpr size_t JSON_TOP_FLOWS = 10;                       ///< Heaviest flows included in JSON records
+
+/**
+ * @brief Appends printf-style formatted text
+ * @param out Destination
+ * @param format printf format string
+ */
+void appendFormat(std::string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) {
+        out.append(buffer, static_cast<size_t>(length) < sizeof(buffer) ? static_cast<size_t>(length) : sizeof(buffer) - 1);
+    }
+}
+
+/**
+ * @brief Appends an unsigned integer in decimal
+ * @param out Destination
+ * @param value Value
+ */
+void appendNumber(std::string& out, uint64_t value) {
+    appendFormat(out, "%llu", static_cast<unsigned long long>(value));
+}
+
+/**
+ * @brief Appends a floating-point value (finite values only)
+ * @param out Destination
+ * @param value Value
+ */
+void appendDouble(std::string& out, double value) {
+    appendFormat(out, "%.6g", value);
+}
+
+/**
+ * @brief Appends a string as a quoted JSON string
+ * @param out Destination
+ * @param text Raw text
+ */
+void appendJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (c < 0x20) {
+            appendFormat(out, "\\u%04x", c);
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief Appends a string as a quoted Prometheus label value
+ * @param out Destination
+ * @param text Raw text
+ */
+void appendLabelValue(std::string& out, const std::string& text) {
+    out += '"';
+    for (char ch : text) {
+        if (ch == '"' || ch == '\\') {
+            out += '\\';
+            out += ch;
+        } else if (ch == '\n') {
+            out += "\\n";
+        } else {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+/**
+ * @brief Appends the HELP and TYPE lines of a metric family
+ * @param out Destination
+ * @param name Metric name
+ * @param type Metric type (counter, gauge, summary)
+ * @param help Description
+ */
+void appendFamily(std::string& out, const char* name, const char* type, const char* help) {
+    out += "# HELP ";
+    out += name;
+    out += ' ';
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += ' ';
+    out += type;
+    out += '\n';
+}
+
+/**
+ * @brief Appends an IEEE 754 double in little-endian byte order
+ * @param out Destination
+ * @param value Value
+ */
+void appendLittleEndianDouble(std::string& out, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    appendLittleEndian(out, bits, 8);
+}
+
+/**
+ * @brief Checks whether a stream target names a TCP peer ("host:port")
+ * @param target Configured target
+ * @return true for host:port targets
+ */
+bool isSocketTarget(const std::string& target) {
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos || colon + 1 == target.size() || target.find('/') != std::string::npos) {
+        return false;
+    }
+    for (size_t i = colon + 1; i < target.size(); i++) {
+        if (target[i] < '0' || target[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Splits "host:port" or "[v6]:port" into its parts
+ * @param target Target string (the host part may be empty)
+ * @param host Receives the host without brackets
+ * @param port Receives the port
+ */
+void splitHostPort(const std::string& target, std::string& host, std::string& port) {
+    size_t colon = target.rfind(':');
+    if (colon == std::string::npos) {
+        host.clear();
+        port = target;
+        return;
+    }
+    host = target.substr(0, colon);
+    port = target.substr(colon + 1);
+    if (host.size() >= 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+}
+
+#ifndef _WIN32
+/**
+ * @brief Switches a descriptor to non-blocking mode
+ * @param fd Descriptor
+ */
+void setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+}
+
+/**
+ * @brief Connects to a TCP peer, waiting at most CONNECT_TIMEOUT_MS
+ * @param target "host:port"
+ * @return Connected non-blocking socket, or -1
+ */
+int connectTo(const std::string& target) {
+    std::string host;
+    std::string port;
+    splitHostPort(target, host, port);
+    
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* results = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &results) != 0) {
+        return -1;
+    }
+    
+    int fd = -1;
+    for (struct addrinfo* ai = results; ai != nullptr && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        setNonBlocking(fd);
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            struct pollfd pfd = {fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t length = sizeof(error);
+            if (errno != EINPROGRESS || poll(&pfd, 1, CONNECT_TIMEOUT_MS) != 1 ||
+                getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    freeaddrinfo(results);
+    return fd;
+}
+#endif
+}
+
+/**
+ * @brief Constructor
+ * @param source Statistics source (shared with the capture threads)
+ * @param export_config Destinations and export period
+ */
+MetricsExporter::MetricsExporter(std::shared_ptr<Dashboard> source, const ExportConfig& export_config)
+    : dashboard(std::move(source)), config(export_config), stopping(false), dropped_records(0),
+      wake_fds{-1, -1}, listen_fd(-1) {
+    json_stream.target = config.json;
+    binary_stream.target = config.binary;
+    prometheus_text.reserve(16384);
+    json_line.reserve(8192);
+    binary_record.reserve(4096);
+}
+
+/**
+ * @brief Destructor - stops the exporter thread
+ */
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+/**
+ * @brief Opens every destination and starts the exporter thread
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool MetricsExporter::start(std::string& error) {
+    if (!config.prometheus.empty() && !openListener(error)) {
+        return false;
+    }
+    if (!json_stream.target.empty() && !openStream(json_stream, error)) {
+        return false;
+    }
+    if (!binary_stream.target.empty() && !openStream(binary_stream, error)) {
+        return false;
+    }
+    if (!config.history.empty()) {
+        history = std::make_unique<HistoryWriter>(config.history, config.history_interval_s);
+        if (!history->open(error)) {
+            return false;
+        }
+    }
+#ifndef _WIN32
+    if (pipe(wake_fds) != 0) {
+        error = std::string("cannot create wake-up pipe: ") + std::strerror(errno);
+        return false;
+    }
+    setNonBlocking(wake_fds[0]);
+    setNonBlocking(wake_fds[1]);
+#endif
+    worker = std::thread(&MetricsExporter::run, this);
+    return true;
+}
+
+/**
+ * @brief Exports a final snapshot and stops the exporter thread
+ */
+void MetricsExporter::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    stopping = true;
+#ifndef _WIN32
+    char byte = 1;
+    ssize_t ignored = write(wake_fds[1], &byte, 1);
+    (void)ignored;
+#endif
+    worker.join();
+    
+    closeStream(json_stream);
+    closeStream(binary_stream);
+#ifndef _WIN32
+    for (Client& client : clients) {
+        close(client.fd);
+    }
+    clients.clear();
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        listen_fd = -1;
+    }
+    close(wake_fds[0]);
+    close(wake_fds[1]);
+    wake_fds[0] = wake_fds[1] = -1;
+#endif
+    if (droppedRecords() > 0) {
+        std::cerr << "Metrics export: " << droppedRecords() << " records dropped (receiver too slow)" << std::endl;
+    }
+}
+
+/**
+ * @brief Exporter thread: exports on every tick and serves scrapes in between
+ */
+void MetricsExporter::run() {
+    const uint64_t interval_ns = static_cast<uint64_t>(config.interval_ms) * NS_PER_MS;
+    uint64_t next_tick = monotonicNs();
+#ifndef _WIN32
+    std::vector<struct pollfd> fds;
+#endif
+
+    while (!stopping) {
+        uint64_t now = monotonicNs();
+        if (now >= next_tick) {
+            exportSnapshot(false);
+            next_tick += interval_ns;
+            now = monotonicNs();
+            if (next_tick <= now) {
+                next_tick = now + interval_ns;  // Overran: skip ticks rather than bursting
+            }
+        }
+        int timeout_ms = static_cast<int>((next_tick - now + NS_PER_MS - 1) / NS_PER_MS);
+
+#ifndef _WIN32
+        fds.clear();
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        if (listen_fd >= 0) {
+            fds.push_back({listen_fd, POLLIN, 0});
+        }
+        size_t first_client = fds.size();
+        for (const Client& client : clients) {
+            fds.push_back({client.fd, static_cast<short>(client.response.empty() ? POLLIN : POLLOUT), 0});
+        }
+        if (poll(fds.data(), fds.size(), timeout_ms) < 0 && errno != EINTR) {
+            break;
+        }
+        
+        // Serve scrapes; a client list snapshot keeps indices aligned with fds
+        now = monotonicNs();
+        size_t kept = 0;
+        for (size_t i = 0; i < clients.size(); i++) {
+            bool alive = now < clients[i].deadline_ns;
+            if (alive && fds[first_client + i].revents != 0) {
+                alive = serviceClient(clients[i]);
+            }
+            if (alive) {
+                if (kept != i) {
+                    clients[kept] = std::move(clients[i]);
+                }
+                kept++;
+            } else {
+                close(clients[i].fd);
+            }
+        }
+        clients.resize(kept);
+        
+        if (listen_fd >= 0 && (fds[1].revents & POLLIN)) {
+            int fd;
+            while ((fd = accept(listen_fd, nullptr, nullptr)) >= 0) {
+                if (clients.size() >= MAX_CLIENTS) {
+                    close(fd);
+                    continue;
+                }
+                setNonBlocking(fd);
+                clients.push_back(Client{fd, std::string(), std::string(), 0, now + CLIENT_TIMEOUT_NS});
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            char drain[16];
+            while (read(wake_fds[0], drain, sizeof(drain)) > 0) {
+            }
+        }
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms < 100 ? timeout_ms : 100));
+#endif
+    }
+    
+    // The last snapshot includes everything the capture threads drained on exit
+    exportSnapshot(true);
+}
+
+/**
+ * @brief Refreshes the dashboard and writes one snapshot to every destination
+ * @param last Last export before the thread stops (closes the history interval)
+ */
+void MetricsExporter::exportSnapshot(bool last) {
+    dashboard->refresh();
+    std::shared_ptr<const DashboardSnapshot> view = dashboard->snapshot();
+    uint64_t wall_ns = wallClockNs();
+    
+    if (!config.prometheus.empty()) {
+        encodePrometheus(*view);
+    }
+    if (!json_stream.target.empty()) {
+        encodeJson(*view, wall_ns);
+        writeStream(json_stream, json_line);
+    }
+    if (!binary_stream.target.empty()) {
+        encodeBinary(*view, wall_ns);
+        writeStream(binary_stream, binary_record);
+    }
+    if (history) {
+        if (last) {
+            history->finish(*view, wall_ns);
+        } else {
+            history->record(*view, wall_ns);
+        }
+    }
+}
+
+
+/**
+ * @brief Encodes a snapshot in the Prometheus text exposition format
+ * @param view Snapshot to encode
+ */
+void MetricsExporter::encodePrometheus(const DashboardSnapshot& view) {
+    std::string& out = prometheus_text;
+    out.clear();
+    
+    appendFamily(out, "network_analyzer_packets_total", "counter", "Packets accounted.");
+    out += "network_analyzer_packets_total ";
+    appendNumber(out, view.counters.total_packets);
+    out += '\n';
+    appendFamily(out, "network_analyzer_bytes_total", "counter", "Bytes accounted.");
+    out += "network_analyzer_bytes_total ";
+    appendNumber(out, view.counters.total_bytes);
+    out += '\n';
+    
+    appendFamily(out, "network_analyzer_protocol_packets_total", "counter", "Packets accounted per protocol.");
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        appendFormat(out, "network_analyzer_protocol_packets_total{protocol=\"%s\"} ", protocolName(static_cast<Protocol>(p)));
+        appendNumber(out, view.counters.protocol_counts[p]);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_protocol_bytes_total", "counter", "Bytes accounted per protocol.");
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        appendFormat(out, "network_analyzer_protocol_bytes_total{protocol=\"%s\"} ", protocolName(static_cast<Protocol>(p)));
+        appendNumber(out, view.counters.protocol_bytes[p]);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_application_packets_total", "counter", "Packets accounted per application protocol.");
+    for (size_t a = 0; a < APP_PROTOCOL_COUNT; a++) {
+        appendFormat(out, "network_analyzer_application_packets_total{application=\"%s\"} ", appProtocolName(static_cast<AppProtocol>(a)));
+        appendNumber(out, view.counters.app_counts[a]);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_application_bytes_total", "counter", "Bytes accounted per application protocol.");
+    for (size_t a = 0; a < APP_PROTOCOL_COUNT; a++) {
+        appendFormat(out, "network_analyzer_application_bytes_total{application=\"%s\"} ", appProtocolName(static_cast<AppProtocol>(a)));
+        appendNumber(out, view.counters.app_bytes[a]);
+        out += '\n';
+    }
+    
+    appendFamily(out, "network_analyzer_packets_per_second", "gauge", "Packet rate over a trailing window.");
+    for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+        Rate rate = view.rates.rate(RATE_CHANNEL_TOTAL, RATE_WINDOWS[w]);
+        appendFormat(out, "network_analyzer_packets_per_second{window=\"%us\"} ", RATE_WINDOWS[w]);
+        appendDouble(out, rate.packets_per_sec);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_bytes_per_second", "gauge", "Byte rate over a trailing window.");
+    for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+        Rate rate = view.rates.rate(RATE_CHANNEL_TOTAL, RATE_WINDOWS[w]);
+        appendFormat(out, "network_analyzer_bytes_per_second{window=\"%us\"} ", RATE_WINDOWS[w]);
+        appendDouble(out, rate.bytes_per_sec);
+        out += '\n';
+    }
+    
+    appendFamily(out, "network_analyzer_active_flows", "gauge", "Flows currently tracked.");
+    out += "network_analyzer_active_flows ";
+    appendNumber(out, view.active_flows);
+    out += '\n';
+    appendFamily(out, "network_analyzer_evicted_flows_total", "counter", "Flows expired or evicted from the flow tables.");
+    out += "network_analyzer_evicted_flows_total ";
+    appendNumber(out, view.evicted_flows);
+    out += '\n';
+    
+    struct PoolEntry {
+        const char* name;
+        const PoolUsage* usage;
+    };
+    const PoolEntry pools[] = {
+        {"flows", &view.health.flow_slots},
+        {"hosts", &view.health.host_slots},
+        {"snapshots", &view.health.snapshot_slots},
+    };
+    appendFamily(out, "network_analyzer_pool_slots", "gauge", "Slots of the fixed-capacity stores in use, or available.");
+    for (const auto& pool : pools) {
+        appendFormat(out, "network_analyzer_pool_slots{pool=\"%s\",state=\"used\"} ", pool.name);
+        appendNumber(out, pool.usage->used);
+        out += '\n';
+        appendFormat(out, "network_analyzer_pool_slots{pool=\"%s\",state=\"capacity\"} ", pool.name);
+        appendNumber(out, pool.usage->capacity);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_pool_bytes", "gauge", "Memory reserved by the fixed-capacity stores.");
+    for (const auto& pool : pools) {
+        appendFormat(out, "network_analyzer_pool_bytes{pool=\"%s\"} ", pool.name);
+        appendNumber(out, pool.usage->bytes);
+        out += '\n';
+    }
+    
+    if (view.sketches.enabled) {
+        appendFamily(out, "network_analyzer_distinct_estimate", "gauge", "Estimated distinct addresses and flows (HyperLogLog).");
+        out += "network_analyzer_distinct_estimate{set=\"sources\"} ";
+        appendDouble(out, view.sketches.distinct_sources);
+        out += "\nnetwork_analyzer_distinct_estimate{set=\"destinations\"} ";
+        appendDouble(out, view.sketches.distinct_destinations);
+        out += "\nnetwork_analyzer_distinct_estimate{set=\"flows\"} ";
+        appendDouble(out, view.sketches.distinct_flows);
+        out += '\n';
+    }
+    
+    appendFamily(out, "network_analyzer_tcp_transitions_total", "counter", "TCP connections that entered each state.");
+    for (size_t t = 1; t < TCP_STATE_COUNT; t++) {
+        appendFormat(out, "network_analyzer_tcp_transitions_total{state=\"%s\"} ", tcpStateName(static_cast<TcpState>(t)));
+        appendNumber(out, view.tcp.transitions[t]);
+        out += '\n';
+    }
+    appendFamily(out, "network_analyzer_tcp_segments_total", "counter", "TCP segments carrying payload, SYN or FIN, and those resending data already seen.");
+    out += "network_analyzer_tcp_segments_total{kind=\"data\"} ";
+    appendNumber(out, view.tcp.data_segments);
+    out += "\nnetwork_analyzer_tcp_segments_total{kind=\"retransmitted\"} ";
+    appendNumber(out, view.tcp.retransmissions);
+    out += '\n';
+    appendFamily(out, "network_analyzer_tcp_handshake_rtt_seconds", "summary", "Time from SYN to the initiator's final handshake ACK.");
+    for (double quantile : {0.5, 0.99}) {
+        appendFormat(out, "network_analyzer_tcp_handshake_rtt_seconds{quantile=\"%g\"} ", quantile);
+        appendDouble(out, static_cast<double>(view.tcp.handshake_rtt.percentile(quantile)) / 1e9);
+        out += '\n';
+    }
+    out += "network_analyzer_tcp_handshake_rtt_seconds_sum ";
+    appendDouble(out, static_cast<double>(view.tcp.handshake_rtt.totalNs()) / 1e9);
+    out += "\nnetwork_analyzer_tcp_handshake_rtt_seconds_count ";
+    appendNumber(out, view.tcp.handshake_rtt.count());
+    out += '\n';
+    
+    // Per-interface families; the label value is written once into scratch
+    struct InterfaceFamily {
+        const char* name;
+        const char* type;
+        const char* help;
+    };
+    static const InterfaceFamily FAMILIES[] = {
+        {"network_analyzer_interface_packets_total", "counter", "Packets accounted per interface."},
+        {"network_analyzer_interface_bytes_total", "counter", "Bytes accounted per interface."},
+        {"network_analyzer_capture_received_total", "counter", "Packets received by the capture socket."},
+        {"network_analyzer_capture_dropped_total", "counter", "Packets dropped because the capture buffer was full."},
+        {"network_analyzer_capture_interface_dropped_total", "counter", "Packets dropped by the interface or driver."},
+        {"network_analyzer_processed_packets_total", "counter", "Packets parsed and accounted by the capture thread."},
+        {"network_analyzer_analysis_queue_dropped_total", "counter", "Packets dropped because an analysis worker queue was full."},
+    };
+    for (size_t f = 0; f < sizeof(FAMILIES) / sizeof(FAMILIES[0]); f++) {
+        appendFamily(out, FAMILIES[f].name, FAMILIES[f].type, FAMILIES[f].help);
+        for (const PipelineHealth& entry : view.health.interfaces) {
+            uint16_t index = entry.interface_index;
+            uint64_t values[] = {
+                view.counters.interface_counts[index], view.counters.interface_bytes[index],
+                entry.capture.received, entry.capture.dropped,
+                entry.capture.interface_dropped, entry.processed, entry.queue_dropped,
+            };
+            scratch.clear();
+            appendLabelValue(scratch, NetworkMonitor::interfaceName(index));
+            out += FAMILIES[f].name;
+            out += "{interface=";
+            out += scratch;
+            out += "} ";
+            appendNumber(out, values[f]);
+            out += '\n';
+        }
+    }
+    
+    // Processing stage latencies, merged across capture threads
+    PipelineHealth merged;
+    for (const PipelineHealth& entry : view.health.interfaces) {
+        merged.merge(entry);
+    }
+    const struct {
+        const char* stage;
+        const LatencyHistogram* histogram;
+    } stages[] = {
+        {"parse", &merged.parse}, {"update", &merged.update},
+        {"analysis", &view.health.analysis.update}, {"render", &view.health.render},
+    };
+    appendFamily(out, "network_analyzer_stage_latency_seconds", "summary", "Time spent per batch in each processing stage.");
+    for (const auto& stage : stages) {
+        for (double quantile : {0.5, 0.99}) {
+            appendFormat(out, "network_analyzer_stage_latency_seconds{stage=\"%s\",quantile=\"%g\"} ", stage.stage, quantile);
+            appendDouble(out, static_cast<double>(stage.histogram->percentile(quantile)) / 1e9);
+            out += '\n';
+        }
+        appendFormat(out, "network_analyzer_stage_latency_seconds_sum{stage=\"%s\"} ", stage.stage);
+        appendDouble(out, static_cast<double>(stage.histogram->totalNs()) / 1e9);
+        appendFormat(out, "\nnetwork_analyzer_stage_latency_seconds_count{stage=\"%s\"} ", stage.stage);
+        appendNumber(out, stage.histogram->count());
+        out += '\n';
+    }
+}
+
+/**
+ * @brief Encodes a snapshot as one JSON object followed by a newline
+ * @param view Snapshot to encode
+ * @param wall_ns Wall-clock time of the export
+ */
+void MetricsExporter::encodeJson(const DashboardSnapshot& view, uint64_t wall_ns) {
+    std::string& out = json_line;
+    out.clear();
+    
+    out += "{\"timestamp_ms\":";
+    appendNumber(out, wall_ns / NS_PER_MS);
+    out += ",\"sequence\":";
+    appendNumber(out, view.sequence);
+    out += ",\"elapsed_seconds\":";
+    appendDouble(out, view.elapsed_seconds);
+    out += ",\"packets\":";
+    appendNumber(out, view.counters.total_packets);
+    out += ",\"bytes\":";
+    appendNumber(out, view.counters.total_bytes);
+    out += ",\"active_flows\":";
+    appendNumber(out, view.active_flows);
+    out += ",\"evicted_flows\":";
+    appendNumber(out, view.evicted_flows);
+    
+    out += ",\"rates\":[";
+    for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+        Rate rate = view.rates.rate(RATE_CHANNEL_TOTAL, RATE_WINDOWS[w]);
+        appendFormat(out, "%s{\"window_seconds\":%u,\"packets_per_sec\":", w == 0 ? "" : ",", RATE_WINDOWS[w]);
+        appendDouble(out, rate.packets_per_sec);
+        out += ",\"bytes_per_sec\":";
+        appendDouble(out, rate.bytes_per_sec);
+        out += '}';
+    }
+    
+    out += "],\"protocols\":{";
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        appendFormat(out, "%s\"%s\":{\"packets\":", p == 0 ? "" : ",", protocolName(static_cast<Protocol>(p)));
+        appendNumber(out, view.counters.protocol_counts[p]);
+        out += ",\"bytes\":";
+        appendNumber(out, view.counters.protocol_bytes[p]);
+        out += '}';
+    }
+    
+    out += "},\"applications\":{";
+    for (size_t a = 0; a < APP_PROTOCOL_COUNT; a++) {
+        appendFormat(out, "%s\"%s\":{\"packets\":", a == 0 ? "" : ",", appProtocolName(static_cast<AppProtocol>(a)));
+        appendNumber(out, view.counters.app_counts[a]);
+        out += ",\"bytes\":";
+        appendNumber(out, view.counters.app_bytes[a]);
+        out += '}';
+    }
+    
+    out += "},\"interfaces\":[";
+    for (size_t i = 0; i < view.health.interfaces.size(); i++) {
+        const PipelineHealth& entry = view.health.interfaces[i];
+        uint16_t index = entry.interface_index;
+        out += i == 0 ? "{\"name\":" : ",{\"name\":";
+        appendJsonString(out, NetworkMonitor::interfaceName(index));
+        out += ",\"packets\":";
+        appendNumber(out, view.counters.interface_counts[index]);
+        out += ",\"bytes\":";
+        appendNumber(out, view.counters.interface_bytes[index]);
+        out += ",\"received\":";
+        appendNumber(out, entry.capture.received);
+        out += ",\"dropped\":";
+        appendNumber(out, entry.capture.dropped);
+        out += ",\"interface_dropped\":";
+        appendNumber(out, entry.capture.interface_dropped);
+        out += ",\"processed\":";
+        appendNumber(out, entry.processed);
+        out += ",\"queue_dropped\":";
+        appendNumber(out, entry.queue_dropped);
+        out += '}';
+    }
+    
+    out += "],\"top_flows\":[";
+    for (size_t i = 0; i < view.top_by_bytes.size() && i < JSON_TOP_FLOWS; i++) {
+        const FlowRecord& record = view.top_by_bytes[i];
+        const ConnectionInfo connection = record.oriented();
+        out += i == 0 ? "{\"protocol\":" : ",{\"protocol\":";
+        appendJsonString(out, protocolName(connection.protocol));
+        out += ",\"application\":";
+        appendJsonString(out, appProtocolName(record.app));
+        out += ",\"source\":";
+        appendJsonString(out, formatAddress(connection.source_addr, connection.ip_version));
+        out += ",\"source_port\":";
+        appendNumber(out, connection.source_port);
+        out += ",\"destination\":";
+        appendJsonString(out, formatAddress(connection.dest_addr, connection.ip_version));
+        out += ",\"destination_port\":";
+        appendNumber(out, connection.dest_port);
+        out += ",\"packets\":";
+        appendNumber(out, record.counters.packets);
+        out += ",\"bytes\":";
+        appendNumber(out, record.counters.bytes);
+        out += ",\"bytes_per_sec\":";
+        appendDouble(out, record.rates[0].bytes_per_sec);
+        if (connection.protocol == Protocol::TCP) {
+            out += ",\"state\":";
+            appendJsonString(out, tcpStateName(record.tcp_state));
+            out += ",\"handshake_rtt_ns\":";
+            appendNumber(out, record.handshake_rtt_ns);
+            out += ",\"retransmissions\":";
+            appendNumber(out, record.retransmissions);
+        }
+        out += '}';
+    }
+    out += "]}\n";
+}
+
+/**
+ * @brief Encodes a snapshot as a binary record
+ * @param view Snapshot to encode
+ * @param wall_ns Wall-clock time of the export
+ */
+void MetricsExporter::encodeBinary(const DashboardSnapshot& view, uint64_t wall_ns) {
+    std::string& out = binary_record;
+    out.assign("NAM1");
+    appendLittleEndian(out, 0, 4);  // Length, patched below
+    appendLittleEndian(out, wall_ns, 8);
+    appendLittleEndian(out, view.sequence, 8);
+    appendLittleEndian(out, view.counters.total_packets, 8);
+    appendLittleEndian(out, view.counters.total_bytes, 8);
+    appendLittleEndian(out, view.active_flows, 8);
+    appendLittleEndian(out, view.evicted_flows, 8);
+    
+    appendLittleEndian(out, PROTOCOL_COUNT, 1);
+    for (size_t p = 0; p < PROTOCOL_COUNT; p++) {
+        appendLittleEndian(out, view.counters.protocol_counts[p], 8);
+        appendLittleEndian(out, view.counters.protocol_bytes[p], 8);
+    }
+    
+    appendLittleEndian(out, RATE_WINDOW_COUNT, 1);
+    for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+        Rate rate = view.rates.rate(RATE_CHANNEL_TOTAL, RATE_WINDOWS[w]);
+        appendLittleEndian(out, RATE_WINDOWS[w], 4);
+        appendLittleEndianDouble(out, rate.packets_per_sec);
+        appendLittleEndianDouble(out, rate.bytes_per_sec);
+    }
+    
+    appendLittleEndian(out, view.health.interfaces.size(), 2);
+    for (const PipelineHealth& entry : view.health.interfaces) {
+        uint16_t index = entry.interface_index;
+        const std::string& name = NetworkMonitor::interfaceName(index);
+        size_t name_length = name.size() < UINT16_MAX ? name.size() : UINT16_MAX;
+        appendLittleEndian(out, name_length, 2);
+        out.append(name, 0, name_length);
+        appendLittleEndian(out, view.counters.interface_counts[index], 8);
+        appendLittleEndian(out, view.counters.interface_bytes[index], 8);
+        appendLittleEndian(out, entry.capture.received, 8);
+        appendLittleEndian(out, entry.capture.dropped, 8);
+        appendLittleEndian(out, entry.capture.interface_dropped, 8);
+        appendLittleEndian(out, entry.processed, 8);
+    }
+    
+    uint32_t length = static_cast<uint32_t>(out.size());
+    for (size_t i = 0; i < 4; i++) {
+        out[4 + i] = static_cast<char>((length >> (8 * i)) & 0xFF);
+    }
+}
+
+/**
+ * @brief Opens a stream destination
+ * @param stream Stream to open (its target must be set)
+ * @param error Receives a description of the failure
+ * @return true on success (TCP destinations connect lazily)
+ */
+bool MetricsExporter::openStream(Stream& stream, std::string& error) {
+    if (stream.target == "-") {
+        stream.file = stdout;
+        return true;
+    }
+    if (isSocketTarget(stream.target)) {
+#ifndef _WIN32
+        return true;  // Connected on the first write, retried while the peer is down
+#else
+        error = "TCP export targets are not supported on Windows: " + stream.target;
+        return false;
+#endif
+    }
+    stream.file = std::fopen(stream.target.c_str(), "ab");
+    if (stream.file == nullptr) {
+        error = "cannot open " + stream.target + ": " + std::strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes one record to a stream without blocking on sockets
+ * 
+ * Files and stdout are written and flushed directly. A socket gets at most
+ * one partially sent record: while its tail is pending, new records are
+ * dropped so the receiver always sees whole records.
+ * 
+ * @param stream Destination
+ * @param record Complete record
+ */
+void MetricsExporter::writeStream(Stream& stream, const std::string& record) {
+    if (stream.file != nullptr) {
+        std::fwrite(record.data(), 1, record.size(), stream.file);
+        std::fflush(stream.file);
+        return;
+    }
+#ifndef _WIN32
+    if (stream.fd < 0) {
+        uint64_t now = monotonicNs();
+        if (now < stream.next_connect_ns || (stream.fd = connectTo(stream.target)) < 0) {
+            if (now >= stream.next_connect_ns) {
+                stream.next_connect_ns = now + RECONNECT_DELAY_NS;
+            }
+            dropped_records.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+    
+    // Finish the previous record first; the new one only goes out behind it
+    const std::string* chunks[] = {&stream.pending, &record};
+    for (const std::string* chunk : chunks) {
+        if (chunk->empty()) {
+            continue;
+        }
+        size_t sent = 0;
+        while (sent < chunk->size()) {
+            ssize_t n = send(stream.fd, chunk->data() + sent, chunk->size() - sent, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+                close(stream.fd);  // Peer went away: reconnect later, resending from a record boundary
+                stream.fd = -1;
+                stream.pending.clear();
+                stream.next_connect_ns = monotonicNs() + RECONNECT_DELAY_NS;
+                dropped_records.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (n <= 0) {
+                break;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        
+        if (chunk == &stream.pending) {
+            stream.pending.erase(0, sent);
+            if (!stream.pending.empty()) {
+                dropped_records.fetch_add(1, std::memory_order_relaxed);  // Still busy: skip this record
+                return;
+            }
+        } else if (sent < chunk->size()) {
+            stream.pending.assign(*chunk, sent, std::string::npos);
+        }
+    }
+#else
+    (void)record;
+#endif
+}
+
+/**
+ * @brief Closes a stream destination
+ * @param stream Stream to close
+ */
+void MetricsExporter::closeStream(Stream& stream) {
+    if (stream.file != nullptr) {
+        if (stream.file != stdout) {
+            std::fclose(stream.file);
+        }
+        stream.file = nullptr;
+    }
+#ifndef _WIN32
+    if (stream.fd >= 0) {
+        close(stream.fd);
+        stream.fd = -1;
+    }
+#endif
+}
+
+/**
+ * @brief Opens the Prometheus listening socket
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool MetricsExporter::openListener(std::string& error) {
+#ifndef _WIN32
+    std::string host;
+    std::string port;
+    splitHostPort(config.prometheus, host, port);
+    
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    struct addrinfo* results = nullptr;
+    int status = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &results);
+    if (status != 0) {
+        error = "invalid Prometheus address " + config.prometheus + ": " + gai_strerror(status);
+        return false;
+    }
+    
+    int last_errno = 0;
+    for (struct addrinfo* ai = results; ai != nullptr && listen_fd < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            last_errno = errno;
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 || listen(fd, static_cast<int>(MAX_CLIENTS)) != 0) {
+            last_errno = errno;
+            close(fd);
+            continue;
+        }
+        setNonBlocking(fd);
+        listen_fd = fd;
+    }
+    freeaddrinfo(results);
+    
+    if (listen_fd < 0) {
+        error = "cannot listen on " + config.prometheus + ": " + std::strerror(last_errno);
+        return false;
+    }
+    return true;
+#else
+    error = "the Prometheus endpoint is not supported on Windows";
+    return false;
+#endif
+}
+
+/**
+ * @brief Reads from or writes to a scrape connection
+ * 
+ * Requests are answered once their headers are complete; GET /metrics (or
+ * /) returns the exposition of the latest export, anything else a 404.
+ * 
+ * @param client Connection with pending events
+ * @return false once the connection is finished
+ */
+bool MetricsExporter::serviceClient(Client& client) {
+#ifndef _WIN32
+    if (client.response.empty()) {
+        char buffer[2048];
+        ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) {
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+        }
+        client.request.append(buffer, static_cast<size_t>(n));
+        if (client.request.size() > MAX_REQUEST_SIZE) {
+            return false;
+        }
+        if (client.request.find("\r\n\r\n") == std::string::npos) {
+            return true;
+        }
+        
+        const std::string& request = client.request;
+        bool found = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 13, "GET /metrics?") == 0 ||
+                     request.compare(0, 6, "GET / ") == 0;
+        const std::string body = found ? prometheus_text : std::string("not found\n");
+        client.response = found ? "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                : "HTTP/1.1 404 Not Found\r\nContent-Type: text/plain\r\n";
+        client.response += "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+        client.response += body;
+    }
+    
+    while (client.sent < client.response.size()) {
+        ssize_t n = send(client.fd, client.response.data() + client.sent, client.response.size() - client.sent,
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.sent += static_cast<size_t>(n);
+    }
+    return false;
+#else
+    (void)client;
+    return false;
+#endif
+}
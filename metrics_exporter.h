@@ -0,0 +1,213 @@
+/**
+ * @file metrics_exporter.h
+ * @brief Periodic export of aggregated statistics for monitoring systems
+ * 
+ * This header defines the MetricsExporter class, which publishes dashboard
+ * snapshots as a Prometheus text endpoint, newline-delimited JSON, a
+ * compact binary record stream and a per-interval history file.
+ */
+
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstdint>
+#include "dashboard.h"
+#include "history_store.h"
+
+/**
+ * @struct ExportConfig
+ * @brief Destinations and period of the metrics export
+ * 
+ * Stream targets are a file path, "-" for stdout, or "host:port" for a TCP
+ * connection. Empty strings disable the corresponding output.
+ */
+struct ExportConfig {
+    unsigned int interval_ms = 1000;   ///< Time between exported snapshots
+    std::string prometheus;            ///< "[address:]port" to serve /metrics on
+    std::string json;                  ///< NDJSON stream target
+    std::string binary;                ///< Binary record stream target
+    std::string history;               ///< Interval history file (see HistoryWriter)
+    unsigned int history_interval_s = 60;  ///< Length of one history interval
+    
+    /**
+     * @brief Checks whether any output is configured
+     * @return true if at least one destination is set
+     */
+    bool enabled() const { return !prometheus.empty() || !json.empty() || !binary.empty() || !history.empty(); }
+};
+
+/**
+ * @class MetricsExporter
+ * @brief Exporter thread turning dashboard snapshots into machine-readable metrics
+ * 
+ * Every interval the exporter refreshes the dashboard and encodes the new
+ * DashboardSnapshot into each configured format. It only ever reads
+ * published snapshots, so a slow scraper or a stalled socket delays the
+ * exporter but never the capture threads. Stream writes to sockets never
+ * block: a record that cannot be sent completely is kept and finished first
+ * on the next interval, and records arriving meanwhile are counted as
+ * dropped. All encoding buffers are reused between intervals. The history
+ * file is rolled over from the same snapshots, so it costs the capture
+ * threads nothing either.
+ * 
+ * Binary records are little-endian:
+ * 
+ *     char[4]  magic "NAM1"
+ *     uint32   record length in bytes, including the magic
+ *     uint64   wall-clock time in ns since the epoch
+ *     uint64   sequence, packets, bytes, active flows, evicted flows
+ *     uint8    protocol count P, then P x (uint64 packets, uint64 bytes)
+ *     uint8    window count W, then W x (uint32 seconds, float64 packets/s, float64 bytes/s)
+ *     uint16   interface count I, then I x (uint16 name length, name bytes,
+ *              uint64 packets, bytes, received, dropped, interface dropped, processed)
+ */
+class MetricsExporter {
+public:
+    /**
+     * @brief Constructor
+     * @param dashboard Statistics source (shared with the capture threads)
+     * @param config Destinations and export period
+     */
+    MetricsExporter(std::shared_ptr<Dashboard> dashboard, const ExportConfig& config);
+    
+    /**
+     * @brief Destructor - stops the exporter thread
+     */
+    ~MetricsExporter();
+    
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    
+    /**
+     * @brief Opens every destination and starts the exporter thread
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool start(std::string& error);
+    
+    /**
+     * @brief Exports a final snapshot and stops the exporter thread
+     */
+    void stop();
+    
+    /**
+     * @brief Gets the number of stream records dropped because a socket was busy
+     * @return Dropped records across all streams
+     */
+    uint64_t droppedRecords() const { return dropped_records.load(std::memory_order_relaxed); }
+
+private:
+    /**
+     * @brief Append-only record stream to a file, stdout or TCP peer
+     */
+    struct Stream {
+        std::string target;      ///< Destination as configured
+        FILE* file = nullptr;    ///< File or stdout destination
+        int fd = -1;             ///< Connected socket (TCP destinations)
+        std::string pending;     ///< Unsent tail of the previous record
+        uint64_t next_connect_ns = 0;  ///< Earliest reconnect attempt
+    };
+    
+    /**
+     * @brief One Prometheus scrape in progress
+     */
+    struct Client {
+        int fd;
+        std::string request;     ///< Bytes received so far
+        std::string response;    ///< Response being sent
+        size_t sent = 0;
+        uint64_t deadline_ns;    ///< Connection is dropped after this time
+    };
+    
+    std::shared_ptr<Dashboard> dashboard;
+    ExportConfig config;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> dropped_records;
+    int wake_fds[2];              ///< Self-pipe waking the exporter thread on stop()
+    int listen_fd;                ///< Prometheus listening socket
+    std::vector<Client> clients;
+    Stream json_stream;
+    Stream binary_stream;
+    std::unique_ptr<HistoryWriter> history;
+    
+    // Encoding buffers, reused every interval
+    std::string prometheus_text;  ///< Latest Prometheus exposition
+    std::string json_line;
+    std::string binary_record;
+    std::string scratch;
+    
+    /**
+     * @brief Exporter thread: exports on every tick and serves scrapes in between
+     */
+    void run();
+    
+    /**
+     * @brief Refreshes the dashboard and writes one snapshot to every destination
+     * @param last Last export before the thread stops (closes the history interval)
+     */
+    void exportSnapshot(bool last);
+    
+    /**
+     * @brief Encodes a snapshot in the Prometheus text exposition format
+     * @param view Snapshot to encode
+     */
+    void encodePrometheus(const DashboardSnapshot& view);
+    
+    /**
+     * @brief Encodes a snapshot as one JSON object followed by a newline
+     * @param view Snapshot to encode
+     * @param wall_ns Wall-clock time of the export
+     */
+    void encodeJson(const DashboardSnapshot& view, uint64_t wall_ns);
+    
+    /**
+     * @brief Encodes a snapshot as a binary record
+     * @param view Snapshot to encode
+     * @param wall_ns Wall-clock time of the export
+     */
+    void encodeBinary(const DashboardSnapshot& view, uint64_t wall_ns);
+    
+    /**
+     * @brief Opens a stream destination
+     * @param stream Stream to open (its target must be set)
+     * @param error Receives a description of the failure
+     * @return true on success (TCP destinations connect lazily)
+     */
+    static bool openStream(Stream& stream, std::string& error);
+    
+    /**
+     * @brief Writes one record to a stream without blocking on sockets
+     * @param stream Destination
+     * @param record Complete record
+     */
+    void writeStream(Stream& stream, const std::string& record);
+    
+    /**
+     * @brief Closes a stream destination
+     * @param stream Stream to close
+     */
+    static void closeStream(Stream& stream);
+    
+    /**
+     * @brief Opens the Prometheus listening socket
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool openListener(std::string& error);
+    
+    /**
+     * @brief Reads from or writes to a scrape connection
+     * @param client Connection with pending events
+     * @return false once the connection is finished
+     */
+    bool serviceClient(Client& client);
+};
+
+#endif // METRICS_EXPORTER_H
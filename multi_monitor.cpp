@@ -8,15 +8,36 @@
 
 #include "multi_monitor.h"
 #include <iostream>
+#include <map>
+#include <algorithm>
+#include <functional>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
 
 /**
  * @brief Constructor - Initializes multi-interface monitoring
  * @param ifaces Vector of interface names to monitor
  * @param use_dash Whether to use dashboard mode
+ * @param config Capture settings applied to every interface
+ * @param worker_count Capture threads per interface
+ * @param placement CPU placement of the capture threads
+ * @param analysis Analysis workers fed by the capture threads
  */
-MultiMonitor::MultiMonitor(const std::vector<std::string>& ifaces, bool use_dash)
-    : interfaces(ifaces), running(false), use_dashboard(use_dash), dashboard(nullptr) {
-    
+MultiMonitor::MultiMonitor(const std::vector<std::string>& ifaces, bool use_dash, const CaptureConfig& config,
+                           unsigned int worker_count, const AffinityConfig& placement, const AnalysisConfig& analysis)
+    : interfaces(ifaces), running(false), monitors_ready(false), stop_requested(false), use_dashboard(use_dash), capture_config(config),
+      workers(worker_count ? worker_count : 1), affinity(placement), startup_cpus(allowedCpus()), dashboard(nullptr),
+      analysis_config(analysis) {
+
+#ifndef __linux__
+    if (workers > 1 && capture_config.backend != BackendType::File) {
+        std::cerr << "Multiple workers per interface need Linux packet fanout; using 1" << std::endl;
+        workers = 1;
+    }
+#endif
+
     if (interfaces.empty()) {
         std::cerr << "No interfaces specified for multi-interface monitoring" << std::endl;
         return;
@@ -24,7 +45,17 @@ MultiMonitor::MultiMonitor(const std::vector<std::string>& ifaces, bool use_dash
     
     std::cout << "Initializing multi-interface monitoring for:" << std::endl;
     for (const auto& iface : interfaces) {
-        std::cout << "  - " << iface << std::endl;
+        std::cout << "  - " << iface;
+        if (workers > 1) {
+            std::cout << " (" << workers
+                      << (capture_config.backend == BackendType::File ? " parallel readers)" : " fanout workers)");
+        }
+        std::cout << std::endl;
+    }
+    if (analysis_config.workers > 0) {
+        std::cout << "  analysis: " << analysis_config.workers << " workers, "
+                  << (analysis_config.policy == QueuePolicy::Block ? "blocking" : "dropping")
+                  << " when a queue of " << analysis_config.ring_capacity << " records is full" << std::endl;
     }
 }
 
@@ -44,65 +75,257 @@ void MultiMonitor::setDashboard(std::shared_ptr<Dashboard> dash) {
 }
 
 /**
- * @brief Thread function for capturing packets on a single interface
- * @param interface_name Name of the interface to capture on
+ * @brief Sets the packet log written by every capture thread
+ * @param log Shared pointer to the packet log
  */
-void MultiMonitor::captureThread(const std::string& interface_name) {
-    try {
-        // Create a monitor for this interface
-        auto monitor = std::make_unique<NetworkMonitor>(interface_name, use_dashboard);
-        
-        if (dashboard) {
-            monitor->setDashboard(dashboard);
+void MultiMonitor::setPacketLog(std::shared_ptr<PacketLog> log) {
+    packet_log = log;
+}
+
+/**
+ * @brief Sets the packet dump fed by every capture thread
+ * @param dump Shared pointer to the packet dump
+ */
+void MultiMonitor::setPacketDump(std::shared_ptr<PacketDump> dump) {
+    packet_dump = dump;
+}
+
+/**
+ * @brief Chooses the CPUs of every capture thread, in monitor order
+ */
+void MultiMonitor::assignCpus() {
+    thread_cpus.clear();
+    if (!affinity.enabled()) {
+        return;
+    }
+    
+    // Automatic choices avoid the housekeeping CPU unless nothing else is left
+    std::vector<int> shared = startup_cpus;
+    shared.erase(std::remove(shared.begin(), shared.end(), affinity.housekeeping_cpu), shared.end());
+    if (shared.empty()) {
+        shared = startup_cpus;
+    }
+    
+    std::map<int, size_t> next_on_node;
+    size_t next_explicit = 0;
+    for (size_t i = 0; i < interfaces.size(); i++) {
+        int node = affinity.numa_local ? deviceNumaNode(interfaces[i]) : -1;
+        std::vector<int> node_cpus;
+        if (node >= 0) {
+            for (int cpu : numaNodeCpus(node)) {
+                if (std::find(shared.begin(), shared.end(), cpu) != shared.end()) {
+                    node_cpus.push_back(cpu);
+                }
+            }
         }
         
+        for (unsigned int w = 0; w < workers; w++) {
+            std::vector<int> cpus;
+            if (!affinity.capture_cpus.empty()) {
+                cpus.push_back(affinity.capture_cpus[next_explicit++ % affinity.capture_cpus.size()]);
+            } else if (!node_cpus.empty()) {
+                cpus.push_back(node_cpus[next_on_node[node]++ % node_cpus.size()]);
+            } else if (affinity.housekeeping_cpu >= 0 || affinity.numa_local) {
+                cpus = shared;   // Unknown node: only keep clear of the housekeeping CPU
+            }
+            thread_cpus.push_back(cpus);
+            
+            if (!cpus.empty()) {
+                std::cout << "  " << interfaces[i];
+                if (workers > 1) {
+                    std::cout << " worker " << w;
+                }
+                std::cout << ": CPU " << formatCpuList(cpus);
+                if (node >= 0) {
+                    std::cout << " (NIC on NUMA node " << node << ")";
+                }
+                std::cout << std::endl;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Thread function for capturing packets on a single interface
+ * @param monitor Monitor owned by this thread until it returns
+ * @param cpus CPUs the thread pins itself to (empty = not pinned)
+ */
+void MultiMonitor::captureThread(NetworkMonitor* monitor, std::vector<int> cpus) {
+    if (!cpus.empty() && !pinCurrentThread(cpus)) {
+        std::cerr << "Could not pin the capture thread for " << monitor->getDevice()
+                  << " to CPU " << formatCpuList(cpus) << std::endl;
+    }
+    try {
         // Start capturing (this will block until stopped)
         monitor->startCapture(-1);
-        
     } catch (const std::exception& e) {
-        std::cerr << "Error in capture thread for " << interface_name << ": " << e.what() << std::endl;
+        std::cerr << "Error in capture thread for " << monitor->getDevice() << ": " << e.what() << std::endl;
+    }
+}
+
+/**
+ * @brief Opens one interface worker and attaches it to the shared consumers
+ * 
+ * Runs on its own thread during startCapture(); every consumer's create
+ * call is thread-safe. The thread is moved onto the worker's CPUs first, so
+ * its ring, shard, log queue and dump buffers are first touched on the
+ * worker's own NUMA node.
+ * 
+ * @param iface Interface name
+ * @param config Capture settings of this worker
+ * @param cpus CPUs of the worker's capture thread (empty = not pinned)
+ * @param monitor Receives the opened monitor (left empty on failure)
+ * @param error Receives a description of the failure
+ */
+void MultiMonitor::openMonitor(const std::string& iface, CaptureConfig config, std::vector<int> cpus,
+                               std::unique_ptr<NetworkMonitor>& monitor, std::string& error) {
+    ScopedAffinity placement(cpus);
+    try {
+        monitor = std::make_unique<NetworkMonitor>(iface, use_dashboard, config);
+    } catch (const std::exception& e) {
+        error = e.what();
+        return;
+    }
+    if (analysis) {
+        monitor->setAnalysisStage(analysis);
+    } else if (dashboard) {
+        monitor->setDashboard(dashboard);
+    }
+    if (packet_log) {
+        monitor->setPacketLog(packet_log);
+    }
+    if (packet_dump) {
+        monitor->setPacketDump(packet_dump);
     }
 }
 
 /**
  * @brief Start capturing packets on all interfaces
+ * @return false if no interface could be opened
  */
-void MultiMonitor::startCapture() {
+bool MultiMonitor::startCapture() {
     if (running) {
         std::cerr << "Capture already running" << std::endl;
-        return;
+        return false;
     }
     
     running = true;
     
     std::cout << "Starting capture on " << interfaces.size() << " interface(s)..." << std::endl;
     
-    // Create a capture thread for each interface
+    assignCpus();
+    
+    // Analysis workers account into the dashboard; without one there is nothing to analyze
+    if (analysis_config.workers > 0 && dashboard) {
+        analysis = std::make_shared<AnalysisStage>(dashboard, analysis_config);
+    } else if (analysis_config.workers > 0) {
+        std::cerr << "Analysis workers need --dashboard or a metrics export; ignoring --analysis-workers" << std::endl;
+    }
+    
+    // Open every interface worker before any capture thread starts, so
+    // stopCapture() always sees the complete list. Devices are opened
+    // concurrently (ring setup and driver probing take a while each), and one
+    // that fails is reported and skipped rather than ending the process.
+    // Registering the names first keeps interface indices in command-line order.
     for (const auto& iface : interfaces) {
-        capture_threads.emplace_back(&MultiMonitor::captureThread, this, iface);
+        NetworkMonitor::registerInterface(iface);
+    }
+    std::vector<std::unique_ptr<NetworkMonitor>> opened(interfaces.size() * workers);
+    std::vector<std::string> errors(opened.size());
+    std::vector<std::thread> openers;
+    for (size_t i = 0; i < interfaces.size(); i++) {
+        CaptureConfig config = capture_config;
+        if (config.replay && workers > 1) {
+            // The parts of a replayed file keep one clock, so they play side by side at the recorded pace
+            config.replay_clock = std::make_shared<std::atomic<uint64_t>>(0);
+        }
+#ifdef __linux__
+        if (workers > 1 && config.backend != BackendType::File) {
+            // One fanout group per interface, unique to this process
+            config.fanout_group = static_cast<int>((static_cast<unsigned int>(getpid()) + i) & 0xFFFF);
+        }
+#endif
+        for (unsigned int w = 0; w < workers; w++) {
+            // Workers reading a file each take one part of it
+            config.file_part = w;
+            config.file_parts = workers;
+            size_t slot = i * workers + w;
+            openers.emplace_back(&MultiMonitor::openMonitor, this, interfaces[i], config,
+                                 thread_cpus.empty() ? std::vector<int>() : thread_cpus[slot],
+                                 std::ref(opened[slot]), std::ref(errors[slot]));
+        }
+    }
+    for (auto& opener : openers) {
+        opener.join();
     }
     
-    // Wait for all threads to complete
+    std::vector<std::vector<int>> opened_cpus;
+    for (size_t slot = 0; slot < opened.size(); slot++) {
+        if (!opened[slot]) {
+            std::cerr << errors[slot] << "; skipping it" << std::endl;
+            open_failures.push_back(errors[slot]);
+            continue;
+        }
+        monitors.push_back(std::move(opened[slot]));
+        if (!thread_cpus.empty()) {
+            opened_cpus.push_back(thread_cpus[slot]);
+        }
+    }
+    thread_cpus = opened_cpus;
+    monitors_ready = true;
+    if (monitors.empty()) {
+        std::cerr << "No interface could be opened" << std::endl;
+        running = false;
+        return false;
+    }
+    
+    // Create the capture threads, unless a stop arrived while opening; the
+    // analysis workers run first so a blocking queue always drains
+    if (!stop_requested) {
+        if (analysis) {
+            analysis->start();
+        }
+        for (size_t m = 0; m < monitors.size(); m++) {
+            std::vector<int> cpus = thread_cpus.empty() ? std::vector<int>() : thread_cpus[m];
+            capture_threads.emplace_back(&MultiMonitor::captureThread, this, monitors[m].get(), cpus);
+        }
+    }
+    
+    // Wait for all threads to drain and complete
     for (auto& thread : capture_threads) {
         if (thread.joinable()) {
             thread.join();
         }
     }
+    capture_threads.clear();
+    if (analysis) {
+        analysis->stop();  // Accounts what is still queued and publishes the final snapshots
+    }
+    running = false;
+    return true;
 }
 
 /**
  * @brief Stop capturing packets on all interfaces
  */
 void MultiMonitor::stopCapture() {
-    if (!running) {
-        return;
+    stop_requested = true;
+    if (!monitors_ready) {
+        return;  // startCapture() checks stop_requested before starting threads
+    }
+    for (auto& monitor : monitors) {
+        monitor->stopCapture();
+    }
+}
+
+/**
+ * @brief Prints the capture counters of every monitor
+ */
+void MultiMonitor::printCaptureStats() {
+    for (auto& monitor : monitors) {
+        monitor->printCaptureStats();
+    }
+    for (const auto& failure : open_failures) {
+        std::cerr << failure << " (not captured)" << std::endl;
     }
-    
-    running = false;
-    
-    std::cout << "Stopping capture on all interfaces..." << std::endl;
-    
-    // Note: pcap_loop doesn't have a clean way to interrupt from another thread
-    // In a production system, you'd want to use pcap_breakloop() or similar
-    // For now, the threads will stop when the main process exits
 }
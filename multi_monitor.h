@@ -18,13 +18,23 @@
 #include <mutex>
 #include "network_monitor.h"
 #include "dashboard.h"
+#include "packet_log.h"
+#include "packet_dump.h"
+#include "cpu_affinity.h"
+#include "analysis_stage.h"
 
 /**
  * @class MultiMonitor
  * @brief Manager class for monitoring multiple network interfaces simultaneously
  * 
  * MultiMonitor creates separate threads for each network interface and
- * coordinates packet capture from all of them concurrently.
+ * coordinates packet capture from all of them concurrently. On Linux a
+ * single interface can also be served by several worker threads whose
+ * sockets share a PACKET_FANOUT_HASH group, each feeding its own shard.
+ * Capture threads can be pinned to CPUs, in which case each worker's
+ * socket ring and statistics shard are also allocated on its CPU's NUMA
+ * node. With analysis workers configured, capture threads only decode and
+ * queue packets, and an AnalysisStage accounts them.
  */
 class MultiMonitor {
 public:
@@ -32,44 +42,113 @@ public:
      * @brief Constructor - initializes multi-interface monitoring
      * @param interfaces Vector of interface names to monitor
      * @param use_dashboard Whether to use dashboard mode (default: false)
+     * @param config Capture settings applied to every interface
+     * @param workers Capture threads per interface (more than one requires Linux fanout)
+     * @param affinity CPU placement of the capture threads
+     * @param analysis Analysis workers fed by the capture threads (none by default)
      */
-    MultiMonitor(const std::vector<std::string>& interfaces, bool use_dashboard = false);
+    MultiMonitor(const std::vector<std::string>& interfaces, bool use_dashboard = false,
+                 const CaptureConfig& config = CaptureConfig(), unsigned int workers = 1,
+                 const AffinityConfig& affinity = AffinityConfig(),
+                 const AnalysisConfig& analysis = AnalysisConfig());
     
     /**
      * @brief Destructor - cleans up all monitoring threads
      */
     ~MultiMonitor();
-
+    
     /**
      * @brief Start capturing packets on all interfaces
+     * 
+     * Opens every interface concurrently, skipping (and reporting) those
+     * that fail, then blocks until all capture threads have drained their
+     * backends and been joined.
+     * 
+     * @return false if no interface could be opened
      */
-    void startCapture();
+    bool startCapture();
     
     /**
      * @brief Stop capturing packets on all interfaces
+     * 
+     * Only sets flags and breaks the capture loops, so it is safe to call
+     * from a signal handler. startCapture() returns once the threads finish.
      */
     void stopCapture();
     
+    /**
+     * @brief Prints the capture counters of every monitor and the interfaces that failed to open
+     * 
+     * Call only after startCapture() has returned.
+     */
+    void printCaptureStats();
+    
     /**
      * @brief Sets the dashboard for visualization
      * @param dash Shared pointer to dashboard instance
      */
     void setDashboard(std::shared_ptr<Dashboard> dash);
+    
+    /**
+     * @brief Sets the packet log written by every capture thread
+     * @param log Shared pointer to the packet log
+     */
+    void setPacketLog(std::shared_ptr<PacketLog> log);
+    
+    /**
+     * @brief Sets the packet dump fed by every capture thread
+     * @param dump Shared pointer to the packet dump
+     */
+    void setPacketDump(std::shared_ptr<PacketDump> dump);
 
 private:
     std::vector<std::string> interfaces;           ///< List of interfaces to monitor
     std::vector<std::unique_ptr<NetworkMonitor>> monitors; ///< Monitor for each interface
-    std::vector<std::thread> capture_threads;      ///< Thread for each interface
+    std::vector<std::thread> capture_threads;      ///< Thread for each interface worker
     std::atomic<bool> running;                     ///< Flag to control capture threads
+    std::atomic<bool> monitors_ready;              ///< monitors is complete and may be stopped
+    std::atomic<bool> stop_requested;              ///< stopCapture() was called
     bool use_dashboard;                            ///< Whether to use dashboard mode
+    CaptureConfig capture_config;                  ///< Capture settings for every interface
+    unsigned int workers;                          ///< Capture threads per interface
+    AffinityConfig affinity;                       ///< CPU placement of the capture threads
+    std::vector<int> startup_cpus;                 ///< CPUs the process could use when constructed
+    std::vector<std::vector<int>> thread_cpus;     ///< CPUs of each monitor's thread (empty = not pinned)
+    std::vector<std::string> open_failures;        ///< Why skipped interface workers could not be opened
     std::shared_ptr<Dashboard> dashboard;          ///< Shared dashboard instance
+    std::shared_ptr<PacketLog> packet_log;         ///< Shared packet log
+    std::shared_ptr<PacketDump> packet_dump;       ///< Shared packet dump
+    AnalysisConfig analysis_config;                ///< Analysis workers and their queues
+    std::shared_ptr<AnalysisStage> analysis;       ///< Analysis workers (null = capture threads account inline)
     std::mutex mutex;                              ///< Mutex for thread safety
     
+    /**
+     * @brief Chooses the CPUs of every capture thread, in monitor order
+     * 
+     * Explicit CPUs are handed out in turn. With NUMA placement each
+     * interface's workers are spread over the CPUs of its NIC's node. The
+     * housekeeping CPU is left out of automatic choices; threads without a
+     * CPU of their own may run on any other CPU.
+     */
+    void assignCpus();
+    
+    /**
+     * @brief Opens one interface worker and attaches it to the shared consumers
+     * @param iface Interface name
+     * @param config Capture settings of this worker
+     * @param cpus CPUs of the worker's capture thread (empty = not pinned)
+     * @param monitor Receives the opened monitor (left empty on failure)
+     * @param error Receives a description of the failure
+     */
+    void openMonitor(const std::string& iface, CaptureConfig config, std::vector<int> cpus,
+                     std::unique_ptr<NetworkMonitor>& monitor, std::string& error);
+    
     /**
      * @brief Thread function for capturing packets on a single interface
-     * @param interface_name Name of the interface to capture on
+     * @param monitor Monitor owned by this thread until it returns
+     * @param cpus CPUs the thread pins itself to (empty = not pinned)
      */
-    void captureThread(const std::string& interface_name);
+    void captureThread(NetworkMonitor* monitor, std::vector<int> cpus);
 };
 
 #endif // MULTI_MONITOR_H
@@ -8,41 +8,108 @@
 
 #include "network_monitor.h"
 #include "dashboard.h"
+#include "packet_log.h"
+#include "packet_dump.h"
+#include "analysis_stage.h"
+#include <cstring>
+#include <stdexcept>
 
-// Static dashboard instance
-std::shared_ptr<Dashboard> NetworkMonitor::dashboard = nullptr;
-// Static current device name for packet handler
-std::string NetworkMonitor::current_device = "";
+// Interface registry shared by all monitors
+std::array<std::string, MAX_INTERFACES> NetworkMonitor::interface_names;
+std::atomic<uint16_t> NetworkMonitor::interface_count(0);
+std::mutex NetworkMonitor::interface_mutex;
+
+/**
+ * @brief Gets the display name of a protocol
+ * @param protocol Protocol identifier
+ * @return Protocol name ("TCP", "UDP", "ICMP" or "Other")
+ */
+const char* protocolName(Protocol protocol) {
+    switch (protocol) {
+        case Protocol::TCP:  return "TCP";
+        case Protocol::UDP:  return "UDP";
+        case Protocol::ICMP: return "ICMP";
+        default:             return "Other";
+    }
+}
+
+/**
+ * @brief Formats a raw IP address for display
+ * @param addr Address bytes in network byte order
+ * @param ip_version IP version (4 or 6)
+ * @return Printable address string
+ */
+std::string formatAddress(const uint8_t* addr, uint8_t ip_version) {
+    char buf[INET6_ADDRSTRLEN];
+    int family = (ip_version == 6) ? AF_INET6 : AF_INET;
+    if (inet_ntop(family, addr, buf, sizeof(buf)) == nullptr) {
+        return "?";
+    }
+    return buf;
+}
 
 /**
  * @brief Constructor - Opens network device for packet capture
  * 
- * Initializes the pcap session in promiscuous mode, which allows capturing
- * all packets on the network interface, not just those destined for this host.
+ * Initializes the configured capture backend in promiscuous mode, which allows
+ * capturing all packets on the network interface, not just those destined for
+ * this host. If the memory-mapped ring cannot be set up, libpcap is used instead.
+ * Several monitors may be constructed concurrently; each status line is
+ * written in one piece so they do not interleave.
  * 
  * @param dev Network device name (e.g., "eth0", "wlan0", "en0")
  * @param use_dash Whether to use dashboard mode
+ * @param config Capture backend and buffer settings
+ * @throws std::runtime_error if the device or file cannot be opened
  */
-NetworkMonitor::NetworkMonitor(const std::string& dev, bool use_dash) 
-    : handle(nullptr), device(dev), use_dashboard(use_dash) {
-    // Open the session in promiscuous mode
-    // Parameters: device, snapshot length, promiscuous mode, timeout (ms), error buffer
-    handle = pcap_open_live(device.c_str(), BUFSIZ, 1, 1000, errbuf);
-    if (handle == nullptr) {
-        std::cerr << "Couldn't open device " << device << ": " << errbuf << std::endl;
-        exit(EXIT_FAILURE);
+NetworkMonitor::NetworkMonitor(const std::string& dev, bool use_dash, const CaptureConfig& config) 
+    : device(dev), use_dashboard(use_dash), interface_index(0),
+      dashboard(nullptr), shard(nullptr), log_queue(nullptr), dump_queue(nullptr), analysis_queue(nullptr), health(&local_health), next_stats_ns(0),
+      decoder(nullptr) {
+    std::string error;
+    backend = CaptureBackend::create(config.backend);
+    if (!backend->open(device, config, error) && config.backend == BackendType::Mmap) {
+        std::cerr << ("Couldn't set up " + std::string(backend->name()) + " capture on " + device + ": " + error +
+                      " (falling back to pcap)\n");
+        backend = CaptureBackend::create(BackendType::Pcap);
+        error.clear();
+        backend->open(device, config, error);
+    }
+    if (!error.empty()) {
+        throw std::runtime_error("Couldn't open " +
+                                 std::string(config.backend == BackendType::File ? "file " : "device ") + device +
+                                 ": " + error);
+    }
+    interface_index = registerInterface(device);
+    local_health.interface_index = interface_index;
+    selectLinkDecoder();
+    if (config.backend == BackendType::File) {
+        std::cout << ("Reading capture file: " + device + (config.replay ? " (timestamp-paced replay)" : "") + "\n");
+    } else {
+        std::cout << ("Sniffing on device: " + device + " (" + backend->name() + " backend, " +
+                      backend->timestampSource() + " timestamps)\n");
     }
-    current_device = device;
-    std::cout << "Sniffing on device: " << device << std::endl;
 }
 
 /**
- * @brief Destructor - Closes the pcap session and releases resources
+ * @brief Constructor - Monitors packets from an already opened backend
+ * @param name Name the packets are accounted under
+ * @param source Opened packet source
+ * @param use_dash Whether to use dashboard mode
+ */
+NetworkMonitor::NetworkMonitor(const std::string& name, std::unique_ptr<CaptureBackend> source, bool use_dash)
+    : backend(std::move(source)), device(name), use_dashboard(use_dash), interface_index(0),
+      dashboard(nullptr), shard(nullptr), log_queue(nullptr), dump_queue(nullptr), analysis_queue(nullptr), health(&local_health), next_stats_ns(0),
+      decoder(nullptr) {
+    interface_index = registerInterface(device);
+    local_health.interface_index = interface_index;
+    selectLinkDecoder();
+}
+
+/**
+ * @brief Destructor - Closes the capture backend and releases resources
  */
 NetworkMonitor::~NetworkMonitor() {
-    if (handle) {
-        pcap_close(handle);
-    }
 }
 
 /**
@@ -51,21 +118,67 @@ NetworkMonitor::~NetworkMonitor() {
  */
 void NetworkMonitor::setDashboard(std::shared_ptr<Dashboard> dash) {
     dashboard = dash;
+    shard = dashboard ? dashboard->createShard() : nullptr;
+    health = shard ? &shard->health() : &local_health;
+    *health = local_health;
+}
+
+/**
+ * @brief Sets the packet log that receives a record of every packet
+ * @param log Shared pointer to the packet log
+ */
+void NetworkMonitor::setPacketLog(std::shared_ptr<PacketLog> log) {
+    packet_log = log;
+    log_queue = packet_log ? packet_log->createQueue() : nullptr;
+}
+
+/**
+ * @brief Sets the packet dump that saves the selected packets
+ * @param dump Shared pointer to the packet dump
+ */
+void NetworkMonitor::setPacketDump(std::shared_ptr<PacketDump> dump) {
+    packet_dump = dump;
+    dump_queue = packet_dump ? packet_dump->createQueue(interface_index, backend->datalink()) : nullptr;
+}
+
+/**
+ * @brief Hands this monitor's packets to analysis workers instead of a shard
+ * @param stage Shared pointer to the analysis stage
+ */
+void NetworkMonitor::setAnalysisStage(std::shared_ptr<AnalysisStage> stage) {
+    analysis = stage;
+    dashboard = nullptr;
+    shard = analysis ? analysis->createHealthShard() : nullptr;
+    analysis_queue = analysis ? analysis->createQueue() : nullptr;
+    health = shard ? &shard->health() : &local_health;
+    *health = local_health;
 }
 
 /**
  * @brief Lists all available network interfaces
- * @return Vector of interface names
+ * 
+ * pcap_findalldevs() probes every device and can take a noticeable time,
+ * so the list is built once per process and reused by later calls (the
+ * default device, interactive selection and --list all read it).
+ * 
+ * @return Vector of interface names, in the order libpcap reports them
  */
 std::vector<std::string> NetworkMonitor::listInterfaces() {
-    std::vector<std::string> interfaces;
+    static std::mutex discovery_mutex;
+    static std::vector<std::string> interfaces;
+    static bool discovered = false;
+    std::lock_guard<std::mutex> lock(discovery_mutex);
+    if (discovered) {
+        return interfaces;
+    }
+    
     pcap_if_t* alldevs;
     char errbuf[PCAP_ERRBUF_SIZE];
     
     // Find all devices
     if (pcap_findalldevs(&alldevs, errbuf) == -1) {
         std::cerr << "Error finding devices: " << errbuf << std::endl;
-        return interfaces;
+        return interfaces;   // Not cached: a later call may succeed
     }
     
     // Iterate through the list and add to vector
@@ -75,6 +188,7 @@ std::vector<std::string> NetworkMonitor::listInterfaces() {
     
     // Free the device list
     pcap_freealldevs(alldevs);
+    discovered = true;
     
     return interfaces;
 }
@@ -87,90 +201,255 @@ std::string NetworkMonitor::getDevice() const {
     return device;
 }
 
+/**
+ * @brief Registers an interface name and returns its compact index
+ * 
+ * Registering the same name twice returns the same index. Names are stored in
+ * a fixed array so lookups from other threads never race with registration.
+ * 
+ * @param name Interface name
+ * @return Index stored in PacketInfo::interface_index
+ */
+uint16_t NetworkMonitor::registerInterface(const std::string& name) {
+    std::lock_guard<std::mutex> lock(interface_mutex);
+    uint16_t count = interface_count.load(std::memory_order_relaxed);
+    for (uint16_t i = 0; i < count; i++) {
+        if (interface_names[i] == name) {
+            return i;
+        }
+    }
+    if (count >= MAX_INTERFACES) {
+        std::cerr << "Too many interfaces, accounting " << name << " as "
+                  << interface_names[MAX_INTERFACES - 1] << std::endl;
+        return MAX_INTERFACES - 1;
+    }
+    interface_names[count] = name;
+    interface_count.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+/**
+ * @brief Looks up the name of a registered interface
+ * @param index Index returned by registerInterface()
+ * @return Interface name, or an empty string for an unknown index
+ */
+const std::string& NetworkMonitor::interfaceName(uint16_t index) {
+    static const std::string unknown;
+    if (index >= interface_count.load(std::memory_order_acquire)) {
+        return unknown;
+    }
+    return interface_names[index];
+}
+
 /**
  * @brief Starts the packet capture loop
  * 
  * Begins capturing packets and calling the packet handler for each one.
- * The loop continues until the specified number of packets is captured
- * or the process is interrupted (e.g., with Ctrl+C).
+ * The loop continues until the specified number of packets is captured,
+ * the backend reports an error, or the process is interrupted (e.g., with Ctrl+C).
  * 
  * @param packet_count Number of packets to capture (-1 for infinite loop)
  */
 void NetworkMonitor::startCapture(int packet_count) {
-    // Start the capture loop
-    pcap_loop(handle, packet_count, packetHandler, nullptr);
+    BatchHandler handler = selectBatchHandler();
+    long captured = 0;
+    while (packet_count < 0 || captured < packet_count) {
+        int remaining = packet_count < 0 ? -1 : static_cast<int>(packet_count - captured);
+        int count = backend->dispatch(remaining, handler, this);
+        if (count < 0) {
+            break;
+        }
+        if (count == 0) {
+            uint64_t now_ns = monotonicNs();
+            refreshCaptureStats(now_ns);
+            if (shard) {
+                shard->poll();  // Idle: still answer pending snapshot requests
+            }
+            if (dump_queue) {
+                dump_queue->flushIdle(now_ns);  // Idle: still hand over the dumped packets
+            }
+        }
+        captured += count;
+    }
+    // Interrupted: drain what the backend already holds, then hand over the final counts
+    if (packet_count < 0 || captured < packet_count) {
+        backend->breakLoop();
+        while (backend->dispatch(-1, handler, this) >= 0) {
+        }
+    }
+    refreshCaptureStats(monotonicNs());
+    if (shard) {
+        shard->publish();
+    }
+    if (dump_queue) {
+        dump_queue->flush();
+    }
+}
+
+/**
+ * @brief Makes startCapture() return (async-signal-safe)
+ */
+void NetworkMonitor::stopCapture() {
+    backend->breakLoop();
+}
+
+/**
+ * @brief Reads the kernel counters of the capture socket
+ * @param stats Receives the counters
+ * @return true if the backend could read them
+ */
+bool NetworkMonitor::captureStats(CaptureStats& stats) {
+    return backend->stats(stats);
+}
+
+/**
+ * @brief Gets the number of packets processed by startCapture()
+ * @return Packets parsed and accounted or logged
+ */
+uint64_t NetworkMonitor::packetsProcessed() const {
+    return health->processed;
 }
 
 /**
- * @brief Packet handler callback - Processes each captured packet
+ * @brief Gets the capture and processing health counters
+ * @return Health counters of this monitor
+ */
+const PipelineHealth& NetworkMonitor::pipelineHealth() const {
+    return *health;
+}
+
+/**
+ * @brief Refreshes the kernel counters in the health record
  * 
- * This static callback function is invoked by pcap_loop for each captured packet.
- * It extracts IP header information, determines the protocol type, and extracts
- * relevant port information for TCP/UDP packets.
+ * Reading the counters is a system call, so it happens at most once per
+ * second, from the capture loop rather than per packet.
  * 
- * @param userData User-defined data (not used in this implementation)
- * @param pkthdr Pointer to packet header with capture metadata
- * @param packet Pointer to raw packet data
+ * @param now_ns Current monotonic time in nanoseconds
  */
-void NetworkMonitor::packetHandler(u_char* userData, const struct pcap_pkthdr* pkthdr, const u_char* packet) {
-    // Parse IP header (skip 14-byte Ethernet header)
-    const struct ip* ip_header = (struct ip*)(packet + 14);
-    const struct tcphdr* tcp_header;
-    int ip_header_length = ip_header->ip_hl * 4; // IP header length in bytes
+void NetworkMonitor::refreshCaptureStats(uint64_t now_ns) {
+    if (now_ns < next_stats_ns) {
+        return;
+    }
+    next_stats_ns = now_ns + 1000000000ULL;
+    backend->stats(health->capture);
+}
 
-    PacketInfo info;
-    info.source_ip = inet_ntoa(ip_header->ip_src);
-    info.dest_ip = inet_ntoa(ip_header->ip_dst);
-    info.length = pkthdr->len;
-    info.interface_name = current_device;
+/**
+ * @brief Prints received, dropped and processed packet counts
+ */
+void NetworkMonitor::printCaptureStats() {
+    CaptureStats stats;
+    std::cout << device << ": " << health->processed << " packets processed";
+    if (captureStats(stats)) {
+        std::cout << ", " << stats.received << " received by filter, "
+                  << stats.dropped << " dropped by kernel, "
+                  << stats.interface_dropped << " dropped by interface";
+    }
+    if (health->queue_dropped > 0) {
+        std::cout << ", " << health->queue_dropped << " dropped by analysis queues";
+    }
+    std::cout << std::endl;
+}
 
-    // Determine protocol and extract port information
-    switch (ip_header->ip_p) {
-        case IPPROTO_TCP:
-            info.protocol = "TCP";
-            tcp_header = (struct tcphdr*)(packet + 14 + ip_header_length);
-            info.source_port = ntohs(tcp_header->th_sport); // Convert from network to host byte order
-            info.dest_port = ntohs(tcp_header->th_dport);
-            break;
-        case IPPROTO_UDP:
-            info.protocol = "UDP";
-            // UDP header has same layout as TCP for port fields
-            tcp_header = (struct tcphdr*)(packet + 14 + ip_header_length);
-            info.source_port = ntohs(tcp_header->th_sport);
-            info.dest_port = ntohs(tcp_header->th_dport);
-            break;
-        case IPPROTO_ICMP:
-            info.protocol = "ICMP";
-            info.source_port = 0; // ICMP doesn't use ports
-            info.dest_port = 0;
-            break;
-        default:
-            info.protocol = "Other";
-            info.source_port = 0;
-            info.dest_port = 0;
-            break;
+/**
+ * @brief Chooses the frame decoder for the backend's link-layer type
+ * 
+ * Frames of unsupported link types are still counted, as Protocol::Other.
+ */
+void NetworkMonitor::selectLinkDecoder() {
+    int link_type = backend->datalink();
+    decoder = selectDecoder(link_type);
+    if (!isSupportedLinkType(link_type)) {
+        std::cerr << "Warning: unsupported link-layer type " << link_type << " on " << device
+                  << "; packets are counted without decoding" << std::endl;
     }
+}
 
-    // Update dashboard if enabled, otherwise print packet info
-    if (dashboard) {
-        dashboard->updatePacket(info);
-    } else {
-        printPacketInfo(info);
+/**
+ * @brief Picks the batch handler for the attached shard, analysis queues, packet log and dump
+ * 
+ * The stages a batch passes through are fixed once capture starts, so they
+ * are chosen here rather than tested on every batch.
+ * 
+ * @return Instantiation of batchHandler() with exactly those stages
+ */
+BatchHandler NetworkMonitor::selectBatchHandler() const {
+    bool log = log_queue != nullptr;
+    bool dump = dump_queue != nullptr;
+    if (analysis_queue) {
+        return batchHandlerFor<StatsStage::Queue>(log, dump);
+    }
+    if (shard) {
+        return batchHandlerFor<StatsStage::Shard>(log, dump);
     }
+    return batchHandlerFor<StatsStage::None>(log, dump);
 }
 
 /**
- * @brief Prints formatted packet information to the console
+ * @brief Picks the batch handler for a statistics stage
+ * @tparam Stats Where records are accounted
+ * @param log Records are handed to the packet log
+ * @param dump Selected packets are dumped
+ * @return Instantiation of batchHandler()
+ */
+template <NetworkMonitor::StatsStage Stats>
+BatchHandler NetworkMonitor::batchHandlerFor(bool log, bool dump) {
+    if (log) {
+        return dump ? &batchHandler<Stats, true, true> : &batchHandler<Stats, true, false>;
+    }
+    return dump ? &batchHandler<Stats, false, true> : &batchHandler<Stats, false, false>;
+}
+
+/**
+ * @brief Batch handler callback - Processes each captured batch
+ * @tparam Stats Where records are accounted
+ * @tparam Log Records are handed to the packet log
+ * @tparam Dump Selected packets are dumped
+ * @param user Pointer to the NetworkMonitor that owns the capture backend
+ * @param batch Captured packets
+ */
+template <NetworkMonitor::StatsStage Stats, bool Log, bool Dump>
+void NetworkMonitor::batchHandler(void* user, const PacketBatch& batch) {
+    static_cast<NetworkMonitor*>(user)->processBatch<Stats, Log, Dump>(batch);
+}
+
+/**
+ * @brief Parses a batch of packets, then applies statistics, logging and the dump
  * 
- * Displays captured packet details in a human-readable format including
- * length, protocol type, source and destination IP addresses and ports.
+ * The batch is decoded by the decoder selected for the handle's link type,
+ * and the stats update runs as a second loop over the parsed records. Both
+ * loops are timed once per batch for the health histograms. The dump copies
+ * the selected packets while the batch still refers to the capture ring.
  * 
- * @param info PacketInfo structure containing the packet metadata
+ * @tparam Stats Where records are accounted
+ * @tparam Log Records are handed to the packet log
+ * @tparam Dump Selected packets are dumped
+ * @param batch Captured packets
  */
-void NetworkMonitor::printPacketInfo(const PacketInfo& info) {
-    std::cout << "[" << info.interface_name << "] ";
-    std::cout << "Packet captured. Length: " << info.length << " | ";
-    std::cout << "Protocol: " << info.protocol << " | ";
-    std::cout << "From: " << info.source_ip << ":" << info.source_port << " -> ";
-    std::cout << "To: " << info.dest_ip << ":" << info.dest_port << std::endl;
+template <NetworkMonitor::StatsStage Stats, bool Log, bool Dump>
+void NetworkMonitor::processBatch(const PacketBatch& batch) {
+    size_t count = batch.count;
+    uint64_t start_ns = monotonicNs();
+    decoder(batch, interface_index, infos.data());
+    uint64_t parsed_ns = monotonicNs();
+    health->parse.record(parsed_ns - start_ns);
+    health->processed += count;
+    health->batches++;
+    refreshCaptureStats(parsed_ns);
+    
+    // Update this monitor's dashboard shard (or queue the records for the analysis
+    // workers) and hand the records to the packet log
+    if constexpr (Stats == StatsStage::Queue) {
+        analysis_queue->submit(infos.data(), batch.packets, count, *health);
+        shard->poll();
+    } else if constexpr (Stats == StatsStage::Shard) {
+        shard->updateBatch(infos.data(), count, parsed_ns, batch.packets);
+    }
+    if constexpr (Log) {
+        log_queue->append(infos.data(), count);
+    }
+    if constexpr (Dump) {
+        dump_queue->append(batch, infos.data(), parsed_ns);
+    }
+    health->update.record(monotonicNs() - parsed_ns);
 }
@@ -13,7 +13,15 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
 #include <pcap.h>
+#include "capture_backend.h"
+#include "health_metrics.h"
+#include "packet_decoder.h"
+#include "app_classifier.h"
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -57,26 +65,86 @@
     #include <arpa/inet.h>
 #endif
 
-// Forward declaration
+// Forward declarations
 class Dashboard;
+class StatsShard;
+class PacketLog;
+class PacketLogQueue;
+class PacketDump;
+class PacketDumpQueue;
+class AnalysisStage;
+class AnalysisQueue;
+
+/**
+ * @enum Protocol
+ * @brief Transport protocol identifier carried in PacketInfo
+ * 
+ * Stored as a single byte so that packet records stay compact; use
+ * protocolName() to obtain the display string.
+ */
+enum class Protocol : uint8_t {
+    TCP = 0,
+    UDP,
+    ICMP,
+    Other,
+    Count          ///< Number of protocol identifiers (not a protocol)
+};
+
+/// Number of distinct Protocol values, usable as an array bound
+constexpr size_t PROTOCOL_COUNT = static_cast<size_t>(Protocol::Count);
+
+/// Maximum number of interfaces that can be registered for capture
+constexpr size_t MAX_INTERFACES = 64;
+
+/**
+ * @brief Gets the display name of a protocol
+ * @param protocol Protocol identifier
+ * @return Protocol name ("TCP", "UDP", "ICMP" or "Other")
+ */
+const char* protocolName(Protocol protocol);
 
 /**
  * @struct PacketInfo
- * @brief Structure to hold captured packet information
+ * @brief Compact binary record describing a captured packet
  * 
- * Contains extracted metadata from network packets including IP addresses,
- * ports, protocol type, and packet length.
+ * Contains extracted metadata from network packets in raw form: addresses are
+ * kept as network-order bytes (IPv4 uses the first 4 bytes), ports are in host
+ * byte order and the interface is referenced by its registry index. Building a
+ * record performs no heap allocation; text conversion happens only when a
+ * packet is displayed (see formatAddress() and NetworkMonitor::interfaceName()).
+ * The payload is only located, not inspected: StatsShard reads it through the
+ * frame while a connection's application is still open. Records queued for
+ * the analysis workers carry the signature of a connection's first payloads
+ * instead, since the frames are gone by the time a worker sees them.
  */
 struct PacketInfo {
-    std::string source_ip;    ///< Source IP address
-    std::string dest_ip;      ///< Destination IP address
-    int source_port;          ///< Source port number
-    int dest_port;            ///< Destination port number
-    std::string protocol;     ///< Protocol type (TCP, UDP, ICMP, etc.)
-    int length;               ///< Total packet length in bytes
-    std::string interface_name; ///< Network interface name
+    uint64_t timestamp_ns;       ///< Capture timestamp in nanoseconds since the epoch
+    uint8_t source_addr[16];     ///< Source IP address (network byte order)
+    uint8_t dest_addr[16];       ///< Destination IP address (network byte order)
+    uint16_t source_port;        ///< Source port number
+    uint16_t dest_port;          ///< Destination port number
+    uint32_t length;             ///< Total packet length in bytes
+    Protocol protocol;           ///< Protocol type (TCP, UDP, ICMP, etc.)
+    uint8_t ip_version;          ///< IP version (4 or 6)
+    uint16_t interface_index;    ///< Index into the interface registry
+    uint32_t tcp_seq;            ///< TCP sequence number (TCP only)
+    uint16_t payload_offset;     ///< Offset of the TCP or UDP payload in the captured frame
+    uint16_t payload_captured;   ///< Payload bytes present in the capture (0 if none or not located)
+    uint16_t tcp_payload;        ///< TCP payload bytes, saturated at 65535 (TCP only)
+    uint8_t tcp_flags;           ///< TCP flags byte: FIN 0x01, SYN 0x02, RST 0x04, ACK 0x10 (TCP only)
+    AppProtocol payload_app;     ///< Payload signature, filled by the capture thread for queued records only
 };
 
+static_assert(sizeof(PacketInfo) <= 64, "PacketInfo must fit in a single cache line");
+
+/**
+ * @brief Formats a raw IP address for display
+ * @param addr Address bytes in network byte order
+ * @param ip_version IP version (4 or 6)
+ * @return Printable address string
+ */
+std::string formatAddress(const uint8_t* addr, uint8_t ip_version);
+
 /**
  * @class NetworkMonitor
  * @brief Main class for monitoring network traffic
@@ -91,28 +159,119 @@ public:
      * @brief Constructor - initializes packet capture on specified device
      * @param device Network interface name (e.g., "eth0", "en0")
      * @param use_dashboard Whether to use dashboard mode (default: false)
+     * @param config Capture backend and buffer settings
+     * @throws std::runtime_error if the device or file cannot be opened
+     */
+    NetworkMonitor(const std::string& device, bool use_dashboard = false,
+                   const CaptureConfig& config = CaptureConfig());
+    
+    /**
+     * @brief Constructor - monitors packets from an already opened backend
+     * 
+     * Lets tools such as the benchmark feed generated traffic through the
+     * regular processing path without a network interface.
+     * 
+     * @param name Name the packets are accounted under
+     * @param backend Opened packet source
+     * @param use_dashboard Whether to use dashboard mode (default: false)
      */
-    NetworkMonitor(const std::string& device, bool use_dashboard = false);
+    NetworkMonitor(const std::string& name, std::unique_ptr<CaptureBackend> backend,
+                   bool use_dashboard = false);
     
     /**
      * @brief Destructor - cleans up packet capture resources
      */
     ~NetworkMonitor();
-
+    
     /**
      * @brief Start capturing packets
+     * 
+     * Returns once packet_count packets were captured, the backend failed or
+     * stopCapture() was called. Packets already in user space are processed
+     * and the final statistics are published to the dashboard before it returns.
+     * 
      * @param packet_count Number of packets to capture (-1 for infinite)
      */
     void startCapture(int packet_count);
     
+    /**
+     * @brief Makes startCapture() return (async-signal-safe)
+     */
+    void stopCapture();
+    
+    /**
+     * @brief Reads the kernel counters of the capture socket
+     * @param stats Receives the counters
+     * @return true if the backend could read them
+     */
+    bool captureStats(CaptureStats& stats);
+    
+    /**
+     * @brief Gets the number of packets processed by startCapture()
+     * @return Packets parsed and accounted or logged
+     */
+    uint64_t packetsProcessed() const;
+    
+    /**
+     * @brief Gets the capture and processing health counters
+     * 
+     * Only consistent once startCapture() has returned; while capturing, read
+     * them through Dashboard::healthReport() instead.
+     * 
+     * @return Health counters of this monitor
+     */
+    const PipelineHealth& pipelineHealth() const;
+    
+    /**
+     * @brief Prints received, dropped and processed packet counts
+     * 
+     * Call only after startCapture() has returned.
+     */
+    void printCaptureStats();
+    
     /**
      * @brief Sets the dashboard for visualization
+     * 
+     * Allocates a private statistics shard for this monitor, so it must be
+     * called from (or before starting) the thread that runs startCapture().
+     * 
      * @param dash Shared pointer to dashboard instance
      */
     void setDashboard(std::shared_ptr<Dashboard> dash);
     
     /**
-     * @brief Lists all available network interfaces
+     * @brief Sets the packet log that receives a record of every packet
+     * 
+     * Allocates a private queue for this monitor, so it must be called from
+     * (or before starting) the thread that runs startCapture().
+     * 
+     * @param log Shared pointer to the packet log
+     */
+    void setPacketLog(std::shared_ptr<PacketLog> log);
+    
+    /**
+     * @brief Sets the packet dump that saves the selected packets
+     * 
+     * Allocates a private queue for this monitor, so it must be called from
+     * (or before starting) the thread that runs startCapture().
+     * 
+     * @param dump Shared pointer to the packet dump
+     */
+    void setPacketDump(std::shared_ptr<PacketDump> dump);
+    
+    /**
+     * @brief Hands this monitor's packets to analysis workers instead of a shard
+     * 
+     * Replaces setDashboard(): the monitor only decodes and queues packets,
+     * and its shard carries the health counters alone. Must be called from
+     * (or before starting) the thread that runs startCapture().
+     * 
+     * @param stage Shared pointer to the analysis stage
+     */
+    void setAnalysisStage(std::shared_ptr<AnalysisStage> stage);
+    
+    /**
+     * @brief Lists all available network interfaces (discovered once per process)
      * @return Vector of interface names
      */
     static std::vector<std::string> listInterfaces();
@@ -122,28 +281,107 @@ public:
      * @return Interface name
      */
     std::string getDevice() const;
+    
+    /**
+     * @brief Registers an interface name and returns its compact index
+     * @param name Interface name
+     * @return Index stored in PacketInfo::interface_index
+     */
+    static uint16_t registerInterface(const std::string& name);
+    
+    /**
+     * @brief Looks up the name of a registered interface
+     * @param index Index returned by registerInterface()
+     * @return Interface name, or an empty string for an unknown index
+     */
+    static const std::string& interfaceName(uint16_t index);
 
 private:
-    pcap_t* handle;                ///< pcap session handle
-    char errbuf[PCAP_ERRBUF_SIZE]; ///< Error message buffer
+    std::unique_ptr<CaptureBackend> backend; ///< Packet source for the device
     std::string device;            ///< Network device to sniff on
     bool use_dashboard;            ///< Whether to use dashboard mode
-    static std::shared_ptr<Dashboard> dashboard; ///< Shared dashboard instance
-    static std::string current_device; ///< Current device being monitored (for packet handler)
-
+    uint16_t interface_index;      ///< Registry index of the monitored device
+    std::shared_ptr<Dashboard> dashboard; ///< Dashboard owning the shard
+    StatsShard* shard;             ///< Statistics shard written by this monitor only
+    std::shared_ptr<PacketLog> packet_log; ///< Packet log owning the queue
+    PacketLogQueue* log_queue;     ///< Packet log queue written by this monitor only
+    std::shared_ptr<PacketDump> packet_dump; ///< Packet dump owning the queue
+    PacketDumpQueue* dump_queue;   ///< Packet dump buffers written by this monitor only
+    std::shared_ptr<AnalysisStage> analysis; ///< Analysis stage owning the queues
+    AnalysisQueue* analysis_queue; ///< Queues to the analysis workers, written by this monitor only
+    PipelineHealth local_health;   ///< Health counters when no dashboard shard is attached
+    PipelineHealth* health;        ///< Health counters being updated (the shard's, if any)
+    uint64_t next_stats_ns;        ///< Monotonic time of the next kernel counter refresh
+    BatchDecoder decoder;          ///< Frame decoder for the backend's link-layer type
+    
+    // Interface registry (names are written once and never moved)
+    static std::array<std::string, MAX_INTERFACES> interface_names;
+    static std::atomic<uint16_t> interface_count;
+    static std::mutex interface_mutex;
+    
+    std::array<PacketInfo, PacketBatch::CAPACITY> infos; ///< Parsed records for the current batch
+    
+    /**
+     * @enum StatsStage
+     * @brief Where a monitor's parsed records are accounted
+     */
+    enum class StatsStage : uint8_t {
+        None,      ///< Nowhere (no dashboard)
+        Shard,     ///< In the monitor's own shard
+        Queue      ///< By the analysis workers
+    };
+    
+    /**
+     * @brief Picks the batch handler for the attached shard, analysis queues, packet log and dump
+     * @return Instantiation of batchHandler() with exactly those stages
+     */
+    BatchHandler selectBatchHandler() const;
+    
+    /**
+     * @brief Picks the batch handler for a statistics stage
+     * @tparam Stats Where records are accounted
+     * @param log Records are handed to the packet log
+     * @param dump Selected packets are dumped
+     * @return Instantiation of batchHandler()
+     */
+    template <StatsStage Stats>
+    static BatchHandler batchHandlerFor(bool log, bool dump);
+    
+    /**
+     * @brief Batch handler invoked by the capture backend
+     * @tparam Stats Where records are accounted
+     * @tparam Log Records are handed to the packet log
+     * @tparam Dump Selected packets are dumped
+     * @param user Pointer to the owning NetworkMonitor
+     * @param batch Captured packets
+     */
+    template <StatsStage Stats, bool Log, bool Dump>
+    static void batchHandler(void* user, const PacketBatch& batch);
+    
+    /**
+     * @brief Parses a batch of packets, then applies statistics, logging and the dump
+     * 
+     * Parsing and accounting run as two tight loops over the whole batch, so
+     * the shard, packet log and dump each receive the batch in one call.
+     * 
+     * @tparam Stats Where records are accounted
+     * @tparam Log Records are handed to the packet log
+     * @tparam Dump Selected packets are dumped
+     * @param batch Captured packets
+     */
+    template <StatsStage Stats, bool Log, bool Dump>
+    void processBatch(const PacketBatch& batch);
+    
     /**
-     * @brief Callback function to process each captured packet
-     * @param userData User-defined data passed to callback
-     * @param pkthdr Packet header with metadata
-     * @param packet Raw packet data
+     * @brief Chooses the frame decoder for the backend's link-layer type
      */
-    static void packetHandler(u_char* userData, const struct pcap_pkthdr* pkthdr, const u_char* packet);
+    void selectLinkDecoder();
     
     /**
-     * @brief Prints formatted packet information to console
-     * @param info PacketInfo structure containing packet details
+     * @brief Refreshes the kernel counters in the health record
+     * @param now_ns Current monotonic time in nanoseconds
      */
-    static void printPacketInfo(const PacketInfo& info);
+    void refreshCaptureStats(uint64_t now_ns);
 };
 
 #endif // NETWORK_MONITOR_H
@@ -0,0 +1,94 @@
+/**
+ * @file object_pool.h
+ * @brief Fixed set of reusable shared objects
+ * 
+ * This header defines the SharedObjectPool template, which recycles large
+ * objects handed out through std::shared_ptr (such as published snapshots)
+ * instead of allocating a fresh one every time.
+ */
+
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include "health_metrics.h"
+
+/**
+ * @class SharedObjectPool
+ * @brief Recycles shared objects once nobody but the pool references them
+ * 
+ * The pool owns up to a fixed number of objects. acquire() returns one
+ * whose only remaining reference is the pool's, so the object and the
+ * buffers it has grown are reused as they are; the caller resets whatever
+ * it needs. Readers can only obtain references through something the
+ * caller publishes, so a use count of one cannot rise again behind the
+ * pool's back. When every object is still referenced, a transient object
+ * outside the pool is returned and counted as refused.
+ * 
+ * acquire() must not be called concurrently.
+ * 
+ * @tparam T Default-constructible object type
+ */
+template <typename T>
+class SharedObjectPool {
+public:
+    /**
+     * @brief Constructor
+     * @param capacity Largest number of pooled objects
+     */
+    explicit SharedObjectPool(size_t capacity) : limit(capacity), recycled(0), refused(0) {
+        objects.reserve(capacity);
+    }
+    
+    /**
+     * @brief Gets an object nobody else references, allocating one if the pool has room
+     * @return Object with whatever state it was last left in (new objects are value-initialized)
+     */
+    std::shared_ptr<T> acquire() {
+        for (const auto& object : objects) {
+            if (object.use_count() == 1) {
+                // Pairs with the release of the last reader's reference drop
+                std::atomic_thread_fence(std::memory_order_acquire);
+                recycled++;
+                return object;
+            }
+        }
+        if (objects.size() < limit) {
+            objects.push_back(std::make_shared<T>());
+            return objects.back();
+        }
+        refused++;
+        return std::make_shared<T>();
+    }
+    
+    /**
+     * @brief Gets the pool's occupancy counters
+     * @param object_bytes Memory attributed to each object
+     * @return Objects in use, capacity and reuse counts
+     */
+    PoolUsage usage(size_t object_bytes = sizeof(T)) const {
+        PoolUsage result;
+        for (const auto& object : objects) {
+            if (object.use_count() > 1) {
+                result.used++;
+            }
+        }
+        result.capacity = limit;
+        result.peak = objects.size();
+        result.recycled = recycled;
+        result.refused = refused;
+        result.bytes = objects.size() * object_bytes;
+        return result;
+    }
+
+private:
+    size_t limit;
+    std::vector<std::shared_ptr<T>> objects;
+    uint64_t recycled;
+    uint64_t refused;
+};
+
+#endif // OBJECT_POOL_H
@@ -0,0 +1,408 @@
+/**
+ * @file packet_decoder.cpp
+ * @brief Implementation of the link-type specific packet decoders
+ * 
+ * This file contains the link-layer header parsers, the IPv4 and IPv6
+ * decoders and one batch decoder instantiated per link-layer type. Every
+ * read is checked against the capture length of the frame.
+ */
+
+#include "packet_decoder.h"
+#include "network_monitor.h"
+#include <cstring>
+
+namespace {
+// Link-layer types; live handles report DLT_* and files LINKTYPE_* values,
+// which only differ for raw IP
+constexpr int LINK_NULL = 0;
+constexpr int LINK_ETHERNET = 1;
+constexpr int LINK_RAW_DLT = 12;
+constexpr int LINK_RAW_DLT_OPENBSD = 14;
+constexpr int LINK_RAW = 101;
+constexpr int LINK_LOOP = 108;
+constexpr int LINK_LINUX_SLL = 113;
+constexpr int LINK_IPV4 = 228;
+constexpr int LINK_IPV6 = 229;
+constexpr int LINK_LINUX_SLL2 = 276;
+
+constexpr uint16_t ETHERTYPE_IPV4 = 0x0800;
+constexpr uint16_t ETHERTYPE_IPV6 = 0x86DD;
+constexpr uint16_t ETHERTYPE_VLAN = 0x8100;
+constexpr uint16_t ETHERTYPE_QINQ = 0x88A8;
+constexpr uint16_t ETHERTYPE_QINQ_LEGACY = 0x9100;
+constexpr int MAX_VLAN_TAGS = 4;
+constexpr int MAX_EXTENSION_HEADERS = 8;
+
+/**
+ * @brief Link-layer framings with a dedicated decoder
+ */
+enum class LinkLayer {
+    Ethernet,   ///< 14-byte Ethernet header, optionally VLAN tagged
+    LinuxSll,   ///< 16-byte Linux cooked header
+    LinuxSll2,  ///< 20-byte Linux cooked header, version 2
+    Null,       ///< 4-byte address family in host byte order
+    Loop,       ///< 4-byte address family in network byte order
+    Raw,        ///< No link-layer header
+    Unknown     ///< Unsupported framing; frames are not parsed
+};
+
+/**
+ * @brief Gets the length of the fixed link-layer header
+ * @param link Link-layer framing
+ * @return Bytes before the network header (VLAN tags not included)
+ */
+constexpr size_t linkHeaderLength(LinkLayer link) {
+    return link == LinkLayer::Ethernet ? 14 :
+           link == LinkLayer::LinuxSll ? 16 :
+           link == LinkLayer::LinuxSll2 ? 20 :
+           (link == LinkLayer::Null || link == LinkLayer::Loop) ? 4 : 0;
+}
+
+/**
+ * @brief Maps IP protocol numbers to Protocol identifiers without branching
+ */
+struct ProtocolTable {
+    Protocol map[256];
+    constexpr ProtocolTable() : map() {
+        for (int i = 0; i < 256; i++) {
+            map[i] = Protocol::Other;
+        }
+        map[IPPROTO_TCP] = Protocol::TCP;
+        map[IPPROTO_UDP] = Protocol::UDP;
+        map[IPPROTO_ICMP] = Protocol::ICMP;
+        map[IPPROTO_ICMPV6] = Protocol::ICMP;
+    }
+};
+constexpr ProtocolTable PROTOCOLS;
+
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
+inline bool likely(bool condition) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_expect(condition, true);
+#else
+    return condition;
+#endif
+}
+
+inline uint16_t load16(const u_char* data) {
+    return static_cast<uint16_t>((data[0] << 8) | data[1]);
+}
+
+inline uint32_t load32(const u_char* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+           (static_cast<uint32_t>(data[2]) << 8) | data[3];
+}
+
+/**
+ * @brief Maps a DLT_NULL/DLT_LOOP address family to an EtherType
+ * @param family AF_* value of the capturing system
+ * @return EtherType, or 0 for families other than IPv4 and IPv6
+ */
+inline uint16_t familyEtherType(uint32_t family) {
+    switch (family) {
+        case 2:                                     // AF_INET everywhere
+            return ETHERTYPE_IPV4;
+        case 10: case 24: case 28: case 30:         // AF_INET6 on Linux, BSDs, FreeBSD, macOS
+            return ETHERTYPE_IPV6;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Skips 802.1Q and QinQ tags following an EtherType field
+ * @param frame Frame data
+ * @param caplen Captured bytes of the frame
+ * @param offset Offset of the tag; advanced past every tag
+ * @param ethertype EtherType read so far; replaced by the encapsulated type
+ * @return false if a tag is truncated
+ */
+inline bool skipVlanTags(const u_char* frame, size_t caplen, size_t& offset, uint16_t& ethertype) {
+    for (int tags = 0; tags < MAX_VLAN_TAGS &&
+         (ethertype == ETHERTYPE_VLAN || ethertype == ETHERTYPE_QINQ || ethertype == ETHERTYPE_QINQ_LEGACY); tags++) {
+        if (offset + 4 > caplen) {
+            return false;
+        }
+        ethertype = load16(frame + offset + 2);
+        offset += 4;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the link-layer header of a frame
+ * @param frame Frame data
+ * @param caplen Captured bytes of the frame
+ * @param offset Receives the offset of the network header
+ * @param ethertype Receives the EtherType of the network header
+ * @return false if the header is truncated or the framing is unknown
+ */
+template <LinkLayer Link>
+inline bool decodeLink(const u_char* frame, size_t caplen, size_t& offset, uint16_t& ethertype) {
+    offset = linkHeaderLength(Link);
+    if (offset > caplen) {
+        return false;
+    }
+    switch (Link) {
+        case LinkLayer::Ethernet:
+            ethertype = load16(frame + 12);
+            return likely(ethertype == ETHERTYPE_IPV4) || skipVlanTags(frame, caplen, offset, ethertype);
+        case LinkLayer::LinuxSll:
+            ethertype = load16(frame + 14);
+            return skipVlanTags(frame, caplen, offset, ethertype);
+        case LinkLayer::LinuxSll2:
+            ethertype = load16(frame);
+            return skipVlanTags(frame, caplen, offset, ethertype);
+        case LinkLayer::Null: {
+            uint32_t family;
+            std::memcpy(&family, frame, sizeof(family));
+            if (family > 0xFFFF) {
+                // Written on a host of the other byte order
+                family = ((family >> 24) & 0xFF) | ((family >> 8) & 0xFF00);
+            }
+            ethertype = familyEtherType(family);
+            return true;
+        }
+        case LinkLayer::Loop:
+            ethertype = familyEtherType((static_cast<uint32_t>(load16(frame)) << 16) | load16(frame + 2));
+            return true;
+        case LinkLayer::Raw:
+            if (caplen == 0) {
+                return false;
+            }
+            ethertype = (frame[0] >> 4) == 6 ? ETHERTYPE_IPV6 : ETHERTYPE_IPV4;
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Records the protocol, the ports, the payload location and, for TCP, the segment fields
+ * @param frame Frame data
+ * @param caplen Captured bytes of the frame
+ * @param offset Offset of the transport header
+ * @param end Offset just past the IP payload, per the IP header
+ * @param protocol IP protocol number
+ * @param first_fragment Whether the transport header is in this packet
+ * @param info Record to fill
+ */
+inline void decodeTransport(const u_char* frame, size_t caplen, size_t offset, size_t end, uint8_t protocol,
+                            bool first_fragment, PacketInfo& info) {
+    info.protocol = PROTOCOLS.map[protocol];
+    // TCP and UDP share the port layout: source and destination in one word
+    if ((info.protocol == Protocol::TCP || info.protocol == Protocol::UDP) && first_fragment &&
+        offset + 4 <= caplen) {
+        info.source_port = load16(frame + offset);
+        info.dest_port = load16(frame + offset + 2);
+        size_t payload_offset = offset + 8;
+        if (info.protocol == Protocol::TCP) {
+            payload_offset = end;   // No payload can be located without a complete header
+            if (offset + 20 <= caplen) {
+                const u_char* tcp = frame + offset;
+                size_t header_length = static_cast<size_t>(tcp[12] >> 4) * 4;
+                info.tcp_seq = load32(tcp + 4);
+                info.tcp_flags = tcp[13];
+                if (header_length >= 20 && offset + header_length < end) {
+                    size_t payload = end - offset - header_length;
+                    info.tcp_payload = static_cast<uint16_t>(payload < UINT16_MAX ? payload : UINT16_MAX);
+                    payload_offset = offset + header_length;
+                }
+            }
+        }
+        size_t payload_end = end < caplen ? end : caplen;
+        if (payload_offset < payload_end && payload_offset <= UINT16_MAX) {
+            size_t captured = payload_end - payload_offset;
+            info.payload_offset = static_cast<uint16_t>(payload_offset);
+            info.payload_captured = static_cast<uint16_t>(captured < UINT16_MAX ? captured : UINT16_MAX);
+        }
+    }
+}
+
+/**
+ * @brief Decodes an IPv4 header and its transport ports
+ * @param frame Frame data
+ * @param caplen Captured bytes of the frame
+ * @param offset Offset of the IPv4 header
+ * @param info Record to fill
+ */
+inline void decodeIpv4(const u_char* frame, size_t caplen, size_t offset, PacketInfo& info) {
+    const u_char* ip = frame + offset;
+    if (offset + 20 > caplen || (ip[0] >> 4) != 4) {
+        return;
+    }
+    size_t header_length = static_cast<size_t>(ip[0] & 0x0F) * 4;
+    std::memcpy(info.source_addr, ip + 12, 4);
+    std::memcpy(info.dest_addr, ip + 16, 4);
+    info.ip_version = 4;
+    if (header_length < 20) {
+        return;
+    }
+    bool first_fragment = (load16(ip + 6) & 0x1FFF) == 0;
+    // A zero total length means segmentation offload; fall back to the wire length
+    size_t total_length = load16(ip + 2);
+    size_t end = total_length >= header_length ? offset + total_length : info.length;
+    decodeTransport(frame, caplen, offset + header_length, end, ip[9], first_fragment, info);
+}
+
+/**
+ * @brief Decodes an IPv6 header, skips extension headers and reads the ports
+ * @param frame Frame data
+ * @param caplen Captured bytes of the frame
+ * @param offset Offset of the IPv6 header
+ * @param info Record to fill
+ */
+inline void decodeIpv6(const u_char* frame, size_t caplen, size_t offset, PacketInfo& info) {
+    const u_char* ip = frame + offset;
+    if (offset + 40 > caplen || (ip[0] >> 4) != 6) {
+        return;
+    }
+    std::memcpy(info.source_addr, ip + 8, 16);
+    std::memcpy(info.dest_addr, ip + 24, 16);
+    info.ip_version = 6;
+    
+    uint8_t next_header = ip[6];
+    size_t position = offset + 40;
+    size_t payload_length = load16(ip + 4);
+    size_t end = payload_length != 0 ? position + payload_length : info.length;   // 0 = jumbogram
+    bool first_fragment = true;
+    for (int i = 0; i < MAX_EXTENSION_HEADERS; i++) {
+        size_t length;
+        switch (next_header) {
+            case 0:    // Hop-by-hop options
+            case 43:   // Routing
+            case 60:   // Destination options
+            case 135:  // Mobility
+                if (position + 2 > caplen) {
+                    return;
+                }
+                length = (static_cast<size_t>(frame[position + 1]) + 1) * 8;
+                break;
+            case 44:   // Fragment
+                if (position + 8 > caplen) {
+                    return;
+                }
+                first_fragment = (load16(frame + position + 2) & 0xFFF8) == 0;
+                length = 8;
+                break;
+            case 51:   // Authentication header
+                if (position + 2 > caplen) {
+                    return;
+                }
+                length = (static_cast<size_t>(frame[position + 1]) + 2) * 4;
+                break;
+            default:
+                decodeTransport(frame, caplen, position, end, next_header, first_fragment, info);
+                return;
+        }
+        next_header = frame[position];
+        position += length;
+    }
+}
+
+/**
+ * @brief Decodes one frame into a packet record
+ * @param header Capture metadata of the frame
+ * @param frame Frame data
+ * @param interface_index Registry index of the capturing interface
+ * @param subsecond_ns Nanoseconds per unit of header.ts.tv_usec (1 or 1000)
+ * @param info Record to fill
+ */
+template <LinkLayer Link>
+inline void decodePacket(const struct pcap_pkthdr& header, const u_char* frame, uint16_t interface_index,
+                         uint64_t subsecond_ns, PacketInfo& info) {
+    std::memset(&info, 0, sizeof(info));
+    info.timestamp_ns = static_cast<uint64_t>(header.ts.tv_sec) * 1000000000ULL +
+                        static_cast<uint64_t>(header.ts.tv_usec) * subsecond_ns;
+    info.length = header.len;
+    info.interface_index = interface_index;
+    info.protocol = Protocol::Other;
+    
+    size_t caplen = header.caplen;
+    size_t offset = 0;
+    uint16_t ethertype = 0;
+    if (!decodeLink<Link>(frame, caplen, offset, ethertype)) {
+        return;
+    }
+    if (likely(ethertype == ETHERTYPE_IPV4)) {
+        decodeIpv4(frame, caplen, offset, info);
+    } else if (ethertype == ETHERTYPE_IPV6) {
+        decodeIpv6(frame, caplen, offset, info);
+    }
+}
+
+/**
+ * @brief Decodes a batch of frames of one link-layer type
+ * 
+ * The next frame's headers are prefetched while the current one is decoded.
+ * 
+ * @param batch Captured packets
+ * @param interface_index Registry index stored in every record
+ * @param infos Receives batch.count records
+ */
+template <LinkLayer Link>
+void decodeBatch(const PacketBatch& batch, uint16_t interface_index, PacketInfo* infos) {
+    size_t count = batch.count;
+    uint64_t subsecond_ns = batch.nanosecond ? 1 : 1000;
+    for (size_t i = 0; i < count; i++) {
+        if (i + 1 < count) {
+            prefetch(batch.packets[i + 1] + linkHeaderLength(Link));
+        }
+        decodePacket<Link>(batch.headers[i], batch.packets[i], interface_index, subsecond_ns, infos[i]);
+    }
+}
+
+/**
+ * @brief Maps a link-layer type to its framing
+ * @param link_type DLT_* or LINKTYPE_* value
+ * @return Framing, or LinkLayer::Unknown
+ */
+LinkLayer linkLayerOf(int link_type) {
+    switch (link_type) {
+        case LINK_ETHERNET:        return LinkLayer::Ethernet;
+        case LINK_LINUX_SLL:       return LinkLayer::LinuxSll;
+        case LINK_LINUX_SLL2:      return LinkLayer::LinuxSll2;
+        case LINK_NULL:            return LinkLayer::Null;
+        case LINK_LOOP:            return LinkLayer::Loop;
+        case LINK_RAW:
+        case LINK_RAW_DLT:
+        case LINK_RAW_DLT_OPENBSD:
+        case LINK_IPV4:
+        case LINK_IPV6:            return LinkLayer::Raw;
+        default:                   return LinkLayer::Unknown;
+    }
+}
+}
+
+/**
+ * @brief Selects the decoder for a link-layer type
+ * @param link_type DLT_* or LINKTYPE_* value of the handle
+ * @return Decoder for the link type
+ */
+BatchDecoder selectDecoder(int link_type) {
+    switch (linkLayerOf(link_type)) {
+        case LinkLayer::Ethernet:  return &decodeBatch<LinkLayer::Ethernet>;
+        case LinkLayer::LinuxSll:  return &decodeBatch<LinkLayer::LinuxSll>;
+        case LinkLayer::LinuxSll2: return &decodeBatch<LinkLayer::LinuxSll2>;
+        case LinkLayer::Null:      return &decodeBatch<LinkLayer::Null>;
+        case LinkLayer::Loop:      return &decodeBatch<LinkLayer::Loop>;
+        case LinkLayer::Raw:       return &decodeBatch<LinkLayer::Raw>;
+        default:                   return &decodeBatch<LinkLayer::Unknown>;
+    }
+}
+
+/**
+ * @brief Checks whether a link-layer type has a real decoder
+ * @param link_type DLT_* or LINKTYPE_* value
+ * @return true if selectDecoder() can parse its frames
+ */
+bool isSupportedLinkType(int link_type) {
+    return linkLayerOf(link_type) != LinkLayer::Unknown;
+}
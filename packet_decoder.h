@@ -0,0 +1,50 @@
+/**
+ * @file packet_decoder.h
+ * @brief Link-type specific decoding of captured frames into packet records
+ * 
+ * This header declares the batch decoders that turn raw frames into
+ * PacketInfo records, one specialization per supported link-layer type.
+ */
+
+#ifndef PACKET_DECODER_H
+#define PACKET_DECODER_H
+
+#include <cstdint>
+#include "capture_backend.h"
+
+struct PacketInfo;
+
+/**
+ * @brief Decodes every frame of a batch into a packet record
+ * 
+ * Decoders never read beyond a frame's capture length. Frames that are not
+ * IPv4 or IPv6, or are too short to hold the headers, are recorded as
+ * Protocol::Other with whatever addresses could be read.
+ * 
+ * @param batch Captured packets
+ * @param interface_index Registry index stored in every record
+ * @param infos Receives batch.count records
+ */
+using BatchDecoder = void (*)(const PacketBatch& batch, uint16_t interface_index, PacketInfo* infos);
+
+/**
+ * @brief Selects the decoder for a link-layer type
+ * 
+ * Called once per capture handle. Supports Ethernet (with 802.1Q and QinQ
+ * tags), Linux cooked capture v1 and v2 ("any" device), BSD loopback
+ * (DLT_NULL and DLT_LOOP) and raw IP.
+ * 
+ * @param link_type DLT_* or LINKTYPE_* value of the handle
+ * @return Decoder for the link type; unsupported types get one that records
+ *         every frame as Protocol::Other
+ */
+BatchDecoder selectDecoder(int link_type);
+
+/**
+ * @brief Checks whether a link-layer type has a real decoder
+ * @param link_type DLT_* or LINKTYPE_* value
+ * @return true if selectDecoder() can parse its frames
+ */
+bool isSupportedLinkType(int link_type);
+
+#endif // PACKET_DECODER_H
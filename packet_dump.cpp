@@ -0,0 +1,517 @@
+/**
+ * @file packet_dump.cpp
+ * @brief Implementation of the selective packet dump
+ * 
+ * This file contains the capture-side packet selection and pcapng encoding
+ * and the writer thread that writes the buffers and rotates the files.
+ */
+
+#include "packet_dump.h"
+#include "dashboard.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <new>
+
+namespace {
+constexpr uint64_t NS_PER_MS = 1000000ULL;
+constexpr uint64_t NS_PER_SEC = 1000000000ULL;
+constexpr uint32_t BLOCK_SECTION_HEADER = 0x0A0D0D0A;
+constexpr uint32_t BLOCK_INTERFACE = 1;
+constexpr uint32_t BLOCK_ENHANCED_PACKET = 6;
+constexpr uint32_t BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr size_t PACKET_BLOCK_OVERHEAD = 32;    ///< Enhanced Packet Block without the packet data
+constexpr int FILTER_SNAPLEN = 262144;
+
+/**
+ * @brief Appends an integer in host byte order (pcapng records the order in its section header)
+ * @param out Destination
+ * @param value Value
+ */
+template <typename T>
+void appendHost(std::string& out, T value) {
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    out.append(bytes, sizeof(T));
+}
+
+/**
+ * @brief Appends a pcapng option, padded to 32 bits
+ * @param out Destination
+ * @param code Option code
+ * @param value Option value
+ * @param length Value length in bytes
+ */
+void appendOption(std::string& out, uint16_t code, const void* value, size_t length) {
+    appendHost<uint16_t>(out, code);
+    appendHost<uint16_t>(out, static_cast<uint16_t>(length));
+    if (length > 0) {
+        out.append(static_cast<const char*>(value), length);
+    }
+    out.append((4 - length % 4) % 4, '\0');
+}
+}  // namespace
+
+/**
+ * @brief Constructor - allocates the buffers and compiles the filter
+ * @param index Interface the capture thread reads
+ * @param link Link-layer type of its packets
+ * @param config Selection and flush settings
+ */
+PacketDumpQueue::PacketDumpQueue(uint16_t index, int link, const DumpConfig& config)
+    : interface_index(index), link_type(link), flush_ns(static_cast<uint64_t>(config.flush_ms) * NS_PER_MS),
+      dump_all(config.filter.empty() && config.top_flows == 0), has_filter(false), filter_failed(false),
+      program(), buffers(BUFFER_COUNT), current(nullptr), current_start_ns(0), filled(BUFFER_COUNT),
+      spare(BUFFER_COUNT), select_top(config.top_flows > 0), dumped(0), dropped(0) {
+    for (Buffer& buffer : buffers) {
+        buffer.data = static_cast<uint8_t*>(::operator new(BUFFER_BYTES, std::align_val_t(BUFFER_ALIGNMENT)));
+    }
+    current = &buffers[0];
+    for (size_t b = 1; b < buffers.size(); b++) {
+        Buffer* buffer = &buffers[b];
+        spare.push(&buffer, 1);
+    }
+    
+    if (!config.filter.empty()) {
+        std::string error;
+        pcap_t* dead = pcap_open_dead(link_type, FILTER_SNAPLEN);
+        has_filter = dead != nullptr && compileFilter(dead, config.filter, program, error);
+        filter_failed = !has_filter;
+        if (dead != nullptr) {
+            pcap_close(dead);
+        }
+    }
+}
+
+/**
+ * @brief Destructor - frees the buffers and the filter
+ */
+PacketDumpQueue::~PacketDumpQueue() {
+    for (Buffer& buffer : buffers) {
+        ::operator delete(buffer.data, std::align_val_t(BUFFER_ALIGNMENT));
+    }
+    if (has_filter) {
+        pcap_freecode(&program);
+    }
+}
+
+/**
+ * @brief Dumps the selected packets of a batch (owning capture thread only)
+ * 
+ * Selected packets are copied once, from the capture ring (or the backend's
+ * batch storage) into the current buffer, already framed as Enhanced Packet
+ * Blocks; the writer writes the buffer as it is. Packets that are not
+ * selected cost the filter run and nothing else.
+ * 
+ * @param batch Captured packets
+ * @param infos Parsed records of the batch
+ * @param now_ns Monotonic time of the batch
+ */
+void PacketDumpQueue::append(const PacketBatch& batch, const PacketInfo* infos, uint64_t now_ns) {
+    if (select_top) {
+        top_keys.update();
+    }
+    const std::vector<ConnectionInfo>& keys = top_keys.readBuffer();
+    uint64_t copied = 0;
+    uint64_t lost = 0;
+    
+    for (size_t i = 0; i < batch.count; i++) {
+        if (!dump_all && !selected(batch, i, infos[i], keys)) {
+            continue;
+        }
+        uint32_t caplen = batch.headers[i].caplen;
+        size_t padded = (static_cast<size_t>(caplen) + 3) & ~static_cast<size_t>(3);
+        size_t length = PACKET_BLOCK_OVERHEAD + padded;
+        if (current != nullptr && current->used + length > BUFFER_BYTES) {
+            submit();
+        }
+        if (current == nullptr) {
+            Buffer* next = nullptr;
+            if (spare.pop(&next, 1) == 0) {
+                lost++;
+                continue;
+            }
+            current = next;
+        }
+        if (current->used == 0) {
+            current_start_ns = now_ns;
+        }
+        
+        uint64_t timestamp = infos[i].timestamp_ns;
+        uint32_t fields[7] = {
+            BLOCK_ENHANCED_PACKET, static_cast<uint32_t>(length), interface_index,
+            static_cast<uint32_t>(timestamp >> 32), static_cast<uint32_t>(timestamp & 0xFFFFFFFFULL),
+            caplen, batch.headers[i].len
+        };
+        uint8_t* out = current->data + current->used;
+        std::memcpy(out, fields, sizeof(fields));
+        std::memcpy(out + sizeof(fields), batch.packets[i], caplen);
+        std::memset(out + sizeof(fields) + caplen, 0, padded - caplen);
+        uint32_t trailer = static_cast<uint32_t>(length);
+        std::memcpy(out + sizeof(fields) + padded, &trailer, sizeof(trailer));
+        current->used += length;
+        copied++;
+    }
+    
+    if (copied > 0) {
+        dumped.fetch_add(copied, std::memory_order_relaxed);
+    }
+    if (lost > 0) {
+        dropped.fetch_add(lost, std::memory_order_relaxed);
+    }
+    flushIdle(now_ns);
+}
+
+/**
+ * @brief Checks whether a packet is selected for the dump
+ * @param batch Captured packets
+ * @param i Index of the packet in the batch
+ * @param info Parsed record of the packet
+ * @param keys Heaviest connections (canonical keys)
+ * @return true if the packet is to be dumped
+ */
+bool PacketDumpQueue::selected(const PacketBatch& batch, size_t i, const PacketInfo& info,
+                               const std::vector<ConnectionInfo>& keys) const {
+    if (has_filter && pcap_offline_filter(&program, &batch.headers[i], batch.packets[i]) != 0) {
+        return true;
+    }
+    if (keys.empty()) {
+        return false;
+    }
+    unsigned int direction = 0;
+    ConnectionInfo conn = canonicalConnection(info, direction);
+    for (const ConnectionInfo& key : keys) {
+        if (std::memcmp(&key, &conn, sizeof(conn)) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Hands the current buffer to the writer and takes a spare one
+ */
+void PacketDumpQueue::submit() {
+    filled.push(&current, 1);   // Always fits: the ring holds every buffer
+    Buffer* next = nullptr;
+    current = spare.pop(&next, 1) == 1 ? next : nullptr;
+}
+
+/**
+ * @brief Constructor
+ * @param dump_config Selection, destination and rotation settings
+ * @param dash Source of the heaviest connections (may be null without top_flows)
+ */
+PacketDump::PacketDump(const DumpConfig& dump_config, std::shared_ptr<Dashboard> dash)
+    : config(dump_config), dashboard(dash), file(nullptr), stopping(false), files_opened(0), announced(0),
+      failed(false), file_bytes(0), file_packets(false), file_opened_ns(0), next_sequence(0) {
+    link_types.fill(0);
+}
+
+/**
+ * @brief Destructor - writes everything handed over and stops the writer
+ */
+PacketDump::~PacketDump() {
+    stop();
+}
+
+/**
+ * @brief Checks the filter, opens the first file and starts the writer thread
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool PacketDump::start(std::string& error) {
+    if (!config.filter.empty()) {
+        // Syntax errors are reported now; each queue compiles for its own link type
+        pcap_t* dead = pcap_open_dead(DLT_EN10MB, FILTER_SNAPLEN);
+        if (dead == nullptr) {
+            error = "pcap_open_dead failed";
+            return false;
+        }
+        struct bpf_program program;
+        bool valid = compileFilter(dead, config.filter, program, error);
+        pcap_close(dead);
+        if (!valid) {
+            return false;
+        }
+        pcap_freecode(&program);
+    }
+    if (!openNext(error)) {
+        return false;
+    }
+    worker = std::thread(&PacketDump::run, this);
+    return true;
+}
+
+/**
+ * @brief Writes everything handed over so far and stops the writer thread
+ */
+void PacketDump::stop() {
+    if (worker.joinable()) {
+        stopping.store(true, std::memory_order_release);
+        worker.join();
+    }
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+}
+
+/**
+ * @brief Creates the queue of one capture thread
+ * @param interface_index Interface the capture thread reads
+ * @param link_type Link-layer type of its packets
+ * @return Pointer to the new queue
+ */
+PacketDumpQueue* PacketDump::createQueue(uint16_t interface_index, int link_type) {
+    auto queue = std::make_unique<PacketDumpQueue>(interface_index, link_type, config);
+    if (queue->filterFailed()) {
+        std::cerr << "Packet dump: filter '" << config.filter << "' does not apply to link type " << link_type
+                  << " of " << NetworkMonitor::interfaceName(interface_index) << "; none of its packets match it"
+                  << std::endl;
+    }
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    if (interface_index < MAX_INTERFACES) {
+        link_types[interface_index] = link_type;
+    }
+    queues.push_back(std::move(queue));
+    return queues.back().get();
+}
+
+/**
+ * @brief Gets the number of packets dumped
+ * @return Packets copied into buffers across all queues
+ */
+uint64_t PacketDump::dumpedPackets() const {
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    uint64_t total = 0;
+    for (const auto& queue : queues) {
+        total += queue->dumped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the number of selected packets lost because no buffer was free
+ * @return Dropped packets across all queues
+ */
+uint64_t PacketDump::droppedPackets() const {
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    uint64_t total = 0;
+    for (const auto& queue : queues) {
+        total += queue->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Writer thread: writes handed-over buffers until stop() and the queues are empty
+ */
+void PacketDump::run() {
+    const uint64_t flush_interval = static_cast<uint64_t>(config.flush_ms) * NS_PER_MS;
+    uint64_t next_selection = 0;
+    
+    while (true) {
+        // Read the flag first: buffers handed over before stop() are then always written
+        bool stop_requested = stopping.load(std::memory_order_acquire);
+        uint64_t now = monotonicNs();
+        if (config.top_flows > 0 && dashboard && now >= next_selection) {
+            publishTopFlows();
+            next_selection = now + flush_interval;
+        }
+        if (drain() == 0) {
+            if (stop_requested) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+/**
+ * @brief Writes every buffer waiting in the queues
+ * @return Number of buffers written
+ */
+size_t PacketDump::drain() {
+    {
+        std::lock_guard<std::mutex> lock(queues_mutex);
+        if (drain_list.size() != queues.size()) {
+            drain_list.clear();
+            for (const auto& queue : queues) {
+                drain_list.push_back(queue.get());
+            }
+        }
+    }
+    
+    size_t total = 0;
+    for (PacketDumpQueue* queue : drain_list) {
+        PacketDumpQueue::Buffer* buffer = nullptr;
+        while (queue->filled.pop(&buffer, 1) == 1) {
+            write(*queue, *buffer);
+            buffer->used = 0;
+            queue->spare.push(&buffer, 1);
+            total++;
+        }
+    }
+    return total;
+}
+
+/**
+ * @brief Publishes the heaviest connections of the latest snapshot to every queue
+ */
+void PacketDump::publishTopFlows() {
+    std::shared_ptr<const DashboardSnapshot> view = dashboard->snapshot();
+    top_scratch.clear();
+    for (size_t i = 0; i < view->top_by_bytes.size() && i < config.top_flows; i++) {
+        top_scratch.push_back(view->top_by_bytes[i].connection);
+    }
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    for (const auto& queue : queues) {
+        queue->top_keys.writeBuffer() = top_scratch;
+        queue->top_keys.publish();
+    }
+}
+
+/**
+ * @brief Writes one buffer, opening or rotating the file as needed
+ * 
+ * A file that already holds packets is rotated before a buffer that would
+ * take it past the size limit, or once it is older than the age limit.
+ * 
+ * @param queue Queue the buffer came from
+ * @param buffer Buffer to write
+ */
+void PacketDump::write(const PacketDumpQueue& queue, const PacketDumpQueue::Buffer& buffer) {
+    if (failed) {
+        return;
+    }
+    // Rotate before writing, so no file is left holding only its headers
+    bool expired = config.rotate_seconds > 0 &&
+                   monotonicNs() - file_opened_ns >= static_cast<uint64_t>(config.rotate_seconds) * NS_PER_SEC;
+    bool full = config.rotate_bytes > 0 && file_bytes + buffer.used > config.rotate_bytes;
+    std::string error;
+    if (file_packets && (expired || full) && !openNext(error)) {
+        std::cerr << "Packet dump: " << error << "; no further packets are saved" << std::endl;
+        failed = true;
+        return;
+    }
+    announce(queue.interface_index);
+    if (std::fwrite(buffer.data, 1, buffer.used, file) != buffer.used) {
+        std::cerr << "Packet dump: writing " << fileName(next_sequence - 1) << " failed: " << std::strerror(errno)
+                  << "; no further packets are saved" << std::endl;
+        failed = true;
+        return;
+    }
+    file_bytes += buffer.used;
+    file_packets = true;
+}
+
+/**
+ * @brief Closes the current file and opens the next one
+ * 
+ * With max_files, the oldest files beyond the limit are deleted, so the
+ * dump keeps a ring of the most recent files.
+ * 
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool PacketDump::openNext(std::string& error) {
+    if (file != nullptr) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    std::string name = fileName(next_sequence++);
+    file = std::fopen(name.c_str(), "wb");
+    if (file == nullptr) {
+        error = "cannot open " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    std::setvbuf(file, nullptr, _IONBF, 0);   // Buffers are written as they are, one write each
+    
+    header.clear();
+    appendHost<uint32_t>(header, BLOCK_SECTION_HEADER);
+    appendHost<uint32_t>(header, 28);
+    appendHost<uint32_t>(header, BYTE_ORDER_MAGIC);
+    appendHost<uint16_t>(header, 1);
+    appendHost<uint16_t>(header, 0);
+    appendHost<int64_t>(header, -1);        // Section length not known in advance
+    appendHost<uint32_t>(header, 28);
+    if (std::fwrite(header.data(), 1, header.size(), file) != header.size()) {
+        error = "writing " + name + " failed: " + std::strerror(errno);
+        return false;
+    }
+    file_bytes = header.size();
+    file_packets = false;
+    file_opened_ns = monotonicNs();
+    announced = 0;
+    files_opened.fetch_add(1, std::memory_order_relaxed);
+    
+    if (config.max_files > 0) {
+        kept_files.push_back(name);
+        while (kept_files.size() > config.max_files) {
+            std::remove(kept_files.front().c_str());
+            kept_files.pop_front();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Writes interface blocks up to an interface index
+ * 
+ * Interface IDs in pcapng are the order of the interface blocks, so every
+ * index up to the one needed is announced, in order.
+ * 
+ * @param interface_index Interface a buffer's packets refer to
+ */
+void PacketDump::announce(uint16_t interface_index) {
+    if (interface_index < announced) {
+        return;
+    }
+    header.clear();
+    for (size_t index = announced; index <= interface_index; index++) {
+        int link_type;
+        {
+            std::lock_guard<std::mutex> lock(queues_mutex);
+            link_type = link_types[index];
+        }
+        const std::string& name = NetworkMonitor::interfaceName(static_cast<uint16_t>(index));
+        size_t start = header.size();
+        appendHost<uint32_t>(header, BLOCK_INTERFACE);
+        appendHost<uint32_t>(header, 0);    // Length, patched below
+        appendHost<uint16_t>(header, static_cast<uint16_t>(link_type));
+        appendHost<uint16_t>(header, 0);
+        appendHost<uint32_t>(header, 0);    // No snapshot length limit
+        appendOption(header, 2, name.data(), name.size() < UINT16_MAX ? name.size() : 0);  // if_name
+        const uint8_t nanoseconds = 9;
+        appendOption(header, 9, &nanoseconds, 1);   // if_tsresol: 10^-9 s
+        appendOption(header, 0, nullptr, 0);         // opt_endofopt
+        uint32_t length = static_cast<uint32_t>(header.size() - start + 4);
+        appendHost<uint32_t>(header, length);
+        std::memcpy(&header[start + 4], &length, sizeof(length));
+    }
+    if (std::fwrite(header.data(), 1, header.size(), file) == header.size()) {
+        file_bytes += header.size();
+    }
+    announced = static_cast<size_t>(interface_index) + 1;
+}
+
+/**
+ * @brief Gets the name of a dump file
+ * @param sequence Sequence number of the file
+ * @return Configured path, with the sequence number before the extension if files rotate
+ */
+std::string PacketDump::fileName(uint64_t sequence) const {
+    if (config.rotate_bytes == 0 && config.rotate_seconds == 0) {
+        return config.path;
+    }
+    char number[24];
+    std::snprintf(number, sizeof(number), "-%04llu", static_cast<unsigned long long>(sequence));
+    size_t slash = config.path.find_last_of("/\\");
+    size_t dot = config.path.find_last_of('.');
+    if (dot == std::string::npos || dot == 0 || (slash != std::string::npos && dot < slash + 2)) {
+        return config.path + number;
+    }
+    return config.path.substr(0, dot) + number + config.path.substr(dot);
+}
@@ -0,0 +1,308 @@
+/**
+ * @file packet_dump.h
+ * @brief Selective packet dump to rotating pcapng files
+ * 
+ * This header defines the PacketDump class, which saves the packets matching
+ * a BPF filter or belonging to the heaviest connections to pcapng files.
+ * Capture threads copy matching packets straight from the batch into large
+ * aligned buffers; a writer thread writes whole buffers and rotates the
+ * files by size and age.
+ */
+
+#ifndef PACKET_DUMP_H
+#define PACKET_DUMP_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <cstdio>
+#include <cstdint>
+#include "network_monitor.h"
+#include "stats_shard.h"
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+
+class Dashboard;
+
+/**
+ * @struct DumpConfig
+ * @brief Selection, destination and rotation of the packet dump
+ * 
+ * With neither a filter nor top_flows every packet is dumped; with both, a
+ * packet is dumped if it matches either.
+ */
+struct DumpConfig {
+    std::string path;                   ///< Output file; rotated files get a sequence number before the extension
+    std::string filter;                 ///< BPF expression selecting packets
+    unsigned int top_flows = 0;         ///< Also dump the packets of this many heaviest connections
+    uint64_t rotate_bytes = 100ULL << 20;  ///< Start a new file after this many bytes (0 = never)
+    unsigned int rotate_seconds = 0;    ///< Start a new file after this many seconds (0 = never)
+    unsigned int max_files = 0;         ///< Delete the oldest files beyond this count (0 = keep all)
+    unsigned int flush_ms = 200;        ///< Longest time a dumped packet waits in a capture thread's buffer
+    
+    /**
+     * @brief Checks whether the dump is configured
+     * @return true if an output file is set
+     */
+    bool enabled() const { return !path.empty(); }
+};
+
+/**
+ * @class PacketDumpQueue
+ * @brief Dump buffers of one capture thread
+ * 
+ * The capture thread appends matching packets as pcapng Enhanced Packet
+ * Blocks to its current buffer and hands full (or stale) buffers to the
+ * writer, which returns them once written. When every buffer is in flight
+ * the packets are dropped and counted; capture never waits for the disk.
+ */
+class PacketDumpQueue {
+public:
+    /// Bytes per buffer (one write to the file)
+    static constexpr size_t BUFFER_BYTES = 1 << 20;
+    /// Buffers per capture thread
+    static constexpr size_t BUFFER_COUNT = 8;
+    /// Buffer alignment, suitable for direct I/O
+    static constexpr size_t BUFFER_ALIGNMENT = 4096;
+    
+    /**
+     * @brief Constructor - allocates the buffers and compiles the filter
+     * @param interface_index Interface the capture thread reads
+     * @param link_type Link-layer type of its packets
+     * @param config Selection and flush settings
+     */
+    PacketDumpQueue(uint16_t interface_index, int link_type, const DumpConfig& config);
+    
+    /**
+     * @brief Destructor - frees the buffers and the filter
+     */
+    ~PacketDumpQueue();
+    
+    PacketDumpQueue(const PacketDumpQueue&) = delete;
+    PacketDumpQueue& operator=(const PacketDumpQueue&) = delete;
+    
+    /**
+     * @brief Dumps the selected packets of a batch (owning capture thread only)
+     * @param batch Captured packets
+     * @param infos Parsed records of the batch
+     * @param now_ns Monotonic time of the batch
+     */
+    void append(const PacketBatch& batch, const PacketInfo* infos, uint64_t now_ns);
+    
+    /**
+     * @brief Hands the current buffer to the writer if it has waited too long (owning capture thread only)
+     * @param now_ns Monotonic time
+     */
+    void flushIdle(uint64_t now_ns) {
+        if (current != nullptr && current->used > 0 && now_ns - current_start_ns >= flush_ns) {
+            submit();
+        }
+    }
+    
+    /**
+     * @brief Hands the current buffer to the writer (owning capture thread only)
+     * 
+     * Call once the thread has stopped capturing.
+     */
+    void flush() {
+        if (current != nullptr && current->used > 0) {
+            submit();
+        }
+    }
+    
+    /** @brief Whether the filter could not be compiled for this link type */
+    bool filterFailed() const { return filter_failed; }
+
+private:
+    friend class PacketDump;
+    
+    /**
+     * @brief One aligned write buffer
+     */
+    struct Buffer {
+        uint8_t* data = nullptr;
+        size_t used = 0;
+    };
+    
+    uint16_t interface_index;
+    int link_type;
+    uint64_t flush_ns;
+    bool dump_all;                       ///< Neither a filter nor top flows selects packets
+    bool has_filter;
+    bool filter_failed;
+    struct bpf_program program;
+    std::vector<Buffer> buffers;
+    Buffer* current;                     ///< Buffer being filled (null while all are in flight)
+    uint64_t current_start_ns;           ///< Time the current buffer received its first packet
+    SpscRing<Buffer*> filled;            ///< Capture thread to writer
+    SpscRing<Buffer*> spare;             ///< Writer back to capture thread
+    TripleBuffer<std::vector<ConnectionInfo>> top_keys;  ///< Heaviest connections, published by the writer
+    bool select_top;
+    std::atomic<uint64_t> dumped;        ///< Packets copied into buffers
+    std::atomic<uint64_t> dropped;       ///< Selected packets lost because no buffer was free
+    
+    /**
+     * @brief Hands the current buffer to the writer and takes a spare one
+     */
+    void submit();
+    
+    /**
+     * @brief Checks whether a packet is selected for the dump
+     * @param batch Captured packets
+     * @param i Index of the packet in the batch
+     * @param info Parsed record of the packet
+     * @param keys Heaviest connections (canonical keys)
+     * @return true if the packet is to be dumped
+     */
+    bool selected(const PacketBatch& batch, size_t i, const PacketInfo& info,
+                  const std::vector<ConnectionInfo>& keys) const;
+};
+
+/**
+ * @class PacketDump
+ * @brief Writer thread saving dump buffers to rotating pcapng files
+ * 
+ * Each file starts with a Section Header Block followed by one Interface
+ * Description Block per interface index in use (name, link type and
+ * nanosecond timestamp resolution), so a block's interface ID is the
+ * interface's registry index and capture threads can encode packets without
+ * knowing which file they will land in. Buffers are written whole with one
+ * unbuffered write each. Packets of different capture threads are written a
+ * buffer at a time, so timestamps are ordered per thread but not across
+ * threads.
+ * 
+ * For top_flows, the writer takes the heaviest connections from the latest
+ * dashboard snapshot every flush interval and publishes them to every
+ * queue; the dashboard must be refreshed by the dashboard or exporter thread.
+ */
+class PacketDump {
+public:
+    /**
+     * @brief Constructor
+     * @param config Selection, destination and rotation settings
+     * @param dashboard Source of the heaviest connections (may be null without top_flows)
+     */
+    PacketDump(const DumpConfig& config, std::shared_ptr<Dashboard> dashboard);
+    
+    /**
+     * @brief Destructor - writes everything handed over and stops the writer
+     */
+    ~PacketDump();
+    
+    PacketDump(const PacketDump&) = delete;
+    PacketDump& operator=(const PacketDump&) = delete;
+    
+    /**
+     * @brief Checks the filter, opens the first file and starts the writer thread
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool start(std::string& error);
+    
+    /**
+     * @brief Writes everything handed over so far and stops the writer thread
+     * 
+     * Call after the capture threads have stopped and flushed their queues.
+     */
+    void stop();
+    
+    /**
+     * @brief Creates the queue of one capture thread
+     * 
+     * Safe to call while the writer is running. The queue is owned by the dump.
+     * 
+     * @param interface_index Interface the capture thread reads
+     * @param link_type Link-layer type of its packets
+     * @return Pointer to the new queue
+     */
+    PacketDumpQueue* createQueue(uint16_t interface_index, int link_type);
+    
+    /**
+     * @brief Gets the number of packets dumped
+     * @return Packets copied into buffers across all queues
+     */
+    uint64_t dumpedPackets() const;
+    
+    /**
+     * @brief Gets the number of selected packets lost because no buffer was free
+     * @return Dropped packets across all queues
+     */
+    uint64_t droppedPackets() const;
+    
+    /**
+     * @brief Gets the number of files written
+     * @return Files opened so far, including deleted ones
+     */
+    uint64_t filesWritten() const { return files_opened.load(std::memory_order_relaxed); }
+
+private:
+    DumpConfig config;
+    std::shared_ptr<Dashboard> dashboard;
+    FILE* file;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> files_opened;
+    mutable std::mutex queues_mutex;           ///< Guards queues and link_types while queues are created
+    std::vector<std::unique_ptr<PacketDumpQueue>> queues;
+    std::vector<PacketDumpQueue*> drain_list;  ///< Writer's copy of queues
+    std::array<int, MAX_INTERFACES> link_types;  ///< Link-layer type per interface index
+    size_t announced;                          ///< Interface blocks written to the current file
+    bool failed;                               ///< A file could not be written; buffers are discarded
+    std::deque<std::string> kept_files;        ///< Files on disk, oldest first (with max_files)
+    uint64_t file_bytes;                       ///< Bytes written to the current file
+    bool file_packets;                         ///< The current file holds packet blocks
+    uint64_t file_opened_ns;                   ///< Monotonic time the current file was opened
+    uint64_t next_sequence;                    ///< Sequence number of the next rotated file
+    std::vector<ConnectionInfo> top_scratch;
+    std::string header;                        ///< Section and interface blocks being written
+    
+    /**
+     * @brief Writer thread: writes handed-over buffers until stop() and the queues are empty
+     */
+    void run();
+    
+    /**
+     * @brief Writes every buffer waiting in the queues
+     * @return Number of buffers written
+     */
+    size_t drain();
+    
+    /**
+     * @brief Publishes the heaviest connections of the latest snapshot to every queue
+     */
+    void publishTopFlows();
+    
+    /**
+     * @brief Writes one buffer, opening or rotating the file as needed
+     * @param queue Queue the buffer came from
+     * @param buffer Buffer to write
+     */
+    void write(const PacketDumpQueue& queue, const PacketDumpQueue::Buffer& buffer);
+    
+    /**
+     * @brief Closes the current file and opens the next one
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool openNext(std::string& error);
+    
+    /**
+     * @brief Writes interface blocks up to an interface index
+     * @param interface_index Interface a buffer's packets refer to
+     */
+    void announce(uint16_t interface_index);
+    
+    /**
+     * @brief Gets the name of a dump file
+     * @param sequence Sequence number of the file
+     * @return Configured path, with the sequence number before the extension if files rotate
+     */
+    std::string fileName(uint64_t sequence) const;
+};
+
+#endif // PACKET_DUMP_H
@@ -0,0 +1,302 @@
+/**
+ * @file packet_log.cpp
+ * @brief Implementation of the asynchronous packet log
+ * 
+ * This file contains the writer thread that drains the per-thread queues and
+ * the text, CSV and binary record formatters.
+ */
+
+#include "packet_log.h"
+#include "health_metrics.h"
+#include "byte_order.h"
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+
+namespace {
+constexpr uint64_t NS_PER_MS = 1000000ULL;
+constexpr size_t FLUSH_THRESHOLD = 1 << 20;   ///< Buffered bytes that trigger a write
+constexpr uint8_t BINARY_VERSION = 1;
+constexpr uint8_t RECORD_INTERFACE = 1;
+constexpr uint8_t RECORD_PACKET = 2;
+
+/**
+ * @brief Appends an unsigned integer in decimal without going through a stream
+ * @param out Destination
+ * @param value Value
+ */
+void appendDecimal(std::string& out, uint64_t value) {
+    char digits[20];
+    size_t length = 0;
+    do {
+        digits[length++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0) {
+        out += digits[--length];
+    }
+}
+
+/**
+ * @brief Appends a string as a CSV field, quoting it if needed
+ * @param out Destination
+ * @param text Field text
+ */
+void appendCsvField(std::string& out, const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char ch : text) {
+        if (ch == '"') {
+            out += '"';
+        }
+        out += ch;
+    }
+    out += '"';
+}
+}
+
+/**
+ * @brief Constructor
+ * @param log_config Destination and buffering settings
+ */
+PacketLog::PacketLog(const LogConfig& log_config)
+    : config(log_config), file(nullptr), stopping(false), written_records(0) {
+    buffer.reserve(FLUSH_THRESHOLD + 4096);
+}
+
+/**
+ * @brief Destructor - writes everything queued and stops the writer
+ */
+PacketLog::~PacketLog() {
+    stop();
+}
+
+/**
+ * @brief Parses a log format name
+ * @param name "text", "csv" or "binary"
+ * @param format Receives the format
+ * @return false for an unknown name
+ */
+bool PacketLog::parseFormat(const std::string& name, LogFormat& format) {
+    if (name == "text") {
+        format = LogFormat::Text;
+    } else if (name == "csv") {
+        format = LogFormat::Csv;
+    } else if (name == "binary") {
+        format = LogFormat::Binary;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Opens the destination and starts the writer thread
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool PacketLog::start(std::string& error) {
+    if (config.path == "-") {
+        file = stdout;
+    } else {
+        file = std::fopen(config.path.c_str(), config.format == LogFormat::Binary ? "wb" : "w");
+        if (file == nullptr) {
+            error = "cannot open " + config.path + ": " + std::strerror(errno);
+            return false;
+        }
+    }
+    
+    if (config.format == LogFormat::Csv) {
+        buffer += "timestamp_ns,interface,protocol,length,source,source_port,destination,destination_port\n";
+    } else if (config.format == LogFormat::Binary) {
+        buffer += "NAPL";
+        appendLittleEndian(buffer, BINARY_VERSION, 4);
+    }
+    worker = std::thread(&PacketLog::run, this);
+    return true;
+}
+
+/**
+ * @brief Writes everything queued so far and stops the writer thread
+ */
+void PacketLog::stop() {
+    if (!worker.joinable()) {
+        return;
+    }
+    stopping.store(true, std::memory_order_release);
+    worker.join();
+    if (file != nullptr && file != stdout) {
+        std::fclose(file);
+    }
+    file = nullptr;
+}
+
+/**
+ * @brief Creates the queue of one capture thread
+ * @return Pointer to the new queue
+ */
+PacketLogQueue* PacketLog::createQueue() {
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    queues.push_back(std::make_unique<PacketLogQueue>(config.ring_capacity));
+    return queues.back().get();
+}
+
+/**
+ * @brief Gets the number of records dropped because a queue was full
+ * @return Dropped records across all queues
+ */
+uint64_t PacketLog::droppedRecords() const {
+    std::lock_guard<std::mutex> lock(queues_mutex);
+    uint64_t total = 0;
+    for (const auto& queue : queues) {
+        total += queue->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Writer thread: drains the queues until stop() and the queues are empty
+ * 
+ * The writer sleeps for a millisecond whenever every queue is empty, so an
+ * idle log costs almost nothing while a busy one is drained continuously.
+ */
+void PacketLog::run() {
+    const uint64_t flush_interval = static_cast<uint64_t>(config.flush_ms) * NS_PER_MS;
+    uint64_t next_flush = monotonicNs() + flush_interval;
+    
+    while (true) {
+        // Read the flag first: records appended before stop() are then always drained
+        bool stop_requested = stopping.load(std::memory_order_acquire);
+        size_t formatted = drain();
+        
+        uint64_t now = monotonicNs();
+        if (buffer.size() >= FLUSH_THRESHOLD || now >= next_flush) {
+            flush();
+            next_flush = now + flush_interval;
+        }
+        if (formatted == 0) {
+            if (stop_requested) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    flush();
+}
+
+/**
+ * @brief Moves queued records of every queue into the buffer
+ * @return Number of records formatted
+ */
+size_t PacketLog::drain() {
+    {
+        std::lock_guard<std::mutex> lock(queues_mutex);
+        if (drain_list.size() != queues.size()) {
+            drain_list.clear();
+            for (const auto& queue : queues) {
+                drain_list.push_back(queue.get());
+            }
+        }
+    }
+    
+    size_t total = 0;
+    for (PacketLogQueue* queue : drain_list) {
+        // Bounded per queue so one busy thread cannot starve the others
+        size_t count = queue->ring.pop(batch.data(), batch.size());
+        for (size_t i = 0; i < count; i++) {
+            format(batch[i]);
+        }
+        total += count;
+    }
+    written_records.fetch_add(total, std::memory_order_relaxed);
+    return total;
+}
+
+/**
+ * @brief Appends one record in the configured format
+ * 
+ * The text format is the classic per-packet line of plain mode.
+ * 
+ * @param info Packet record
+ */
+void PacketLog::format(const PacketInfo& info) {
+    const std::string& interface_name = NetworkMonitor::interfaceName(info.interface_index);
+    switch (config.format) {
+        case LogFormat::Text:
+            buffer += '[';
+            buffer += interface_name;
+            buffer += "] Packet captured. Length: ";
+            appendDecimal(buffer, info.length);
+            buffer += " | Protocol: ";
+            buffer += protocolName(info.protocol);
+            buffer += " | From: ";
+            buffer += formatAddress(info.source_addr, info.ip_version);
+            buffer += ':';
+            appendDecimal(buffer, info.source_port);
+            buffer += " -> To: ";
+            buffer += formatAddress(info.dest_addr, info.ip_version);
+            buffer += ':';
+            appendDecimal(buffer, info.dest_port);
+            buffer += '\n';
+            break;
+        
+        case LogFormat::Csv:
+            appendDecimal(buffer, info.timestamp_ns);
+            buffer += ',';
+            appendCsvField(buffer, interface_name);
+            buffer += ',';
+            buffer += protocolName(info.protocol);
+            buffer += ',';
+            appendDecimal(buffer, info.length);
+            buffer += ',';
+            buffer += formatAddress(info.source_addr, info.ip_version);
+            buffer += ',';
+            appendDecimal(buffer, info.source_port);
+            buffer += ',';
+            buffer += formatAddress(info.dest_addr, info.ip_version);
+            buffer += ',';
+            appendDecimal(buffer, info.dest_port);
+            buffer += '\n';
+            break;
+        
+        case LogFormat::Binary:
+            if (info.interface_index < MAX_INTERFACES && !interface_announced[info.interface_index]) {
+                interface_announced[info.interface_index] = true;
+                size_t name_length = interface_name.size() < UINT16_MAX ? interface_name.size() : UINT16_MAX;
+                appendLittleEndian(buffer, RECORD_INTERFACE, 1);
+                appendLittleEndian(buffer, info.interface_index, 2);
+                appendLittleEndian(buffer, name_length, 2);
+                buffer.append(interface_name, 0, name_length);
+            }
+            appendLittleEndian(buffer, RECORD_PACKET, 1);
+            appendLittleEndian(buffer, info.timestamp_ns, 8);
+            appendLittleEndian(buffer, info.length, 4);
+            appendLittleEndian(buffer, info.interface_index, 2);
+            appendLittleEndian(buffer, static_cast<uint8_t>(info.protocol), 1);
+            appendLittleEndian(buffer, info.ip_version, 1);
+            appendLittleEndian(buffer, info.source_port, 2);
+            appendLittleEndian(buffer, info.dest_port, 2);
+            buffer.append(reinterpret_cast<const char*>(info.source_addr), sizeof(info.source_addr));
+            buffer.append(reinterpret_cast<const char*>(info.dest_addr), sizeof(info.dest_addr));
+            break;
+    }
+}
+
+/**
+ * @brief Writes the buffer to the destination
+ */
+void PacketLog::flush() {
+    if (buffer.empty() || file == nullptr) {
+        return;
+    }
+    if (file == stdout) {
+        std::cout.flush();  // Keep status messages written through std::cout in order
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), file);
+    std::fflush(file);
+    buffer.clear();
+}
@@ -0,0 +1,195 @@
+/**
+ * @file packet_log.h
+ * @brief Asynchronous per-packet logging for plain (non-dashboard) mode
+ * 
+ * This header defines the PacketLog class, which moves packet records from
+ * the capture threads to a writer thread through lock-free rings and writes
+ * them as text, CSV or binary records in large batches.
+ */
+
+#ifndef PACKET_LOG_H
+#define PACKET_LOG_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <array>
+#include <cstdio>
+#include <cstdint>
+#include "network_monitor.h"
+#include "spsc_ring.h"
+
+/**
+ * @enum LogFormat
+ * @brief Output format of the packet log
+ */
+enum class LogFormat {
+    Text,    ///< One human-readable line per packet (the classic output)
+    Csv,     ///< Comma-separated values with a header row
+    Binary   ///< Typed little-endian records, see PacketLog
+};
+
+/**
+ * @struct LogConfig
+ * @brief Destination and buffering of the packet log
+ */
+struct LogConfig {
+    LogFormat format = LogFormat::Text;
+    std::string path = "-";             ///< Output file, "-" for stdout
+    unsigned int flush_ms = 200;        ///< Longest time a formatted record waits in memory
+    size_t ring_capacity = 65536;       ///< Records queued per capture thread (rounded up to a power of two)
+};
+
+/**
+ * @class PacketLogQueue
+ * @brief Records of one capture thread on their way to the packet log writer
+ */
+class PacketLogQueue {
+public:
+    explicit PacketLogQueue(size_t capacity) : ring(capacity), dropped(0) {}
+    
+    /**
+     * @brief Queues records for writing, dropping those that do not fit
+     * 
+     * Must only be called by the thread the queue was created for.
+     * 
+     * @param infos Packet records
+     * @param count Number of records
+     */
+    void append(const PacketInfo* infos, size_t count) {
+        size_t queued = ring.push(infos, count);
+        if (queued < count) {
+            dropped.fetch_add(count - queued, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    friend class PacketLog;
+    SpscRing<PacketInfo> ring;
+    std::atomic<uint64_t> dropped;   ///< Records lost because the ring was full
+};
+
+/**
+ * @class PacketLog
+ * @brief Writer thread formatting packet records in bulk
+ * 
+ * Every capture thread gets its own PacketLogQueue, a single-producer ring of
+ * PacketInfo records, so appending costs a few stores and never blocks or
+ * allocates. When a ring is full the excess records are dropped and
+ * counted. The writer thread drains all rings, formats the records into one
+ * large buffer and writes it once the buffer is large or flush_ms elapsed.
+ * 
+ * Binary logs start with the magic "NAPL" and a uint32 version (1), followed
+ * by records that begin with a uint8 type; all integers are little-endian:
+ * 
+ *     type 1 (interface): uint16 index, uint16 name length, name bytes
+ *     type 2 (packet):    uint64 timestamp ns, uint32 length, uint16 interface index,
+ *                         uint8 protocol, uint8 IP version, uint16 source port,
+ *                         uint16 destination port, 16 bytes source, 16 bytes destination
+ * 
+ * An interface record precedes the first packet of each interface. Addresses
+ * are in network byte order; IPv4 uses the first 4 bytes. Protocol values
+ * follow the Protocol enum.
+ */
+class PacketLog {
+public:
+    /**
+     * @brief Constructor
+     * @param config Destination and buffering settings
+     */
+    explicit PacketLog(const LogConfig& config);
+    
+    /**
+     * @brief Destructor - writes everything queued and stops the writer
+     */
+    ~PacketLog();
+    
+    PacketLog(const PacketLog&) = delete;
+    PacketLog& operator=(const PacketLog&) = delete;
+    
+    /**
+     * @brief Opens the destination and starts the writer thread
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool start(std::string& error);
+    
+    /**
+     * @brief Writes everything queued so far and stops the writer thread
+     * 
+     * Call after the capture threads have stopped appending.
+     */
+    void stop();
+    
+    /**
+     * @brief Creates the queue of one capture thread
+     * 
+     * Safe to call while the writer is running. The queue is owned by the log.
+     * 
+     * @return Pointer to the new queue
+     */
+    PacketLogQueue* createQueue();
+    
+    /**
+     * @brief Gets the number of records dropped because a queue was full
+     * @return Dropped records across all queues
+     */
+    uint64_t droppedRecords() const;
+    
+    /**
+     * @brief Gets the number of records written
+     * @return Records formatted and handed to the destination
+     */
+    uint64_t writtenRecords() const { return written_records.load(std::memory_order_relaxed); }
+    
+    /**
+     * @brief Parses a log format name
+     * @param name "text", "csv" or "binary"
+     * @param format Receives the format
+     * @return false for an unknown name
+     */
+    static bool parseFormat(const std::string& name, LogFormat& format);
+
+private:
+    /// Records moved out of a queue per drain step
+    static constexpr size_t DRAIN_BATCH = 1024;
+    
+    LogConfig config;
+    FILE* file;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<uint64_t> written_records;
+    mutable std::mutex queues_mutex;          ///< Guards queues while they are created
+    std::vector<std::unique_ptr<PacketLogQueue>> queues;
+    std::vector<PacketLogQueue*> drain_list;  ///< Writer's copy of queues
+    std::array<PacketInfo, DRAIN_BATCH> batch;
+    std::string buffer;                       ///< Formatted records not yet written
+    std::array<bool, MAX_INTERFACES> interface_announced{};  ///< Binary interface records written
+    
+    /**
+     * @brief Writer thread: drains the queues until stop() and the queues are empty
+     */
+    void run();
+    
+    /**
+     * @brief Moves queued records of every queue into the buffer
+     * @return Number of records formatted
+     */
+    size_t drain();
+    
+    /**
+     * @brief Appends one record in the configured format
+     * @param info Packet record
+     */
+    void format(const PacketInfo& info);
+    
+    /**
+     * @brief Writes the buffer to the destination
+     */
+    void flush();
+};
+
+#endif // PACKET_LOG_H
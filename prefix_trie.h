@@ -0,0 +1,325 @@
+/**
+ * @file prefix_trie.h
+ * @brief Path-compressed binary trie aggregating traffic per address prefix
+ * 
+ * This header defines the PrefixTrie class, which counts packets and bytes
+ * per host address and sums them per subnet of any prefix length. All
+ * storage is allocated once at construction, so updates never allocate.
+ */
+
+#ifndef PREFIX_TRIE_H
+#define PREFIX_TRIE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "flow_table.h"
+#include "flow_state.h"
+
+/**
+ * @struct TalkerConfig
+ * @brief Sizing and subnet granularity of the per-host aggregation
+ */
+struct TalkerConfig {
+    size_t max_hosts = 16384;   ///< Hosts tracked per address family and capture thread (0 = disabled)
+    uint8_t ipv4_prefix = 24;   ///< Prefix length of the IPv4 subnets reported
+    uint8_t ipv6_prefix = 64;   ///< Prefix length of the IPv6 subnets reported
+    bool sketches = false;      ///< Also estimate distinct counts and fan-in/fan-out with sketches
+};
+
+/**
+ * @class PrefixTrie
+ * @brief Patricia trie over fixed-width addresses with per-host traffic counters
+ * 
+ * Counters live in a flat hash table keyed on the address, so accounting a
+ * packet of a known host is a single probe. Only a new host walks the trie,
+ * one step per address bit at most, to attach its leaf; every internal node
+ * covers the longest prefix shared by its two subtrees. Subnet totals are
+ * summed from the leaves when they are read, which touches each host once
+ * per visit. Inserting a host takes at most two trie nodes (the leaf and one
+ * split), so the node pool is sized to 2 * max_hosts + 1. Once max_hosts
+ * hosts are tracked, packets of further hosts are only counted by
+ * untracked(). Each host also keeps its traffic of the latest history
+ * intervals, which the visitors sum as of the interval they are given.
+ */
+class PrefixTrie {
+public:
+    /// Longest supported address in bits
+    static constexpr uint8_t MAX_BITS = 128;
+    
+    /**
+     * @struct Prefix
+     * @brief An address prefix with its traffic, as passed to visitors
+     */
+    struct Prefix {
+        uint8_t address[16];       ///< Network byte order, bits past length are zero
+        uint8_t length;            ///< Prefix length in bits
+        uint64_t packets;
+        uint64_t bytes;
+        IntervalCounters interval; ///< History interval traffic, as of the interval passed to the visitor
+    };
+    
+    /**
+     * @brief Constructor - allocates the host table and node pool
+     * @param address_bits Address width in bits (32 for IPv4, 128 for IPv6)
+     * @param max_hosts Largest number of hosts tracked
+     */
+    PrefixTrie(uint8_t address_bits, size_t max_hosts)
+        : bits(address_bits > MAX_BITS ? MAX_BITS : address_bits), host_limit(max_hosts),
+          counters(tableConfig(max_hosts)), untracked_packets(0) {
+        nodes.reserve(2 * max_hosts + 1);
+        Node root;
+        std::memset(&root, 0, sizeof(root));
+        nodes.push_back(root);
+    }
+    
+    /**
+     * @brief Accounts a packet to an address
+     * @param address Address in network byte order (bits / 8 bytes)
+     * @param length Packet length in bytes
+     * @param interval History interval in progress
+     */
+    void add(const uint8_t* address, uint64_t length, uint32_t interval) {
+        HostKey key;
+        std::memset(&key, 0, sizeof(key));
+        std::memcpy(key.address, address, bits / 8u);
+        
+        HostCounters* host = counters.find(key);
+        if (host == nullptr) {
+            if (counters.size() >= host_limit) {
+                untracked_packets++;
+                return;
+            }
+            insert(key);
+            host = &counters.findOrInsert(key, 0);
+        }
+        host->packets++;
+        host->bytes += length;
+        host->interval.add(interval, length);
+    }
+    
+    /**
+     * @brief Visits the traffic of every prefix of a given length that has traffic
+     * 
+     * Each prefix is visited once with the totals of all hosts inside it.
+     * Lengths of at least the address width visit the hosts.
+     * 
+     * @param length Prefix length in bits
+     * @param interval History interval for Prefix::interval
+     * @param visit Called with a const Prefix& per prefix
+     */
+    template <typename Visitor>
+    void forEachPrefix(uint8_t length, uint32_t interval, Visitor&& visit) {
+        if (length > bits) {
+            length = bits;
+        }
+        // The first node at or below the requested length covers exactly one prefix
+        uint32_t stack[MAX_BITS + 2];
+        size_t depth = 0;
+        stack[depth++] = 0;
+        while (depth > 0) {
+            uint32_t index = stack[--depth];
+            const Node& node = nodes[index];
+            if (node.length >= length) {
+                Prefix prefix;
+                storeKey(node.key, length, prefix.address);
+                prefix.length = length;
+                sumHosts(index, interval, prefix);
+                if (prefix.packets != 0) {
+                    visit(static_cast<const Prefix&>(prefix));
+                }
+                continue;
+            }
+            for (unsigned int branch = 0; branch < 2; branch++) {
+                if (node.child[branch] != 0) {
+                    stack[depth++] = node.child[branch];
+                }
+            }
+        }
+    }
+    
+    /**
+     * @brief Visits every tracked host
+     * @param interval History interval for Prefix::interval
+     * @param visit Called with a const Prefix& per host
+     */
+    template <typename Visitor>
+    void forEachHost(uint32_t interval, Visitor&& visit) {
+        forEachPrefix(bits, interval, visit);
+    }
+    
+    /** @brief Number of tracked hosts */
+    size_t hosts() const { return counters.size(); }
+    
+    /** @brief Packets of hosts that did not fit */
+    uint64_t untracked() const { return untracked_packets; }
+    
+    /** @brief Largest number of hosts tracked */
+    size_t maxHosts() const { return host_limit; }
+    
+    /** @brief Bytes of host table and node pool storage allocated at construction */
+    size_t memoryBytes() const { return counters.memoryBytes() + nodes.capacity() * sizeof(Node); }
+    
+    /** @brief Address width in bits */
+    uint8_t addressBits() const { return bits; }
+
+private:
+    /**
+     * @struct HostKey
+     * @brief Host address as a hash key (unused trailing bytes are zero)
+     */
+    struct HostKey {
+        uint8_t address[16];
+    };
+    
+    /**
+     * @struct HostCounters
+     * @brief Traffic of one host
+     */
+    struct HostCounters {
+        uint64_t packets = 0;
+        uint64_t bytes = 0;
+        IntervalCounters interval;
+    };
+    
+    /**
+     * @struct Node
+     * @brief A prefix covering one leaf (a host) or two subtrees
+     */
+    struct Node {
+        uint64_t key[2];      ///< Address bits, most significant first; bits past length are ignored
+        uint32_t child[2];    ///< Pool indices by next bit (0 = none, the root is never a child)
+        uint8_t length;       ///< Prefix length in bits (bits for a host)
+    };
+    
+    uint8_t bits;
+    size_t host_limit;
+    FlowTable<HostKey, HostCounters> counters;  ///< Never fills up, so it never evicts
+    uint64_t untracked_packets;
+    std::vector<Node> nodes;  ///< Pool; capacity never grows after construction
+    
+    static FlowTableConfig tableConfig(size_t max_hosts) {
+        FlowTableConfig config;
+        config.max_flows = max_hosts ? max_hosts : 1;
+        config.idle_timeout_ns = 0;
+        return config;
+    }
+    
+    /**
+     * @brief Attaches the leaf of a new host, splitting an edge if needed
+     * @param host Host address
+     */
+    void insert(const HostKey& host) {
+        uint64_t key[2];
+        loadKey(host.address, key);
+        
+        uint32_t index = 0;
+        while (true) {
+            unsigned int branch = bitAt(key, nodes[index].length);
+            uint32_t child = nodes[index].child[branch];
+            if (child == 0) {
+                nodes[index].child[branch] = newNode(key, bits);
+                return;
+            }
+            uint8_t common = commonPrefix(key, nodes[child].key, nodes[child].length);
+            if (common == nodes[child].length) {
+                index = child;   // Cannot be a leaf: the host would already be tracked
+                continue;
+            }
+            
+            // The address leaves the child's prefix early: split the edge
+            uint32_t split = newNode(key, common);
+            uint32_t leaf = newNode(key, bits);
+            unsigned int leaf_branch = bitAt(key, common);
+            nodes[split].child[leaf_branch] = leaf;
+            nodes[split].child[leaf_branch ^ 1] = child;
+            nodes[index].child[branch] = split;
+            return;
+        }
+    }
+    
+    /**
+     * @brief Sums the counters of every host below a node
+     * @param index Subtree root
+     * @param interval History interval summed into prefix.interval
+     * @param prefix Receives the totals
+     */
+    void sumHosts(uint32_t index, uint32_t interval, Prefix& prefix) {
+        prefix.packets = 0;
+        prefix.bytes = 0;
+        prefix.interval = IntervalCounters().at(interval);
+        uint32_t stack[MAX_BITS + 2];
+        size_t depth = 0;
+        stack[depth++] = index;
+        while (depth > 0) {
+            const Node& node = nodes[stack[--depth]];
+            if (node.length == bits) {
+                HostKey host;
+                storeKey(node.key, bits, host.address);
+                const HostCounters* found = counters.find(host);
+                if (found != nullptr) {
+                    IntervalCounters recent = found->interval.at(interval);
+                    prefix.packets += found->packets;
+                    prefix.bytes += found->bytes;
+                    prefix.interval.current.packets += recent.current.packets;
+                    prefix.interval.current.bytes += recent.current.bytes;
+                    prefix.interval.previous.packets += recent.previous.packets;
+                    prefix.interval.previous.bytes += recent.previous.bytes;
+                }
+                continue;
+            }
+            for (unsigned int branch = 0; branch < 2; branch++) {
+                if (node.child[branch] != 0) {
+                    stack[depth++] = node.child[branch];
+                }
+            }
+        }
+    }
+    
+    uint32_t newNode(const uint64_t* key, uint8_t length) {
+        Node node;
+        node.key[0] = key[0];
+        node.key[1] = key[1];
+        node.child[0] = 0;
+        node.child[1] = 0;
+        node.length = length;
+        nodes.push_back(node);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
+    
+    void loadKey(const uint8_t* address, uint64_t* key) const {
+        key[0] = 0;
+        key[1] = 0;
+        for (size_t i = 0; i < bits / 8u; i++) {
+            key[i / 8] |= static_cast<uint64_t>(address[i]) << (56 - 8 * (i % 8));
+        }
+    }
+    
+    static void storeKey(const uint64_t* key, uint8_t length, uint8_t* address) {
+        std::memset(address, 0, 16);
+        for (size_t i = 0; i < 16 && 8 * i < length; i++) {
+            address[i] = static_cast<uint8_t>(key[i / 8] >> (56 - 8 * (i % 8)));
+        }
+        if (length % 8 != 0) {
+            address[length / 8] &= static_cast<uint8_t>(0xFF << (8 - length % 8));
+        }
+    }
+    
+    static unsigned int bitAt(const uint64_t* key, uint8_t position) {
+        return static_cast<unsigned int>((key[position / 64] >> (63 - position % 64)) & 1);
+    }
+    
+    static uint8_t commonPrefix(const uint64_t* a, const uint64_t* b, uint8_t limit) {
+        for (unsigned int word = 0; word < 2 && 64 * word < limit; word++) {
+            uint64_t diff = a[word] ^ b[word];
+            if (diff != 0) {
+                unsigned int common = 64 * word + static_cast<unsigned int>(__builtin_clzll(diff));
+                return static_cast<uint8_t>(common < limit ? common : limit);
+            }
+        }
+        return limit;
+    }
+};
+
+#endif // PREFIX_TRIE_H
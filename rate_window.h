@@ -0,0 +1,382 @@
+/**
+ * @file rate_window.h
+ * @brief Sliding-window packet and byte rates from per-second buckets
+ * 
+ * This header defines the RateHistory template, a fixed ring of per-second
+ * counters that yields packet and byte rates over the last 1, 10 and 60
+ * seconds, and KeyedRates, which derives the same rates for a bounded set of
+ * keys such as the heaviest connections.
+ */
+
+#ifndef RATE_WINDOW_H
+#define RATE_WINDOW_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "flow_table.h"
+
+/// Seconds of per-second buckets kept by a RateHistory (a power of two above the longest window)
+constexpr size_t RATE_HISTORY_SECONDS = 64;
+/// Number of averaging windows reported
+constexpr size_t RATE_WINDOW_COUNT = 3;
+/// Length of each averaging window in seconds
+constexpr std::array<uint32_t, RATE_WINDOW_COUNT> RATE_WINDOWS = {1, 10, 60};
+
+/**
+ * @struct RateBucket
+ * @brief Packets and bytes counted in one second
+ */
+struct RateBucket {
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+};
+
+/**
+ * @struct Rate
+ * @brief Packet and byte rate
+ */
+struct Rate {
+    double packets_per_sec = 0.0;
+    double bytes_per_sec = 0.0;
+    
+    /**
+     * @brief Adds another rate to this one (used when merging shards)
+     * @param other Rate to add
+     */
+    void merge(const Rate& other) {
+        packets_per_sec += other.packets_per_sec;
+        bytes_per_sec += other.bytes_per_sec;
+    }
+};
+
+/**
+ * @class RateHistory
+ * @brief Ring of per-second buckets for a fixed number of channels
+ * 
+ * Every channel (e.g. the total, each protocol, each interface) shares the
+ * same row per second, so accounting a packet touches one row and advancing
+ * the clock clears one row per elapsed second. Seconds are taken from packet
+ * timestamps; rates cover complete seconds before the current one, so a
+ * window reports 0 until its first second has passed.
+ * 
+ * @tparam Channels Number of independent counters per second
+ */
+template <size_t Channels>
+class RateHistory {
+public:
+    static constexpr size_t CHANNELS = Channels;
+    
+    /**
+     * @brief Gets the bucket row for a second, moving the clock forward if needed
+     * @param second Absolute second (e.g. packet timestamp / 1e9)
+     * @return Row of Channels buckets, or nullptr if the second is too old to keep
+     */
+    RateBucket* row(uint64_t second) {
+        if (second != current || !started) {
+            if (!started || second > current) {
+                advance(second);
+            } else if (current - second >= RATE_HISTORY_SECONDS) {
+                return nullptr;
+            }
+        }
+        return rows[second & MASK].data();
+    }
+    
+    /**
+     * @brief Moves the clock forward, clearing the seconds that elapsed
+     * @param second New current second (ignored if not newer)
+     */
+    void advance(uint64_t second) {
+        if (!started) {
+            started = true;
+            first = second;
+            current = second;
+            return;
+        }
+        if (second <= current) {
+            return;
+        }
+        if (second - current >= RATE_HISTORY_SECONDS) {
+            for (auto& r : rows) {
+                r.fill(RateBucket());
+            }
+        } else {
+            for (uint64_t s = current + 1; s <= second; s++) {
+                rows[s & MASK].fill(RateBucket());
+            }
+        }
+        current = second;
+    }
+    
+    /**
+     * @brief Adds another history, aligning buckets by absolute second
+     * @param other History to add
+     */
+    void merge(const RateHistory& other) {
+        if (!other.started) {
+            return;
+        }
+        if (!started) {
+            *this = other;
+            return;
+        }
+        advance(other.current);
+        if (other.first < first) {
+            first = other.first;
+        }
+        uint64_t oldest = other.current >= RATE_HISTORY_SECONDS - 1 ? other.current - (RATE_HISTORY_SECONDS - 1) : 0;
+        for (uint64_t s = oldest < other.first ? other.first : oldest; s <= other.current; s++) {
+            if (current - s >= RATE_HISTORY_SECONDS) {
+                continue;
+            }
+            auto& mine = rows[s & MASK];
+            const auto& theirs = other.rows[s & MASK];
+            for (size_t c = 0; c < Channels; c++) {
+                mine[c].packets += theirs[c].packets;
+                mine[c].bytes += theirs[c].bytes;
+            }
+        }
+    }
+    
+    /**
+     * @brief Gets the average rate over the complete seconds of a window
+     * 
+     * Shortly after the first packet the window is shortened to the seconds
+     * actually observed, so early rates are not diluted by empty history.
+     * 
+     * @param channel Channel index
+     * @param window Window length in seconds (at most RATE_HISTORY_SECONDS - 1)
+     * @return Average rate, or zero before the first second completed
+     */
+    Rate rate(size_t channel, uint32_t window) const {
+        Rate result;
+        uint64_t observed = started ? current - first : 0;
+        uint64_t seconds = window < observed ? window : observed;
+        if (seconds == 0) {
+            return result;
+        }
+        RateBucket sum;
+        for (uint64_t s = current - seconds; s < current; s++) {
+            const RateBucket& bucket = rows[s & MASK][channel];
+            sum.packets += bucket.packets;
+            sum.bytes += bucket.bytes;
+        }
+        result.packets_per_sec = static_cast<double>(sum.packets) / static_cast<double>(seconds);
+        result.bytes_per_sec = static_cast<double>(sum.bytes) / static_cast<double>(seconds);
+        return result;
+    }
+    
+    /**
+     * @brief Gets the highest one-second rates among the kept complete seconds
+     * @param channel Channel index
+     * @return Peak packet and byte rates (each may come from a different second)
+     */
+    Rate peak(size_t channel) const {
+        Rate result;
+        if (!started) {
+            return result;
+        }
+        uint64_t observed = current - first;
+        uint64_t seconds = observed < RATE_HISTORY_SECONDS - 1 ? observed : RATE_HISTORY_SECONDS - 1;
+        for (uint64_t s = current - seconds; s < current; s++) {
+            const RateBucket& bucket = rows[s & MASK][channel];
+            if (static_cast<double>(bucket.packets) > result.packets_per_sec) {
+                result.packets_per_sec = static_cast<double>(bucket.packets);
+            }
+            if (static_cast<double>(bucket.bytes) > result.bytes_per_sec) {
+                result.bytes_per_sec = static_cast<double>(bucket.bytes);
+            }
+        }
+        return result;
+    }
+    
+    /**
+     * @brief Gets the rates of one channel over every window in RATE_WINDOWS
+     * @param channel Channel index
+     * @return One rate per window
+     */
+    std::array<Rate, RATE_WINDOW_COUNT> rates(size_t channel) const {
+        std::array<Rate, RATE_WINDOW_COUNT> result;
+        for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+            result[w] = rate(channel, RATE_WINDOWS[w]);
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint64_t MASK = RATE_HISTORY_SECONDS - 1;
+    static_assert((RATE_HISTORY_SECONDS & MASK) == 0, "RATE_HISTORY_SECONDS must be a power of two");
+    
+    std::array<std::array<RateBucket, Channels>, RATE_HISTORY_SECONDS> rows{};
+    uint64_t current = 0;   ///< Newest second in the ring
+    uint64_t first = 0;     ///< First second ever recorded
+    bool started = false;   ///< A second has been recorded
+};
+
+/**
+ * @class KeyedRates
+ * @brief Sliding-window rates for a bounded, changing set of keys
+ * 
+ * Rather than counting every packet a second time, the cumulative counters
+ * of each tracked key are sampled when a snapshot is published and kept in
+ * a ring holding at most one sample per second. Differences of samples give
+ * the same per-second resolution as RateHistory at no cost per packet.
+ * 
+ * The tracked set is replaced with track(), typically with the current
+ * heaviest keys; keys that stay in the set keep their samples and new keys
+ * report zero until a second sample exists. All storage is allocated up
+ * front for capacity keys.
+ * 
+ * @tparam Key Trivially copyable key type compared bytewise
+ */
+template <typename Key>
+class KeyedRates {
+public:
+    /**
+     * @brief Constructor - allocates all sample rings up front
+     * @param capacity Maximum number of tracked keys
+     */
+    explicit KeyedRates(size_t capacity)
+        : index(FlowTableConfig{capacity ? capacity : 1, 0}),
+          entries(capacity ? capacity : 1), generation(0) {
+        free_slots.reserve(entries.size());
+        for (size_t i = entries.size(); i > 0; i--) {
+            free_slots.push_back(static_cast<uint32_t>(i - 1));
+        }
+    }
+    
+    /**
+     * @brief Replaces the tracked set
+     * @param wanted Keys to track (duplicates allowed; keys beyond capacity are ignored)
+     */
+    void track(const std::vector<Key>& wanted) {
+        generation++;
+        for (const Key& key : wanted) {
+            uint32_t* slot = index.find(key);
+            if (slot != nullptr) {
+                entries[*slot].mark = generation;
+            }
+        }
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].in_use && entries[i].mark != generation) {
+                index.erase(entries[i].key);
+                entries[i].in_use = false;
+                free_slots.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        for (const Key& key : wanted) {
+            if (free_slots.empty()) {
+                break;
+            }
+            if (index.find(key) != nullptr) {
+                continue;
+            }
+            uint32_t slot = free_slots.back();
+            free_slots.pop_back();
+            index.findOrInsert(key, 0) = slot;
+            Entry& entry = entries[slot];
+            entry.key = key;
+            entry.mark = generation;
+            entry.in_use = true;
+            entry.count = 0;
+            entry.head = 0;
+        }
+    }
+    
+    /**
+     * @brief Samples the cumulative counters of every tracked key
+     * @param now_ns Current time on the packet clock
+     * @param cumulative Callable bool(const Key&, RateBucket&) filling the key's totals
+     */
+    template <typename Fn>
+    void sample(uint64_t now_ns, Fn cumulative) {
+        for (Entry& entry : entries) {
+            if (!entry.in_use) {
+                continue;
+            }
+            Sample current{now_ns, RateBucket()};
+            if (!cumulative(entry.key, current.totals)) {
+                continue;
+            }
+            entry.latest = current;
+            if (entry.count == 0 || now_ns >= newest(entry).time_ns + NS_PER_SECOND) {
+                entry.head = (entry.head + 1) & MASK;
+                entry.ring[entry.head] = current;
+                if (entry.count < RATE_HISTORY_SECONDS) {
+                    entry.count++;
+                }
+            }
+        }
+    }
+    
+    /**
+     * @brief Gets the rates of a key over every window in RATE_WINDOWS
+     * 
+     * Each rate compares the latest sample with the newest one at least a
+     * window older, or with the oldest one kept if none is that old.
+     * 
+     * @param key Key
+     * @return One rate per window (zero if the key is not tracked or has one sample)
+     */
+    std::array<Rate, RATE_WINDOW_COUNT> rates(const Key& key) {
+        std::array<Rate, RATE_WINDOW_COUNT> result;
+        uint32_t* slot = index.find(key);
+        if (slot == nullptr || entries[*slot].count == 0) {
+            return result;
+        }
+        const Entry& entry = entries[*slot];
+        for (size_t w = 0; w < RATE_WINDOW_COUNT; w++) {
+            uint64_t span = static_cast<uint64_t>(RATE_WINDOWS[w]) * NS_PER_SECOND;
+            const Sample* base = nullptr;
+            for (size_t n = 0; n < entry.count; n++) {
+                base = &entry.ring[(entry.head - n) & MASK];
+                if (base->time_ns + span <= entry.latest.time_ns) {
+                    break;
+                }
+            }
+            if (base == nullptr || base->time_ns >= entry.latest.time_ns) {
+                continue;
+            }
+            double seconds = static_cast<double>(entry.latest.time_ns - base->time_ns) / NS_PER_SECOND;
+            result[w].packets_per_sec = static_cast<double>(entry.latest.totals.packets - base->totals.packets) / seconds;
+            result[w].bytes_per_sec = static_cast<double>(entry.latest.totals.bytes - base->totals.bytes) / seconds;
+        }
+        return result;
+    }
+
+private:
+    static constexpr uint64_t NS_PER_SECOND = 1000000000ULL;
+    static constexpr size_t MASK = RATE_HISTORY_SECONDS - 1;
+    
+    /**
+     * @brief Cumulative counters at one point on the packet clock
+     */
+    struct Sample {
+        uint64_t time_ns;
+        RateBucket totals;
+    };
+    
+    /**
+     * @brief Sample ring of one tracked key
+     */
+    struct Entry {
+        Key key;
+        std::array<Sample, RATE_HISTORY_SECONDS> ring;  ///< Samples at least a second apart
+        Sample latest;                                  ///< Most recent sample
+        size_t head = 0;                                ///< Ring position of the newest sample
+        size_t count = 0;                               ///< Samples in the ring
+        uint64_t mark = 0;                              ///< Generation the key was last wanted in
+        bool in_use = false;
+    };
+    
+    static const Sample& newest(const Entry& entry) { return entry.ring[entry.head]; }
+    
+    FlowTable<Key, uint32_t> index;   ///< Key to entry slot
+    std::vector<Entry> entries;
+    std::vector<uint32_t> free_slots;
+    uint64_t generation;
+};
+
+#endif // RATE_WINDOW_H
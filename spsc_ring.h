@@ -0,0 +1,102 @@
+/**
+ * @file spsc_ring.h
+ * @brief Lock-free bounded single-producer/single-consumer ring buffer
+ * 
+ * This header defines the SpscRing template used to move packet records from
+ * a capture thread to a consumer thread in bulk without locks.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+/**
+ * @class SpscRing
+ * @brief Bounded FIFO between exactly one producer and one consumer thread
+ * 
+ * The capacity is rounded up to a power of two. Each side owns one index and
+ * keeps a cached copy of the other, so the shared indices are only read when
+ * the cached view says the ring is full (producer) or empty (consumer). The
+ * indices live on separate cache lines to avoid false sharing. push() never
+ * blocks: it stores what fits and reports how many items that was.
+ */
+template <typename T>
+class SpscRing {
+public:
+    /**
+     * @brief Constructor - allocates the slots
+     * @param min_capacity Smallest number of items the ring must hold
+     */
+    explicit SpscRing(size_t min_capacity)
+        : write_index(0), cached_read(0), read_index(0), cached_write(0) {
+        size_t capacity = 2;
+        while (capacity < min_capacity) {
+            capacity <<= 1;
+        }
+        slots.resize(capacity);
+        mask = capacity - 1;
+    }
+    
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+    
+    /**
+     * @brief Appends items, as many as fit (producer only)
+     * @param items Items to append
+     * @param count Number of items
+     * @return Number of items appended
+     */
+    size_t push(const T* items, size_t count) {
+        size_t write = write_index.load(std::memory_order_relaxed);
+        size_t free_slots = slots.size() - (write - cached_read);
+        if (free_slots < count) {
+            cached_read = read_index.load(std::memory_order_acquire);
+            free_slots = slots.size() - (write - cached_read);
+        }
+        size_t n = count < free_slots ? count : free_slots;
+        for (size_t i = 0; i < n; i++) {
+            slots[(write + i) & mask] = items[i];
+        }
+        write_index.store(write + n, std::memory_order_release);
+        return n;
+    }
+    
+    /**
+     * @brief Removes up to max_count items in FIFO order (consumer only)
+     * @param out Receives the items
+     * @param max_count Capacity of out
+     * @return Number of items removed
+     */
+    size_t pop(T* out, size_t max_count) {
+        size_t read = read_index.load(std::memory_order_relaxed);
+        if (cached_write - read < max_count) {
+            cached_write = write_index.load(std::memory_order_acquire);
+        }
+        size_t available = cached_write - read;
+        size_t n = max_count < available ? max_count : available;
+        for (size_t i = 0; i < n; i++) {
+            out[i] = slots[(read + i) & mask];
+        }
+        read_index.store(read + n, std::memory_order_release);
+        return n;
+    }
+    
+    /**
+     * @brief Gets the number of items the ring holds when full
+     * @return Capacity
+     */
+    size_t capacity() const { return slots.size(); }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> write_index;  ///< Next slot to fill (written by the producer)
+    size_t cached_read;                           ///< Producer's view of read_index
+    alignas(64) std::atomic<size_t> read_index;   ///< Next slot to drain (written by the consumer)
+    size_t cached_write;                          ///< Consumer's view of write_index
+};
+
+#endif // SPSC_RING_H
@@ -0,0 +1,527 @@
+/**
+ * @file stats_shard.cpp
+ * @brief Implementation of the StatsShard class
+ * 
+ * This file contains the per-thread statistics update path and the
+ * lock-free snapshot hand-off to the dashboard thread.
+ */
+
+#include "stats_shard.h"
+#include <algorithm>
+
+/**
+ * @brief Adds another set of counters to this one
+ * @param other Counters to add
+ */
+void StatsCounters::merge(const StatsCounters& other) {
+    total_packets += other.total_packets;
+    total_bytes += other.total_bytes;
+    for (size_t i = 0; i < PROTOCOL_COUNT; i++) {
+        protocol_counts[i] += other.protocol_counts[i];
+        protocol_bytes[i] += other.protocol_bytes[i];
+    }
+    for (size_t i = 0; i < MAX_INTERFACES; i++) {
+        interface_counts[i] += other.interface_counts[i];
+        interface_bytes[i] += other.interface_bytes[i];
+    }
+    for (size_t i = 0; i < APP_PROTOCOL_COUNT; i++) {
+        app_counts[i] += other.app_counts[i];
+        app_bytes[i] += other.app_bytes[i];
+    }
+}
+
+/**
+ * @brief Constructor
+ * 
+ * Sizes: 2^14 registers per distinct counter (0.8 % error), 2 x 1024 cells
+ * of 64 registers per spread sketch and 4 x 8192 byte counters.
+ * 
+ * @param enabled Whether to allocate the full-size sketches (about 560 KiB)
+ */
+TrafficSketches::TrafficSketches(bool enabled)
+    : sources(enabled ? 14 : 4), destinations(enabled ? 14 : 4), flows(enabled ? 14 : 4),
+      sources_per_destination(enabled ? 1024 : 16, enabled ? 2 : 1, enabled ? 6 : 4),
+      ports_per_source(enabled ? 1024 : 16, enabled ? 2 : 1, enabled ? 6 : 4),
+      bytes_per_source(enabled ? 8192 : 16, enabled ? 4 : 1) {
+}
+
+/**
+ * @brief Adds a packet to every sketch
+ * @param info Packet record (IPv4 or IPv6)
+ * @param connection The packet's 5-tuple
+ */
+void TrafficSketches::add(const PacketInfo& info, const ConnectionInfo& connection) {
+    uint64_t source = addressHash(info.source_addr, info.ip_version);
+    uint64_t destination = addressHash(info.dest_addr, info.ip_version);
+    sources.add(source);
+    destinations.add(destination);
+    flows.add(hashKeyBytes(&connection, sizeof(connection)));
+    sources_per_destination.add(destination, source);
+    ports_per_source.add(source, hashKeyBytes(&info.dest_port, sizeof(info.dest_port)));
+    bytes_per_source.add(source, info.length);
+}
+
+/**
+ * @brief Adds another set of sketches of the same shapes
+ * @param other Sketches to merge
+ */
+void TrafficSketches::merge(const TrafficSketches& other) {
+    sources.merge(other.sources);
+    destinations.merge(other.destinations);
+    flows.merge(other.flows);
+    sources_per_destination.merge(other.sources_per_destination);
+    ports_per_source.merge(other.ports_per_source);
+    bytes_per_source.merge(other.bytes_per_source);
+}
+
+/**
+ * @brief Forgets everything added
+ */
+void TrafficSketches::clear() {
+    sources.clear();
+    destinations.clear();
+    flows.clear();
+    sources_per_destination.clear();
+    ports_per_source.clear();
+    bytes_per_source.clear();
+}
+
+/**
+ * @brief Gets the bytes of sketch storage
+ * @return Total size of all registers and counters
+ */
+size_t TrafficSketches::memoryBytes() const {
+    return sources.memoryBytes() + destinations.memoryBytes() + flows.memoryBytes() +
+           sources_per_destination.memoryBytes() + ports_per_source.memoryBytes() +
+           bytes_per_source.memoryBytes();
+}
+
+/**
+ * @brief Constructor - Initializes an empty shard
+ * @param flow_config Flow table sizing and eviction settings
+ * @param talker_config Host table sizing and reported subnet lengths
+ */
+StatsShard::StatsShard(const FlowTableConfig& flow_config, const TalkerConfig& talker_config)
+    : connections(flow_config), top_packets(TOP_CONNECTIONS), top_bytes(TOP_CONNECTIONS),
+      flow_rates(2 * TOP_CONNECTIONS), talkers(talker_config),
+      account_loop(selectAccountLoop(talker_config)), hosts_v4(32, talker_config.max_hosts),
+      hosts_v6(128, talker_config.max_hosts), sketches(talker_config.sketches), last_packet_ns(0), rate_clock_ns(0), last_batch_ns(monotonicNs()), published_epoch(0),
+      interval(0), requested_epoch(0) {
+    rate_keys_scratch.reserve(2 * TOP_CONNECTIONS);
+    talker_scratch.reserve(TOP_TALKERS);
+}
+
+/**
+ * @brief Accounts a packet in this shard
+ * 
+ * Called only by the owning capture thread. Relaxed loads of the history
+ * interval and the requested epoch are the only shared-memory accesses on
+ * this path.
+ * 
+ * @param info Packet record
+ * @param now_ns Monotonic time the packet was processed
+ */
+void StatsShard::updatePacket(const PacketInfo& info, uint64_t now_ns) {
+    enterInterval();
+    (this->*account_loop)(&info, nullptr, 1);
+    last_batch_ns = now_ns;
+    poll();
+}
+
+/**
+ * @brief Accounts a batch of packets in this shard
+ * 
+ * The snapshot request is checked once per batch rather than per packet,
+ * and all windowing uses the packets' own timestamps, so nothing on this
+ * path reads a clock.
+ * 
+ * @param infos Packet records
+ * @param count Number of records
+ * @param now_ns Monotonic time the batch was processed, already read by the caller
+ * @param frames Captured frames of the records, for payload signatures (null = use PacketInfo::payload_app)
+ */
+void StatsShard::updateBatch(const PacketInfo* infos, size_t count, uint64_t now_ns,
+                             const uint8_t* const* frames) {
+    enterInterval();
+    (this->*account_loop)(infos, frames, count);
+    last_batch_ns = now_ns;
+    poll();
+}
+
+/**
+ * @brief Picks the accounting loop for the shard's configuration
+ * 
+ * Optional features are template parameters of the loop, so the check for
+ * each of them happens here, once per shard, instead of once per packet.
+ * 
+ * @param talker_config Host table and sketch settings
+ * @return Instantiation of accountBatch() with exactly the enabled features
+ */
+StatsShard::AccountLoop StatsShard::selectAccountLoop(const TalkerConfig& talker_config) {
+    bool hosts = talker_config.max_hosts != 0;
+    if (hosts && talker_config.sketches) {
+        return &StatsShard::accountBatch<true, true>;
+    }
+    if (hosts) {
+        return &StatsShard::accountBatch<true, false>;
+    }
+    if (talker_config.sketches) {
+        return &StatsShard::accountBatch<false, true>;
+    }
+    return &StatsShard::accountBatch<false, false>;
+}
+
+/**
+ * @brief Adds a batch of packets to the writer-private state
+ * @tparam TrackHosts Per-host and per-subnet tables are enabled
+ * @tparam Sketches Traffic sketches are enabled
+ * @param infos Packet records
+ * @param frames Captured frames of the records, or null
+ * @param count Number of records
+ */
+template <bool TrackHosts, bool Sketches>
+void StatsShard::accountBatch(const PacketInfo* infos, const uint8_t* const* frames, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        account<TrackHosts, Sketches>(infos[i], frames != nullptr ? frames[i] : nullptr);
+    }
+}
+
+/**
+ * @brief Adds one packet to the writer-private state
+ * @tparam TrackHosts Per-host and per-subnet tables are enabled
+ * @tparam Sketches Traffic sketches are enabled
+ * @param info Packet record
+ * @param frame Captured frame of the record, or null
+ */
+template <bool TrackHosts, bool Sketches>
+inline void StatsShard::account(const PacketInfo& info, const uint8_t* frame) {
+    counters.total_packets++;
+    counters.total_bytes += info.length;
+    
+    // Update protocol statistics
+    size_t proto = static_cast<size_t>(info.protocol);
+    counters.protocol_counts[proto]++;
+    counters.protocol_bytes[proto] += info.length;
+    
+    // Update interface statistics
+    counters.interface_counts[info.interface_index]++;
+    counters.interface_bytes[info.interface_index] += info.length;
+    
+    // Update the per-second rate buckets (one row shared by all channels)
+    uint64_t second = info.timestamp_ns / 1000000000ULL;
+    RateBucket* rate_row = rates.row(second);
+    if (rate_row != nullptr) {
+        rate_row[RATE_CHANNEL_TOTAL].packets++;
+        rate_row[RATE_CHANNEL_TOTAL].bytes += info.length;
+        rate_row[protocolRateChannel(proto)].packets++;
+        rate_row[protocolRateChannel(proto)].bytes += info.length;
+        rate_row[interfaceRateChannel(info.interface_index)].packets++;
+        rate_row[interfaceRateChannel(info.interface_index)].bytes += info.length;
+    }
+    if (info.timestamp_ns > last_packet_ns) {
+        last_packet_ns = info.timestamp_ns;
+    }
+    
+    // Update connection tracking: both directions share an entry
+    unsigned int direction = 0;
+    ConnectionInfo conn = canonicalConnection(info, direction);
+    
+    FlowState& flow = connections.findOrInsert(conn, info.timestamp_ns);
+    if (flow.counters.packets == 0 && direction == 1) {
+        flow.flags |= FlowState::INITIATOR_REVERSED;   // Until a SYN says otherwise, the first sender initiated
+    }
+    flow.counters.packets++;
+    flow.counters.bytes += info.length;
+    flow.interval.add(interval, info.length);
+    if (info.protocol == Protocol::TCP) {
+        trackTcp(flow, info, direction);
+    }
+    
+    // Settle the application: the ports give a guess on the first packet and the first payload of each
+    // direction is checked against the signatures. A match is final; without one the guess stays, and
+    // later packets of the connection are not classified at all
+    uint8_t checked = static_cast<uint8_t>(FlowState::APP_CHECKED << direction);
+    if (!(flow.flags & (FlowState::APP_CONFIRMED | checked))) {
+        bool tcp = info.protocol == Protocol::TCP;
+        if (flow.counters.packets == 1) {
+            flow.app = portApplication(tcp, info.source_port, info.dest_port);
+        }
+        if (info.payload_captured != 0) {
+            flow.flags |= checked;
+            // Queued records arrive without their frames but with the capture thread's check
+            AppProtocol signature = frame != nullptr ?
+                payloadSignature(tcp, frame + info.payload_offset, info.payload_captured) : info.payload_app;
+            if (signature != AppProtocol::Unknown) {
+                flow.app = signature;
+                flow.flags |= FlowState::APP_CONFIRMED;
+            }
+        }
+    }
+    size_t app = static_cast<size_t>(flow.app);
+    counters.app_counts[app]++;
+    counters.app_bytes[app] += info.length;
+    top_packets.update(conn, flow.counters);
+    top_bytes.update(conn, flow.counters);
+    
+    // Update per-host and per-subnet traffic (each address walks one trie path)
+    if constexpr (TrackHosts) {
+        if (info.ip_version == 4) {
+            hosts_v4.add(info.source_addr, info.length, interval);
+            hosts_v4.add(info.dest_addr, info.length, interval);
+        } else if (info.ip_version == 6) {
+            hosts_v6.add(info.source_addr, info.length, interval);
+            hosts_v6.add(info.dest_addr, info.length, interval);
+        }
+    }
+    if constexpr (Sketches) {
+        if (info.ip_version == 4 || info.ip_version == 6) {
+            sketches.add(info, conn);
+        }
+    }
+}
+
+/**
+ * @brief Advances a connection's TCP state and sequence tracking
+ * 
+ * Follows SYN, SYN-ACK, ACK, FIN and RST far enough to time the handshake
+ * and tell how connections end; it does not validate windows or
+ * acknowledgments. A segment is counted as a retransmission when all of the
+ * sequence space it occupies (payload, SYN and FIN) was already sent in its
+ * direction, which also catches out-of-order arrivals behind a gap.
+ * 
+ * @param flow Connection state
+ * @param info TCP packet record
+ * @param direction 0 if the packet came from the key's source endpoint, 1 otherwise
+ */
+void StatsShard::trackTcp(FlowState& flow, const PacketInfo& info, unsigned int direction) {
+    uint8_t flags = info.tcp_flags;
+    unsigned int initiator = flow.reversed() ? 1 : 0;
+    
+    if (flags & TCP_RST) {
+        if (flow.state != TcpState::Reset) {
+            enterState(flow, TcpState::Reset);
+        }
+        return;
+    }
+    
+    if ((flags & (TCP_SYN | TCP_ACK)) == TCP_SYN) {
+        // A SYN opens the connection, or reopens a finished one with fresh sequence numbers
+        if (flow.state == TcpState::None || flow.state == TcpState::Closed || flow.state == TcpState::Reset) {
+            flow.flags = direction == 1 ? FlowState::INITIATOR_REVERSED : 0;
+            flow.syn_ns = info.timestamp_ns;
+            flow.handshake_rtt_ns = 0;
+            enterState(flow, TcpState::SynSent);
+        }
+    } else if ((flags & (TCP_SYN | TCP_ACK)) == (TCP_SYN | TCP_ACK)) {
+        if (flow.state == TcpState::SynSent && direction != initiator) {
+            enterState(flow, TcpState::SynReceived);
+        }
+    } else if (flow.state == TcpState::SynReceived && (flags & TCP_ACK) && direction == initiator) {
+        uint64_t rtt = info.timestamp_ns > flow.syn_ns ? info.timestamp_ns - flow.syn_ns : 0;
+        flow.handshake_rtt_ns = rtt;
+        tcp_stats.handshake_rtt.record(rtt);
+        enterState(flow, TcpState::Established);
+    } else if (flow.state == TcpState::None) {
+        enterState(flow, TcpState::Established);   // Joined mid-stream
+    }
+    
+    if (flags & TCP_FIN) {
+        flow.flags |= FlowState::FIN_SEEN << direction;
+        bool both = (flow.flags & FlowState::FIN_SEEN) && (flow.flags & (FlowState::FIN_SEEN << 1));
+        if (both && flow.state != TcpState::Closed) {
+            enterState(flow, TcpState::Closed);
+        } else if (!both && (flow.state == TcpState::Established || flow.state == TcpState::SynReceived)) {
+            enterState(flow, TcpState::Closing);
+        }
+    }
+    
+    uint32_t length = info.tcp_payload + ((flags & TCP_SYN) ? 1u : 0u) + ((flags & TCP_FIN) ? 1u : 0u);
+    if (length == 0) {
+        return;   // Pure ACKs occupy no sequence space
+    }
+    tcp_stats.data_segments++;
+    uint32_t end = info.tcp_seq + length;
+    uint8_t known = static_cast<uint8_t>(FlowState::SEQUENCE_KNOWN << direction);
+    if (!(flow.flags & known)) {
+        flow.flags |= known;
+        flow.next_seq[direction] = end;
+    } else if (static_cast<int32_t>(end - flow.next_seq[direction]) <= 0) {
+        flow.retransmissions++;
+        tcp_stats.retransmissions++;
+    } else {
+        flow.next_seq[direction] = end;
+    }
+}
+
+/**
+ * @brief Builds the snapshot record of a heavy connection
+ * @param key Connection key
+ * @param counters Counters reported to the top-K tracker
+ * @return Record with rates and TCP details
+ */
+FlowRecord StatsShard::makeRecord(const ConnectionInfo& key, const FlowCounters& counters) {
+    FlowRecord record;
+    record.connection = key;
+    record.counters = counters;
+    record.rates = flow_rates.rates(key);
+    const FlowState* flow = connections.find(key);
+    record.interval = IntervalCounters().at(interval);
+    if (flow != nullptr) {
+        record.interval = flow->interval.at(interval);
+        record.tcp_state = flow->state;
+        record.app = flow->app;
+        record.app_confirmed = (flow->flags & FlowState::APP_CONFIRMED) != 0;
+        record.reversed = flow->reversed();
+        record.retransmissions = flow->retransmissions;
+        record.handshake_rtt_ns = flow->handshake_rtt_ns;
+    }
+    return record;
+}
+
+/**
+ * @brief Fills a snapshot list with the heaviest prefixes of both tries
+ * 
+ * A bounded min-heap keeps the TOP_TALKERS heaviest prefixes while the tries
+ * are walked, so publishing costs one pass over the trie nodes and no
+ * allocation once the lists have grown to size.
+ * 
+ * @param out Destination list, sorted by bytes descending
+ * @param ipv4_length IPv4 prefix length (32 for hosts)
+ * @param ipv6_length IPv6 prefix length (128 for hosts)
+ */
+void StatsShard::collectTalkers(std::vector<TalkerRecord>& out, uint8_t ipv4_length, uint8_t ipv6_length) {
+    auto heavier = [](const TalkerRecord& a, const TalkerRecord& b) { return a.counters.bytes > b.counters.bytes; };
+    talker_scratch.clear();
+    auto offer = [&](uint8_t ip_version, const PrefixTrie::Prefix& prefix) {
+        if (talker_scratch.size() == TOP_TALKERS) {
+            if (prefix.bytes <= talker_scratch.front().counters.bytes) {
+                return;
+            }
+            std::pop_heap(talker_scratch.begin(), talker_scratch.end(), heavier);
+            talker_scratch.pop_back();
+        }
+        TalkerRecord record;
+        std::memcpy(record.address, prefix.address, sizeof(record.address));
+        record.ip_version = ip_version;
+        record.prefix_length = prefix.length;
+        record.counters.packets = prefix.packets;
+        record.counters.bytes = prefix.bytes;
+        record.interval = prefix.interval;
+        talker_scratch.push_back(record);
+        std::push_heap(talker_scratch.begin(), talker_scratch.end(), heavier);
+    };
+    hosts_v4.forEachPrefix(ipv4_length, interval, [&](const PrefixTrie::Prefix& prefix) { offer(4, prefix); });
+    hosts_v6.forEachPrefix(ipv6_length, interval, [&](const PrefixTrie::Prefix& prefix) { offer(6, prefix); });
+    
+    std::sort_heap(talker_scratch.begin(), talker_scratch.end(), heavier);
+    out.assign(talker_scratch.begin(), talker_scratch.end());
+}
+
+std::atomic<uint32_t> StatsShard::interval_clock(0);
+
+/**
+ * @brief Starts a new history interval in every shard
+ * @return Number of the interval now in progress
+ */
+uint32_t StatsShard::startInterval() {
+    return interval_clock.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief Gets the history interval in progress
+ * @return Number of the latest interval started
+ */
+uint32_t StatsShard::currentInterval() {
+    return interval_clock.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Asks the writer to publish a fresh snapshot
+ */
+void StatsShard::requestSnapshot() {
+    requested_epoch.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Copies the current state into the triple buffer and publishes it
+ */
+void StatsShard::publish() {
+    published_epoch = requested_epoch.load(std::memory_order_relaxed);
+    ShardSnapshot& snapshot = snapshots.writeBuffer();
+    snapshot.counters = counters;
+    
+    // Everything accounted so far belongs to this interval or an earlier one
+    enterInterval();
+    snapshot.interval = interval;
+    snapshot.interval_start = interval_start;
+    
+    // While no packets arrive the packet clock is extrapolated, so rates fall to zero;
+    // this is the only clock read, once per snapshot
+    if (last_packet_ns != 0) {
+        uint64_t now_ns = monotonicNs();
+        uint64_t idle_ns = now_ns > last_batch_ns ? now_ns - last_batch_ns : 0;
+        uint64_t now_second = (last_packet_ns + idle_ns) / 1000000000ULL;
+        rates.advance(now_second);
+        rate_clock_ns = last_packet_ns + idle_ns;
+    }
+    snapshot.rates = rates;
+    
+    // Only the top-K lists are copied, so publishing is O(K) however many flows exist
+    top_packets.sorted(top_packets_scratch);
+    top_bytes.sorted(top_bytes_scratch);
+    rate_keys_scratch.clear();
+    for (const auto& entry : top_packets_scratch) {
+        rate_keys_scratch.push_back(entry.key);
+    }
+    for (const auto& entry : top_bytes_scratch) {
+        rate_keys_scratch.push_back(entry.key);
+    }
+    flow_rates.track(rate_keys_scratch);
+    flow_rates.sample(rate_clock_ns, [this](const ConnectionInfo& key, RateBucket& totals) {
+        const FlowState* flow = connections.find(key);
+        if (flow == nullptr) {
+            return false;
+        }
+        totals.packets = flow->counters.packets;
+        totals.bytes = flow->counters.bytes;
+        return true;
+    });
+    
+    snapshot.top_by_packets.clear();
+    for (const auto& entry : top_packets_scratch) {
+        snapshot.top_by_packets.push_back(makeRecord(entry.key, entry.value));
+    }
+    snapshot.top_by_bytes.clear();
+    for (const auto& entry : top_bytes_scratch) {
+        snapshot.top_by_bytes.push_back(makeRecord(entry.key, entry.value));
+    }
+    snapshot.active_flows = connections.size();
+    snapshot.evicted_flows = connections.evicted();
+    snapshot.flow_slots.used = connections.size();
+    snapshot.flow_slots.capacity = connections.maxFlows();
+    snapshot.flow_slots.peak = connections.peak();
+    snapshot.flow_slots.recycled = connections.evicted();
+    snapshot.flow_slots.bytes = connections.memoryBytes();
+    
+    // Talker lists walk the tries, so they cost O(tracked hosts) per publication
+    collectTalkers(snapshot.top_hosts, 32, 128);
+    collectTalkers(snapshot.top_subnets, talkers.ipv4_prefix, talkers.ipv6_prefix);
+    snapshot.host_slots.used = hosts_v4.hosts() + hosts_v6.hosts();
+    snapshot.host_slots.capacity = hosts_v4.maxHosts() + hosts_v6.maxHosts();
+    snapshot.host_slots.peak = snapshot.host_slots.used;   // Hosts are never released
+    snapshot.host_slots.refused = hosts_v4.untracked() + hosts_v6.untracked();
+    snapshot.host_slots.bytes = hosts_v4.memoryBytes() + hosts_v6.memoryBytes();
+    snapshot.tcp = tcp_stats;
+    snapshot.sketches = sketches;   // Same shapes every time, so the copy reuses the snapshot's storage
+    snapshot.health = pipeline_health;
+    snapshots.publish();
+}
+
+/**
+ * @brief Gets the most recently published snapshot
+ * @return Latest snapshot, possibly from an earlier epoch
+ */
+const ShardSnapshot& StatsShard::latest() {
+    snapshots.update();
+    return snapshots.readBuffer();
+}
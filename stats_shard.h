@@ -0,0 +1,451 @@
+/**
+ * @file stats_shard.h
+ * @brief Per-thread traffic statistics shard
+ * 
+ * This header defines the StatsShard class. Each capture thread owns one
+ * shard and is its only writer; the dashboard thread reads published
+ * snapshots of every shard and merges them for display.
+ */
+
+#ifndef STATS_SHARD_H
+#define STATS_SHARD_H
+
+#include <array>
+#include <vector>
+#include <atomic>
+#include <cstring>
+#include "network_monitor.h"
+#include "triple_buffer.h"
+#include "flow_table.h"
+#include "top_k.h"
+#include "health_metrics.h"
+#include "rate_window.h"
+#include "prefix_trie.h"
+#include "sketch.h"
+#include "flow_state.h"
+
+/**
+ * @struct ConnectionInfo
+ * @brief Binary key identifying a network connection (5-tuple)
+ * 
+ * Fields are laid out without padding so keys can be compared bytewise;
+ * addresses are only formatted when a connection is displayed. Table keys
+ * hold the endpoints in canonical order (see StatsShard), so both
+ * directions of a connection map to the same key.
+ */
+struct ConnectionInfo {
+    uint8_t source_addr[16];
+    uint8_t dest_addr[16];
+    uint16_t source_port;
+    uint16_t dest_port;
+    Protocol protocol;
+    uint8_t ip_version;
+    
+    bool operator<(const ConnectionInfo& other) const {
+        return std::memcmp(this, &other, sizeof(ConnectionInfo)) < 0;
+    }
+};
+
+/**
+ * @brief Builds the table key of a packet's connection
+ * 
+ * The lower endpoint goes first, so both directions of a connection share
+ * one key.
+ * 
+ * @param info Packet record
+ * @param direction Receives 0 if the packet came from the key's source endpoint, 1 otherwise
+ * @return Canonical connection key
+ */
+inline ConnectionInfo canonicalConnection(const PacketInfo& info, unsigned int& direction) {
+    int order = std::memcmp(info.source_addr, info.dest_addr, sizeof(info.source_addr));
+    direction = (order > 0 || (order == 0 && info.source_port > info.dest_port)) ? 1 : 0;
+    ConnectionInfo conn;
+    if (direction == 0) {
+        std::memcpy(conn.source_addr, info.source_addr, sizeof(conn.source_addr));
+        std::memcpy(conn.dest_addr, info.dest_addr, sizeof(conn.dest_addr));
+        conn.source_port = info.source_port;
+        conn.dest_port = info.dest_port;
+    } else {
+        std::memcpy(conn.source_addr, info.dest_addr, sizeof(conn.source_addr));
+        std::memcpy(conn.dest_addr, info.source_addr, sizeof(conn.dest_addr));
+        conn.source_port = info.dest_port;
+        conn.dest_port = info.source_port;
+    }
+    conn.protocol = info.protocol;
+    conn.ip_version = info.ip_version;
+    return conn;
+}
+
+/**
+ * @struct FlowRecord
+ * @brief A connection and its counters, as copied into snapshots
+ */
+struct FlowRecord {
+    ConnectionInfo connection;                    ///< Canonical key
+    FlowCounters counters;                        ///< Both directions
+    IntervalCounters interval;                    ///< Both directions, during the snapshot's history interval
+    std::array<Rate, RATE_WINDOW_COUNT> rates{};  ///< Rates over RATE_WINDOWS (heaviest flows only)
+    TcpState tcp_state = TcpState::None;
+    AppProtocol app = AppProtocol::Unknown;       ///< Application of the connection
+    bool app_confirmed = false;                   ///< app came from a payload signature, not a port guess
+    bool reversed = false;                        ///< The key's destination endpoint initiated the connection
+    uint32_t retransmissions = 0;
+    uint64_t handshake_rtt_ns = 0;                ///< 0 if the handshake was not observed
+    
+    /**
+     * @brief Gets the connection with the initiator as source
+     * @return Connection in the direction it was opened
+     */
+    ConnectionInfo oriented() const {
+        if (!reversed) {
+            return connection;
+        }
+        ConnectionInfo result = connection;
+        std::memcpy(result.source_addr, connection.dest_addr, sizeof(result.source_addr));
+        std::memcpy(result.dest_addr, connection.source_addr, sizeof(result.dest_addr));
+        result.source_port = connection.dest_port;
+        result.dest_port = connection.source_port;
+        return result;
+    }
+};
+
+/**
+ * @struct TalkerRecord
+ * @brief A host or subnet and its traffic, as copied into snapshots
+ * 
+ * Host traffic counts packets both sent and received by the address.
+ */
+struct TalkerRecord {
+    uint8_t address[16];       ///< Network byte order, bits past prefix_length are zero
+    uint8_t ip_version;
+    uint8_t prefix_length;     ///< 32 or 128 for a host
+    FlowCounters counters;
+    IntervalCounters interval; ///< Traffic during the snapshot's history interval
+};
+
+/// Flow table type used by statistics shards
+using ConnectionTable = FlowTable<ConnectionInfo, FlowState>;
+/// Heaviest connections by packet count
+using TopByPackets = TopK<ConnectionInfo, FlowCounters, &FlowCounters::packets>;
+/// Heaviest connections by byte count
+using TopByBytes = TopK<ConnectionInfo, FlowCounters, &FlowCounters::bytes>;
+
+/// Number of heaviest connections each shard tracks per metric
+constexpr size_t TOP_CONNECTIONS = 32;
+/// Number of heaviest hosts and subnets each shard reports
+constexpr size_t TOP_TALKERS = 16;
+
+/// Per-second traffic rates: the total, then one channel per protocol, then one per interface
+using TrafficRates = RateHistory<1 + PROTOCOL_COUNT + MAX_INTERFACES>;
+/// Rate channel counting every packet
+constexpr size_t RATE_CHANNEL_TOTAL = 0;
+
+/**
+ * @brief Gets the rate channel of a protocol
+ * @param protocol Protocol index
+ * @return Channel index in TrafficRates
+ */
+constexpr size_t protocolRateChannel(size_t protocol) { return 1 + protocol; }
+
+/**
+ * @brief Gets the rate channel of an interface
+ * @param interface_index Interface registry index
+ * @return Channel index in TrafficRates
+ */
+constexpr size_t interfaceRateChannel(size_t interface_index) { return 1 + PROTOCOL_COUNT + interface_index; }
+
+/**
+ * @struct StatsCounters
+ * @brief Plain cumulative traffic counters
+ */
+struct StatsCounters {
+    size_t total_packets = 0;
+    size_t total_bytes = 0;
+    std::array<size_t, PROTOCOL_COUNT> protocol_counts{};
+    std::array<size_t, PROTOCOL_COUNT> protocol_bytes{};
+    std::array<size_t, MAX_INTERFACES> interface_counts{};  ///< Packet count per interface index
+    std::array<size_t, MAX_INTERFACES> interface_bytes{};   ///< Byte count per interface index
+    std::array<size_t, APP_PROTOCOL_COUNT> app_counts{};    ///< Packet count per application
+    std::array<size_t, APP_PROTOCOL_COUNT> app_bytes{};     ///< Byte count per application
+    
+    /**
+     * @brief Adds another set of counters to this one
+     * @param other Counters to add
+     */
+    void merge(const StatsCounters& other);
+};
+
+/**
+ * @struct TrafficSketches
+ * @brief Fixed-size sketches of the address and port mix
+ * 
+ * Answer questions exact tables cannot afford over millions of keys: how
+ * many distinct sources a destination sees (DDoS fan-in), how many
+ * destination ports a source touches (scans) and roughly how much a source
+ * sent. Shards merge by combining their sketches. A disabled set uses the
+ * smallest shapes, so copying it into snapshots costs next to nothing.
+ */
+struct TrafficSketches {
+    HyperLogLog sources;                   ///< Distinct source addresses
+    HyperLogLog destinations;              ///< Distinct destination addresses
+    HyperLogLog flows;                     ///< Distinct 5-tuples
+    SpreadSketch sources_per_destination;  ///< Fan-in per destination address
+    SpreadSketch ports_per_source;         ///< Destination ports per source address
+    CountMinSketch bytes_per_source;       ///< Bytes sent per source address
+    
+    /**
+     * @brief Constructor
+     * @param enabled Whether to allocate the full-size sketches (about 560 KiB)
+     */
+    explicit TrafficSketches(bool enabled = false);
+    
+    /**
+     * @brief Adds a packet to every sketch
+     * @param info Packet record (IPv4 or IPv6)
+     * @param connection The packet's 5-tuple
+     */
+    void add(const PacketInfo& info, const ConnectionInfo& connection);
+    
+    /**
+     * @brief Adds another set of sketches of the same shapes
+     * @param other Sketches to merge
+     */
+    void merge(const TrafficSketches& other);
+    
+    /** @brief Forgets everything added */
+    void clear();
+    
+    /** @brief Bytes of sketch storage */
+    size_t memoryBytes() const;
+    
+    /**
+     * @brief Hashes an address as a sketch key
+     * @param address Address in network byte order
+     * @param ip_version 4 or 6
+     * @return 64-bit hash
+     */
+    static uint64_t addressHash(const uint8_t* address, uint8_t ip_version) {
+        return hashKeyBytes(address, ip_version == 6 ? 16 : 4);
+    }
+};
+
+/**
+ * @struct ShardSnapshot
+ * @brief Consistent copy of a shard's statistics at publication time
+ */
+struct ShardSnapshot {
+    StatsCounters counters;
+    std::vector<FlowRecord> top_by_packets;  ///< Heaviest flows by packets, descending
+    std::vector<FlowRecord> top_by_bytes;    ///< Heaviest flows by bytes, descending
+    std::vector<TalkerRecord> top_hosts;     ///< Heaviest hosts by bytes, descending
+    std::vector<TalkerRecord> top_subnets;   ///< Heaviest subnets by bytes, descending
+    size_t active_flows = 0;                 ///< Live flows in the shard's table
+    size_t evicted_flows = 0;                ///< Flows removed from the shard's table so far
+    PoolUsage flow_slots;                    ///< Occupancy of the connection table
+    PoolUsage host_slots;                    ///< Occupancy of both per-host tables
+    TrafficSketches sketches;                ///< Copy of the shard's sketches (tiny when disabled)
+    TcpStats tcp;                            ///< Handshake, close and retransmission totals
+    PipelineHealth health;                   ///< Capture and processing health of the owning thread
+    TrafficRates rates;                      ///< Per-second total, protocol and interface counters
+    uint32_t interval = 0;                   ///< History interval in progress; earlier ones are complete here
+    StatsCounters interval_start;            ///< Counters when the shard entered interval
+};
+
+/**
+ * @class StatsShard
+ * @brief Single-writer statistics shard with epoch-based snapshot publication
+ * 
+ * The owning capture thread updates private counters with plain stores. The
+ * dashboard thread asks for a snapshot by bumping an epoch counter; the
+ * writer notices on its next packet and copies its state into a triple
+ * buffer. Neither side ever takes a lock or waits for the other.
+ */
+class StatsShard {
+public:
+    /**
+     * @brief Constructor - initializes an empty shard
+     * @param flow_config Flow table sizing and eviction settings
+     * @param talker_config Host table sizing and reported subnet lengths
+     */
+    explicit StatsShard(const FlowTableConfig& flow_config = FlowTableConfig(),
+                        const TalkerConfig& talker_config = TalkerConfig());
+    
+    /**
+     * @brief Accounts a packet in this shard (owning thread only)
+     * @param info Packet record
+     * @param now_ns Monotonic time the packet was processed (monotonicNs())
+     */
+    void updatePacket(const PacketInfo& info, uint64_t now_ns);
+    
+    /**
+     * @brief Accounts a batch of packets in this shard (owning thread only)
+     * @param infos Packet records
+     * @param count Number of records
+     * @param now_ns Monotonic time the batch was processed (monotonicNs())
+     * @param frames Captured frames of the records, for payload signatures (null = use PacketInfo::payload_app)
+     */
+    void updateBatch(const PacketInfo* infos, size_t count, uint64_t now_ns,
+                     const uint8_t* const* frames = nullptr);
+    
+    /**
+     * @brief Publishes a snapshot if one was requested (owning thread only)
+     */
+    void poll() {
+        if (requested_epoch.load(std::memory_order_relaxed) != published_epoch) {
+            publish();
+        }
+    }
+    
+    /**
+     * @brief Asks the writer to publish a fresh snapshot (reader only)
+     */
+    void requestSnapshot();
+    
+    /**
+     * @brief Publishes a snapshot immediately
+     * 
+     * Only safe from the owning thread, or from any thread once the owning
+     * thread has stopped updating the shard.
+     */
+    void publish();
+    
+    /**
+     * @brief Gets the health counters published with every snapshot (owning thread only)
+     * @return Writer-private health counters
+     */
+    PipelineHealth& health() { return pipeline_health; }
+    
+    /**
+     * @brief Gets the most recently published snapshot (reader only)
+     * @return Latest snapshot, possibly from an earlier epoch
+     */
+    const ShardSnapshot& latest();
+    
+    /**
+     * @brief Starts a new history interval in every shard (any thread)
+     * 
+     * Each shard moves to the new interval with its next batch or snapshot,
+     * whichever comes first, and its flow and host entries move their
+     * interval counters on with their next packet.
+     * 
+     * @return Number of the interval now in progress
+     */
+    static uint32_t startInterval();
+    
+    /**
+     * @brief Gets the history interval in progress (any thread)
+     * @return Number of the latest interval started
+     */
+    static uint32_t currentInterval();
+
+private:
+    /// Accounting loop compiled for one set of optional features
+    using AccountLoop = void (StatsShard::*)(const PacketInfo* infos, const uint8_t* const* frames, size_t count);
+    
+    /**
+     * @brief Picks the accounting loop for the shard's configuration
+     * @param talker_config Host table and sketch settings
+     * @return Instantiation of accountBatch() with exactly the enabled features
+     */
+    static AccountLoop selectAccountLoop(const TalkerConfig& talker_config);
+    
+    /**
+     * @brief Adds a batch of packets to the writer-private state
+     * @tparam TrackHosts Per-host and per-subnet tables are enabled
+     * @tparam Sketches Traffic sketches are enabled
+     * @param infos Packet records
+     * @param frames Captured frames of the records, or null
+     * @param count Number of records
+     */
+    template <bool TrackHosts, bool Sketches>
+    void accountBatch(const PacketInfo* infos, const uint8_t* const* frames, size_t count);
+    
+    /**
+     * @brief Adds one packet to the writer-private state
+     * @tparam TrackHosts Per-host and per-subnet tables are enabled
+     * @tparam Sketches Traffic sketches are enabled
+     * @param info Packet record
+     * @param frame Captured frame of the record, or null
+     */
+    template <bool TrackHosts, bool Sketches>
+    void account(const PacketInfo& info, const uint8_t* frame);
+    
+    /**
+     * @brief Advances a connection's TCP state and sequence tracking
+     * @param flow Connection state
+     * @param info TCP packet record
+     * @param direction 0 if the packet came from the key's source endpoint, 1 otherwise
+     */
+    void trackTcp(FlowState& flow, const PacketInfo& info, unsigned int direction);
+    
+    /**
+     * @brief Moves a connection to a new TCP state and counts the transition
+     * @param flow Connection state
+     * @param state New state
+     */
+    void enterState(FlowState& flow, TcpState state) {
+        flow.state = state;
+        tcp_stats.transitions[static_cast<size_t>(state)]++;
+    }
+    
+    /**
+     * @brief Moves to the history interval in progress if a new one was started
+     */
+    void enterInterval() {
+        uint32_t now = interval_clock.load(std::memory_order_relaxed);
+        if (now != interval) {
+            interval = now;
+            interval_start = counters;
+        }
+    }
+    
+    /**
+     * @brief Builds the snapshot record of a heavy connection
+     * @param key Connection key
+     * @param counters Counters reported to the top-K tracker
+     * @return Record with rates and TCP details
+     */
+    FlowRecord makeRecord(const ConnectionInfo& key, const FlowCounters& counters);
+    
+    /**
+     * @brief Fills a snapshot list with the heaviest prefixes of both tries
+     * @param out Destination list, sorted by bytes descending
+     * @param ipv4_length IPv4 prefix length (32 for hosts)
+     * @param ipv6_length IPv6 prefix length (128 for hosts)
+     */
+    void collectTalkers(std::vector<TalkerRecord>& out, uint8_t ipv4_length, uint8_t ipv6_length);
+    
+    // Writer-private state
+    StatsCounters counters;
+    ConnectionTable connections;
+    TopByPackets top_packets;
+    TopByBytes top_bytes;
+    std::vector<TopByPackets::Entry> top_packets_scratch;
+    std::vector<TopByBytes::Entry> top_bytes_scratch;
+    TrafficRates rates;
+    KeyedRates<ConnectionInfo> flow_rates;            ///< Rates of the current heaviest flows
+    std::vector<ConnectionInfo> rate_keys_scratch;
+    TalkerConfig talkers;
+    AccountLoop account_loop;                        ///< Chosen once from talkers
+    PrefixTrie hosts_v4;                             ///< Per-host and per-subnet IPv4 traffic
+    PrefixTrie hosts_v6;                             ///< Per-host and per-subnet IPv6 traffic
+    std::vector<TalkerRecord> talker_scratch;        ///< Bounded heap used while publishing
+    TrafficSketches sketches;
+    TcpStats tcp_stats;
+    uint64_t last_packet_ns;                         ///< Newest packet timestamp accounted
+    uint64_t rate_clock_ns;                          ///< Packet clock at the last publication
+    uint64_t last_batch_ns;                          ///< Monotonic time of the newest batch, for idle extrapolation
+    PipelineHealth pipeline_health;
+    uint64_t published_epoch;
+    uint32_t interval;                               ///< History interval of the packets being accounted
+    StatsCounters interval_start;                    ///< Counters when interval was entered
+    
+    // Shared with every thread
+    static std::atomic<uint32_t> interval_clock;     ///< Interval in progress, advanced by startInterval()
+    
+    // Shared with the reader
+    std::atomic<uint64_t> requested_epoch;
+    TripleBuffer<ShardSnapshot> snapshots;
+};
+
+#endif // STATS_SHARD_H
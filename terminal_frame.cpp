@@ -0,0 +1,313 @@
+/**
+ * @file terminal_frame.cpp
+ * @brief Implementation of the diff-based terminal frame renderer
+ * 
+ * This file contains the frame text buffer, the layout of frame text on the
+ * cell grid and the generation of minimal cursor-addressed updates.
+ */
+
+#include "terminal_frame.h"
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/ioctl.h>
+#endif
+
+namespace {
+const char RESET_SEQUENCE[] = "\033[0m";
+const char CLEAR_SEQUENCE[] = "\033[2J\033[1;1H";
+/// Unchanged cells rewritten instead of being skipped with a cursor move (about 8 bytes)
+constexpr int MAX_GAP = 4;
+constexpr uint32_t BLANK_GLYPH = ' ';
+}
+
+/**
+ * @brief Appends one character to the frame text
+ * @param ch Character
+ * @return The character, or a non-EOF value for EOF
+ */
+TerminalFrame::TextBuffer::int_type TerminalFrame::TextBuffer::overflow(int_type ch) {
+    if (traits_type::eq_int_type(ch, traits_type::eof())) {
+        return traits_type::not_eof(ch);
+    }
+    text.push_back(traits_type::to_char_type(ch));
+    return ch;
+}
+
+/**
+ * @brief Appends a run of characters to the frame text
+ * @param s Characters
+ * @param count Number of characters
+ * @return count
+ */
+std::streamsize TerminalFrame::TextBuffer::xsputn(const char* s, std::streamsize count) {
+    text.append(s, static_cast<size_t>(count));
+    return count;
+}
+
+/**
+ * @brief Constructor - preallocates the frame and output buffers
+ */
+TerminalFrame::TerminalFrame()
+    : text_stream(&buffer), rows(0), columns(0), full_redraw(true) {
+    buffer.text.reserve(16384);
+    output.reserve(16384);
+    styles.emplace_back();  // Style 0: default attributes
+}
+
+/**
+ * @brief Starts a new frame
+ * @return Stream the frame text is written to
+ */
+std::ostream& TerminalFrame::stream() {
+    buffer.text.clear();
+    return text_stream;
+}
+
+/**
+ * @brief Queries the terminal size of stdout
+ * @param height Receives the number of rows
+ * @param width Receives the number of columns
+ * @return false if stdout is not a terminal
+ */
+bool TerminalFrame::terminalSize(int& height, int& width) {
+#ifndef _WIN32
+    struct winsize size;
+    if (!isatty(STDOUT_FILENO) || ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) != 0 ||
+        size.ws_row < 2 || size.ws_col == 0) {
+        return false;
+    }
+    height = size.ws_row;
+    width = size.ws_col;
+    return true;
+#else
+    (void)height;
+    (void)width;
+    return false;
+#endif
+}
+
+/**
+ * @brief Gets the index of an SGR sequence, adding it if new
+ * @param sequence Complete escape sequence
+ * @return Style index
+ */
+uint16_t TerminalFrame::internStyle(const std::string& sequence) {
+    for (size_t i = 1; i < styles.size(); i++) {
+        if (styles[i] == sequence) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+    if (styles.size() >= UINT16_MAX) {
+        return 0;
+    }
+    styles.push_back(sequence);
+    return static_cast<uint16_t>(styles.size() - 1);
+}
+
+/**
+ * @brief Lays the frame text out on the cell grid
+ * 
+ * Any SGR sequence other than a reset replaces the current style; the
+ * dashboard only sets foreground colors. Other control sequences are dropped.
+ * 
+ * @return Number of rows the frame occupies (clipped to the grid)
+ */
+int TerminalFrame::layout() {
+    const std::string& text = buffer.text;
+    const int grid_rows = rows - 1;
+    std::string sequence;
+    int row = 0;
+    int column = 0;
+    uint16_t style = 0;
+    size_t i = 0;
+    
+    while (i < text.size() && row < grid_rows) {
+        unsigned char ch = static_cast<unsigned char>(text[i]);
+        if (ch == '\n') {
+            row++;
+            column = 0;
+            i++;
+            continue;
+        }
+        if (ch == '\033') {
+            // CSI sequence: ESC [ parameters final-byte
+            size_t end = i + 1;
+            if (end < text.size() && text[end] == '[') {
+                end++;
+                while (end < text.size() && (text[end] < 0x40 || text[end] > 0x7E)) {
+                    end++;
+                }
+            }
+            if (end >= text.size()) {
+                break;
+            }
+            if (text[end] == 'm') {
+                sequence.assign(text, i, end - i + 1);
+                style = (sequence == RESET_SEQUENCE || sequence == "\033[m") ? 0 : internStyle(sequence);
+            }
+            i = end + 1;
+            continue;
+        }
+        if (ch < 0x20) {
+            i++;
+            continue;
+        }
+        
+        size_t length = ch < 0x80 ? 1 : ch < 0xE0 ? 2 : ch < 0xF0 ? 3 : 4;
+        if (i + length > text.size()) {
+            break;
+        }
+        uint32_t glyph = 0;
+        for (size_t k = 0; k < length; k++) {
+            glyph |= static_cast<uint32_t>(static_cast<unsigned char>(text[i + k])) << (8 * k);
+        }
+        if (column < columns) {
+            cells[static_cast<size_t>(row) * columns + column] = Cell{glyph, style};
+        }
+        column++;
+        i += length;
+    }
+    
+    int used = row + (column > 0 ? 1 : 0);
+    return used < grid_rows ? used : grid_rows;
+}
+
+/**
+ * @brief Appends the escape sequences that switch to a style
+ * @param style Style index
+ */
+void TerminalFrame::appendStyle(uint16_t style) {
+    output.append(RESET_SEQUENCE);
+    if (style != 0) {
+        output.append(styles[style]);
+    }
+}
+
+/**
+ * @brief Appends the UTF-8 bytes of a cell's character
+ * @param cell Cell to draw
+ */
+void TerminalFrame::appendGlyph(const Cell& cell) {
+    for (uint32_t glyph = cell.glyph; glyph != 0; glyph >>= 8) {
+        output.push_back(static_cast<char>(glyph & 0xFF));
+    }
+}
+
+/**
+ * @brief Appends a cursor move to a 0-based screen position
+ * @param row Row
+ * @param column Column
+ */
+void TerminalFrame::appendCursor(int row, int column) {
+    char move[32];
+    int length = std::snprintf(move, sizeof(move), "\033[%d;%dH", row + 1, column + 1);
+    output.append(move, static_cast<size_t>(length));
+}
+
+/**
+ * @brief Writes the differences to the previous frame to stdout
+ * 
+ * A full repaint happens on the first frame, after invalidate() and when
+ * the terminal is resized; it starts from a cleared screen, so only cells
+ * that are not blank are drawn.
+ */
+void TerminalFrame::present() {
+    // Anything still buffered in std::cout belongs before this frame
+    std::cout.flush();
+    std::fflush(stdout);
+    output.clear();
+    
+    int height = 0;
+    int width = 0;
+    if (!terminalSize(height, width)) {
+        output.append(CLEAR_SEQUENCE);
+        output.append(buffer.text);
+        rows = 0;
+        columns = 0;
+        full_redraw = true;
+        flush();
+        return;
+    }
+    
+    if (height != rows || width != columns) {
+        rows = height;
+        columns = width;
+        full_redraw = true;
+    }
+    const size_t grid_size = static_cast<size_t>(rows - 1) * columns;
+    const Cell blank{BLANK_GLYPH, 0};
+    cells.assign(grid_size, blank);
+    int used = layout();
+    
+    output.append("\033[?25l");  // Hide the cursor while drawing
+    if (full_redraw) {
+        output.append(CLEAR_SEQUENCE);
+        screen.assign(grid_size, blank);
+    }
+    output.append(RESET_SEQUENCE);
+    
+    uint16_t current_style = 0;
+    for (int row = 0; row < rows - 1; row++) {
+        const size_t base = static_cast<size_t>(row) * columns;
+        int cursor = -1;  // Column the cursor is at on this row, if known
+        for (int column = 0; column < columns; column++) {
+            if (cells[base + column] == screen[base + column]) {
+                continue;
+            }
+            int from = column;
+            if (cursor >= 0 && column - cursor <= MAX_GAP) {
+                from = cursor;  // Continue from the cursor, redrawing a short unchanged gap
+            } else {
+                appendCursor(row, column);
+            }
+            for (int c = from; c <= column; c++) {
+                const Cell& cell = cells[base + c];
+                if (cell.style != current_style) {
+                    appendStyle(cell.style);
+                    current_style = cell.style;
+                }
+                appendGlyph(cell);
+            }
+            cursor = column + 1;
+        }
+    }
+    
+    if (current_style != 0) {
+        output.append(RESET_SEQUENCE);
+    }
+    appendCursor(used, 0);  // Park below the frame so later output does not overwrite it
+    output.append("\033[?25h");
+    
+    screen.swap(cells);
+    full_redraw = false;
+    flush();
+}
+
+/**
+ * @brief Writes the output buffer to stdout
+ */
+void TerminalFrame::flush() {
+#ifndef _WIN32
+    const char* data = output.data();
+    size_t remaining = output.size();
+    while (remaining > 0) {
+        ssize_t written = ::write(STDOUT_FILENO, data, remaining);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        remaining -= static_cast<size_t>(written);
+    }
+#else
+    std::fwrite(output.data(), 1, output.size(), stdout);
+    std::fflush(stdout);
+#endif
+}
@@ -0,0 +1,144 @@
+/**
+ * @file terminal_frame.h
+ * @brief Double-buffered, diff-based terminal frame renderer
+ * 
+ * This header defines the TerminalFrame class, which turns a fully formatted
+ * text frame into the smallest set of terminal updates against the frame
+ * shown before it.
+ */
+
+#ifndef TERMINAL_FRAME_H
+#define TERMINAL_FRAME_H
+
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @class TerminalFrame
+ * @brief Renders text frames by updating only the cells that changed
+ * 
+ * A frame is written through stream() like to std::cout, with '\n' between
+ * rows and SGR color sequences ("\033[...m") inline. present() lays the text
+ * out as a grid of cells sized to the terminal, compares it with the grid on
+ * screen and emits cursor-addressed runs of the changed cells in a single
+ * write(). Rows beyond the terminal height and columns beyond its width are
+ * clipped so nothing scrolls; the cursor is parked below the frame.
+ * 
+ * All buffers keep their capacity between frames, so steady-state rendering
+ * does not allocate. When the output is not a terminal (or on Windows) the
+ * whole frame is written after a clear-screen sequence instead.
+ * 
+ * Not thread-safe; one thread renders.
+ */
+class TerminalFrame {
+public:
+    TerminalFrame();
+    
+    /**
+     * @brief Starts a new frame
+     * @return Stream the frame text is written to
+     */
+    std::ostream& stream();
+    
+    /**
+     * @brief Writes the differences to the previous frame to stdout
+     */
+    void present();
+    
+    /**
+     * @brief Forces the next present() to repaint the whole screen
+     */
+    void invalidate() { full_redraw = true; }
+    
+    /**
+     * @brief Gets the number of bytes the last present() wrote
+     * @return Bytes written to stdout
+     */
+    size_t lastWriteSize() const { return output.size(); }
+
+private:
+    /**
+     * @brief Stream buffer appending to a string that is reused between frames
+     */
+    class TextBuffer : public std::streambuf {
+    public:
+        std::string text;  ///< Frame text written so far
+    
+    protected:
+        int_type overflow(int_type ch) override;
+        std::streamsize xsputn(const char* s, std::streamsize count) override;
+    };
+    
+    /**
+     * @brief One screen position
+     */
+    struct Cell {
+        uint32_t glyph;   ///< UTF-8 bytes of the character, packed low byte first
+        uint16_t style;   ///< Index into styles (0 = default attributes)
+        
+        bool operator==(const Cell& other) const {
+            return glyph == other.glyph && style == other.style;
+        }
+        bool operator!=(const Cell& other) const { return !(*this == other); }
+    };
+    
+    TextBuffer buffer;
+    std::ostream text_stream;
+    std::vector<Cell> cells;             ///< Grid being presented, rows x columns
+    std::vector<Cell> screen;            ///< Grid currently on screen
+    std::vector<std::string> styles;     ///< SGR sequences seen so far, interned
+    std::string output;                  ///< Escape sequences of the last present()
+    int rows;                            ///< Terminal height the grids were laid out for
+    int columns;                         ///< Terminal width the grids were laid out for
+    bool full_redraw;                    ///< Repaint every cell on the next present()
+    
+    /**
+     * @brief Queries the terminal size of stdout
+     * @param height Receives the number of rows
+     * @param width Receives the number of columns
+     * @return false if stdout is not a terminal
+     */
+    static bool terminalSize(int& height, int& width);
+    
+    /**
+     * @brief Lays the frame text out on the cell grid
+     * @return Number of rows the frame occupies (clipped to the grid)
+     */
+    int layout();
+    
+    /**
+     * @brief Gets the index of an SGR sequence, adding it if new
+     * @param sequence Complete escape sequence
+     * @return Style index
+     */
+    uint16_t internStyle(const std::string& sequence);
+    
+    /**
+     * @brief Appends the escape sequences that switch to a style
+     * @param style Style index
+     */
+    void appendStyle(uint16_t style);
+    
+    /**
+     * @brief Appends the UTF-8 bytes of a cell's character
+     * @param cell Cell to draw
+     */
+    void appendGlyph(const Cell& cell);
+    
+    /**
+     * @brief Appends a cursor move to a 0-based screen position
+     * @param row Row
+     * @param column Column
+     */
+    void appendCursor(int row, int column);
+    
+    /**
+     * @brief Writes the output buffer to stdout
+     */
+    void flush();
+};
+
+#endif // TERMINAL_FRAME_H
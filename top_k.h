@@ -0,0 +1,143 @@
+/**
+ * @file top_k.h
+ * @brief Incremental top-K tracker (indexed min-heap)
+ * 
+ * This header defines the TopK template, which keeps the K heaviest keys of
+ * a stream up to date as counts change, so the dashboard can render the
+ * heaviest connections in O(K) regardless of how many flows exist.
+ */
+
+#ifndef TOP_K_H
+#define TOP_K_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+#include "flow_table.h"
+
+/**
+ * @class TopK
+ * @brief Min-heap of the K largest entries with a key-to-position index
+ * 
+ * Callers report the exact current value of a key after every update. A key
+ * already in the heap is re-sifted in place; any other key only enters by
+ * displacing the current minimum, which costs one probe of a small index
+ * table and one comparison in the common case.
+ * 
+ * @tparam Key Trivially copyable key type
+ * @tparam Value Counter structure stored alongside the key
+ * @tparam Metric Member of Value used for ordering
+ */
+template <typename Key, typename Value, uint64_t Value::*Metric>
+class TopK {
+public:
+    /**
+     * @struct Entry
+     * @brief A tracked key with its latest reported value
+     */
+    struct Entry {
+        Key key;
+        Value value;
+    };
+    
+    /**
+     * @brief Constructor
+     * @param k Number of entries to keep
+     */
+    explicit TopK(size_t k = 32)
+        : capacity(k ? k : 1), positions(indexConfig(capacity)) {
+        heap.reserve(capacity);
+    }
+    
+    /**
+     * @brief Reports the current value of a key
+     * @param key Key whose value changed
+     * @param value Latest value for the key
+     */
+    void update(const Key& key, const Value& value) {
+        uint32_t* pos = positions.find(key);
+        if (pos != nullptr) {
+            size_t i = *pos;
+            heap[i].value = value;
+            siftDown(siftUp(i));
+            return;
+        }
+        if (heap.size() < capacity) {
+            heap.push_back(Entry{key, value});
+            positions.findOrInsert(key, 0) = static_cast<uint32_t>(heap.size() - 1);
+            siftUp(heap.size() - 1);
+            return;
+        }
+        if (value.*Metric > heap[0].value.*Metric) {
+            positions.erase(heap[0].key);
+            heap[0] = Entry{key, value};
+            positions.findOrInsert(key, 0) = 0;
+            siftDown(0);
+        }
+    }
+    
+    /**
+     * @brief Copies the tracked entries in descending metric order
+     * @param out Destination vector (cleared first)
+     */
+    void sorted(std::vector<Entry>& out) const {
+        out.assign(heap.begin(), heap.end());
+        std::sort(out.begin(), out.end(),
+                  [](const Entry& a, const Entry& b) { return a.value.*Metric > b.value.*Metric; });
+    }
+    
+    /** @brief Number of tracked entries */
+    size_t size() const { return heap.size(); }
+
+private:
+    size_t capacity;
+    std::vector<Entry> heap;               ///< Min-heap ordered by Metric
+    FlowTable<Key, uint32_t> positions;    ///< Key to heap index
+    
+    static FlowTableConfig indexConfig(size_t k) {
+        FlowTableConfig config;
+        config.max_flows = k;
+        config.idle_timeout_ns = 0;
+        return config;
+    }
+    
+    bool less(size_t a, size_t b) const {
+        return heap[a].value.*Metric < heap[b].value.*Metric;
+    }
+    
+    void swapEntries(size_t a, size_t b) {
+        std::swap(heap[a], heap[b]);
+        *positions.find(heap[a].key) = static_cast<uint32_t>(a);
+        *positions.find(heap[b].key) = static_cast<uint32_t>(b);
+    }
+    
+    size_t siftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!less(i, parent)) {
+                break;
+            }
+            swapEntries(i, parent);
+            i = parent;
+        }
+        return i;
+    }
+    
+    void siftDown(size_t i) {
+        for (;;) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < heap.size() && less(left, smallest)) smallest = left;
+            if (right < heap.size() && less(right, smallest)) smallest = right;
+            if (smallest == i) {
+                break;
+            }
+            swapEntries(i, smallest);
+            i = smallest;
+        }
+    }
+};
+
+#endif // TOP_K_H
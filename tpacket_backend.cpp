@@ -0,0 +1,430 @@
+/**
+ * @file tpacket_backend.cpp
+ * @brief Implementation of the TPACKET_V3 capture backend
+ * 
+ * This file contains the AF_PACKET socket and ring setup and the block
+ * walking loop that delivers packets without copying them.
+ */
+
+#include "tpacket_backend.h"
+
+#ifdef __linux__
+
+#include <cstring>
+#include <iostream>
+#include <cerrno>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
+
+namespace {
+/// Nominal frame size used to derive the block count from the frame count
+constexpr uint32_t NOMINAL_FRAME_SIZE = 2048;
+/// Size of the Linux cooked (DLT_LINUX_SLL) header synthesized for "any"
+constexpr uint32_t SLL_HEADER_LENGTH = 16;
+/// Offset of the sockaddr_ll the kernel stores behind every frame header
+constexpr uint32_t SOCKADDR_OFFSET = TPACKET_ALIGN(sizeof(struct tpacket3_hdr));
+
+std::string errnoMessage(const char* what) {
+    return std::string(what) + ": " + std::strerror(errno);
+}
+
+/**
+ * @brief Writes a Linux cooked (DLT_LINUX_SLL) header from the frame's address
+ * @param header Destination, SLL_HEADER_LENGTH bytes in front of the network header
+ * @param from Link-layer address the kernel recorded for the frame
+ */
+void writeCookedHeader(unsigned char* header, const struct sockaddr_ll& from) {
+    uint16_t fields[3] = {htons(from.sll_pkttype), htons(from.sll_hatype), htons(from.sll_halen)};
+    std::memcpy(header, fields, sizeof(fields));
+    std::memset(header + 6, 0, 8);
+    std::memcpy(header + 6, from.sll_addr, from.sll_halen < 8 ? from.sll_halen : 8);
+    std::memcpy(header + 14, &from.sll_protocol, sizeof(from.sll_protocol));  // Already in network order
+}
+}
+
+/**
+ * @brief Constructor - creates an unopened backend
+ */
+TPacketBackend::TPacketBackend()
+    : fd(-1), ring(nullptr), ring_size(0), block_size(0), block_count(0),
+      current_block(0), timeout_ms(1000), retire_timeout_ms(0), cooked(false), skip_outgoing(false), wake_fd(-1),
+      stopped(false), drained_blocks(0), retire_waited(false), timestamp_source("host") {
+    batch.nanosecond = true;  // Frames carry tp_nsec
+}
+
+/**
+ * @brief Destructor - unmaps the ring and closes the socket
+ */
+TPacketBackend::~TPacketBackend() {
+    close();
+}
+
+/**
+ * @brief Releases the socket and ring
+ */
+void TPacketBackend::close() {
+    if (ring) {
+        munmap(ring, ring_size);
+        ring = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    if (wake_fd >= 0) {
+        ::close(wake_fd);
+        wake_fd = -1;
+    }
+}
+
+/**
+ * @brief Attaches the configured filter to the socket
+ * 
+ * A cooked socket hands the kernel filter the packet from its network
+ * header on, so the expression is compiled for DLT_RAW there; expressions
+ * that test link-layer fields do not compile and open() fails.
+ * 
+ * @param config Capture settings (filter expression and snaplen)
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool TPacketBackend::attachFilter(const CaptureConfig& config, std::string& error) {
+    pcap_t* dead = pcap_open_dead(cooked ? DLT_RAW : DLT_EN10MB, config.snaplen);
+    if (dead == nullptr) {
+        error = "pcap_open_dead failed";
+        return false;
+    }
+    struct bpf_program program;
+    bool ok = compileFilter(dead, config.filter, program, error);
+    pcap_close(dead);
+    if (!ok) {
+        return false;
+    }
+    
+    // libpcap's bpf_insn has the same layout as the kernel's sock_filter
+    struct sock_fprog fprog;
+    fprog.len = static_cast<unsigned short>(program.bf_len);
+    fprog.filter = reinterpret_cast<struct sock_filter*>(program.bf_insns);
+    int result = setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+    pcap_freecode(&program);
+    if (result < 0) {
+        error = errnoMessage("SO_ATTACH_FILTER");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Switches the socket to raw NIC hardware timestamps if requested
+ * @param device Network interface name
+ * @param type Requested time stamp type name
+ */
+void TPacketBackend::setupTimestamps(const std::string& device, const std::string& type) {
+    timestamp_source = "host";
+    if (type.compare(0, 7, "adapter") != 0) {
+        return;  // Host types are what the kernel stamps anyway
+    }
+    if (device == "any") {
+        std::cerr << "Warning: hardware timestamps need a specific device, using host timestamps" << std::endl;
+        return;
+    }
+    
+    struct hwtstamp_config hardware;
+    std::memset(&hardware, 0, sizeof(hardware));
+    hardware.tx_type = HWTSTAMP_TX_OFF;
+    hardware.rx_filter = HWTSTAMP_FILTER_ALL;
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, device.c_str(), IFNAMSIZ - 1);
+    ifr.ifr_data = reinterpret_cast<char*>(&hardware);
+    int request = SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (ioctl(fd, SIOCSHWTSTAMP, &ifr) < 0 ||
+        setsockopt(fd, SOL_PACKET, PACKET_TIMESTAMP, &request, sizeof(request)) < 0) {
+        std::cerr << "Warning on " << device << ": " << errnoMessage("hardware timestamps")
+                  << ", using host timestamps" << std::endl;
+        return;
+    }
+    timestamp_source = type;
+}
+
+/**
+ * @brief Creates the AF_PACKET socket, sets up the TPACKET_V3 ring and binds it
+ * 
+ * A single device gets a SOCK_RAW socket and Ethernet frames. On "any" the
+ * devices have different link layers (Ethernet, tun, ppp, ...), so, as
+ * libpcap does, a SOCK_DGRAM socket is used and dispatch() puts a Linux
+ * cooked header in front of each network-layer packet.
+ * 
+ * @param device Network interface name ("any" captures on all interfaces)
+ * @param config Capture settings (ring geometry, promiscuous mode, timeout)
+ * @param error Receives a description of the failure
+ * @return true on success
+ */
+bool TPacketBackend::open(const std::string& device, const CaptureConfig& config, std::string& error) {
+    unsigned int ifindex = 0;
+    if (device != "any") {
+        ifindex = if_nametoindex(device.c_str());
+        if (ifindex == 0) {
+            error = errnoMessage("unknown interface");
+            return false;
+        }
+    }
+    
+    cooked = ifindex == 0;
+    // Protocol 0: the socket receives nothing until bind() names the protocol and the device
+    fd = socket(AF_PACKET, cooked ? SOCK_DGRAM : SOCK_RAW, 0);
+    if (fd < 0) {
+        error = errnoMessage("socket(AF_PACKET)");
+        return false;
+    }
+    
+    // Filter before the socket is bound so no unfiltered packet is queued
+    if (!attachFilter(config, error)) {
+        close();
+        return false;
+    }
+    
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) < 0) {
+        error = errnoMessage("PACKET_VERSION");
+        close();
+        return false;
+    }
+    
+    setupTimestamps(device, config.timestamp_type);
+    
+    // Derive the ring layout: enough blocks to hold the requested frames
+    long page_size = sysconf(_SC_PAGESIZE);
+    block_size = config.ring_block_size;
+    if (block_size < static_cast<uint32_t>(page_size) || (block_size & (block_size - 1)) != 0) {
+        error = "ring block size must be a power of two and at least one page";
+        close();
+        return false;
+    }
+    uint64_t ring_bytes = static_cast<uint64_t>(config.ring_frame_count) * NOMINAL_FRAME_SIZE;
+    block_count = static_cast<uint32_t>((ring_bytes + block_size - 1) / block_size);
+    if (block_count < 2) {
+        block_count = 2;
+    }
+    
+    struct tpacket_req3 req;
+    std::memset(&req, 0, sizeof(req));
+    req.tp_block_size = block_size;
+    req.tp_block_nr = block_count;
+    req.tp_frame_size = NOMINAL_FRAME_SIZE;
+    req.tp_frame_nr = (block_size / NOMINAL_FRAME_SIZE) * block_count;
+    req.tp_retire_blk_tov = config.ring_block_timeout_ms;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+        error = errnoMessage("PACKET_RX_RING");
+        close();
+        return false;
+    }
+    
+    ring_size = static_cast<size_t>(block_size) * block_count;
+    void* mapped = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        error = errnoMessage("mmap");
+        ring = nullptr;
+        close();
+        return false;
+    }
+    ring = static_cast<unsigned char*>(mapped);
+    
+    struct sockaddr_ll addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = static_cast<int>(ifindex);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        error = errnoMessage("bind");
+        close();
+        return false;
+    }
+    
+    if (config.promiscuous && ifindex != 0) {
+        struct packet_mreq mreq;
+        std::memset(&mreq, 0, sizeof(mreq));
+        mreq.mr_ifindex = static_cast<int>(ifindex);
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+            error = errnoMessage("PACKET_ADD_MEMBERSHIP");
+            close();
+            return false;
+        }
+    }
+    
+    if (config.fanout_group >= 0 && !joinFanoutGroup(fd, config.fanout_group, error)) {
+        close();
+        return false;
+    }
+    
+    // On loopback every packet is seen twice (outgoing and incoming), as libpcap does keep one.
+    // "any" includes loopback, so its frames are checked one by one as well.
+    struct ifreq ifr;
+    std::memset(&ifr, 0, sizeof(ifr));
+    std::strncpy(ifr.ifr_name, device.c_str(), IFNAMSIZ - 1);
+    skip_outgoing = cooked || (ioctl(fd, SIOCGIFHWADDR, &ifr) == 0 && ifr.ifr_hwaddr.sa_family == ARPHRD_LOOPBACK);
+    
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd < 0) {
+        error = errnoMessage("eventfd");
+        close();
+        return false;
+    }
+    
+    timeout_ms = config.timeout_ms;
+    retire_timeout_ms = static_cast<int>(config.ring_block_timeout_ms);
+    current_block = 0;
+    drained_blocks = 0;
+    retire_waited = false;
+    totals = CaptureStats();
+    return true;
+}
+
+/**
+ * @brief Delivers every packet of the next retired block in place
+ * 
+ * Waits up to the read timeout for the kernel to retire a block. All frames
+ * of a block are delivered before it is handed back, so max_packets is only
+ * honoured at block granularity. After breakLoop() the blocks that were
+ * already retired (at most one ring's worth) are still delivered, and the
+ * block being filled is given one retire timeout to be handed over.
+ * 
+ * @param max_packets Ignored beyond block granularity (-1 for no limit)
+ * @param handler Function invoked for every filled batch
+ * @param user Opaque pointer passed to the handler
+ * @return Number of packets delivered, or -1 on error or after breakLoop()
+ */
+int TPacketBackend::dispatch(int max_packets, BatchHandler handler, void* user) {
+    (void)max_packets;
+    auto* block = reinterpret_cast<struct tpacket_block_desc*>(ring + static_cast<size_t>(current_block) * block_size);
+    bool ready = (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+    if (stopped.load(std::memory_order_relaxed)) {
+        if (!ready && !retire_waited) {
+            retire_waited = true;
+            struct pollfd pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN | POLLERR;
+            pfd.revents = 0;
+            poll(&pfd, 1, 2 * retire_timeout_ms);
+            ready = (__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) != 0;
+        }
+        if (!ready || drained_blocks >= block_count) {
+            return -1;
+        }
+        drained_blocks++;
+    } else if (!ready) {
+        struct pollfd pfds[2];
+        pfds[0].fd = fd;
+        pfds[0].events = POLLIN | POLLERR;
+        pfds[0].revents = 0;
+        pfds[1].fd = wake_fd;
+        pfds[1].events = POLLIN;
+        pfds[1].revents = 0;
+        if (poll(pfds, 2, timeout_ms) < 0 && errno != EINTR) {
+            return -1;
+        }
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            return stopped.load(std::memory_order_relaxed) ? -1 : 0;
+        }
+    }
+    
+    uint32_t packets = block->hdr.bh1.num_pkts;
+    auto* frame = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<unsigned char*>(block) +
+                                                        block->hdr.bh1.offset_to_first_pkt);
+    int delivered = 0;
+    batch.count = 0;
+    for (uint32_t i = 0; i < packets; i++) {
+        unsigned char* frame_bytes = reinterpret_cast<unsigned char*>(frame);
+        const auto* from = reinterpret_cast<const struct sockaddr_ll*>(frame_bytes + SOCKADDR_OFFSET);
+        bool skip = skip_outgoing && from->sll_pkttype == PACKET_OUTGOING && from->sll_hatype == ARPHRD_LOOPBACK;
+        unsigned char* data = frame_bytes + frame->tp_mac;
+        uint32_t link_length = 0;
+        if (cooked && !skip) {
+            // The kernel leaves room in front of the network header for exactly this header
+            if (frame->tp_mac < SOCKADDR_OFFSET + sizeof(struct sockaddr_ll) + SLL_HEADER_LENGTH) {
+                skip = true;
+            } else {
+                data -= SLL_HEADER_LENGTH;
+                writeCookedHeader(data, *from);
+                link_length = SLL_HEADER_LENGTH;
+            }
+        }
+        if (!skip) {
+            struct pcap_pkthdr& pkthdr = batch.headers[batch.count];
+            pkthdr.ts.tv_sec = frame->tp_sec;
+            pkthdr.ts.tv_usec = static_cast<decltype(pkthdr.ts.tv_usec)>(frame->tp_nsec);
+            pkthdr.caplen = frame->tp_snaplen + link_length;
+            pkthdr.len = frame->tp_len + link_length;
+            batch.packets[batch.count] = data;
+            if (++batch.count == PacketBatch::CAPACITY) {
+                handler(user, batch);
+                batch.count = 0;
+            }
+            delivered++;
+        }
+        frame = reinterpret_cast<struct tpacket3_hdr*>(reinterpret_cast<unsigned char*>(frame) + frame->tp_next_offset);
+    }
+    if (batch.count > 0) {
+        handler(user, batch);
+        batch.count = 0;
+    }
+    
+    // Hand the block back to the kernel
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    current_block = (current_block + 1) % block_count;
+    return delivered;
+}
+
+/**
+ * @brief Interrupts the capture loop and wakes a pending poll() (async-signal-safe)
+ */
+void TPacketBackend::breakLoop() {
+    stopped.store(true, std::memory_order_relaxed);
+    if (wake_fd >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wake_fd, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+/**
+ * @brief Reads the kernel packet counters via PACKET_STATISTICS
+ * @param stats Receives the counters accumulated since open()
+ * @return true if the socket counters could be read
+ */
+bool TPacketBackend::stats(CaptureStats& stats) {
+    struct tpacket_stats_v3 kernel_stats;
+    socklen_t length = sizeof(kernel_stats);
+    if (fd < 0 || getsockopt(fd, SOL_PACKET, PACKET_STATISTICS, &kernel_stats, &length) < 0) {
+        return false;
+    }
+    // tp_packets already includes tp_drops
+    totals.received += kernel_stats.tp_packets;
+    totals.dropped += kernel_stats.tp_drops;
+    stats = totals;
+    return true;
+}
+
+/**
+ * @brief Gets the link-layer type of captured packets
+ * @return DLT_EN10MB for a single device, DLT_LINUX_SLL for "any"
+ */
+int TPacketBackend::datalink() const {
+    return cooked ? DLT_LINUX_SLL : DLT_EN10MB;
+}
+
+#endif // __linux__
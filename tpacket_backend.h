@@ -0,0 +1,96 @@
+/**
+ * @file tpacket_backend.h
+ * @brief Linux AF_PACKET TPACKET_V3 zero-copy capture backend
+ * 
+ * This header defines the TPacketBackend class, which maps a TPACKET_V3
+ * receive ring shared with the kernel and processes packets in place, one
+ * retired block at a time. It is only available on Linux.
+ */
+
+#ifndef TPACKET_BACKEND_H
+#define TPACKET_BACKEND_H
+
+#ifdef __linux__
+
+#include <cstddef>
+#include <string>
+#include "capture_backend.h"
+
+/**
+ * @class TPacketBackend
+ * @brief Memory-mapped TPACKET_V3 ring reader
+ * 
+ * The kernel fills fixed-size blocks with variable-length frames and hands a
+ * block to user space when it is full or its retire timeout expires. Every
+ * frame in the block is processed straight from the ring, and
+ * the whole block is then returned to the kernel. Frames of a block are
+ * gathered into batches of pointers into the ring, so no packet data is
+ * copied.
+ */
+class TPacketBackend : public CaptureBackend {
+public:
+    TPacketBackend();
+    ~TPacketBackend() override;
+    
+    bool open(const std::string& device, const CaptureConfig& config, std::string& error) override;
+    int dispatch(int max_packets, BatchHandler handler, void* user) override;
+    void breakLoop() override;
+    bool stats(CaptureStats& stats) override;
+    int datalink() const override;
+    const char* name() const override { return "mmap"; }
+    const char* timestampSource() const override { return timestamp_source.c_str(); }
+
+private:
+    int fd;                        ///< AF_PACKET socket
+    unsigned char* ring;           ///< Mapped ring memory
+    size_t ring_size;              ///< Size of the mapping in bytes
+    uint32_t block_size;           ///< Bytes per block
+    uint32_t block_count;          ///< Number of blocks in the ring
+    uint32_t current_block;        ///< Next block to read
+    int timeout_ms;                ///< Poll timeout when no block is ready
+    int retire_timeout_ms;         ///< Kernel block retire timeout
+    bool cooked;                   ///< SOCK_DGRAM socket on "any"; frames get a Linux cooked header
+    bool skip_outgoing;            ///< Drop looped-back copies of sent packets (loopback devices and "any")
+    int wake_fd;                   ///< eventfd written by breakLoop() to end a pending poll()
+    std::atomic<bool> stopped;     ///< Set by breakLoop()
+    uint32_t drained_blocks;       ///< Ready blocks delivered since breakLoop()
+    bool retire_waited;            ///< Waited for the partly filled block after breakLoop()
+    CaptureStats totals;           ///< Counters accumulated from PACKET_STATISTICS (which resets on read)
+    PacketBatch batch;             ///< Pointers into the current block
+    std::string timestamp_source;  ///< Time stamp type in effect
+    
+    /**
+     * @brief Switches the socket to raw NIC hardware timestamps if requested
+     * 
+     * Enables receive timestamping on the device (SIOCSHWTSTAMP, which needs
+     * CAP_NET_ADMIN and driver support) and asks for the raw hardware value
+     * in the ring (PACKET_TIMESTAMP). Failure is not fatal: the kernel's
+     * software timestamps stay in use and a warning is printed.
+     * 
+     * @param device Network interface name
+     * @param type Requested time stamp type name
+     */
+    void setupTimestamps(const std::string& device, const std::string& type);
+    
+    /**
+     * @brief Releases the socket and ring
+     */
+    void close();
+    
+    /**
+     * @brief Attaches the configured filter to the socket
+     * 
+     * A program is always attached: its return value truncates every packet
+     * to the snapshot length inside the kernel, so only headers are copied
+     * into the ring. Cooked sockets are filtered from the network header on.
+     * 
+     * @param config Capture settings (filter expression and snaplen)
+     * @param error Receives a description of the failure
+     * @return true on success
+     */
+    bool attachFilter(const CaptureConfig& config, std::string& error);
+};
+
+#endif // __linux__
+
+#endif // TPACKET_BACKEND_H
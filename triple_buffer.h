@@ -0,0 +1,74 @@
+/**
+ * @file triple_buffer.h
+ * @brief Lock-free single-producer/single-consumer triple buffer
+ * 
+ * This header defines the TripleBuffer template used to hand statistics
+ * snapshots from a capture thread to the dashboard thread without either
+ * side ever blocking on the other.
+ */
+
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TripleBuffer
+ * @brief Wait-free exchange of the latest value between two threads
+ * 
+ * The writer fills writeBuffer() and calls publish(); the reader calls
+ * update() and then reads readBuffer(). Each side owns one of the three
+ * buffers at all times and the third is swapped through a single atomic,
+ * so neither side waits and the reader always sees a complete value.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), back(0), front(2) {}
+    
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+    
+    /**
+     * @brief Gets the buffer owned by the writer
+     * @return Buffer to fill before calling publish()
+     */
+    T& writeBuffer() { return buffers[back]; }
+    
+    /**
+     * @brief Publishes the writer buffer as the latest value (writer only)
+     */
+    void publish() {
+        back = middle.exchange(static_cast<uint8_t>(back | FRESH), std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    
+    /**
+     * @brief Acquires the latest published value if there is one (reader only)
+     * @return true if readBuffer() changed since the last call
+     */
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    
+    /**
+     * @brief Gets the buffer owned by the reader
+     * @return Most recently acquired value
+     */
+    const T& readBuffer() const { return buffers[front]; }
+
+private:
+    static constexpr uint8_t FRESH = 0x4;       ///< Set when middle holds unread data
+    static constexpr uint8_t INDEX_MASK = 0x3;  ///< Buffer index bits
+    
+    T buffers[3];
+    std::atomic<uint8_t> middle;  ///< Index of the exchange buffer plus FRESH flag
+    uint8_t back;                 ///< Writer's buffer index
+    uint8_t front;                ///< Reader's buffer index
+};
+
+#endif // TRIPLE_BUFFER_H